@@ -0,0 +1,37 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#pragma once
+
+#include <cstdint>
+#include <CKPE.Common.Common.h>
+
+namespace CKPE
+{
+	namespace Common
+	{
+		// Sampled allocation-site tracker.
+		// Roughly one allocation per "uAllocationSampleRate" bytes is sampled, the call stack is hashed
+		// and the estimated live size is accumulated per call site. The sites that grew the most
+		// since the previous report are periodically printed to the log window.
+		class CKPE_COMMON_API AllocationTracker
+		{
+			AllocationTracker(const AllocationTracker&) = delete;
+			AllocationTracker& operator=(const AllocationTracker&) = delete;
+		public:
+			constexpr AllocationTracker() noexcept(true) = default;
+
+			static void Initialize() noexcept(true);
+			static void Shutdown() noexcept(true);
+			[[nodiscard]] static bool HasEnabled() noexcept(true);
+
+			static void OnAlloc(void* block, std::size_t size) noexcept(true);
+			static void OnFree(void* block) noexcept(true);
+			// The block has grown or shrunk in place
+			static void OnResize(void* block, std::size_t size) noexcept(true);
+
+			static void Report(std::uint32_t top) noexcept(true);
+		};
+	}
+}
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include <cstdio>
 #include <cstdint>
 #include <string>
+#include <CKPE.PESymbolizer.h>
 #include <CKPE.Common.Common.h>
 
 namespace CKPE
@@ -30,11 +31,23 @@ namespace CKPE
 			TOutputVersionHandler OnOutputVersion{ nullptr };
 			TOutputVersionHandler OnOutputCKVersion{ nullptr };
 
+			enum AnnotationTag : std::uint16_t
+			{
+				atVirtualFunction = 0,
+				atPatch,
+				atKnownFunction,
+			};
+
 			CrashHandler() noexcept(true) = default;
 			virtual ~CrashHandler() noexcept(true) = default;
 
 			void Install() noexcept(true);
 
+			// Table of the loaded modules, the functions of the application are annotated with
+			// the virtual functions of the RTTI classes, the functions known to the relocation database
+			// and the places of the active patches
+			static void BuildModuleTable(PESymbolizer::ModuleTable& Modules) noexcept(true);
+
 			static CrashHandler* GetSingleton() noexcept(true);
 		};
 	}
@@ -0,0 +1,34 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#pragma once
+
+#include <CKPE.Common.Common.h>
+
+namespace CKPE
+{
+	namespace Common
+	{
+		// First part of the crash report, written without the heap: the heap may be broken or locked
+		// by the faulting thread. The faulting thread only copies its context and stack into memory reserved
+		// at startup, the crash handler thread formats them into a reserved buffer and writes it with a file
+		// handle opened at startup. The handle is of a temporary file of the process, removed on exit if there
+		// was no crash and renamed to the report after a crash, so the report of the previous session is kept.
+		class CKPE_COMMON_API CrashReport
+		{
+			CrashReport(const CrashReport&) = delete;
+			CrashReport& operator=(const CrashReport&) = delete;
+		public:
+			constexpr CrashReport() noexcept(true) = default;
+
+			static bool Initialize(const char* fname) noexcept(true);
+			// Called by the faulting thread, only the first call is captured
+			static void Capture(void* ExceptionInfo, void* Tib) noexcept(true);
+			// Called by the crash handler thread
+			static bool Write() noexcept(true);
+			[[nodiscard]] static bool HasWritten() noexcept(true);
+			[[nodiscard]] static bool HasCaptured() noexcept(true);
+		};
+	}
+}
@@ -22,9 +22,6 @@ namespace CKPE
 			ID3D11Device2* m_Device;
 			D3D11DeviceContextProxy* m_ContextProxy;
 
-			float m_MipLODBias;
-			int m_MaxAnisotropy;
-
 			D3D11DeviceProxy(ID3D11Device* Device);
 			D3D11DeviceProxy(ID3D11Device2* Device);
 
@@ -0,0 +1,31 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#pragma once
+
+#include <cstdint>
+#include <CKPE.Common.Common.h>
+
+namespace CKPE
+{
+	namespace Common
+	{
+		// Watchdog of the main message loop.
+		// A message hook of the main thread marks every retrieved message, if there were no messages
+		// for "uHangTimeout" seconds, the stack of the main thread is sampled every "uHangSampleInterval" ms
+		// until it pumps messages again. The samples are summarized in a report in the "Hangs" folder.
+		class CKPE_COMMON_API HangWatchdog
+		{
+			HangWatchdog(const HangWatchdog&) = delete;
+			HangWatchdog& operator=(const HangWatchdog&) = delete;
+		public:
+			constexpr HangWatchdog() noexcept(true) = default;
+
+			// Must be called by the main thread
+			static void Initialize() noexcept(true);
+			static void Shutdown() noexcept(true);
+			[[nodiscard]] static bool HasEnabled() noexcept(true);
+		};
+	}
+}
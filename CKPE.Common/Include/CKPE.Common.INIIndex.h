@@ -0,0 +1,64 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#pragma once
+
+#include <CKPE.Common.Common.h>
+#include <CKPE.INIParser.h>
+#include <string_view>
+#include <string>
+#include <cstdint>
+#include <vector>
+
+namespace CKPE
+{
+	namespace Common
+	{
+		// Read-only INI file: the text is loaded in one piece and parsed in one pass into a flat array
+		// of section/key/value spans sorted without regard to case. Lookups don't allocate.
+		// The syntax decides the separators and which of the duplicate keys is kept (CKPE.INIParser.h).
+		class CKPE_COMMON_API INIIndex
+		{
+			INIIndex(const INIIndex&) = delete;
+			INIIndex& operator=(const INIIndex&) = delete;
+		public:
+			// Offsets in the text, every span ends with a null
+			using Entry = INIParser::Entry;
+		private:
+			char* _text{ nullptr };
+			std::size_t _size{ 0 };
+			std::vector<Entry>* _entries{ nullptr };
+			INIParser::Syntax _syntax{ INIParser::Syntax::Profile };
+		public:
+			INIIndex() noexcept(true) = default;
+			explicit INIIndex(INIParser::Syntax syntax) noexcept(true) : _syntax(syntax) {}
+			~INIIndex() noexcept(true);
+
+			bool Open(const std::wstring& filename) noexcept(true);
+			// Copies the text
+			bool Parse(const char* text, std::size_t length) noexcept(true);
+			void Clear() noexcept(true);
+
+			[[nodiscard]] inline bool IsEmpty() const noexcept(true) { return !_entries || _entries->empty(); }
+			[[nodiscard]] inline std::size_t GetCount() const noexcept(true) { return _entries ? _entries->size() : 0; }
+			[[nodiscard]] inline const char* GetText(std::uint32_t offset) const noexcept(true) { return _text + offset; }
+
+			// The value is not unquoted
+			[[nodiscard]] bool Find(const std::string_view& section, const std::string_view& key,
+				std::string_view& value) const noexcept(true);
+
+			template<typename T>
+			void ForEach(T&& func) const
+			{
+				if (_entries)
+					for (auto& entry : *_entries)
+						func(std::string_view(_text + entry.section, entry.section_length),
+							std::string_view(_text + entry.key, entry.key_length),
+							std::string_view(_text + entry.value, entry.value_length));
+			}
+		private:
+			bool DoParse() noexcept(true);
+		};
+	}
+}
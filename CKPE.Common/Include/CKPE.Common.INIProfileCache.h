@@ -0,0 +1,27 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#pragma once
+
+#include <CKPE.Common.Common.h>
+
+namespace CKPE
+{
+	namespace Common
+	{
+		// Serves the editor's GetPrivateProfileStringA from indexed copies of its INI files.
+		// Every call of the API opens and parses the file again, the editor does it for each option.
+		// A file is checked for changes at most once a second, writes through the API drop its copy.
+		class CKPE_COMMON_API INIProfileCache
+		{
+			INIProfileCache(const INIProfileCache&) = delete;
+			INIProfileCache& operator=(const INIProfileCache&) = delete;
+		public:
+			constexpr INIProfileCache() noexcept(true) = default;
+
+			static void Initialize() noexcept(true);
+			static void Shutdown() noexcept(true);
+		};
+	}
+}
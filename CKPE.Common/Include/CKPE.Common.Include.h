@@ -5,6 +5,7 @@
 #pragma once
 
 #include <CKPE.Common.Interface.h>
+#include <CKPE.Common.SettingHandle.h>
 #include <CKPE.Common.MemoryManager.h>
 #include <CKPE.Common.RTTI.h>
 #include <CKPE.Common.EditorUI.h>
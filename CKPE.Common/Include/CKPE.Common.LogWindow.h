@@ -14,11 +14,18 @@ namespace CKPE
 {
 	namespace Common
 	{
+		// The log window keeps the last "uLogWindowLines" lines in a fixed-capacity ring buffer,
+		// the list shows them through an owner-drawn list box without its own data,
+		// only the visible rows are drawn, so the window cost does not depend on the number of lines.
 		class CKPE_COMMON_API LogWindow
 		{
 			bool _auto_scroll{ true };
 			void* _handle{ nullptr };
-			void* _handle_richedit{ nullptr };
+			void* _handle_list{ nullptr };
+			void* _handle_search{ nullptr };
+			void* _handle_filter{ nullptr };
+			void* _font{ nullptr };
+			std::uint32_t _bar_height{ 0 };
 			void* _external_pipereader_handler{ nullptr };
 			void* _external_pipewriter_handler{ nullptr };
 			FILE* _output_file{ nullptr };
@@ -40,7 +47,9 @@ namespace CKPE
 
 			[[nodiscard]] static LogWindow* GetSingleton() noexcept(true);
 			[[nodiscard]] constexpr inline void* GetHandle() const noexcept(true) { return _handle; }
-			[[nodiscard]] constexpr inline void* GetRichEditHandle() const noexcept(true) { return _handle_richedit; }
+			[[nodiscard]] constexpr inline void* GetListHandle() const noexcept(true) { return _handle_list; }
+			[[nodiscard]] constexpr inline void* GetSearchHandle() const noexcept(true) { return _handle_search; }
+			[[nodiscard]] constexpr inline void* GetFilterHandle() const noexcept(true) { return _handle_filter; }
 
 			bool Initialize(void* handle, const void* create_struct);
 			void Show(bool sh) const noexcept(true);
@@ -54,16 +63,28 @@ namespace CKPE
 			void ResizeHandler(std::uint32_t x, std::uint32_t y) const noexcept(true);
 			void ActiveHandler(bool active) const noexcept(true);
 			void CloseHandler() const noexcept(true);
+			void RefreshHandler(bool reset) const noexcept(true);
+			void DrawItemHandler(const void* draw_struct) const noexcept(true);
+			void SearchHandler(bool next, bool backward) const noexcept(true);
+			void FilterHandler() const noexcept(true);
+			void OpenFormHandler() const noexcept(true);
+			void ContextMenuHandler(std::int32_t x, std::int32_t y) const noexcept(true);
+			bool KeyDownHandler(void* handle, std::uint32_t key) const noexcept(true);
 
 			bool CreateStdoutListener() noexcept(true);
 			void CloseOutputFile() noexcept(true);
 
-			bool SaveRichTextToFile(const std::string& fname) const noexcept(true);
-			bool SaveRichTextToFile(const std::wstring& fname) const noexcept(true);
+			// Writes all lines of the buffer, regardless of the filter
+			bool SaveToFile(const std::string& fname) const noexcept(true);
+			bool SaveToFile(const std::wstring& fname) const noexcept(true);
 			
 			[[nodiscard]] constexpr inline void* GetStdoutListenerPipe() const noexcept(true) 
 			{ return _external_pipewriter_handler; }
 
+			// Checks the "fmt:" lines of the blacklist before the message is formatted,
+			// call_site is the return address in the editor for the "fmt@<rva>:" lines
+			[[nodiscard]] static bool IsFormatBlacklisted(const char* format, const void* call_site = nullptr) noexcept(true);
+
 			virtual void InputLog(const std::string_view& formatted_message, ...);
 			virtual void InputLogVa(const std::string_view& formatted_message, va_list va);
 			virtual void InputLog(const std::wstring_view& formatted_message, ...);
@@ -17,12 +17,22 @@ namespace CKPE
 			MemoryManager(const MemoryManager&) = delete;
 			MemoryManager& operator=(const MemoryManager&) = delete;
 		public:
+			struct ReallocStats
+			{
+				std::uint64_t count;
+				std::uint64_t copied_bytes;
+			};
+
 			MemoryManager() noexcept(true);
 
 			[[nodiscard]] virtual void* MemAlloc(size_t size, size_t alignment = 0, bool aligned = false, 
 				bool zeroed = true) noexcept(true);
 			virtual void MemFree(void* block) noexcept(true);
 			[[nodiscard]] virtual size_t MemSize(void* block) noexcept(true);
+			// Moves the block, copies only what fits in the new size and zeroes the growth
+			[[nodiscard]] virtual void* MemRealloc(void* block, size_t size) noexcept(true);
+
+			[[nodiscard]] static ReallocStats GetReallocStats() noexcept(true);
 
 			[[nodiscard]] static MemoryManager* GetSingleton() noexcept(true);
 		};
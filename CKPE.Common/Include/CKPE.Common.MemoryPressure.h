@@ -0,0 +1,45 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#pragma once
+
+#include <cstdint>
+#include <CKPE.Common.Common.h>
+
+namespace CKPE
+{
+	namespace Common
+	{
+		// Central memory-pressure monitor.
+		// Polls the available physical memory and the commit charge, under pressure calls the registered
+		// trim callbacks (lower priority value first) and then returns empty allocator pages to the OS.
+		class CKPE_COMMON_API MemoryPressure
+		{
+			MemoryPressure(const MemoryPressure&) = delete;
+			MemoryPressure& operator=(const MemoryPressure&) = delete;
+		public:
+			enum Level : std::uint32_t
+			{
+				plNone = 0,
+				plModerate,
+				plCritical,
+			};
+
+			// Returns the approximate number of bytes released
+			typedef std::size_t(*TrimCallback)(Level level, void* user_data);
+
+			constexpr MemoryPressure() noexcept(true) = default;
+
+			static void Initialize() noexcept(true);
+			static void Shutdown() noexcept(true);
+
+			static std::uint32_t RegisterTrimCallback(const char* name, std::int32_t priority, TrimCallback callback,
+				void* user_data = nullptr) noexcept(true);
+			static void UnregisterTrimCallback(std::uint32_t id) noexcept(true);
+
+			[[nodiscard]] static Level GetLevel() noexcept(true);
+			static std::size_t Trim(Level level) noexcept(true);
+		};
+	}
+}
\ No newline at end of file
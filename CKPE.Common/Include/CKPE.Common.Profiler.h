@@ -0,0 +1,32 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#pragma once
+
+#include <cstdint>
+#include <CKPE.Common.Common.h>
+
+namespace CKPE
+{
+	namespace Common
+	{
+		// Sampling profiler, started and stopped by the "sProfilerHotkey" hotkey.
+		// The threads are sampled every "uProfilerInterval" ms, the stacks are named by the module table
+		// of the crash handler (the RTTI classes, the functions known to the relocation database) and written in the collapsed format of the flame graph tools
+		// to the "Profiles" folder.
+		class CKPE_COMMON_API Profiler
+		{
+			Profiler(const Profiler&) = delete;
+			Profiler& operator=(const Profiler&) = delete;
+		public:
+			constexpr Profiler() noexcept(true) = default;
+
+			// Must be called by the main thread
+			static void Initialize() noexcept(true);
+			static void Shutdown() noexcept(true);
+			[[nodiscard]] static bool HasEnabled() noexcept(true);
+			[[nodiscard]] static bool IsRunning() noexcept(true);
+		};
+	}
+}
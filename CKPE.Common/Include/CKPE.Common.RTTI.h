@@ -114,6 +114,8 @@ namespace CKPE
 				const char* RawName;					// Mangled
 				CompleteObjectLocator* Locator;			//
 			};
+
+			typedef void(*EnumCallback)(const Info* info, void* user_data);
 		private:
 			RTTI(const RTTI&) = delete;
 			RTTI& operator=(const RTTI&) = delete;
@@ -131,6 +133,8 @@ namespace CKPE
 			virtual void Dump(const std::wstring& fname) const noexcept(true);
 			virtual const Info* Find(const std::string_view& name, bool error_if_no_found = true) const noexcept(true);
 			virtual const Info* Find(const std::uintptr_t address, bool error_if_no_found = true) const noexcept(true);
+			// In the order of the vtable addresses
+			virtual void Enum(EnumCallback callback, void* user_data = nullptr) const noexcept(true);
 			virtual void* Cast(const void* InPtr, long VfDelta,
 				const char* lpstrFromType, const char* lpstrTargetType, bool isReference = false);
 		};
@@ -0,0 +1,34 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#pragma once
+
+#include <cstdint>
+#include <CKPE.Common.Common.h>
+
+namespace CKPE
+{
+	namespace Common
+	{
+		// Per-thread linear arena for the short-lived allocations of the editor's scrap heaps.
+		// A block is taken by moving the top of the arena, freeing the top block moves it back (together with
+		// the blocks below it that were freed earlier), and the arena is rewound when nothing in it is alive.
+		// Requests that do not fit, and threads left without an arena, go to the general allocator.
+		class CKPE_COMMON_API ScrapHeap
+		{
+			ScrapHeap(const ScrapHeap&) = delete;
+			ScrapHeap& operator=(const ScrapHeap&) = delete;
+		public:
+			constexpr ScrapHeap() noexcept(true) = default;
+
+			static void Initialize() noexcept(true);
+			[[nodiscard]] static bool HasEnabled() noexcept(true);
+			[[nodiscard]] static bool Owns(const void* block) noexcept(true);
+
+			[[nodiscard]] static void* Allocate(std::size_t size, std::size_t alignment) noexcept(true);
+			static void Deallocate(void* block) noexcept(true);
+			[[nodiscard]] static std::size_t Size(const void* block) noexcept(true);
+		};
+	}
+}
@@ -7,6 +7,7 @@
 #include <CKPE.Common.Common.h>
 #include <CKPE.Stream.h>
 #include <string>
+#include <string_view>
 #include <cstdint>
 #include <cstdio>
 #include <map>
@@ -209,6 +210,9 @@ namespace CKPE
 			virtual bool DoSave() const noexcept(true);
 		};
 
+		class INIIndex;
+
+		// Reads go to the index of the file, the editable tree is built only when the settings are changed
 		class CKPE_COMMON_API INISettingCollection : public CustomSettingCollection
 		{
 			class CKPE_COMMON_API INIStructure
@@ -226,13 +230,15 @@ namespace CKPE
 			INISettingCollection(const INISettingCollection&) = delete;
 			INISettingCollection& operator=(const INISettingCollection&) = delete;
 
-			INIStructure _iniData;
+			mutable INIStructure _iniData;
+			INIIndex* _index{ nullptr };
 		public:
 			INISettingCollection() noexcept(true) = default;
 			INISettingCollection(const std::string& filename) noexcept(true);
 			INISettingCollection(std::int32_t folderID, const std::string& relPath) noexcept(true);
 			INISettingCollection(const std::wstring& filename) noexcept(true);
 			INISettingCollection(std::int32_t folderID, const std::wstring& relPath) noexcept(true);
+			virtual ~INISettingCollection();
 
 			virtual void Dump(TextFileStream& Stream) const noexcept(true);
 
@@ -244,10 +250,12 @@ namespace CKPE
 
 			[[nodiscard]] inline virtual INIStructure::_Mbase::const_iterator FirstUnsafe() const noexcept(true)
 			{
+				Materialize();
 				return _iniData.data->begin();
 			}
 			[[nodiscard]] inline virtual INIStructure::_Mbase::const_iterator LastUnsafe() const noexcept(true)
 			{
+				Materialize();
 				return _iniData.data->end();
 			}
 
@@ -302,6 +310,12 @@ namespace CKPE
 			virtual bool DoOpen(const std::wstring& filename) noexcept(true);
 			virtual bool DoOpenSerialization(const char* text, size_t len) noexcept(true);
 			virtual bool DoSave() const noexcept(true);
+		private:
+			// Builds the tree from the index before the first change
+			void Materialize() const noexcept(true);
+			// The value is null terminated
+			[[nodiscard]] bool FindValue(const std::string& section, const std::string& option,
+				std::string_view& value) const noexcept(true);
 		};
 	}
 }
\ No newline at end of file
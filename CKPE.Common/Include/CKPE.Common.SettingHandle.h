@@ -0,0 +1,75 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#pragma once
+
+#include <CKPE.Common.Common.h>
+#include <CKPE.Common.SettingCollection.h>
+#include <type_traits>
+#include <cstdint>
+#include <atomic>
+
+namespace CKPE
+{
+	namespace Common
+	{
+		// Option of the main settings file bound once by name ("Section:sOption", the name must be static).
+		// The value is cached, reading it is a single load without building the keys and looking them up.
+		// When the file is changed on disk, it is re-read and the handles get the new values.
+		class CKPE_COMMON_API CustomSettingHandle
+		{
+			CustomSettingHandle(const CustomSettingHandle&) = delete;
+			CustomSettingHandle& operator=(const CustomSettingHandle&) = delete;
+
+			const char* _name{ nullptr };
+			std::uint32_t _section_length{ 0 };
+		public:
+			CustomSettingHandle(const char* name) noexcept(true);
+			virtual ~CustomSettingHandle() noexcept(true) = default;
+
+			[[nodiscard]] inline const char* GetName() const noexcept(true) { return _name; }
+
+			// Re-reads the values of all handles, returns the number of the changed ones
+			static std::uint32_t Refresh(const CustomSettingCollection* settings) noexcept(true);
+			// Watches the settings file and refreshes the handles when it is saved
+			static void Initialize() noexcept(true);
+			static void Shutdown() noexcept(true);
+		protected:
+			void Register() noexcept(true);
+			void Unregister() noexcept(true);
+			// Returns true if the value has changed
+			virtual bool Update(const CustomSettingCollection* settings) noexcept(true) = 0;
+
+			[[nodiscard]] bool ReadValue(const CustomSettingCollection* settings, bool def) const noexcept(true);
+			[[nodiscard]] long ReadValue(const CustomSettingCollection* settings, long def) const noexcept(true);
+			// Options with the "h" prefix are read as hex
+			[[nodiscard]] unsigned long ReadValue(const CustomSettingCollection* settings, 
+				unsigned long def) const noexcept(true);
+			[[nodiscard]] float ReadValue(const CustomSettingCollection* settings, float def) const noexcept(true);
+		};
+
+		template<typename T>
+		class SettingHandle : public CustomSettingHandle
+		{
+			static_assert(std::is_same_v<T, bool> || std::is_same_v<T, long> || std::is_same_v<T, unsigned long> ||
+				std::is_same_v<T, float>, "SettingHandle: unsupported type of the option");
+
+			std::atomic<T> _value;
+			T _default;
+		public:
+			SettingHandle(const char* name, T def) noexcept(true) : CustomSettingHandle(name), _value(def), _default(def)
+			{ Register(); }
+			virtual ~SettingHandle() noexcept(true) { Unregister(); }
+
+			[[nodiscard]] inline T Get() const noexcept(true) { return _value.load(std::memory_order_relaxed); }
+			[[nodiscard]] inline operator T() const noexcept(true) { return Get(); }
+		protected:
+			virtual bool Update(const CustomSettingCollection* settings) noexcept(true)
+			{
+				auto value = ReadValue(settings, _default);
+				return _value.exchange(value, std::memory_order_relaxed) != value;
+			}
+		};
+	}
+}
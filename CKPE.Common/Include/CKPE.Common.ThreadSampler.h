@@ -0,0 +1,36 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#pragma once
+
+#include <cstdint>
+#include <CKPE.PESymbolizer.h>
+#include <CKPE.Common.Common.h>
+
+namespace CKPE
+{
+	namespace Common
+	{
+		// Call stacks of other threads of the process: while the thread is suspended only its context
+		// and the top of its stack are copied, the copy is unwound by the unwind data of the module table
+		// (.pdata) after the thread is resumed. The suspended thread may own the heap lock or the locks
+		// of the loader that RtlLookupFunctionEntry takes, nothing else is done while it is suspended.
+		class CKPE_COMMON_API ThreadSampler
+		{
+			std::uint8_t* _stack{ nullptr };
+
+			ThreadSampler(const ThreadSampler&) = delete;
+			ThreadSampler& operator=(const ThreadSampler&) = delete;
+		public:
+			ThreadSampler() noexcept(true);
+			~ThreadSampler() noexcept(true);
+
+			// The handle needs THREAD_SUSPEND_RESUME and THREAD_GET_CONTEXT access, the table is built
+			// by CrashHandler::BuildModuleTable before the sampling, the frames of the modules loaded later end the stack.
+			// Returns the count of the frames (the leaf first), zero if the thread can't be sampled.
+			[[nodiscard]] std::uint32_t Capture(void* Thread, const PESymbolizer::ModuleTable& Modules,
+				std::uintptr_t* Frames, std::uint32_t MaxFrames) noexcept(true);
+		};
+	}
+}
@@ -0,0 +1,380 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#include <windows.h>
+#include <CKPE.HashUtils.h>
+#include <CKPE.CriticalSection.h>
+#include <CKPE.Common.Interface.h>
+#include <CKPE.Common.AllocationTracker.h>
+#include <CKPE.Common.MemoryPressure.h>
+#include <CKPE.Common.MemoryManager.h>
+#include <unordered_map>
+#include <algorithm>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <cmath>
+#include <intrin.h>
+
+namespace CKPE
+{
+	namespace Common
+	{
+		constexpr static std::uint32_t ALLOCTRACK_MAX_FRAMES = 24;
+		constexpr static std::uint32_t ALLOCTRACK_SKIP_FRAMES = 2;
+		constexpr static std::uint32_t ALLOCTRACK_PRINT_FRAMES = 6;
+		constexpr static std::size_t ALLOCTRACK_FILTER_SIZE = 1 << 16;
+
+		struct AllocationSite
+		{
+			void* frames[ALLOCTRACK_MAX_FRAMES]{};
+			std::uint32_t count_frames{ 0 };
+			std::int64_t live_bytes{ 0 };
+			std::int64_t live_count{ 0 };
+			std::int64_t reported_bytes{ 0 };
+			std::uint64_t total_samples{ 0 };
+		};
+
+		struct AllocationSample
+		{
+			std::uint64_t site;
+			std::int64_t weight;
+			std::size_t size;
+		};
+
+		static bool _senabled = false;
+		static double _ssample_rate = 512.0 * 1024.0;
+		static CriticalSection _ssection;
+		static std::unordered_map<std::uint64_t, AllocationSite>* _ssites = nullptr;
+		static std::unordered_map<void*, AllocationSample>* _slive = nullptr;
+		// Counting filter: lets OnFree skip the lock for blocks that were never sampled
+		static std::atomic_uint16_t _sfilter[ALLOCTRACK_FILTER_SIZE];
+		static HANDLE _sreport_event = nullptr;
+		static std::thread* _sreport_thread = nullptr;
+
+		static thread_local std::int64_t _sbytes_until_sample = 0;
+		static thread_local std::uint64_t _srandom_state = 0;
+		static thread_local bool _sinside = false;
+
+		[[nodiscard]] static inline std::size_t FilterIndex(const void* block) noexcept(true)
+		{
+			auto v = (std::uintptr_t)block >> 4;
+			return (v ^ (v >> 16) ^ (v >> 32)) & (ALLOCTRACK_FILTER_SIZE - 1);
+		}
+
+		[[nodiscard]] static std::int64_t NextSampleInterval() noexcept(true)
+		{
+			// Exponentially distributed intervals, the average is the sampling rate,
+			// this avoids aliasing with allocation patterns of the same size.
+			if (!_srandom_state)
+				_srandom_state = ((std::uint64_t)GetCurrentThreadId() << 32) ^ __rdtsc() ^ 0x9E3779B97F4A7C15ull;
+
+			_srandom_state ^= _srandom_state << 13;
+			_srandom_state ^= _srandom_state >> 7;
+			_srandom_state ^= _srandom_state << 17;
+
+			auto u = (double)((_srandom_state >> 11) + 1) * (1.0 / 9007199254740992.0);
+			return (std::int64_t)(-std::log(u) * _ssample_rate) + 1;
+		}
+
+		[[nodiscard]] static const char* GetModuleNameByAddress(const void* address, std::uintptr_t& base) noexcept(true)
+		{
+			static thread_local char name[MAX_PATH];
+			HMODULE module = nullptr;
+
+			if (!GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+				(LPCSTR)address, &module) || !GetModuleFileNameA(module, name, MAX_PATH))
+			{
+				base = 0;
+				return "<unknown>";
+			}
+
+			base = (std::uintptr_t)module;
+			auto slash = strrchr(name, '\\');
+			return slash ? slash + 1 : name;
+		}
+
+		static std::size_t TrimDeadSites(MemoryPressure::Level level, void* user_data) noexcept(true)
+		{
+			std::size_t released = 0;
+			_sinside = true;
+
+			{
+				ScopeCriticalSection guard(_ssection);
+
+				// Sites without live samples are needed only for the next report
+				for (auto it = _ssites->begin(); it != _ssites->end();)
+				{
+					if (it->second.live_count <= 0)
+					{
+						it = _ssites->erase(it);
+						released += sizeof(AllocationSite);
+					}
+					else
+						it++;
+				}
+			}
+
+			_sinside = false;
+			return released;
+		}
+
+		void AllocationTracker::Initialize() noexcept(true)
+		{
+			if (_senabled || !_READ_OPTION_BOOL("Memory", "bAllocationTracker", false))
+				return;
+
+			_ssample_rate = (double)std::max(_READ_OPTION_UINT("Memory", "uAllocationSampleRate", 512 * 1024), 4096ul);
+			auto interval = std::max(_READ_OPTION_UINT("Memory", "uAllocationReportInterval", 60), 5ul);
+			auto top = std::max(_READ_OPTION_UINT("Memory", "uAllocationReportTop", 10), 1ul);
+
+			_ssites = new std::unordered_map<std::uint64_t, AllocationSite>;
+			_slive = new std::unordered_map<void*, AllocationSample>;
+			_ssites->reserve(4096);
+			_slive->reserve(65536);
+
+			_sreport_event = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+			_sreport_thread = new std::thread([](std::uint32_t interval, std::uint32_t top)
+				{
+					while (WaitForSingleObject(_sreport_event, interval * 1000) == WAIT_TIMEOUT)
+						Report(top);
+				}, interval, top);
+
+			_senabled = true;
+
+			MemoryPressure::RegisterTrimCallback("Allocation tracker", 0, &TrimDeadSites);
+
+			_MESSAGE("Allocation tracker: enabled (sample rate: %.0f bytes, report interval: %u sec)",
+				_ssample_rate, interval);
+		}
+
+		void AllocationTracker::Shutdown() noexcept(true)
+		{
+			if (!_senabled)
+				return;
+
+			_senabled = false;
+
+			if (_sreport_thread)
+			{
+				SetEvent(_sreport_event);
+				if (_sreport_thread->joinable())
+					_sreport_thread->join();
+
+				delete _sreport_thread;
+				_sreport_thread = nullptr;
+			}
+
+			if (_sreport_event)
+			{
+				CloseHandle(_sreport_event);
+				_sreport_event = nullptr;
+			}
+		}
+
+		bool AllocationTracker::HasEnabled() noexcept(true)
+		{
+			return _senabled;
+		}
+
+		void AllocationTracker::OnAlloc(void* block, std::size_t size) noexcept(true)
+		{
+			if (!_senabled || !block || !size)
+				return;
+
+			_sbytes_until_sample -= (std::int64_t)size;
+			if (_sbytes_until_sample > 0)
+				return;
+
+			if (_sinside)
+				return;
+
+			_sinside = true;
+			_sbytes_until_sample = NextSampleInterval();
+
+			void* frames[ALLOCTRACK_MAX_FRAMES];
+			auto count = (std::uint32_t)RtlCaptureStackBackTrace(ALLOCTRACK_SKIP_FRAMES, ALLOCTRACK_MAX_FRAMES,
+				frames, nullptr);
+			auto site_hash = HashUtils::MurmurHash64A(frames, count * sizeof(void*));
+
+			// Unbiased estimate of the bytes represented by this sample
+			auto fsize = (double)size;
+			auto weight = (std::int64_t)(fsize / (1.0 - std::exp(-fsize / _ssample_rate)));
+
+			{
+				ScopeCriticalSection guard(_ssection);
+
+				auto& site = (*_ssites)[site_hash];
+				if (!site.count_frames)
+				{
+					site.count_frames = count;
+					memcpy(site.frames, frames, count * sizeof(void*));
+				}
+
+				site.live_bytes += weight;
+				site.live_count++;
+				site.total_samples++;
+
+				auto it = _slive->find(block);
+				if (it == _slive->end())
+				{
+					_slive->emplace(block, AllocationSample{ site_hash, weight, size });
+					_sfilter[FilterIndex(block)].fetch_add(1, std::memory_order_relaxed);
+				}
+				else
+					it->second = AllocationSample{ site_hash, weight, size };
+			}
+
+			_sinside = false;
+		}
+
+		void AllocationTracker::OnFree(void* block) noexcept(true)
+		{
+			if (!_senabled || !block)
+				return;
+
+			auto& filter = _sfilter[FilterIndex(block)];
+			if (!filter.load(std::memory_order_relaxed))
+				return;
+
+			if (_sinside)
+				return;
+
+			_sinside = true;
+
+			{
+				ScopeCriticalSection guard(_ssection);
+
+				auto it = _slive->find(block);
+				if (it != _slive->end())
+				{
+					auto site = _ssites->find(it->second.site);
+					if (site != _ssites->end())
+					{
+						site->second.live_bytes -= it->second.weight;
+						site->second.live_count--;
+					}
+
+					_slive->erase(it);
+					filter.fetch_sub(1, std::memory_order_relaxed);
+				}
+			}
+
+			_sinside = false;
+		}
+
+		void AllocationTracker::OnResize(void* block, std::size_t size) noexcept(true)
+		{
+			if (!_senabled || !block || !size)
+				return;
+
+			if (!_sfilter[FilterIndex(block)].load(std::memory_order_relaxed))
+				return;
+
+			if (_sinside)
+				return;
+
+			_sinside = true;
+
+			{
+				ScopeCriticalSection guard(_ssection);
+
+				auto it = _slive->find(block);
+				if ((it != _slive->end()) && it->second.size && (it->second.size != size))
+				{
+					// The sample stands for weight / size blocks of its size, the estimate grows with the block
+					auto weight = (std::int64_t)((double)it->second.weight * (double)size / (double)it->second.size);
+
+					auto site = _ssites->find(it->second.site);
+					if (site != _ssites->end())
+						site->second.live_bytes += weight - it->second.weight;
+
+					it->second.weight = weight;
+					it->second.size = size;
+				}
+			}
+
+			_sinside = false;
+		}
+
+		void AllocationTracker::Report(std::uint32_t top) noexcept(true)
+		{
+			if (!_senabled)
+				return;
+
+			struct ReportEntry
+			{
+				std::int64_t growth;
+				std::int64_t live_bytes;
+				std::int64_t live_count;
+				std::uint32_t count_frames;
+				void* frames[ALLOCTRACK_MAX_FRAMES];
+			};
+
+			std::vector<ReportEntry> entries;
+			std::int64_t total_live = 0;
+
+			_sinside = true;
+
+			{
+				ScopeCriticalSection guard(_ssection);
+
+				entries.reserve(_ssites->size());
+				for (auto& site : *_ssites)
+				{
+					total_live += site.second.live_bytes;
+
+					auto growth = site.second.live_bytes - site.second.reported_bytes;
+					site.second.reported_bytes = site.second.live_bytes;
+					if (growth <= 0)
+						continue;
+
+					ReportEntry entry{ growth, site.second.live_bytes, site.second.live_count, site.second.count_frames };
+					memcpy(entry.frames, site.second.frames, sizeof(entry.frames));
+					entries.emplace_back(entry);
+				}
+			}
+
+			_sinside = false;
+
+			auto realloc_stats = MemoryManager::GetReallocStats();
+			if (realloc_stats.count)
+				_CONSOLE("[ALLOCTRACK] Reallocations: %llu, copied %.2f MB", realloc_stats.count,
+					(double)realloc_stats.copied_bytes / (1024.0 * 1024.0));
+
+			if (entries.empty())
+				return;
+
+			auto count = std::min((std::size_t)top, entries.size());
+			std::partial_sort(entries.begin(), entries.begin() + count, entries.end(),
+				[](const ReportEntry& a, const ReportEntry& b) { return a.growth > b.growth; });
+
+			auto selfModule = Interface::GetSingleton()->GetInstanceDLL();
+
+			_CONSOLE("[ALLOCTRACK] Top growing allocation sites (estimated live: %.2f MB):",
+				(double)total_live / (1024.0 * 1024.0));
+
+			for (std::size_t i = 0; i < count; i++)
+			{
+				auto& entry = entries[i];
+				_CONSOLE("[ALLOCTRACK] #%llu +%.2f MB (live %.2f MB in ~%lld samples)", i + 1,
+					(double)entry.growth / (1024.0 * 1024.0), (double)entry.live_bytes / (1024.0 * 1024.0),
+					entry.live_count);
+
+				std::uint32_t printed = 0;
+				for (std::uint32_t j = 0; (j < entry.count_frames) && (printed < ALLOCTRACK_PRINT_FRAMES); j++)
+				{
+					std::uintptr_t base = 0;
+					auto name = GetModuleNameByAddress(entry.frames[j], base);
+					// Skip the frames of the memory manager itself
+					if (base == selfModule)
+						continue;
+
+					_CONSOLE("[ALLOCTRACK]     %s+0x%llX", name, (std::uintptr_t)entry.frames[j] - base);
+					printed++;
+				}
+			}
+		}
+	}
+}
\ No newline at end of file
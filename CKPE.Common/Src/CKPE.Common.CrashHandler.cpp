@@ -22,16 +22,19 @@
 #include <CKPE.GDIPlus.h>
 #include <CKPE.Graphics.h>
 #include <CKPE.StringUtils.h>
+#include <CKPE.PESymbolizer.h>
 #include <CKPE.Common.RTTI.h>
 #include <CKPE.Common.Interface.h>
 #include <CKPE.Common.CrashHandler.h>
+#include <CKPE.Common.CrashReport.h>
 #include <CKPE.Common.PatchManager.h>
+#include <CKPE.Common.Relocator.h>
 #include <CKPE.Common.ModernTheme.h>
 #include <CKPE.Common.UIVarCommon.h>
 #include <vector>
 #include <atomic>
 #include <thread>
-#include <unordered_map>
+#include <algorithm>
 
 namespace CKPE
 {
@@ -68,8 +71,8 @@ namespace CKPE
 			ZydisDecoder Decoder{};
 			ZydisFormatter Formatter{};
 		public:
-			struct Module { std::uintptr_t Start, End; CKPE::Segment SecCode; };
-			using ModuleMapInfo = std::unordered_map<std::string, Module>;
+			// Sorted by address, the crash log looks up every register and stack slot
+			using ModuleMapInfo = PESymbolizer::ModuleTable;
 			using ArrayMemoryInfo = std::vector<CKPE::Segment>;
 
 			enum AnalyzeItemType
@@ -116,6 +119,10 @@ namespace CKPE
 			[[nodiscard]] AnalyzeInfo Analyze(std::uintptr_t Address, ModuleMapInfo* Modules,
 				ArrayMemoryInfo* Memory) const noexcept(true);
 		private:
+			static void AnnotateApplication(PESymbolizer::ModuleTable& Modules,
+				PESymbolizer::Module& Module) noexcept(true);
+			[[nodiscard]] static std::string FormatFunction(const PESymbolizer::Symbol& Symbol) noexcept(true);
+
 			[[nodiscard]] bool AnalyzeClass(std::uintptr_t Address, AnalyzeInfo* Info,
 				std::uintptr_t RefAddress = 0) const noexcept(true);
 		};
@@ -170,7 +177,8 @@ namespace CKPE
 		Introspection GlobalCrashIntrospection;
 		std::atomic<PEXCEPTION_POINTERS> GlobalCrashDumpExceptionInfo;
 		std::atomic_uint32_t GlobalCrashDumpTargetThreadId;
-		HMODULE GlobalModuleList[1024];
+
+		constexpr static auto CrashReportFName = "CreationKitPlatformExtendedCrashReport.log";
 
 		///////////////////////////////////////////////////
 		/// Introspection continue
@@ -202,6 +210,109 @@ namespace CKPE
 			return false;
 		}
 
+		void Introspection::AnnotateApplication(PESymbolizer::ModuleTable& Modules,
+			PESymbolizer::Module& Module) noexcept(true)
+		{
+			// Virtual functions, the name of the first class is enough
+			RTTI::GetSingleton()->Enum([](const RTTI::Info* Info, void* UserData)
+				{
+					auto Module = (PESymbolizer::Module*)UserData;
+					auto Name = strchr(Info->Name, ' ');
+					Name = Name ? Name + 1 : Info->Name;
+
+					auto VTable = (const std::uintptr_t*)Info->VTableAddress;
+					auto Count = std::min(Info->VFunctionCount, (std::uint64_t)0xFFFF);
+					for (std::uint64_t i = 0; i < Count; i++)
+						if ((VTable[i] >= Module->start) && (VTable[i] < Module->end))
+							Module->annotations.push_back({ (std::uint32_t)(VTable[i] - Module->start),
+								CrashHandler::atVirtualFunction, (std::uint16_t)i, Name });
+				}, &Module);
+
+			// The database has no symbols, an entry at the start of a function is named as the patches
+			// refer to it: <patch>#<index>
+			auto Databases = Relocator::GetSingleton();
+			for (std::uint32_t i = 0; i < Databases->GetCount(); i++)
+			{
+				auto Db = Databases->GetAtConst(i);
+				if (!Db)
+					continue;
+
+				const char* Name = nullptr;
+				for (std::uint32_t j = 0; j < Db->GetCount(); j++)
+				{
+					PESymbolizer::Function Function;
+					auto Rva = Db->GetAt(j).Rva;
+					if (!Rva || (Rva >= (Module.end - Module.start)) || !Module.image.FindFunction(Rva, Function) ||
+						(Function.begin != Rva))
+						continue;
+
+					if (!Name)
+						Name = Modules.AddName(Db->GetName());
+					Module.annotations.push_back({ Rva, CrashHandler::atKnownFunction, (std::uint16_t)j, Name });
+				}
+			}
+
+			// Places changed by the active patches
+			auto Entries = PatchManager::GetSingleton()->GetEntries();
+			if (!Entries)
+				return;
+
+			for (auto& itP : *Entries)
+			{
+				if (!itP.db || !itP.patch->IsActive())
+					continue;
+
+				auto Name = Modules.AddName(itP.patch->GetName());
+				for (std::uint32_t i = 0; i < itP.db->GetCount(); i++)
+				{
+					auto Rva = itP.db->GetAt(i).Rva;
+					if (Rva && (Rva < (Module.end - Module.start)))
+						Module.annotations.push_back({ Rva, CrashHandler::atPatch, (std::uint16_t)i, Name });
+				}
+			}
+		}
+
+		std::string Introspection::FormatFunction(const PESymbolizer::Symbol& Symbol) noexcept(true)
+		{
+			auto& Function = Symbol.function;
+
+			std::string Text = (Function.fragment_begin == Function.begin) ?
+				StringUtils::FormatString("(sub_%X+%X", Function.begin, Symbol.rva - Function.begin) :
+				StringUtils::FormatString("(sub_%X part+%X", Function.begin, Symbol.rva - Function.fragment_begin);
+
+			bool VirtualFunction = false;
+			bool KnownFunction = false;
+			const char* LastPatch = nullptr;
+
+			Symbol.module->ForEachAnnotation(Function.begin, Function.end, [&](const PESymbolizer::Annotation& Entry)
+				{
+					if (Entry.tag == CrashHandler::atVirtualFunction)
+					{
+						if (VirtualFunction || (Entry.rva != Function.begin))
+							return;
+
+						VirtualFunction = true;
+						Text.append(StringUtils::FormatString(" %s::vfunc_%u", Entry.name, Entry.index));
+					}
+					else if (Entry.tag == CrashHandler::atKnownFunction)
+					{
+						if (KnownFunction || (Entry.rva != Function.begin))
+							return;
+
+						KnownFunction = true;
+						Text.append(StringUtils::FormatString(" %s#%u", Entry.name, Entry.index));
+					}
+					else if (Entry.name != LastPatch)
+					{
+						LastPatch = Entry.name;
+						Text.append(StringUtils::FormatString(" patch:\"%s\"", Entry.name));
+					}
+				});
+
+			Text.append(") ");
+			return Text;
+		}
+
 		Introspection::AnalyzeInfo Introspection::Analyze(std::uintptr_t Address,
 			ModuleMapInfo* Modules, ArrayMemoryInfo* Memory) const noexcept(true)
 		{
@@ -220,25 +331,17 @@ namespace CKPE
 				return Info;
 			}
 
-			auto itMod = Modules->begin();
-			for (; itMod != Modules->end(); itMod++)
-			{
-				if ((Address >= itMod->second.Start) && (Address < itMod->second.End))
-					break;
-			}
-
-			if (itMod != Modules->end())
+			PESymbolizer::Symbol Symbol;
+			if (Modules->Symbolize(Address, Symbol))
 			{
 				// Address module
 
-				PIMAGE_NT_HEADERS ntHeaders = (PIMAGE_NT_HEADERS)(itMod->second.Start + 
-					((PIMAGE_DOS_HEADER)itMod->second.Start)->e_lfanew);
-
-				if ((Address >= itMod->second.SecCode.GetAddress()) && (Address < itMod->second.SecCode.GetEndAddress()))
+				if (Symbol.code)
 				{
 					Info.Type = aitCode;
-					Info.Text = StringUtils::FormatString("%s+%X ", itMod->first.c_str(),
-						(uint32_t)(Address - itMod->second.Start));
+					Info.Text = StringUtils::FormatString("%s+%X ", Symbol.module->name.c_str(), Symbol.rva);
+					if (Symbol.has_function)
+						Info.Text.append(FormatFunction(Symbol));
 
 					char InstructionText[256];
 					ZydisDecodedInstruction Instruction;
@@ -252,10 +355,10 @@ namespace CKPE
 					else
 						Info.Text.append("<FATAL DECODER INSTRUCTION>");
 				}
-				else if (!(Address - itMod->second.Start))
+				else if (!Symbol.rva)
 				{
 					Info.Type = aitInstance;
-					Info.Text = itMod->first.c_str();
+					Info.Text = Symbol.module->name;
 				}
 				else
 					goto Analize_Continue;
@@ -265,14 +368,11 @@ namespace CKPE
 			Analize_Continue:
 				if (Memory)
 				{
-					auto itMem = Memory->begin();
-					for (; itMem != Memory->end(); itMem++)
-					{
-						if ((Address >= itMem->GetAddress()) && (Address < itMem->GetEndAddress()))
-							break;
-					}
+					// The regions are in the order of the addresses
+					auto itMem = std::upper_bound(Memory->begin(), Memory->end(), Address,
+						[](std::uintptr_t Address, const CKPE::Segment& Region) { return Address < Region.GetAddress(); });
 
-					if (itMem != Memory->end())
+					if ((itMem != Memory->begin()) && (Address < (itMem - 1)->GetEndAddress()))
 					{
 						auto Tib = GlobalCrashEvent.GetTib();
 						if (Tib && (Tib->StackLimit <= Address) && (Tib->StackBase > Address))
@@ -375,29 +475,7 @@ namespace CKPE
 			ModuleMapInfo Modules;
 			ArrayMemoryInfo Memory;
 
-			DWORD cbNeeded;
-			auto hProcess = GetCurrentProcess();
-			// Get a list of all the modules in this process.
-			if (EnumProcessModules(hProcess, GlobalModuleList, sizeof(GlobalModuleList), &cbNeeded))
-			{
-				for (DWORD i = 0; i < (cbNeeded / sizeof(HMODULE)); i++)
-				{
-					CHAR szModName[MAX_PATH];
-					// Get the full path to the module's file.
-					if (GetModuleFileNameExA(hProcess, GlobalModuleList[i], szModName, ARRAYSIZE(szModName)))
-					{
-						MODULEINFO Info;
-						GetModuleInformation(hProcess, GlobalModuleList[i], &Info, sizeof(MODULEINFO));
-
-						CKPE::Module smodule(GlobalModuleList[i]);
-						auto secCode = smodule.GetSegment(CKPE::Segment::text);
-						Modules.insert(Modules.end(),
-							std::make_pair<std::string, Module>(PathFindFileNameA(szModName),
-								{ (uintptr_t)Info.lpBaseOfDll, (uintptr_t)Info.lpBaseOfDll + (uintptr_t)Info.SizeOfImage, 
-								  secCode }));
-					}
-				}
-			}
+			CrashHandler::BuildModuleTable(Modules);
 
 			MEMORY_BASIC_INFORMATION mbi;
 			ZeroMemory(&mbi, sizeof(mbi));
@@ -896,14 +974,14 @@ namespace CKPE
 		void Introspection::PrintModules(TextFileStream& Stream, ModuleMapInfo* Modules) noexcept(true)
 		{
 			Stream.WriteLine("MODULES:");
-			Stream.WriteLine("\tTotal: %u", (uint32_t)Modules->size());
+			Stream.WriteLine("\tTotal: %u", (uint32_t)Modules->GetCount());
 
 			std::size_t column_max = 0;
 			for (auto itM = Modules->begin(); itM != Modules->end(); itM++)
-				column_max = std::max(column_max, itM->first.length());
+				column_max = std::max(column_max, itM->name.length());
 
 			for (auto itM = Modules->begin(); itM != Modules->end(); itM++)
-				Stream.WriteLine("\t%-*s\t%016llX", (unsigned int)column_max, itM->first.c_str(), itM->second.Start);
+				Stream.WriteLine("\t%-*s\t%016llX", (unsigned int)column_max, itM->name.c_str(), itM->start);
 
 			Stream.WriteString("\n");
 			Stream.Flush();
@@ -914,9 +992,12 @@ namespace CKPE
 
 		static LONG WINAPI DumpExceptionHandler(PEXCEPTION_POINTERS ExceptionInfo) noexcept(true)
 		{
+			auto Tib = (NT_TIB64*)__readgsqword(0x30);
+			CrashReport::Capture(ExceptionInfo, Tib);
+
 			GlobalCrashDumpExceptionInfo = ExceptionInfo;
 			GlobalCrashDumpTargetThreadId = GetCurrentThreadId();
-			GlobalCrashEvent.CallError((NT_TIB64*)__readgsqword(0x30));
+			GlobalCrashEvent.CallError(Tib);
 			// wait always (app no close)
 			Sleep(INFINITE);
 
@@ -1034,8 +1115,6 @@ namespace CKPE
 				PEXCEPTION_POINTERS ExceptionInfo;
 			};
 
-			constexpr static auto CrashReportFName = "CreationKitPlatformExtendedCrashReport.log";
-
 			static CrashDlgParam Param;
 			Param.File = File;
 			Param.Line = Line;
@@ -1204,11 +1283,16 @@ namespace CKPE
 				return FALSE;
 				};
 
+			// The messages still queued by the log writer go to the file right now
+			Interface::GetSingleton()->GetLogger()->Flush();
 			LogWindow::GetSingleton()->CloseOutputFile();
 
 			if (Param.ExceptionInfo)
 			{
-				TextFileStream stm(CrashReportFName, FileStream::fmCreate);
+				// The detailed part follows the report written without the heap, if it hangs the report is on disk
+				TextFileStream stm(CrashReportFName, CrashReport::HasWritten() ? 
+					FileStream::fmOpenReadWrite : FileStream::fmCreate);
+				stm.Offset(0, Stream::ofEnd);
 				Introspection::ContextWriteToCrashLog(stm, Param.ExceptionInfo);
 			}
 
@@ -1274,7 +1358,7 @@ namespace CKPE
 				if (Param.ExceptionInfo)
 				{
 					constexpr static auto crash_log = "CreationKitPlatformExtendedCrash.log";
-					LogWindow::GetSingleton()->SaveRichTextToFile(crash_log);
+					LogWindow::GetSingleton()->SaveToFile(crash_log);
 					if (PathUtils::FileExists(crash_log) && PathUtils::FileExists(CrashReportFName))
 					{
 						FileStream stm(crash_log, FileStream::fmOpenReadWrite);
@@ -1311,6 +1395,9 @@ namespace CKPE
 			SetProcessExceptionHandlers();
 			SetThreadExceptionHandlers();
 
+			if (!CrashReport::Initialize(CrashReportFName))
+				_WARNING("Crash handler: unable to prepare the crash report \"%s\"", CrashReportFName);
+
 			std::thread t([]()
 				{
 					if (UI::IsDarkTheme())
@@ -1319,6 +1406,9 @@ namespace CKPE
 					if (!GlobalCrashEvent.Wait())
 						return;
 
+					// Before anything that may need the heap
+					CrashReport::Write();
+
 					auto ehInfo = GlobalCrashDumpExceptionInfo.load();
 					const char* reason = nullptr;
 
@@ -1360,6 +1450,37 @@ namespace CKPE
 			t.detach();
 		}
 
+		void CrashHandler::BuildModuleTable(PESymbolizer::ModuleTable& Modules) noexcept(true)
+		{
+			HMODULE ModuleList[1024];
+			auto AppBase = Interface::GetSingleton()->GetApplication()->GetBase();
+
+			DWORD cbNeeded;
+			auto hProcess = GetCurrentProcess();
+			// Get a list of all the modules in this process.
+			if (EnumProcessModules(hProcess, ModuleList, sizeof(ModuleList), &cbNeeded))
+			{
+				auto Count = std::min(cbNeeded / (DWORD)sizeof(HMODULE), (DWORD)ARRAYSIZE(ModuleList));
+				for (DWORD i = 0; i < Count; i++)
+				{
+					CHAR szModName[MAX_PATH];
+					// Get the full path to the module's file.
+					if (GetModuleFileNameExA(hProcess, ModuleList[i], szModName, ARRAYSIZE(szModName)))
+					{
+						MODULEINFO Info;
+						GetModuleInformation(hProcess, ModuleList[i], &Info, sizeof(MODULEINFO));
+
+						auto& Module = Modules.Add(PathFindFileNameA(szModName), (uintptr_t)Info.lpBaseOfDll,
+							Info.lpBaseOfDll, (std::size_t)Info.SizeOfImage, true);
+						if ((uintptr_t)Info.lpBaseOfDll == AppBase)
+							Introspection::AnnotateApplication(Modules, Module);
+					}
+				}
+			}
+
+			Modules.Build();
+		}
+
 		CrashHandler* CrashHandler::GetSingleton() noexcept(true)
 		{
 			return &GlobalCrashHandler;
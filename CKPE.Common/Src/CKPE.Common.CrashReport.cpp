@@ -0,0 +1,445 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#include <windows.h>
+#include <psapi.h>
+#include <cstdarg>
+#include <cstdio>
+#include <cwchar>
+#include <atomic>
+#include <algorithm>
+#include <CKPE.PESymbolizer.h>
+#include <CKPE.Common.CrashReport.h>
+
+namespace CKPE
+{
+	namespace Common
+	{
+		constexpr static std::size_t CRASHREPORT_BUFFER_SIZE = 1024 * 1024;
+		constexpr static std::size_t CRASHREPORT_STACK_SIZE = 512 * 1024;
+		constexpr static std::size_t CRASHREPORT_STACK_PRINT = 0x2500;
+		constexpr static std::uint32_t CRASHREPORT_MAX_MODULES = 1024;
+		constexpr static std::uint32_t CRASHREPORT_MAX_RECORDS = 4;
+		constexpr static std::uint32_t CRASHREPORT_MAX_CALLS = 128;
+
+		struct CrashReportModule
+		{
+			std::uintptr_t start;
+			std::uintptr_t end;
+			PESymbolizer::Image image;
+			char name[64];
+		};
+
+		struct CrashReportSnapshot
+		{
+			CONTEXT context;
+			EXCEPTION_RECORD records[CRASHREPORT_MAX_RECORDS];
+			std::uint32_t count_records;
+			std::uint32_t thread_id;
+			std::uintptr_t stack_base;
+			std::uintptr_t stack_limit;
+			// Copied from RSP to the base of the stack, no more than CRASHREPORT_STACK_SIZE
+			std::size_t stack_size;
+			std::uint8_t stack[CRASHREPORT_STACK_SIZE];
+			HMODULE handles[CRASHREPORT_MAX_MODULES];
+			CrashReportModule modules[CRASHREPORT_MAX_MODULES];
+			std::uint32_t count_modules;
+			std::size_t length;
+			char buffer[CRASHREPORT_BUFFER_SIZE];
+			// FILE_RENAME_INFO of the temporary file to the report, the full name is filled in at startup
+			alignas(FILE_RENAME_INFO) std::uint8_t rename[sizeof(FILE_RENAME_INFO) + MAX_PATH * sizeof(wchar_t)];
+		};
+
+		static CrashReportSnapshot* _ssnapshot = nullptr;
+		static HANDLE _sfile = INVALID_HANDLE_VALUE;
+		static std::atomic_bool _scaptured = false;
+		static bool _swritten = false;
+
+		static bool CopyMemorySafe(void* dst, const void* src, std::size_t size) noexcept(true)
+		{
+			__try
+			{
+				memcpy(dst, src, size);
+				return true;
+			}
+			__except (EXCEPTION_EXECUTE_HANDLER)
+			{
+				return false;
+			}
+		}
+
+		static void Append(const char* format, ...) noexcept(true)
+		{
+			auto& length = _ssnapshot->length;
+			if (length >= (CRASHREPORT_BUFFER_SIZE - 1))
+				return;
+
+			va_list ap;
+			va_start(ap, format);
+			auto written = _vsnprintf_s(_ssnapshot->buffer + length, CRASHREPORT_BUFFER_SIZE - length, _TRUNCATE,
+				format, ap);
+			va_end(ap);
+
+			length = (written < 0) ? (CRASHREPORT_BUFFER_SIZE - 1) : (length + (std::size_t)written);
+		}
+
+		[[nodiscard]] static const CrashReportModule* FindModule(std::uintptr_t address) noexcept(true)
+		{
+			auto begin = _ssnapshot->modules;
+			auto end = begin + _ssnapshot->count_modules;
+			auto it = std::upper_bound(begin, end, address,
+				[](std::uintptr_t address, const CrashReportModule& module) { return address < module.start; });
+			if (it == begin)
+				return nullptr;
+
+			--it;
+			return (address < it->end) ? it : nullptr;
+		}
+
+		// Appends the module and the function of the address, returns true for code
+		static bool AppendSymbol(std::uintptr_t address) noexcept(true)
+		{
+			auto module = FindModule(address);
+			if (!module)
+				return false;
+
+			auto rva = (std::uint32_t)(address - module->start);
+			if (!module->image.IsOpen() || !module->image.IsCode(rva))
+			{
+				Append(" %s+%X", module->name, rva);
+				return false;
+			}
+
+			PESymbolizer::Function function;
+			if (!module->image.FindFunction(rva, function))
+				Append(" %s+%X", module->name, rva);
+			else if (function.fragment_begin == function.begin)
+				Append(" %s+%X (sub_%X+%X)", module->name, rva, function.begin, rva - function.begin);
+			else
+				Append(" %s+%X (sub_%X part+%X)", module->name, rva, function.begin, rva - function.fragment_begin);
+
+			return true;
+		}
+
+		// A return address follows a call: E8 rel32, FF /2 with a register or a memory operand
+		[[nodiscard]] static bool IsReturnAddress(std::uintptr_t address) noexcept(true)
+		{
+			std::uint8_t code[7];
+			if (!CopyMemorySafe(code, (const void*)(address - sizeof(code)), sizeof(code)))
+				return false;
+
+			if (code[2] == 0xE8)
+				return true;
+
+			for (std::uint32_t length = 2; length <= 7; length++)
+			{
+				auto opcode = code[sizeof(code) - length];
+				auto modrm = code[sizeof(code) - length + 1];
+				if ((opcode == 0xFF) && (((modrm >> 3) & 7) == 2))
+					return true;
+			}
+
+			return false;
+		}
+
+		static void CollectModules() noexcept(true)
+		{
+			auto process = GetCurrentProcess();
+			DWORD needed = 0;
+
+			_ssnapshot->count_modules = 0;
+			if (!EnumProcessModules(process, _ssnapshot->handles, sizeof(_ssnapshot->handles), &needed))
+				return;
+
+			auto count = std::min((std::uint32_t)(needed / sizeof(HMODULE)), CRASHREPORT_MAX_MODULES);
+			for (std::uint32_t i = 0; i < count; i++)
+			{
+				MODULEINFO info{};
+				if (!GetModuleInformation(process, _ssnapshot->handles[i], &info, sizeof(info)))
+					continue;
+
+				auto& module = _ssnapshot->modules[_ssnapshot->count_modules++];
+				module.start = (std::uintptr_t)info.lpBaseOfDll;
+				module.end = module.start + info.SizeOfImage;
+				if (!GetModuleBaseNameA(process, _ssnapshot->handles[i], module.name, sizeof(module.name)))
+					strcpy_s(module.name, "<unknown>");
+
+				__try
+				{
+					module.image.Open(info.lpBaseOfDll, info.SizeOfImage, true);
+				}
+				__except (EXCEPTION_EXECUTE_HANDLER)
+				{
+					module.image = PESymbolizer::Image();
+				}
+			}
+
+			// Insertion sort, std::sort may allocate
+			auto modules = _ssnapshot->modules;
+			for (std::uint32_t i = 1; i < _ssnapshot->count_modules; i++)
+			{
+				auto module = modules[i];
+				auto j = i;
+				for (; j && (modules[j - 1].start > module.start); j--)
+					modules[j] = modules[j - 1];
+				modules[j] = module;
+			}
+		}
+
+		static void AppendException() noexcept(true)
+		{
+			for (std::uint32_t i = 0; i < _ssnapshot->count_records; i++)
+			{
+				auto& record = _ssnapshot->records[i];
+
+				Append("%sException 0x%08X at 0x%016llX", i ? "Nested " : "", record.ExceptionCode,
+					(std::uintptr_t)record.ExceptionAddress);
+				AppendSymbol((std::uintptr_t)record.ExceptionAddress);
+				Append("\n\tFlags: 0x%08X\n", record.ExceptionFlags);
+
+				if (((record.ExceptionCode == EXCEPTION_ACCESS_VIOLATION) ||
+					(record.ExceptionCode == EXCEPTION_IN_PAGE_ERROR)) && (record.NumberParameters >= 2))
+				{
+					auto access = record.ExceptionInformation[0];
+					Append("\tTried to %s memory at 0x%016llX\n",
+						(access == 0) ? "read" : ((access == 1) ? "write" : ((access == 8) ? "execute" : "access")),
+						record.ExceptionInformation[1]);
+				}
+				else
+				{
+					for (DWORD j = 0; j < std::min(record.NumberParameters, (DWORD)EXCEPTION_MAXIMUM_PARAMETERS); j++)
+						Append("\tParameter[%u]: 0x%016llX\n", j, record.ExceptionInformation[j]);
+				}
+			}
+
+			Append("Thread: %u\n\n", _ssnapshot->thread_id);
+		}
+
+		static void AppendRegisters() noexcept(true)
+		{
+			auto& context = _ssnapshot->context;
+
+			const struct { const char* name; DWORD64 value; } registers[] =
+			{
+				{ "RIP", context.Rip }, { "RAX", context.Rax }, { "RBX", context.Rbx }, { "RCX", context.Rcx },
+				{ "RDX", context.Rdx }, { "RBP", context.Rbp }, { "RSP", context.Rsp }, { "RSI", context.Rsi },
+				{ "RDI", context.Rdi }, { "R8 ", context.R8 }, { "R9 ", context.R9 }, { "R10", context.R10 },
+				{ "R11", context.R11 }, { "R12", context.R12 }, { "R13", context.R13 }, { "R14", context.R14 },
+				{ "R15", context.R15 },
+			};
+
+			Append("REGISTERS:\n");
+
+			for (auto& reg : registers)
+			{
+				Append("\t%s %016llX", reg.name, reg.value);
+				AppendSymbol((std::uintptr_t)reg.value);
+				Append("\n");
+			}
+
+			Append("\tEFLAGS %08X\n\n", context.EFlags);
+		}
+
+		static void AppendCallStack() noexcept(true)
+		{
+			auto slots = (const std::uintptr_t*)_ssnapshot->stack;
+			auto count = _ssnapshot->stack_size / sizeof(std::uintptr_t);
+
+			Append("PROBABLE CALL STACK:\n\t[RIP     ] 0x%016llX", _ssnapshot->context.Rip);
+			AppendSymbol((std::uintptr_t)_ssnapshot->context.Rip);
+			Append("\n");
+
+			std::uint32_t calls = 0;
+			for (std::size_t i = 0; (i < count) && (calls < CRASHREPORT_MAX_CALLS); i++)
+			{
+				auto module = FindModule(slots[i]);
+				if (!module || !module->image.IsOpen() || !module->image.IsCode((std::uint32_t)(slots[i] - module->start)) ||
+					!IsReturnAddress(slots[i]))
+					continue;
+
+				Append("\t[RSP+%-4llX] 0x%016llX", i * sizeof(std::uintptr_t), slots[i]);
+				AppendSymbol(slots[i]);
+				Append("\n");
+				calls++;
+			}
+
+			Append("\n");
+		}
+
+		static void AppendStack() noexcept(true)
+		{
+			auto slots = (const std::uintptr_t*)_ssnapshot->stack;
+			auto count = std::min(_ssnapshot->stack_size, CRASHREPORT_STACK_PRINT) / sizeof(std::uintptr_t);
+
+			Append("STACK:\n\tBase: %llX / %llX Last: %llX Copied: %llu bytes\n", _ssnapshot->stack_limit,
+				_ssnapshot->stack_base, _ssnapshot->context.Rsp, (std::uint64_t)_ssnapshot->stack_size);
+
+			for (std::size_t i = 0; i < count; i++)
+			{
+				Append("\t[RSP+%-4llX] 0x%016llX", i * sizeof(std::uintptr_t), slots[i]);
+				AppendSymbol(slots[i]);
+				Append("\n");
+			}
+
+			Append("\n");
+		}
+
+		static void AppendModules() noexcept(true)
+		{
+			Append("MODULES:\n\tTotal: %u\n", _ssnapshot->count_modules);
+
+			for (std::uint32_t i = 0; i < _ssnapshot->count_modules; i++)
+			{
+				auto& module = _ssnapshot->modules[i];
+				Append("\t%016llX %016llX %s\n", module.start, module.end, module.name);
+			}
+
+			Append("\n");
+		}
+
+		static void Format() noexcept(true)
+		{
+			__try
+			{
+				CollectModules();
+
+				Append("====== CRASH REPORT ======\n\n");
+				AppendException();
+				AppendRegisters();
+				AppendCallStack();
+				AppendStack();
+				AppendModules();
+			}
+			__except (EXCEPTION_EXECUTE_HANDLER)
+			{
+				Append("\n<FAILED TO FORMAT THE REPORT>\n\n");
+			}
+		}
+
+		bool CrashReport::Initialize(const char* fname) noexcept(true)
+		{
+			if (_ssnapshot)
+				return true;
+
+			// Not from the heap, it may be broken or locked at the time of the crash
+			_ssnapshot = (CrashReportSnapshot*)VirtualAlloc(nullptr, sizeof(CrashReportSnapshot),
+				MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+			if (!_ssnapshot)
+				return false;
+
+			// The report of the previous session is not touched: a temporary file of this process is opened,
+			// it's renamed to the report only when there is a crash
+			wchar_t name[MAX_PATH], temp[MAX_PATH + 32];
+			auto rename = (FILE_RENAME_INFO*)_ssnapshot->rename;
+			auto length = MultiByteToWideChar(CP_ACP, 0, fname, -1, name, MAX_PATH) ?
+				GetFullPathNameW(name, MAX_PATH, rename->FileName, nullptr) : 0;
+			if (length && (length < MAX_PATH))
+			{
+				rename->ReplaceIfExists = TRUE;
+				rename->RootDirectory = nullptr;
+				rename->FileNameLength = length * sizeof(wchar_t);
+
+				swprintf_s(temp, L"%s.%u.tmp", rename->FileName, GetCurrentProcessId());
+				_sfile = CreateFileW(temp, GENERIC_WRITE | DELETE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+					nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+			}
+
+			if (_sfile == INVALID_HANDLE_VALUE)
+			{
+				VirtualFree(_ssnapshot, 0, MEM_RELEASE);
+				_ssnapshot = nullptr;
+				return false;
+			}
+
+			// Removed when the handle is closed by the system on exit, unless it is cancelled by a crash
+			FILE_DISPOSITION_INFO disposition{ TRUE };
+			SetFileInformationByHandle(_sfile, FileDispositionInfo, &disposition, sizeof(disposition));
+
+			return true;
+		}
+
+		void CrashReport::Capture(void* ExceptionInfo, void* Tib) noexcept(true)
+		{
+			auto info = (PEXCEPTION_POINTERS)ExceptionInfo;
+			if (!_ssnapshot || !info || _scaptured.exchange(true))
+				return;
+
+			// Only copying: the stack of the thread may be almost exhausted
+			CopyMemorySafe(&_ssnapshot->context, info->ContextRecord, sizeof(CONTEXT));
+
+			_ssnapshot->count_records = 0;
+			for (auto record = info->ExceptionRecord; record && (_ssnapshot->count_records < CRASHREPORT_MAX_RECORDS);
+				record = record->ExceptionRecord)
+			{
+				if (!CopyMemorySafe(&_ssnapshot->records[_ssnapshot->count_records], record, sizeof(EXCEPTION_RECORD)))
+					break;
+
+				_ssnapshot->count_records++;
+			}
+
+			_ssnapshot->thread_id = GetCurrentThreadId();
+			_ssnapshot->stack_size = 0;
+
+			auto tib = (NT_TIB64*)Tib;
+			if (!tib)
+				return;
+
+			_ssnapshot->stack_base = (std::uintptr_t)tib->StackBase;
+			_ssnapshot->stack_limit = (std::uintptr_t)tib->StackLimit;
+
+			auto rsp = (std::uintptr_t)_ssnapshot->context.Rsp;
+			if ((rsp >= _ssnapshot->stack_limit) && (rsp < _ssnapshot->stack_base))
+			{
+				auto size = std::min((std::size_t)(_ssnapshot->stack_base - rsp), CRASHREPORT_STACK_SIZE);
+				if (CopyMemorySafe(_ssnapshot->stack, (const void*)rsp, size))
+					_ssnapshot->stack_size = size;
+			}
+		}
+
+		bool CrashReport::Write() noexcept(true)
+		{
+			if (!_scaptured || _swritten || (_sfile == INVALID_HANDLE_VALUE))
+				return false;
+
+			_ssnapshot->length = 0;
+			Format();
+
+			FILE_DISPOSITION_INFO disposition{ FALSE };
+			SetFileInformationByHandle(_sfile, FileDispositionInfo, &disposition, sizeof(disposition));
+
+			auto data = _ssnapshot->buffer;
+			auto size = _ssnapshot->length;
+			while (size)
+			{
+				DWORD written = 0;
+				if (!WriteFile(_sfile, data, (DWORD)std::min(size, (std::size_t)0x10000000), &written, nullptr) || !written)
+					break;
+
+				data += written;
+				size -= written;
+			}
+
+			SetEndOfFile(_sfile);
+
+			// If the rename fails, the report stays in the temporary file
+			auto rename = (FILE_RENAME_INFO*)_ssnapshot->rename;
+			SetFileInformationByHandle(_sfile, FileRenameInfo, rename, sizeof(FILE_RENAME_INFO) + rename->FileNameLength);
+			CloseHandle(_sfile);
+			_sfile = INVALID_HANDLE_VALUE;
+
+			_swritten = !size;
+			return _swritten;
+		}
+
+		bool CrashReport::HasWritten() noexcept(true)
+		{
+			return _swritten;
+		}
+
+		bool CrashReport::HasCaptured() noexcept(true)
+		{
+			return _scaptured;
+		}
+	}
+}
@@ -5,12 +5,17 @@
 #include <algorithm>
 #include <CKPE.Asserts.h>
 #include <CKPE.Common.Interface.h>
+#include <CKPE.Common.SettingHandle.h>
 #include <CKPE.Common.D3D11Proxy.h>
 
 namespace CKPE
 {
 	namespace Common
 	{
+		// Samplers created after the options were changed get the new values
+		static SettingHandle<float> _smip_lod_bias("Graphics:fMipLODBias", 0.f);
+		static SettingHandle<unsigned long> _smax_anisotropy("Graphics:uMaxAnisotropy", 0);
+
 		D3D11DeviceProxy::D3D11DeviceProxy(ID3D11Device *Device)
 		{
 			HRESULT hr = Device->QueryInterface<ID3D11Device2>(&m_Device);
@@ -22,10 +27,6 @@ namespace CKPE
 			m_Device->GetImmediateContext2(&temp);
 
 			m_ContextProxy = new D3D11DeviceContextProxy(temp);
-			m_MipLODBias = std::min(5.f, std::max(-5.f, 
-				_READ_OPTION_FLOAT("Graphics", "fMipLODBias", 0.f)));
-			m_MaxAnisotropy = std::min(16ul, std::max(0ul,
-				_READ_OPTION_UINT("Graphics", "uMaxAnisotropy", 0)));
 		}
 
 		D3D11DeviceProxy::D3D11DeviceProxy(ID3D11Device2 *Device)
@@ -36,10 +37,6 @@ namespace CKPE
 			m_Device->GetImmediateContext2(&temp);
 
 			m_ContextProxy = new D3D11DeviceContextProxy(temp);
-			m_MipLODBias = std::min(5.f, std::max(-5.f,
-				_READ_OPTION_FLOAT("Graphics", "fMipLODBias", 0.f)));
-			m_MaxAnisotropy = std::min(16ul, std::max(0ul,
-				_READ_OPTION_UINT("Graphics", "uMaxAnisotropy", 0)));
 		}
 
 		HRESULT STDMETHODCALLTYPE D3D11DeviceProxy::QueryInterface(REFIID riid, void **ppvObj)
@@ -199,9 +196,9 @@ namespace CKPE
 				auto SamplerDesc = const_cast<D3D11_SAMPLER_DESC*>(pSamplerDesc);
 
 				if (SamplerDesc->Filter == D3D11_FILTER_ANISOTROPIC)
-					SamplerDesc->MaxAnisotropy = m_MaxAnisotropy;
+					SamplerDesc->MaxAnisotropy = std::min(_smax_anisotropy.Get(), 16ul);
 
-				SamplerDesc->MipLODBias = m_MipLODBias;		// mipmap level bias value
+				SamplerDesc->MipLODBias = std::clamp(_smip_lod_bias.Get(), -5.f, 5.f);		// mipmap level bias value
 				SamplerDesc->MinLOD = 0.0f;					// alternative minimum mipmap level
 				SamplerDesc->MaxLOD = D3D11_FLOAT32_MAX;	// alternative maximum mipmap level
 			}
@@ -0,0 +1,346 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#include <windows.h>
+#include <CKPE.Stream.h>
+#include <CKPE.HashUtils.h>
+#include <CKPE.PathUtils.h>
+#include <CKPE.StringUtils.h>
+#include <CKPE.PESymbolizer.h>
+#include <CKPE.Common.Interface.h>
+#include <CKPE.Common.CrashHandler.h>
+#include <CKPE.Common.CrashReport.h>
+#include <CKPE.Common.HangWatchdog.h>
+#include <CKPE.Common.ThreadSampler.h>
+#include <unordered_map>
+#include <algorithm>
+#include <vector>
+#include <atomic>
+#include <thread>
+
+namespace CKPE
+{
+	namespace Common
+	{
+		constexpr static std::uint32_t HANGWATCHDOG_MAX_FRAMES = 64;
+		constexpr static std::uint32_t HANGWATCHDOG_PING_MS = 500;
+		constexpr static std::uint32_t HANGWATCHDOG_TOP_FUNCTIONS = 15;
+		constexpr static std::uint32_t HANGWATCHDOG_TOP_STACKS = 5;
+
+		struct HangSample
+		{
+			std::uintptr_t frames[HANGWATCHDOG_MAX_FRAMES];
+			std::uint32_t count_frames;
+		};
+
+		struct HangCounter
+		{
+			std::uint32_t self{ 0 };
+			std::uint32_t total{ 0 };
+			std::uint32_t last_sample{ 0 };
+			std::uintptr_t address{ 0 };
+		};
+
+		static bool _senabled = false;
+		static DWORD _smain_thread_id = 0;
+		static HANDLE _smain_thread = nullptr;
+		static HHOOK _shook = nullptr;
+		// Tick of the last message retrieved by the main thread, zero until the message loop starts
+		static std::atomic_uint64_t _sheartbeat = 0;
+		static std::uint32_t _stimeout = 10;
+		static std::uint32_t _sinterval = 50;
+		static std::uint32_t _smax_samples = 200;
+		static HANDLE _sclose_event = nullptr;
+		static std::thread* _swatchdog_thread = nullptr;
+
+		static LRESULT CALLBACK GetMessageProc(int code, WPARAM wParam, LPARAM lParam) noexcept(true)
+		{
+			_sheartbeat.store(GetTickCount64(), std::memory_order_relaxed);
+			return CallNextHookEx(nullptr, code, wParam, lParam);
+		}
+
+		static void WriteReport(const PESymbolizer::ModuleTable& modules, const HangSample* samples,
+			std::uint32_t count, std::uint64_t duration, bool recovered) noexcept(true)
+		{
+			auto FormatAddress = [&modules](std::uintptr_t address) -> std::string
+				{
+					PESymbolizer::Symbol symbol;
+					if (!modules.Symbolize(address, symbol))
+						return StringUtils::FormatString("%016llX", address);
+
+					auto text = StringUtils::FormatString("%s+%X", symbol.module->name.c_str(), symbol.rva);
+					if (symbol.has_function)
+						text.append(StringUtils::FormatString(" (sub_%X+%X)", symbol.function.begin,
+							symbol.rva - symbol.function.begin));
+					return text;
+				};
+
+			// Samples are grouped by function, the address of an unknown function is used as is
+			auto FunctionOf = [&modules](std::uintptr_t address) -> std::uintptr_t
+				{
+					PESymbolizer::Symbol symbol;
+					if (modules.Symbolize(address, symbol) && symbol.has_function)
+						return symbol.module->start + symbol.function.begin;
+					return address;
+				};
+
+			std::unordered_map<std::uintptr_t, HangCounter> functions;
+			std::unordered_map<std::uint64_t, std::pair<std::uint32_t, std::uint32_t>> stacks;
+
+			for (std::uint32_t i = 0; i < count; i++)
+			{
+				auto& sample = samples[i];
+
+				for (std::uint32_t j = 0; j < sample.count_frames; j++)
+				{
+					auto function = FunctionOf(sample.frames[j]);
+					auto& counter = functions[function];
+					counter.address = function;
+
+					if (!j)
+						counter.self++;
+
+					// Recursion counts once per sample
+					if (!counter.total || (counter.last_sample != i))
+					{
+						counter.total++;
+						counter.last_sample = i;
+					}
+				}
+
+				auto& stack = stacks[HashUtils::MurmurHash64A(sample.frames, sample.count_frames * sizeof(std::uintptr_t))];
+				if (!stack.first++)
+					stack.second = i;
+			}
+
+			SYSTEMTIME sysTime;
+			GetSystemTime(&sysTime);
+
+			auto fname = StringUtils::FormatString(L"%s_%4d%02d%02d_%02d%02d%02d.log",
+				PathUtils::ExtractFileName(PathUtils::GetApplicationFileName()).c_str(), sysTime.wYear, sysTime.wMonth,
+				sysTime.wDay, sysTime.wHour, sysTime.wMinute, sysTime.wSecond);
+			PathUtils::CreateFolder(PathUtils::GetCKPELogsPath() + L"Hangs");
+			fname = PathUtils::GetCKPELogsPath() + L"Hangs\\" + fname;
+
+			try
+			{
+				TextFileStream Stream(fname, FileStream::fmCreate);
+
+				Stream.WriteString("====== HANG INFO ======\n\n");
+
+				auto handler = CrashHandler::GetSingleton();
+				if (handler && handler->OnOutputCKVersion)
+				{
+					std::string str;
+					handler->OnOutputCKVersion(str);
+					Stream.WriteLine("CK %s", str.c_str());
+				}
+
+				Stream.WriteLine("The main thread (id: %u) hasn't processed messages for %.1f sec, %s.", _smain_thread_id,
+					(double)duration / 1000.0, recovered ? "then it has resumed" : "it still doesn't respond");
+				Stream.WriteLine("Samples: %u (interval: %u ms)\n", count, _sinterval);
+
+				std::vector<HangCounter> sorted;
+				sorted.reserve(functions.size());
+				for (auto& it : functions)
+					sorted.push_back(it.second);
+
+				auto top = std::min((std::size_t)HANGWATCHDOG_TOP_FUNCTIONS, sorted.size());
+
+				// Self: where the thread is right now, total: who called it
+				std::partial_sort(sorted.begin(), sorted.begin() + top, sorted.end(),
+					[](const HangCounter& a, const HangCounter& b) { return a.self > b.self; });
+
+				Stream.WriteString("TOP FUNCTIONS (SELF):\n");
+				for (std::size_t i = 0; (i < top) && sorted[i].self; i++)
+					Stream.WriteLine("\t%5.1f%%\t%5u\t%s", sorted[i].self * 100.0 / count, sorted[i].self,
+						FormatAddress(sorted[i].address).c_str());
+
+				std::partial_sort(sorted.begin(), sorted.begin() + top, sorted.end(),
+					[](const HangCounter& a, const HangCounter& b) { return a.total > b.total; });
+
+				Stream.WriteString("\nTOP FUNCTIONS (TOTAL):\n");
+				for (std::size_t i = 0; i < top; i++)
+					Stream.WriteLine("\t%5.1f%%\t%5u\t%s", sorted[i].total * 100.0 / count, sorted[i].total,
+						FormatAddress(sorted[i].address).c_str());
+
+				std::vector<std::pair<std::uint32_t, std::uint32_t>> sorted_stacks;
+				sorted_stacks.reserve(stacks.size());
+				for (auto& it : stacks)
+					sorted_stacks.push_back(it.second);
+
+				auto top_stacks = std::min((std::size_t)HANGWATCHDOG_TOP_STACKS, sorted_stacks.size());
+				std::partial_sort(sorted_stacks.begin(), sorted_stacks.begin() + top_stacks, sorted_stacks.end(),
+					[](const auto& a, const auto& b) { return a.first > b.first; });
+
+				Stream.WriteLine("\nTOP STACKS (unique: %llu):", sorted_stacks.size());
+				for (std::size_t i = 0; i < top_stacks; i++)
+				{
+					auto& sample = samples[sorted_stacks[i].second];
+					Stream.WriteLine("\t#%llu %u samples (%.1f%%):", i + 1, sorted_stacks[i].first,
+						sorted_stacks[i].first * 100.0 / count);
+
+					for (std::uint32_t j = 0; j < sample.count_frames; j++)
+						Stream.WriteLine("\t\t[%2u] %s", j, FormatAddress(sample.frames[j]).c_str());
+				}
+
+				Stream.WriteString("\nMODULES:\n");
+
+				std::size_t column_max = 0;
+				for (auto& it : modules)
+					column_max = std::max(column_max, it.name.length());
+
+				for (auto& it : modules)
+					Stream.WriteLine("\t%-*s\t%016llX", (unsigned int)column_max, it.name.c_str(), it.start);
+
+				Stream.WriteString("\n");
+				Stream.Flush();
+			}
+			catch (const std::exception& e)
+			{
+				_ERROR("Hang watchdog: %s", e.what());
+				return;
+			}
+
+			_WARNING("Hang watchdog: the main thread didn't respond for %.1f sec, the report is \"%s\"",
+				(double)duration / 1000.0, StringUtils::Utf16ToWinCP(fname).c_str());
+		}
+
+		static void SampleHang(std::uint64_t heartbeat) noexcept(true)
+		{
+			// Before the thread is suspended, the stacks are unwound by this table
+			PESymbolizer::ModuleTable modules;
+			CrashHandler::BuildModuleTable(modules);
+
+			ThreadSampler sampler;
+			auto samples = new HangSample[_smax_samples];
+			std::uint32_t count = 0;
+
+			for (std::uint32_t i = 0; (i < _smax_samples) &&
+				(WaitForSingleObject(_sclose_event, _sinterval) == WAIT_TIMEOUT) &&
+				(_sheartbeat.load(std::memory_order_relaxed) == heartbeat); i++)
+			{
+				samples[count].count_frames = sampler.Capture(_smain_thread, modules, samples[count].frames,
+					HANGWATCHDOG_MAX_FRAMES);
+				if (samples[count].count_frames)
+					count++;
+			}
+
+			// No samples: the thread has responded within the first interval (after a sleep of the system),
+			// it wasn't a hang
+			if (count)
+				WriteReport(modules, samples, count, GetTickCount64() - heartbeat,
+					_sheartbeat.load(std::memory_order_relaxed) != heartbeat);
+
+			delete[] samples;
+
+			// One report per hang
+			while ((_sheartbeat.load(std::memory_order_relaxed) == heartbeat) &&
+				(WaitForSingleObject(_sclose_event, HANGWATCHDOG_PING_MS) == WAIT_TIMEOUT));
+		}
+
+		static void WatchdogProc() noexcept(true)
+		{
+			std::uint64_t pinged = ~0ull;
+
+			while (WaitForSingleObject(_sclose_event, HANGWATCHDOG_PING_MS) == WAIT_TIMEOUT)
+			{
+				auto heartbeat = _sheartbeat.load(std::memory_order_relaxed);
+
+				// An idle message loop waits in GetMessage, a posted message makes it beat.
+				// The next one is posted after the previous one is retrieved, the queue of a hung thread isn't filled.
+				if (heartbeat != pinged)
+				{
+					pinged = heartbeat;
+					PostThreadMessageW(_smain_thread_id, WM_NULL, 0, 0);
+				}
+
+				if (!heartbeat || ((GetTickCount64() - heartbeat) < (_stimeout * 1000ull)))
+					continue;
+
+				// The debugger stops all threads, the crash handler stops the main thread on purpose
+				if (IsDebuggerPresent() || CrashReport::HasCaptured())
+					continue;
+
+				SampleHang(heartbeat);
+			}
+		}
+
+		void HangWatchdog::Initialize() noexcept(true)
+		{
+			if (_senabled || !_READ_OPTION_BOOL("Crashes", "bHangWatchdog", false))
+				return;
+
+			_stimeout = std::max(_READ_OPTION_UINT("Crashes", "uHangTimeout", 10), 2ul);
+			_sinterval = std::clamp(_READ_OPTION_UINT("Crashes", "uHangSampleInterval", 50), 10ul, 1000ul);
+			_smax_samples = std::clamp(_READ_OPTION_UINT("Crashes", "uHangMaxSamples", 200), 10ul, 10000ul);
+
+			_smain_thread_id = GetCurrentThreadId();
+			_smain_thread = OpenThread(THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT | THREAD_QUERY_INFORMATION, FALSE,
+				_smain_thread_id);
+			if (!_smain_thread)
+			{
+				_ERROR("Hang watchdog: OpenThread failed (error: %u)", GetLastError());
+				return;
+			}
+
+			_shook = SetWindowsHookExW(WH_GETMESSAGE, &GetMessageProc, nullptr, _smain_thread_id);
+			if (!_shook)
+			{
+				_ERROR("Hang watchdog: SetWindowsHookEx failed (error: %u)", GetLastError());
+				CloseHandle(_smain_thread);
+				_smain_thread = nullptr;
+				return;
+			}
+
+			_sclose_event = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+			_swatchdog_thread = new std::thread(&WatchdogProc);
+
+			_senabled = true;
+
+			_MESSAGE("Hang watchdog: enabled (timeout: %u sec, sample interval: %u ms)", _stimeout, _sinterval);
+		}
+
+		void HangWatchdog::Shutdown() noexcept(true)
+		{
+			if (!_senabled)
+				return;
+
+			_senabled = false;
+
+			if (_shook)
+			{
+				UnhookWindowsHookEx(_shook);
+				_shook = nullptr;
+			}
+
+			if (_swatchdog_thread)
+			{
+				SetEvent(_sclose_event);
+				if (_swatchdog_thread->joinable())
+					_swatchdog_thread->join();
+
+				delete _swatchdog_thread;
+				_swatchdog_thread = nullptr;
+			}
+
+			if (_sclose_event)
+			{
+				CloseHandle(_sclose_event);
+				_sclose_event = nullptr;
+			}
+
+			if (_smain_thread)
+			{
+				CloseHandle(_smain_thread);
+				_smain_thread = nullptr;
+			}
+		}
+
+		bool HangWatchdog::HasEnabled() noexcept(true)
+		{
+			return _senabled;
+		}
+	}
+}
@@ -0,0 +1,101 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#include <windows.h>
+#include <CKPE.Common.INIIndex.h>
+#include <algorithm>
+#include <cstring>
+
+namespace CKPE
+{
+	namespace Common
+	{
+		// Larger INI files are not settings
+		constexpr static std::size_t INIINDEX_MAX_SIZE = 64 * 1024 * 1024;
+
+		INIIndex::~INIIndex() noexcept(true)
+		{
+			Clear();
+		}
+
+		void INIIndex::Clear() noexcept(true)
+		{
+			delete[] _text;
+			_text = nullptr;
+			_size = 0;
+
+			delete _entries;
+			_entries = nullptr;
+		}
+
+		bool INIIndex::Open(const std::wstring& filename) noexcept(true)
+		{
+			Clear();
+
+			// Not mapped: a mapped file can't be truncated, the editor would fail to write its INI
+			auto file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+				nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				return false;
+
+			LARGE_INTEGER size{};
+			bool result = GetFileSizeEx(file, &size) && ((std::uint64_t)size.QuadPart <= INIINDEX_MAX_SIZE);
+			if (result)
+			{
+				_size = (std::size_t)size.QuadPart;
+				_text = new char[_size + 1];
+
+				DWORD read = 0;
+				result = ReadFile(file, _text, (DWORD)_size, &read, nullptr) && (read == _size);
+			}
+
+			CloseHandle(file);
+
+			if (!result)
+			{
+				Clear();
+				return false;
+			}
+
+			_text[_size] = '\0';
+			return DoParse();
+		}
+
+		bool INIIndex::Parse(const char* text, std::size_t length) noexcept(true)
+		{
+			Clear();
+
+			if (!text || (length > INIINDEX_MAX_SIZE))
+				return false;
+
+			_size = length;
+			_text = new char[_size + 1];
+			memcpy(_text, text, _size);
+			_text[_size] = '\0';
+
+			return DoParse();
+		}
+
+		bool INIIndex::DoParse() noexcept(true)
+		{
+			_entries = new std::vector<Entry>;
+			INIParser::Parse(_text, _size, _syntax, *_entries);
+			return true;
+		}
+
+		bool INIIndex::Find(const std::string_view& section, const std::string_view& key,
+			std::string_view& value) const noexcept(true)
+		{
+			if (!_entries)
+				return false;
+
+			auto entry = INIParser::Find(_text, *_entries, section, key);
+			if (!entry)
+				return false;
+
+			value = std::string_view(_text + entry->value, entry->value_length);
+			return true;
+		}
+	}
+}
@@ -0,0 +1,216 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#include <windows.h>
+#include <CKPE.Detours.h>
+#include <CKPE.Application.h>
+#include <CKPE.StringUtils.h>
+#include <CKPE.Common.Interface.h>
+#include <CKPE.Common.INIIndex.h>
+#include <CKPE.Common.INIProfileCache.h>
+#include <unordered_map>
+#include <shared_mutex>
+#include <algorithm>
+#include <string>
+#include <atomic>
+
+namespace CKPE
+{
+	namespace Common
+	{
+		constexpr static std::uint64_t INIPROFILECACHE_CHECK_INTERVAL_MS = 1000;
+
+		struct INIProfileCacheFile
+		{
+			INIIndex index;
+			std::uint64_t write_time{ 0 };
+			std::atomic_uint64_t next_check{ 0 };
+		};
+
+		using INIProfileCacheMap = std::unordered_map<std::string, INIProfileCacheFile*>;
+
+		static bool _senabled = false;
+		static std::shared_mutex _slock;
+		static INIProfileCacheMap* _sfiles = nullptr;
+		static std::uintptr_t _sGetPrivateProfileStringA = 0;
+		static std::uintptr_t _sWritePrivateProfileStringA = 0;
+
+		[[nodiscard]] static std::string GetFileKey(const char* fname) noexcept(true)
+		{
+			std::string key = fname;
+			for (auto& ch : key)
+			{
+				if (ch == '/') ch = '\\';
+				else if ((ch >= 'A') && (ch <= 'Z')) ch += 'a' - 'A';
+			}
+			return key;
+		}
+
+		[[nodiscard]] static bool GetLastWriteTime(const char* fname, std::uint64_t& write_time) noexcept(true)
+		{
+			WIN32_FILE_ATTRIBUTE_DATA data{};
+			if (!GetFileAttributesExA(fname, GetFileExInfoStandard, &data) ||
+				(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+				return false;
+
+			write_time = ((std::uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+			return true;
+		}
+
+		[[nodiscard]] static bool IsCurrent(INIProfileCacheFile* file) noexcept(true)
+		{
+			return GetTickCount64() < file->next_check.load(std::memory_order_relaxed);
+		}
+
+		// Returns the copy of the file under the shared lock, or nullptr (the lock isn't taken)
+		[[nodiscard]] static INIProfileCacheFile* AcquireFile(const char* fname, const std::string& key) noexcept(true)
+		{
+			{
+				_slock.lock_shared();
+
+				auto it = _sfiles->find(key);
+				if ((it != _sfiles->end()) && IsCurrent(it->second))
+					return it->second;
+
+				_slock.unlock_shared();
+			}
+
+			std::uint64_t write_time = 0;
+			if (!GetLastWriteTime(fname, write_time))
+				return nullptr;
+
+			{
+				std::unique_lock guard(_slock);
+
+				auto& file = (*_sfiles)[key];
+				if (!file)
+					file = new INIProfileCacheFile;
+
+				if (file->index.IsEmpty() || (file->write_time != write_time))
+				{
+					file->write_time = write_time;
+					if (!file->index.Open(StringUtils::WinCPToUtf16(fname)))
+					{
+						delete file;
+						_sfiles->erase(key);
+						return nullptr;
+					}
+				}
+
+				file->next_check.store(GetTickCount64() + INIPROFILECACHE_CHECK_INTERVAL_MS, std::memory_order_relaxed);
+			}
+
+			// Taken again, a writer may have dropped the copy in between
+			_slock.lock_shared();
+
+			auto it = _sfiles->find(key);
+			if (it != _sfiles->end())
+				return it->second;
+
+			_slock.unlock_shared();
+			return nullptr;
+		}
+
+		static DWORD WINAPI HKGetPrivateProfileStringA(LPCSTR lpAppName, LPCSTR lpKeyName, LPCSTR lpDefault,
+			LPSTR lpReturnedString, DWORD nSize, LPCSTR lpFileName) noexcept(true)
+		{
+			// Enumerations of sections and keys, the Windows directory and the registry mappings go to the API
+			if (!lpAppName || !lpKeyName || !lpFileName || !lpReturnedString || !nSize ||
+				(!strchr(lpFileName, '\\') && !strchr(lpFileName, '/')))
+				return ((decltype(&GetPrivateProfileStringA))_sGetPrivateProfileStringA)(lpAppName, lpKeyName,
+					lpDefault, lpReturnedString, nSize, lpFileName);
+
+			auto key = GetFileKey(lpFileName);
+			auto file = AcquireFile(lpFileName, key);
+			if (!file)
+				return ((decltype(&GetPrivateProfileStringA))_sGetPrivateProfileStringA)(lpAppName, lpKeyName,
+					lpDefault, lpReturnedString, nSize, lpFileName);
+
+			std::string_view value;
+			if (file->index.Find(lpAppName, lpKeyName, value))
+			{
+				// As the API does, the quotes are removed only in pairs
+				if ((value.length() >= 2) && ((value.front() == '"') || (value.front() == '\'')) &&
+					(value.back() == value.front()))
+					value = value.substr(1, value.length() - 2);
+			}
+			else
+			{
+				value = lpDefault ? lpDefault : "";
+				while (!value.empty() && (value.back() == ' '))
+					value.remove_suffix(1);
+			}
+
+			auto length = std::min((std::size_t)nSize - 1, value.length());
+			memcpy(lpReturnedString, value.data(), length);
+			lpReturnedString[length] = '\0';
+
+			_slock.unlock_shared();
+			return (DWORD)length;
+		}
+
+		static BOOL WINAPI HKWritePrivateProfileStringA(LPCSTR lpAppName, LPCSTR lpKeyName, LPCSTR lpString,
+			LPCSTR lpFileName) noexcept(true)
+		{
+			auto result = ((decltype(&WritePrivateProfileStringA))_sWritePrivateProfileStringA)(lpAppName, lpKeyName,
+				lpString, lpFileName);
+
+			if (lpFileName)
+			{
+				std::unique_lock guard(_slock);
+
+				auto it = _sfiles->find(GetFileKey(lpFileName));
+				if (it != _sfiles->end())
+				{
+					delete it->second;
+					_sfiles->erase(it);
+				}
+			}
+
+			return result;
+		}
+
+		void INIProfileCache::Initialize() noexcept(true)
+		{
+			if (_senabled || !_READ_OPTION_BOOL("CreationKit", "bINIProfileCache", false))
+				return;
+
+			auto base = Interface::GetSingleton()->GetApplication()->GetBase();
+
+			_sfiles = new INIProfileCacheMap;
+			_sWritePrivateProfileStringA = Detours::DetourIAT(base, "kernel32.dll", "WritePrivateProfileStringA",
+				(std::uintptr_t)&HKWritePrivateProfileStringA);
+			_sGetPrivateProfileStringA = Detours::DetourIAT(base, "kernel32.dll", "GetPrivateProfileStringA",
+				(std::uintptr_t)&HKGetPrivateProfileStringA);
+
+			if (!_sGetPrivateProfileStringA)
+			{
+				if (_sWritePrivateProfileStringA)
+					Detours::DetourIAT(base, "kernel32.dll", "WritePrivateProfileStringA", _sWritePrivateProfileStringA);
+
+				_WARNING("INI profile cache: the editor doesn't import GetPrivateProfileStringA");
+				return;
+			}
+
+			_senabled = true;
+			_MESSAGE("INI profile cache: enabled");
+		}
+
+		void INIProfileCache::Shutdown() noexcept(true)
+		{
+			if (!_senabled)
+				return;
+
+			_senabled = false;
+
+			auto base = Interface::GetSingleton()->GetApplication()->GetBase();
+
+			Detours::DetourIAT(base, "kernel32.dll", "GetPrivateProfileStringA", _sGetPrivateProfileStringA);
+			if (_sWritePrivateProfileStringA)
+				Detours::DetourIAT(base, "kernel32.dll", "WritePrivateProfileStringA", _sWritePrivateProfileStringA);
+
+			// The copies are kept, a call may still be running
+		}
+	}
+}
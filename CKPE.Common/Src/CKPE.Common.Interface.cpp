@@ -16,6 +16,12 @@
 #include <CKPE.Common.GenerateTableID.h>
 #endif
 #include <CKPE.Common.Registry.h>
+#include <CKPE.Common.AllocationTracker.h>
+#include <CKPE.Common.MemoryPressure.h>
+#include <CKPE.Common.SettingHandle.h>
+#include <CKPE.Common.INIProfileCache.h>
+#include <CKPE.Common.HangWatchdog.h>
+#include <CKPE.Common.Profiler.h>
 #include <CKPE.Common.RTTI.h>
 #include <CKPE.Exception.h>
 #include <algorithm>
@@ -33,6 +39,12 @@ namespace CKPE
 
 		Interface::~Interface() noexcept(true)
 		{
+			Profiler::Shutdown();
+			HangWatchdog::Shutdown();
+			INIProfileCache::Shutdown();
+			CustomSettingHandle::Shutdown();
+			MemoryPressure::Shutdown();
+			AllocationTracker::Shutdown();
 			LogWindow::Shutdown();
 
 			if (_settings)
@@ -75,6 +87,8 @@ namespace CKPE
 					_theme_settings = new TOMLSettingCollection(spath + _stheme_settings_fname);
 				else
 					_theme_settings = nullptr;
+				// Handles created before the settings were loaded still hold the defaults
+				CustomSettingHandle::Refresh(_settings);
 				_version = FileUtils::GetFileVersion(spath + _dllName);
 				Common::PatchManager::GetSingleton()->OpenBlackList();
 
@@ -349,8 +363,31 @@ namespace CKPE
 				else if (_READ_OPTION_BOOL("CreationKit", "bUIDarkTheme", false))
 					ModernTheme::Hook::Initialize();
 
+				// STRUCTURED LOG (before the log window, to get its first lines too)
+				auto structuredLog = _READ_OPTION_USTR("Log", "sStructuredLogFile", L"none");
+				if (!structuredLog.empty() && _wcsicmp(structuredLog.c_str(), L"none") &&
+					!_interface->logger->EnableStructured(structuredLog))
+					_ERROR(L"Unable to open the structured log '%s' for writing", structuredLog.c_str());
+
 				// LOG WINDOW
 				/* call constructor */ new LogWindow();		
+
+				// LOG FILE
+				if (_READ_OPTION_BOOL("Log", "bAsyncLogFile", true))
+					_interface->logger->EnableAsync(_READ_OPTION_UINT("Log", "uAsyncLogBufferKB", 2048) * 1024,
+						_READ_OPTION_BOOL("Log", "bAsyncLogBlockWhenFull", true));
+
+				// MEMORY
+				MemoryPressure::Initialize();
+				AllocationTracker::Initialize();
+
+				// SETTINGS
+				CustomSettingHandle::Initialize();
+				INIProfileCache::Initialize();
+
+				// DIAGNOSTICS
+				HangWatchdog::Initialize();
+				Profiler::Initialize();
 			}
 
 			char timeBuffer[80];
@@ -3,19 +3,27 @@
 // License: https://www.gnu.org/licenses/lgpl-3.0.html
 
 #include <windows.h>
-#include <richedit.h>
+#include <windowsx.h>
+#include <commctrl.h>
+#include <commdlg.h>
+#include <shlwapi.h>
 #include <CKPE.Application.h>
 #include <CKPE.Exception.h>
 #include <CKPE.HashUtils.h>
 #include <CKPE.Stream.h>
 #include <CKPE.PathUtils.h>
 #include <CKPE.MessageBox.h>
+#include <CKPE.CriticalSection.h>
 #include <CKPE.Common.Interface.h>
 #include <CKPE.Common.MemoryManager.h>
 #include <CKPE.Common.ClassicTheme.h>
 #include <CKPE.Common.ModernTheme.h>
-#include <concurrent_vector.h>
-#include <unordered_set>
+#include <CKPE.Common.UIVarCommon.h>
+#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <vector>
 #include <thread>
 #include <stdexcept>
 #include <memory>
@@ -30,17 +38,279 @@ namespace CKPE
 		constexpr static auto UI_LOG_CMD_ADDTEXT = 0x23000;
 		constexpr static auto UI_LOG_CMD_CLEARTEXT = 0x23001;
 		constexpr static auto UI_LOG_CMD_AUTOSCROLL = 0x23002;
+		constexpr static auto UI_LOG_CONTROL_LIST = 0x3010;
+		constexpr static auto UI_LOG_CONTROL_SEARCH = 0x3011;
+		constexpr static auto UI_LOG_CONTROL_FILTER = 0x3012;
+		constexpr static auto UI_LOG_MENU_COPY = 0x3020;
+		constexpr static auto UI_LOG_MENU_FINDNEXT = 0x3021;
+		constexpr static auto UI_LOG_MENU_EXPORT = 0x3022;
+		constexpr static auto UI_LOG_MENU_CLEAR = 0x3023;
+		constexpr static auto UI_LOG_MENU_BLACKLIST = 0x3024;
+
+		constexpr static std::size_t LINECOUNT_DEFAULT = 100000;
+		constexpr static std::size_t LINECOUNT_MIN = 1000;
+		constexpr static std::size_t LINECOUNT_MAX = 1000000;
+		// Clear() keeps the CKPE header at the top
+		constexpr static std::uint64_t LINECOUNT_PINNED = 7;
+		constexpr static std::uint32_t SEARCH_WIDTH = 320;
+		constexpr static std::uint32_t FILTER_WIDTH = 180;
+		constexpr static std::uint32_t EXPORT_BUFFER_SIZE = 64 * 1024;
+		constexpr static std::uint32_t BLACKLIST_REPORT_TOP = 20;
+		// Blacklist lines "fmt:<format>" and "fmt@<rva>:<format>" are matched by the format string
+		// (and the call site in the editor) before formatting, the rest by the formatted message
+		constexpr static std::string_view BLACKLIST_FORMAT_PREFIX = "fmt:";
+		constexpr static std::string_view BLACKLIST_FORMAT_SITE_PREFIX = "fmt@";
+
+		enum LogSeverity : std::uint8_t
+		{
+			lsInfo = 0,
+			lsWarning,
+			lsError,
+		};
+
+		struct LogLine
+		{
+			char* text;
+			std::uint32_t length;
+			LogSeverity severity;
+		};
 
-		constexpr static size_t LINECOUNT_MAX = 50000;
+		// The editor warnings come as "[CATEGORY] message"
+		constexpr static const char* WARNING_CATEGORIES[] =
+		{
+			"DEFAULT", "COMBAT", "ANIMATION", "AI", "SCRIPTS", "SAVELOAD", "DIALOGUE", "QUESTS", "PACKAGES",
+			"EDITOR", "MODELS", "TEXTURES", "PLUGINS", "MASTERFILE", "FORMS", "MAGIC", "SHADERS", "RENDERING",
+			"PATHFINDING", "MENUS", "AUDIO", "CELLS", "HAVOK", "FACEGEN", "WATER", "INGAME", "MEMORY",
+			"PERFORMANCE", "JOBS", "SYSTEM",
+		};
+
+		struct BlacklistEntry
+		{
+			std::string text;
+			std::atomic_uint64_t hits{ 0 };
+			// Formatted only to be dropped
+			std::atomic_uint64_t bytes{ 0 };
+		};
 
 		static LogWindow* slogwindow = nullptr;
-		concurrency::concurrent_vector<const char*> _pendingMessages;
-		std::unordered_set<uint64_t> _messageBlacklist;
+		std::unordered_map<uint64_t, BlacklistEntry> _messageBlacklist;
+		std::unordered_map<uint64_t, BlacklistEntry> _formatBlacklist;
+		static bool _sformat_has_sites = false;
+		static std::uintptr_t _seditor_base = 0;
+		static std::atomic_uint64_t _ssuppressed = 0;
+
+		// Ring buffer of the lines, the line number N lives in the slot N % capacity
+		static CriticalSection _slines_section;
+		static std::vector<LogLine> _slines;
+		static std::uint64_t _sfirst_line = 0;
+		static std::uint64_t _snext_line = 0;
+		static std::uint32_t _smax_length = 0;
+		// With a severity filter the list shows the numbers of the lines that passed it
+		static std::deque<std::uint64_t> _sview;
+		static LogSeverity _sfilter = lsInfo;
+		// Rows that left the top of the list since the last refresh
+		static std::size_t _sdropped_rows = 0;
+		static std::atomic_bool _sdirty = false;
+		static std::atomic_bool _sreset = false;
+		static std::int32_t _schar_width = 8;
+		static bool _sdark_theme = false;
+
+		[[nodiscard]] static inline LogLine& GetLine(std::uint64_t number) noexcept(true)
+		{
+			return _slines[number % _slines.size()];
+		}
 
-		static LRESULT CALLBACK LogWindowProc(HWND Hwnd, UINT Message, WPARAM wParam, LPARAM lParam)
+		[[nodiscard]] static inline std::size_t GetRowCount() noexcept(true)
+		{
+			return (_sfilter == lsInfo) ? (std::size_t)(_snext_line - _sfirst_line) : _sview.size();
+		}
+
+		[[nodiscard]] static inline bool GetRowLine(std::size_t row, std::uint64_t& number) noexcept(true)
+		{
+			if (row >= GetRowCount())
+				return false;
+
+			number = (_sfilter == lsInfo) ? (_sfirst_line + row) : _sview[row];
+			return true;
+		}
+
+		[[nodiscard]] static LogSeverity GetSeverity(const char* text) noexcept(true)
+		{
+			if (strstr(text, "ERROR") || strstr(text, "ASSERTION"))
+				return lsError;
+
+			if (strstr(text, "WARNING"))
+				return lsWarning;
+
+			if (text[0] == '[')
+			{
+				auto end = strchr(text, ']');
+				if (end)
+				{
+					std::string_view category(text + 1, (std::size_t)(end - text - 1));
+					for (auto name : WARNING_CATEGORIES)
+						if (category == name)
+							return lsWarning;
+				}
+			}
+
+			return lsInfo;
+		}
+
+		[[nodiscard]] static std::uint64_t GetFormatHash(const char* format, std::size_t length) noexcept(true)
+		{
+			while (length && isspace((unsigned char)format[length - 1]))
+				length--;
+
+			while (length && isspace((unsigned char)format[0]))
+			{
+				format++;
+				length--;
+			}
+
+			return HashUtils::MurmurHash64A(format, length);
+		}
+
+		[[nodiscard]] static inline std::uint64_t GetFormatSiteKey(std::uint64_t hash, std::uintptr_t rva) noexcept(true)
+		{
+			return hash ^ (((std::uint64_t)rva + 1) * 0x9E3779B97F4A7C15ull);
+		}
+
+		static void PrintBlacklistHits() noexcept(true)
+		{
+			struct HitEntry
+			{
+				const BlacklistEntry* entry;
+				std::uint64_t hits;
+				bool formatted;
+			};
+
+			std::vector<HitEntry> entries;
+			std::uint64_t before = 0, after = 0, bytes = 0;
+
+			for (auto& it : _formatBlacklist)
+				if (auto hits = it.second.hits.load(std::memory_order_relaxed); hits)
+				{
+					entries.emplace_back(HitEntry{ &it.second, hits, false });
+					before += hits;
+				}
+
+			for (auto& it : _messageBlacklist)
+				if (auto hits = it.second.hits.load(std::memory_order_relaxed); hits)
+				{
+					entries.emplace_back(HitEntry{ &it.second, hits, true });
+					after += hits;
+					bytes += it.second.bytes.load(std::memory_order_relaxed);
+				}
+
+			_CONSOLE("[BLACKLIST] Suppressed %llu messages: %llu before formatting, %llu after formatting "
+				"(%.2f MB formatted for nothing)", before + after, before, after, (double)bytes / (1024.0 * 1024.0));
+
+			auto count = std::min(entries.size(), (std::size_t)BLACKLIST_REPORT_TOP);
+			std::partial_sort(entries.begin(), entries.begin() + count, entries.end(),
+				[](const HitEntry& a, const HitEntry& b) { return a.hits > b.hits; });
+
+			for (std::size_t i = 0; i < count; i++)
+				_CONSOLE("[BLACKLIST] %10llu %s%s", entries[i].hits, entries[i].formatted ? "" : "(not formatted) ",
+					entries[i].entry->text.c_str());
+		}
+
+		static void RebuildView() noexcept(true)
+		{
+			_sview.clear();
+			_sdropped_rows = 0;
+
+			if (_sfilter == lsInfo)
+				return;
+
+			for (auto i = _sfirst_line; i < _snext_line; i++)
+				if (GetLine(i).severity >= _sfilter)
+					_sview.push_back(i);
+		}
+
+		static void PushLine(const char* text, std::size_t length) noexcept(true)
+		{
+			LogLine line{ CKPE::strdup(text), (std::uint32_t)length, GetSeverity(text) };
+			if (!line.text)
+				return;
+
+			ScopeCriticalSection guard(_slines_section);
+
+			if (_slines.empty())
+			{
+				CKPE::free(line.text);
+				return;
+			}
+
+			if ((_snext_line - _sfirst_line) == _slines.size())
+			{
+				// The buffer is full, the oldest line gives way
+				if (_sfilter == lsInfo)
+					_sdropped_rows++;
+				else if (!_sview.empty() && (_sview.front() == _sfirst_line))
+				{
+					_sview.pop_front();
+					_sdropped_rows++;
+				}
+
+				CKPE::free(GetLine(_sfirst_line).text);
+				_sfirst_line++;
+			}
+
+			if ((_sfilter != lsInfo) && (line.severity >= _sfilter))
+				_sview.push_back(_snext_line);
+
+			GetLine(_snext_line++) = line;
+			_smax_length = std::max(_smax_length, line.length);
+			_sdirty = true;
+		}
+
+		static void GetLineColors(LogSeverity severity, bool selected, COLORREF& text, COLORREF& back) noexcept(true)
 		{
-			static size_t LineCount = 0;
+			if (_sdark_theme)
+			{
+				back = UI::GetThemeSysColor(selected ? UI::ThemeColor_SelectedItem_Back : UI::ThemeColor_ListView_Color);
+				text = UI::GetThemeSysColor(selected ? UI::ThemeColor_SelectedItem_Text : UI::ThemeColor_Text_3);
+			}
+			else
+			{
+				back = GetSysColor(selected ? COLOR_HIGHLIGHT : COLOR_WINDOW);
+				text = GetSysColor(selected ? COLOR_HIGHLIGHTTEXT : COLOR_WINDOWTEXT);
+			}
 
+			if (selected)
+				return;
+
+			if (severity == lsError)
+				text = _sdark_theme ? RGB(240, 110, 100) : RGB(200, 0, 0);
+			else if (severity == lsWarning)
+				text = _sdark_theme ? RGB(230, 190, 90) : RGB(160, 100, 0);
+		}
+
+		static LRESULT CALLBACK LogListSubclass(HWND Hwnd, UINT Message, WPARAM wParam, LPARAM lParam,
+			UINT_PTR uIdSubclass, DWORD_PTR dwRefData)
+		{
+			// The position in WM_VSCROLL is only 16 bits, with a large buffer take the 32-bit one
+			if ((Message == WM_VSCROLL) && ((LOWORD(wParam) == SB_THUMBTRACK) || (LOWORD(wParam) == SB_THUMBPOSITION)))
+			{
+				SCROLLINFO info
+				{
+					.cbSize = sizeof(SCROLLINFO),
+					.fMask = SIF_TRACKPOS,
+				};
+
+				if (GetScrollInfo(Hwnd, SB_VERT, &info))
+				{
+					SendMessageA(Hwnd, LB_SETTOPINDEX, (WPARAM)info.nTrackPos, 0);
+					return 0;
+				}
+			}
+
+			return DefSubclassProc(Hwnd, Message, wParam, lParam);
+		}
+
+		static LRESULT CALLBACK LogWindowProc(HWND Hwnd, UINT Message, WPARAM wParam, LPARAM lParam)
+		{
 			if (WM_NCCREATE == Message)
 			{
 				auto info = reinterpret_cast<const CREATESTRUCT*>(lParam);
@@ -62,7 +332,7 @@ namespace CKPE
 					catch (const std::exception& e)
 					{
 						ErrorHandler::Trigger(e.what());
-					}					
+					}
 				}
 				return 0;
 
@@ -87,65 +357,54 @@ namespace CKPE
 					if (wParam != UI_LOG_CMD_ADDTEXT)
 						break;
 
-					// Если очень много тысяч в лог окне, то разумно его почистить,
-					// Это освободит немного памяти.
-					if (LineCount >= LINECOUNT_MAX)
+					// Показать в заголовке, сколько сообщений отсеял чёрный список
+					static std::uint64_t suppressed = 0;
+					if (auto now = _ssuppressed.load(std::memory_order_relaxed); now != suppressed)
 					{
-						log->Clear();
-						auto rich = log->GetRichEditHandle();
-						LineCount = (size_t)SendMessageA((HWND)rich, EM_GETLINECOUNT, 0, 0);
+						char title[64];
+						suppressed = now;
+						_snprintf_s(title, _TRUNCATE, "Log Window (blacklisted: %llu)", now);
+						SetWindowTextA(Hwnd, title);
 					}
 
-					if (_pendingMessages.size() <= 0)
-						break;
-
-					return LogWindowProc(Hwnd, UI_LOG_CMD_ADDTEXT, 0, 0);
+					// Новые строки уже лежат в буфере, списку достаточно узнать их количество
+					auto reset = _sreset.exchange(false);
+					if (_sdirty.exchange(false) || reset)
+						log->RefreshHandler(reset);
 				}
 				return 0;
 
-				case WM_NOTIFY:
+				case WM_DRAWITEM:
+					log->DrawItemHandler((const void*)lParam);
+					return TRUE;
+
+				case WM_CONTEXTMENU:
 				{
-					static uint64_t lastClickTime;
-					auto notification = reinterpret_cast<const LPNMHDR>(lParam);
+					if ((HWND)wParam != (HWND)log->GetListHandle())
+						break;
 
-					if (notification->code == EN_MSGFILTER)
-					{
-						auto msgFilter = reinterpret_cast<const MSGFILTER*>(notification);
+					log->ContextMenuHandler(GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+				}
+				return 0;
 
-						if (msgFilter->msg == WM_LBUTTONDBLCLK)
-							lastClickTime = GetTickCount64();
-					}
-					else if (notification->code == EN_SELCHANGE)
+				case WM_COMMAND:
+				{
+					switch (LOWORD(wParam))
 					{
-						auto selChange = reinterpret_cast<const SELCHANGE*>(notification);
-						
-						// Двойной щелчок мыши с правильным выбором -> попробовать проанализировать идентификатор формы
-						if ((GetTickCount64() - lastClickTime > 1000) || selChange->seltyp == SEL_EMPTY)
-							break;
-
-						if (!log->OnOpenFormById)
-							break;
-
-						char lineData[2048] = { 0 };
-						*reinterpret_cast<uint16_t*>(&lineData[0]) = ARRAYSIZE(lineData);
-
-						// Получить номер строки и текст из выбранного диапазона
-						LRESULT lineIndex = SendMessageA((HWND)log->GetRichEditHandle(), EM_LINEFROMCHAR,
-							selChange->chrg.cpMin, 0);
-						LRESULT charCount = SendMessageA((HWND)log->GetRichEditHandle(), EM_GETLINE, lineIndex,
-							reinterpret_cast<LPARAM>(&lineData));
-
-						if (charCount > 0)
-						{
-							lineData[charCount - 1] = '\0';
-
-							// Захватить шестнадцатеричный идентификатор формы в формате "(XXXXXXXX)"
-							for (char* p = lineData; p[0] != '\0'; p++)
-								if (p[0] == '(' && strlen(p) >= 10 && p[9] == ')')
-									log->OnOpenFormById(strtoul(&p[1], nullptr, 16));
-						}
-
-						lastClickTime = GetTickCount64() + 1000;
+					case UI_LOG_CONTROL_LIST:
+						// Двойной щелчок по строке -> попробовать проанализировать идентификатор формы
+						if (HIWORD(wParam) == LBN_DBLCLK)
+							log->OpenFormHandler();
+						break;
+					case UI_LOG_CONTROL_SEARCH:
+						// Поиск по мере ввода
+						if (HIWORD(wParam) == EN_CHANGE)
+							log->SearchHandler(false, false);
+						break;
+					case UI_LOG_CONTROL_FILTER:
+						if (HIWORD(wParam) == CBN_SELCHANGE)
+							log->FilterHandler();
+						break;
 					}
 				}
 				break;
@@ -157,50 +416,12 @@ namespace CKPE
 				case UI_LOG_CMD_AUTOSCROLL:
 					log->SetAutoScroll(static_cast<bool>(wParam));
 					return 0;
-
-				case UI_LOG_CMD_ADDTEXT:
-				{
-					auto rich = (HWND)log->GetRichEditHandle();
-					SendMessageA(rich, WM_SETREDRAW, FALSE, 0);
-
-					// Сохранить старую позицию, если нет автоскроллинга
-					POINT scrollRange = { 0 };
-
-					if (!log->HasAutoScroll())
-						SendMessageA(rich, EM_GETSCROLLPOS, 0, reinterpret_cast<LPARAM>(&scrollRange));
-
-					// Получить копию всех элементов и очистить целевой список
-					auto messages(std::move(_pendingMessages));
-
-					for (const char* message : messages)
-					{
-						// Переместить курсор в конец, затем написать
-						CHARRANGE range
-						{
-							.cpMin = LONG_MAX,
-							.cpMax = LONG_MAX,
-						};
-
-						SendMessageA(rich, EM_EXSETSEL, 0, reinterpret_cast<LPARAM>(&range));
-						SendMessageA(rich, EM_REPLACESEL, FALSE, reinterpret_cast<LPARAM>(message));
-
-						CKPE::free((void*)message);
-						LineCount++;
-					}
-
-					if (!log->HasAutoScroll())
-						SendMessageA(rich, EM_SETSCROLLPOS, 0, reinterpret_cast<LPARAM>(&scrollRange));
-
-					SendMessageA(rich, WM_SETREDRAW, TRUE, 0);
-					RedrawWindow(rich, nullptr, nullptr, RDW_ERASE | RDW_INVALIDATE | RDW_NOCHILDREN);
-				}
-				return 0;
 				}
 			}
 
 			return DefWindowProc(Hwnd, Message, wParam, lParam);
 		}
-		
+
 		bool LogWindow::Create()
 		{
 			if (slogwindow || _handle)
@@ -208,12 +429,11 @@ namespace CKPE
 
 			slogwindow = this;
 
-			// Загрузка нового RichEdit
-			if (!LoadLibraryA("MSFTEDIT.dll"))
-				return false;
-
 			LoadWarningBlacklist();
 
+			_slines.resize(std::clamp((std::size_t)_READ_OPTION_UINT("Log", "uLogWindowLines", (std::uint32_t)LINECOUNT_DEFAULT),
+				LINECOUNT_MIN, LINECOUNT_MAX));
+
 			auto fName = _READ_OPTION_USTR("Log", "sOutputFile", FILE_NONE);
 			if ((fName != FILE_NONE) && !fName.empty())
 			{
@@ -236,7 +456,10 @@ namespace CKPE
 						ClassicTheme::InitializeCurrentThread();
 
 					else if (_READ_OPTION_BOOL("CreationKit", "bUIDarkTheme", false))
+					{
 						ModernTheme::InitializeCurrentThread();
+						_sdark_theme = true;
+					}
 
 					WNDCLASSEXA wc
 					{
@@ -246,7 +469,7 @@ namespace CKPE
 						.hInstance = instance,
 						.hIcon = LoadIconA(instance, MAKEINTRESOURCE(0x13E)),				// 0x13E всегда иконка Creation Kit
 						.hCursor = LoadCursor(NULL, IDC_ARROW),
-						.hbrBackground = static_cast<HBRUSH>(GetStockObject(WHITE_BRUSH)),
+						.hbrBackground = reinterpret_cast<HBRUSH>(COLOR_BTNFACE + 1),
 						.lpszClassName = "RTEDITLOG",
 						.hIconSm = wc.hIcon,
 					};
@@ -260,7 +483,7 @@ namespace CKPE
 					if (!(*window))
 						return false;
 
-					if (_READ_OPTION_BOOL("CreationKit", "bUIDarkTheme", false))
+					if (_sdark_theme)
 						ModernTheme::ApplyDarkThemeForWindow(reinterpret_cast<void*>(*window));
 
 					// Опрашивайть каждые 100 мс на наличие новых строк
@@ -270,6 +493,9 @@ namespace CKPE
 					MSG msg;
 					while (GetMessageA(&msg, NULL, 0, 0) > 0)
 					{
+						if ((msg.message == WM_KEYDOWN) && module->KeyDownHandler(msg.hwnd, (std::uint32_t)msg.wParam))
+							continue;
+
 						TranslateMessage(&msg);
 						DispatchMessageA(&msg);
 					}
@@ -289,6 +515,15 @@ namespace CKPE
 				DestroyWindow((HWND)_handle);
 				_handle = nullptr;
 			}
+
+			ScopeCriticalSection guard(_slines_section);
+
+			for (auto& line : _slines)
+				CKPE::free(line.text);
+
+			_slines.clear();
+			_sview.clear();
+			_sfirst_line = _snext_line = 0;
 		}
 
 		bool LogWindow::CreateStdoutListener() noexcept(true)
@@ -361,6 +596,7 @@ namespace CKPE
 		{
 			auto app = Interface::GetSingleton()->GetApplication();
 			auto spath = std::wstring(app->GetPath());
+			_seditor_base = app->GetBase();
 			
 			if (!PathUtils::FileExists(spath + FILE_BLACKLIST))
 				return;
@@ -384,12 +620,45 @@ namespace CKPE
 
 					nCount++;
 					Message = StringUtils::Trim(sbuffer.get());
-					_messageBlacklist.emplace(HashUtils::MurmurHash64A(Message.c_str(), Message.length()));
+
+					std::uint64_t key;
+					std::unordered_map<uint64_t, BlacklistEntry>* list = &_formatBlacklist;
+					if (Message.starts_with(BLACKLIST_FORMAT_PREFIX))
+					{
+						auto format = Message.c_str() + BLACKLIST_FORMAT_PREFIX.length();
+						key = GetFormatHash(format, strlen(format));
+					}
+					else if (Message.starts_with(BLACKLIST_FORMAT_SITE_PREFIX))
+					{
+						// Адрес вызова задаётся смещением от начала модуля редактора
+						char* format = nullptr;
+						auto rva = strtoull(Message.c_str() + BLACKLIST_FORMAT_SITE_PREFIX.length(), &format, 16);
+						if (!format || (*format != ':'))
+						{
+							_WARNING("Messages Blacklist: invalid line \"%s\"", Message.c_str());
+							continue;
+						}
+
+						format++;
+						key = GetFormatSiteKey(GetFormatHash(format, strlen(format)), (std::uintptr_t)rva);
+						_sformat_has_sites = true;
+					}
+					else
+					{
+						key = HashUtils::MurmurHash64A(Message.c_str(), Message.length());
+						list = &_messageBlacklist;
+					}
+
+					auto entry = list->try_emplace(key);
+					if (entry.second)
+						entry.first->second.text = Message;
 				}
 
-				_MESSAGE("Messages Blacklist: %llu", _messageBlacklist.size());
-				if (nCount > _messageBlacklist.size())
-					_MESSAGE("Number of messages whose hash has already been added: %llu", (nCount - _messageBlacklist.size()));
+				_MESSAGE("Messages Blacklist: %llu (by format: %llu)", _messageBlacklist.size() + _formatBlacklist.size(),
+					_formatBlacklist.size());
+				if (nCount > (_messageBlacklist.size() + _formatBlacklist.size()))
+					_MESSAGE("Number of messages whose hash has already been added: %llu",
+						(nCount - _messageBlacklist.size() - _formatBlacklist.size()));
 			}
 			catch (const std::exception& e)
 			{
@@ -426,26 +695,54 @@ namespace CKPE
 			auto cs = reinterpret_cast<const CREATESTRUCTA*>(create_struct);
 			_handle = handle;
 
-			// Создание rich edit control (https://docs.microsoft.com/en-us/windows/desktop/Controls/rich-edit-controls)
-			uint32_t style = WS_VISIBLE | WS_CHILD | WS_VSCROLL | ES_MULTILINE | ES_LEFT | ES_NOHIDESEL |
-				ES_AUTOVSCROLL | ES_READONLY;
-
-			_handle_richedit = (void*)CreateWindowExW(0, MSFTEDIT_CLASS, L"", style, 0, 0, (int)cs->cx, (int)cs->cy, (HWND)_handle,
-				NULL, cs->hInstance, NULL);
-			if (!_handle_richedit)
+			// Установить лучший шрифт, размер задан в пунктах
+			auto dc = GetDC((HWND)_handle);
+			auto height = -MulDiv(_READ_OPTION_INT("Log", "nFontSize", 10), GetDeviceCaps(dc, LOGPIXELSY), 72);
+			_font = (void*)CreateFontA(height, 0, 0, 0, (int)_READ_OPTION_UINT("Log", "uFontWeight", FW_NORMAL),
+				FALSE, FALSE, FALSE, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
+				FIXED_PITCH | FF_MODERN, _READ_OPTION_STR("Log", "sFont", "Consolas").c_str());
+
+			TEXTMETRICA metrics = { 0 };
+			auto old_font = SelectObject(dc, (HFONT)_font);
+			GetTextMetricsA(dc, &metrics);
+			SelectObject(dc, old_font);
+			ReleaseDC((HWND)_handle, dc);
+			_schar_width = std::max(metrics.tmAveCharWidth, 1l);
+
+			// Строка поиска и фильтр по важности над списком
+			_handle_search = (void*)CreateWindowExA(WS_EX_CLIENTEDGE, WC_EDITA, "",
+				WS_VISIBLE | WS_CHILD | WS_TABSTOP | ES_AUTOHSCROLL, 0, 0, SEARCH_WIDTH, 20, (HWND)_handle,
+				(HMENU)UI_LOG_CONTROL_SEARCH, cs->hInstance, NULL);
+			_handle_filter = (void*)CreateWindowExA(0, WC_COMBOBOXA, "",
+				WS_VISIBLE | WS_CHILD | WS_TABSTOP | WS_VSCROLL | CBS_DROPDOWNLIST, SEARCH_WIDTH + 4, 0, FILTER_WIDTH, 200,
+				(HWND)_handle, (HMENU)UI_LOG_CONTROL_FILTER, cs->hInstance, NULL);
+
+			// Список без собственных данных: он знает лишь количество строк и рисует только видимые из буфера
+			_handle_list = (void*)CreateWindowExA(0, WC_LISTBOXA, "",
+				WS_VISIBLE | WS_CHILD | WS_VSCROLL | WS_HSCROLL | WS_TABSTOP | LBS_NODATA | LBS_OWNERDRAWFIXED |
+				LBS_NOINTEGRALHEIGHT | LBS_NOTIFY, 0, 0, (int)cs->cx, (int)cs->cy, (HWND)_handle,
+				(HMENU)UI_LOG_CONTROL_LIST, cs->hInstance, NULL);
+
+			if (!_handle_search || !_handle_filter || !_handle_list)
 				return false;
 
-			// Установить лучший шрифт и преобразовать баллы в пункты (1 балл = 20 пункты)
-			CHARFORMAT2A format = { 0 };
-			format.cbSize = sizeof(format);
-			format.dwMask = CFM_FACE | CFM_SIZE | CFM_WEIGHT;
-			format.yHeight = _READ_OPTION_INT("Log", "nFontSize", 10) * 20;
-			format.wWeight = (WORD)_READ_OPTION_UINT("Log", "uFontWeight", FW_NORMAL);
-			strncpy_s(format.szFaceName, _READ_OPTION_STR("Log", "sFont", "Consolas").c_str(), _TRUNCATE);
+			auto ui_font = (WPARAM)GetStockObject(DEFAULT_GUI_FONT);
+			SendMessageA((HWND)_handle_search, WM_SETFONT, ui_font, FALSE);
+			SendMessageA((HWND)_handle_filter, WM_SETFONT, ui_font, FALSE);
+			SendMessageA((HWND)_handle_list, WM_SETFONT, (WPARAM)_font, FALSE);
+			SendMessageA((HWND)_handle_list, LB_SETITEMHEIGHT, 0, metrics.tmHeight + 2);
+			SendMessageW((HWND)_handle_search, EM_SETCUEBANNER, FALSE, (LPARAM)L"Search (Ctrl+F, F3 - next, Esc - clear)");
+
+			SendMessageA((HWND)_handle_filter, CB_ADDSTRING, 0, (LPARAM)"All messages");
+			SendMessageA((HWND)_handle_filter, CB_ADDSTRING, 0, (LPARAM)"Warnings and errors");
+			SendMessageA((HWND)_handle_filter, CB_ADDSTRING, 0, (LPARAM)"Errors only");
+			SendMessageA((HWND)_handle_filter, CB_SETCURSEL, 0, 0);
 
-			SendMessageA((HWND)_handle_richedit, EM_SETCHARFORMAT, SCF_ALL, reinterpret_cast<LPARAM>(&format));
-			//Подписаться на EN_MSGFILTER и EN_SELCHANGE
-			SendMessageA((HWND)_handle_richedit, EM_SETEVENTMASK, 0, ENM_MOUSEEVENTS | ENM_SELCHANGE);
+			RECT rc;
+			GetWindowRect((HWND)_handle_filter, &rc);
+			_bar_height = (std::uint32_t)(rc.bottom - rc.top);
+
+			SetWindowSubclass((HWND)_handle_list, LogListSubclass, 0, 0);
 
 			if (_READ_OPTION_BOOL("Log", "bShowWindow", true))
 			{
@@ -481,34 +778,61 @@ namespace CKPE
 
 		void LogWindow::Clear() const noexcept(true)
 		{
-			if ((HWND)_handle_richedit)
 			{
-				CHARRANGE range
+				ScopeCriticalSection guard(_slines_section);
+
+				auto keep = (_sfirst_line < LINECOUNT_PINNED) ?
+					(std::min(_snext_line, LINECOUNT_PINNED) - _sfirst_line) : 0;
+
+				for (auto i = _sfirst_line + keep; i < _snext_line; i++)
 				{
-					.cpMin = (LONG)SendMessageA((HWND)_handle_richedit, EM_LINEINDEX, 7, 0),
-					.cpMax = LONG_MAX,
-				};
+					auto& line = GetLine(i);
+					CKPE::free(line.text);
+					line.text = nullptr;
+				}
 
-				SendMessageA((HWND)_handle_richedit, EM_EXSETSEL, 0, reinterpret_cast<LPARAM>(&range));
-				SendMessageA((HWND)_handle_richedit, EM_REPLACESEL, FALSE, reinterpret_cast<LPARAM>(""));
+				_snext_line = _sfirst_line + keep;
+				RebuildView();
 			}
+
+			// Список обновится в своём потоке по таймеру
+			_sreset = true;
 		}
 
 		void LogWindow::ReleaseHandler() noexcept(true)
 		{
-			if (DestroyWindow((HWND)_handle_richedit))
-				_handle_richedit = nullptr;
+			if (_handle_list)
+			{
+				RemoveWindowSubclass((HWND)_handle_list, LogListSubclass, 0);
+				if (DestroyWindow((HWND)_handle_list))
+					_handle_list = nullptr;
+			}
+
+			if (_handle_search && DestroyWindow((HWND)_handle_search))
+				_handle_search = nullptr;
+
+			if (_handle_filter && DestroyWindow((HWND)_handle_filter))
+				_handle_filter = nullptr;
+
+			if (_font)
+			{
+				DeleteObject((HFONT)_font);
+				_font = nullptr;
+			}
 		}
 
 		void LogWindow::ResizeHandler(std::uint32_t x, std::uint32_t y) const noexcept(true)
 		{
-			MoveWindow((HWND)_handle_richedit, 0, 0, x, y, TRUE);
+			auto bar = (int)_bar_height;
+			MoveWindow((HWND)_handle_search, 0, 0, SEARCH_WIDTH, bar, TRUE);
+			MoveWindow((HWND)_handle_filter, SEARCH_WIDTH + 4, 0, FILTER_WIDTH, 200, TRUE);
+			MoveWindow((HWND)_handle_list, 0, bar + 2, x, std::max((int)y - bar - 2, 0), TRUE);
 		}
 
 		void LogWindow::ActiveHandler(bool active) const noexcept(true)
 		{
 			if (active)
-				SetFocus((HWND)_handle_richedit);
+				SetFocus((HWND)_handle_list);
 		}
 
 		void LogWindow::CloseHandler() const noexcept(true)
@@ -516,73 +840,372 @@ namespace CKPE
 			Show(false);
 		}
 
-		bool LogWindow::SaveRichTextToFile(const std::string& fname) const noexcept(true)
+		void LogWindow::RefreshHandler(bool reset) const noexcept(true)
+		{
+			auto list = (HWND)_handle_list;
+			if (!list)
+				return;
+
+			std::size_t count, dropped;
+			std::uint32_t max_length;
+
+			{
+				ScopeCriticalSection guard(_slines_section);
+
+				count = GetRowCount();
+				dropped = _sdropped_rows;
+				max_length = _smax_length;
+				_sdropped_rows = 0;
+			}
+
+			auto top = (std::intptr_t)SendMessageA(list, LB_GETTOPINDEX, 0, 0);
+			auto selected = reset ? LB_ERR : (std::intptr_t)SendMessageA(list, LB_GETCURSEL, 0, 0);
+
+			SendMessageA(list, WM_SETREDRAW, FALSE, 0);
+			SendMessageA(list, LB_SETCOUNT, (WPARAM)count, 0);
+			SendMessageA(list, LB_SETHORIZONTALEXTENT, (WPARAM)(max_length + 2) * _schar_width, 0);
+
+			// Строки, ушедшие из начала буфера, сдвигают индексы остальных
+			if (selected != LB_ERR)
+			{
+				selected -= (std::intptr_t)dropped;
+				if (selected >= 0)
+					SendMessageA(list, LB_SETCURSEL, (WPARAM)selected, 0);
+			}
+
+			// Автопрокрутка не уводит из-под пользователя выбранную строку
+			if (_auto_scroll && (selected < 0))
+				SendMessageA(list, LB_SETTOPINDEX, count ? (WPARAM)(count - 1) : 0, 0);
+			else
+				SendMessageA(list, LB_SETTOPINDEX, (WPARAM)std::max(top - (std::intptr_t)dropped, (std::intptr_t)0), 0);
+
+			SendMessageA(list, WM_SETREDRAW, TRUE, 0);
+			RedrawWindow(list, nullptr, nullptr, RDW_ERASE | RDW_INVALIDATE | RDW_NOCHILDREN);
+		}
+
+		void LogWindow::DrawItemHandler(const void* draw_struct) const noexcept(true)
 		{
-			return SaveRichTextToFile(StringUtils::Utf8ToUtf16(fname));
+			auto draw = reinterpret_cast<const DRAWITEMSTRUCT*>(draw_struct);
+			if ((draw->CtlType != ODT_LISTBOX) || (draw->hwndItem != (HWND)_handle_list))
+				return;
+
+			COLORREF text, back;
+			auto old_font = SelectObject(draw->hDC, (HFONT)_font);
+
+			{
+				ScopeCriticalSection guard(_slines_section);
+
+				std::uint64_t number;
+				LogLine* line = nullptr;
+				if ((draw->itemID != (UINT)-1) && GetRowLine(draw->itemID, number))
+					line = &GetLine(number);
+
+				GetLineColors(line ? line->severity : lsInfo, (draw->itemState & ODS_SELECTED) == ODS_SELECTED, text, back);
+
+				SetTextColor(draw->hDC, text);
+				SetBkColor(draw->hDC, back);
+				ExtTextOutA(draw->hDC, draw->rcItem.left + 4, draw->rcItem.top + 1, ETO_OPAQUE | ETO_CLIPPED,
+					&draw->rcItem, (line && line->text) ? line->text : "", (line && line->text) ? line->length : 0,
+					nullptr);
+			}
+
+			if ((draw->itemState & ODS_FOCUS) == ODS_FOCUS)
+				DrawFocusRect(draw->hDC, &draw->rcItem);
+
+			SelectObject(draw->hDC, old_font);
 		}
 
-		bool LogWindow::SaveRichTextToFile(const std::wstring& fname) const noexcept(true)
+		void LogWindow::SearchHandler(bool next, bool backward) const noexcept(true)
 		{
-			// Изучено отсюда
-			// https://subscribe.ru/archive/comp.soft.prog.qandacpp/200507/10000511.html
+			char needle[256];
+			if (!GetWindowTextA((HWND)_handle_search, needle, ARRAYSIZE(needle)))
+				return;
+
+			auto list = (HWND)_handle_list;
+			auto start = (std::intptr_t)SendMessageA(list, LB_GETCURSEL, 0, 0);
+			std::intptr_t found = LB_ERR;
 
-			try
 			{
-				// открываю\создаю файл, полностью заменяю его содержимое
-				// если файл существует
-				auto stream = new FileStream(fname, FileStream::fmCreate);
-				if (!stream)
+				ScopeCriticalSection guard(_slines_section);
+
+				auto count = (std::intptr_t)GetRowCount();
+				if (!count)
+					return;
+
+				// Поиск по мере ввода начинается с текущей строки, F3 и Enter ищут со следующей
+				if (start == LB_ERR)
+					start = backward ? count - 1 : 0;
+				else if (next)
+					start += backward ? -1 : 1;
+
+				for (std::intptr_t i = 0; i < count; i++)
 				{
-					_ERROR(L"I can't open the file for writing: \"%s\"", fname.c_str());
+					auto row = (((start + (backward ? -i : i)) % count) + count) % count;
+
+					std::uint64_t number;
+					if (!GetRowLine((std::size_t)row, number))
+						break;
+
+					auto& line = GetLine(number);
+					if (line.text && StrStrIA(line.text, needle))
+					{
+						found = row;
+						break;
+					}
+				}
+			}
+
+			if (found != LB_ERR)
+				SendMessageA(list, LB_SETCURSEL, (WPARAM)found, 0);
+			else
+				MessageBeep(MB_ICONASTERISK);
+		}
+
+		void LogWindow::FilterHandler() const noexcept(true)
+		{
+			auto index = SendMessageA((HWND)_handle_filter, CB_GETCURSEL, 0, 0);
+
+			{
+				ScopeCriticalSection guard(_slines_section);
+
+				_sfilter = ((index == CB_ERR) || (index > lsError)) ? lsInfo : (LogSeverity)index;
+				RebuildView();
+			}
+
+			RefreshHandler(true);
+		}
+
+		void LogWindow::OpenFormHandler() const noexcept(true)
+		{
+			if (!OnOpenFormById)
+				return;
+
+			auto row = (std::intptr_t)SendMessageA((HWND)_handle_list, LB_GETCURSEL, 0, 0);
+			if (row == LB_ERR)
+				return;
+
+			std::string text;
+
+			{
+				ScopeCriticalSection guard(_slines_section);
+
+				std::uint64_t number;
+				if (GetRowLine((std::size_t)row, number) && GetLine(number).text)
+					text = GetLine(number).text;
+			}
+
+			// Захватить шестнадцатеричный идентификатор формы в формате "(XXXXXXXX)"
+			for (auto p = text.c_str(); p[0] != '\0'; p++)
+				if (p[0] == '(' && strlen(p) >= 10 && p[9] == ')')
+					OnOpenFormById(strtoul(&p[1], nullptr, 16));
+		}
+
+		static void CopySelectedLine(HWND list) noexcept(true)
+		{
+			auto row = (std::intptr_t)SendMessageA(list, LB_GETCURSEL, 0, 0);
+			if (row == LB_ERR)
+				return;
+
+			std::string text;
+
+			{
+				ScopeCriticalSection guard(_slines_section);
+
+				std::uint64_t number;
+				if (GetRowLine((std::size_t)row, number) && GetLine(number).text)
+					text = GetLine(number).text;
+			}
+
+			auto memory = GlobalAlloc(GMEM_MOVEABLE, text.length() + 1);
+			if (!memory)
+				return;
+
+			memcpy(GlobalLock(memory), text.c_str(), text.length() + 1);
+			GlobalUnlock(memory);
+
+			if (OpenClipboard(list))
+			{
+				EmptyClipboard();
+				if (SetClipboardData(CF_TEXT, memory))
+					memory = nullptr;
+				CloseClipboard();
+			}
+
+			if (memory)
+				GlobalFree(memory);
+		}
+
+		static void ShowExportDialog(const LogWindow* log) noexcept(true)
+		{
+			wchar_t filePath[MAX_PATH] = L"CreationKitLog.txt";
+			OPENFILENAMEW ofnData
+			{
+				.lStructSize = sizeof(OPENFILENAMEW),
+				.hwndOwner = (HWND)log->GetHandle(),
+				.lpstrFilter = L"Text Files (*.txt)\0*.txt\0All Files (*.*)\0*.*\0\0",
+				.lpstrFile = filePath,
+				.nMaxFile = ARRAYSIZE(filePath),
+				.Flags = OFN_PATHMUSTEXIST | OFN_OVERWRITEPROMPT,
+				.lpstrDefExt = L"txt",
+			};
+
+			if (GetSaveFileNameW(&ofnData))
+				log->SaveToFile(std::wstring(filePath));
+		}
+
+		void LogWindow::ContextMenuHandler(std::int32_t x, std::int32_t y) const noexcept(true)
+		{
+			auto list = (HWND)_handle_list;
+
+			// Меню вызвано с клавиатуры
+			if ((x == -1) && (y == -1))
+			{
+				RECT rc;
+				GetWindowRect(list, &rc);
+				x = rc.left + 8;
+				y = rc.top + 8;
+			}
+
+			auto menu = CreatePopupMenu();
+			if (!menu)
+				return;
+
+			auto has_selected = SendMessageA(list, LB_GETCURSEL, 0, 0) != LB_ERR;
+			AppendMenuA(menu, MF_STRING | (has_selected ? 0 : MF_GRAYED), UI_LOG_MENU_COPY, "Copy\tCtrl+C");
+			AppendMenuA(menu, MF_STRING, UI_LOG_MENU_FINDNEXT, "Find next\tF3");
+			AppendMenuA(menu, MF_SEPARATOR, 0, nullptr);
+			AppendMenuA(menu, MF_STRING, UI_LOG_MENU_EXPORT, "Export...\tCtrl+S");
+			AppendMenuA(menu, MF_STRING, UI_LOG_MENU_CLEAR, "Clear");
+			AppendMenuA(menu, MF_SEPARATOR, 0, nullptr);
+			AppendMenuA(menu, MF_STRING, UI_LOG_MENU_BLACKLIST, "Blacklist hits");
+
+			auto command = TrackPopupMenu(menu, TPM_RETURNCMD | TPM_NONOTIFY | TPM_RIGHTBUTTON, x, y, 0,
+				(HWND)_handle, nullptr);
+			DestroyMenu(menu);
+
+			switch (command)
+			{
+			case UI_LOG_MENU_COPY:
+				CopySelectedLine(list);
+				break;
+			case UI_LOG_MENU_FINDNEXT:
+				SearchHandler(true, false);
+				break;
+			case UI_LOG_MENU_EXPORT:
+				ShowExportDialog(this);
+				break;
+			case UI_LOG_MENU_CLEAR:
+				Clear();
+				break;
+			case UI_LOG_MENU_BLACKLIST:
+				PrintBlacklistHits();
+				break;
+			}
+		}
+
+		bool LogWindow::KeyDownHandler(void* handle, std::uint32_t key) const noexcept(true)
+		{
+			auto window = (HWND)handle;
+			if (!_handle || ((window != (HWND)_handle) && !IsChild((HWND)_handle, window)))
+				return false;
+
+			auto ctrl = (GetKeyState(VK_CONTROL) & 0x8000) != 0;
+			auto shift = (GetKeyState(VK_SHIFT) & 0x8000) != 0;
+
+			switch (key)
+			{
+			case VK_F3:
+				SearchHandler(true, shift);
+				return true;
+			case VK_RETURN:
+				if (window != (HWND)_handle_search)
+					return false;
+				SearchHandler(true, shift);
+				return true;
+			case VK_ESCAPE:
+				if ((window != (HWND)_handle_search) && (window != (HWND)_handle_list))
 					return false;
+				// Сбросить поиск и выделение, автопрокрутка снова следует за новыми строками
+				if (window == (HWND)_handle_search)
+				{
+					SetWindowTextA(window, "");
+					SetFocus((HWND)_handle_list);
 				}
+				SendMessageA((HWND)_handle_list, LB_SETCURSEL, (WPARAM)-1, 0);
+				_sdirty = true;
+				return true;
+			case 'F':
+				if (!ctrl)
+					return false;
+				SetFocus((HWND)_handle_search);
+				SendMessageA((HWND)_handle_search, EM_SETSEL, 0, -1);
+				return true;
+			case 'C':
+				if (!ctrl || (window != (HWND)_handle_list))
+					return false;
+				CopySelectedLine((HWND)_handle_list);
+				return true;
+			case 'S':
+				if (!ctrl)
+					return false;
+				ShowExportDialog(this);
+				return true;
+			}
 
-				// функция обратного вызова для вывода в файл
-				auto MyOutFunction = [](
-					DWORD_PTR dwCookie, // то самое пользовательское значение которое
-					// мы указали в EDITSTREAM::dwCookie
-					LPBYTE pbBuff,		// буфер с данными которые передает RichEdit
-					LONG cb,			// размер буфера в байтах
-					LONG* pcb			// указатель на переменную в которую следует
-					// записать сколько функция MyOutFunction
-					// успешно обработала байтов из буфера pbBuff) -> DWORD 
-					) -> DWORD {
-						// в качестве dwCookie получаем указатель который мы
-						// установили в EDITSTREAM
-						auto stream = reinterpret_cast<FileStream*>(dwCookie);
-						// записываем полученный буфер в файл, размер переданного нам
-						// буфера в переменной cb
-						stream->Write(pbBuff, cb);
-						// говорим RichEditу сколько мы обработали байтов
-						*pcb = cb;
-						// возвращаем ноль (у нас всё ОК)
-						return 0;
-					};
+			return false;
+		}
 
-				EDITSTREAM es = { 0 };
-				// указываем функцию обратного вызова
-				es.pfnCallback = static_cast<EDITSTREAMCALLBACK>(MyOutFunction);
-				// сбрасываем ошибки
-				es.dwError = 0;
-				// в качестве Cookie передаем указатель на наш объект file
-				es.dwCookie = (DWORD_PTR)stream;
-				// посылаем сообщение окну RichEdit, WPARAM==флаги,
-				// LPARAM - указатель на EDITSTREAM
-				SendMessageA((HWND)_handle_richedit, EM_STREAMOUT,
-					SF_TEXT /*получать обычный текст*/,
-					(LPARAM)&es);
-
-				delete stream;
-
-				// true - если не было ошибок, иначе что-то где-то вдруг
-				// порою не в порядке.
-				return !es.dwError;
+		bool LogWindow::SaveToFile(const std::string& fname) const noexcept(true)
+		{
+			return SaveToFile(StringUtils::Utf8ToUtf16(fname));
+		}
+
+		bool LogWindow::SaveToFile(const std::wstring& fname) const noexcept(true)
+		{
+			// При падении блокировку может держать остановленный поток, долго её не ждём
+			bool locked = false;
+			for (std::uint32_t i = 0; (i < 50) && !(locked = _slines_section.TryLock()); i++)
+				Sleep(5);
+
+			bool result = true;
+
+			try
+			{
+				FileStream stream(fname, FileStream::fmCreate);
+
+				std::string buffer;
+				buffer.reserve(EXPORT_BUFFER_SIZE + 1024);
+
+				if (!_slines.empty())
+				{
+					for (auto i = _sfirst_line; i < _snext_line; i++)
+					{
+						auto& line = GetLine(i);
+						if (!line.text)
+							continue;
+
+						buffer.append(line.text, line.length).append("\r\n");
+						if (buffer.length() >= EXPORT_BUFFER_SIZE)
+						{
+							stream.Write(buffer.data(), (std::uint32_t)buffer.length());
+							buffer.clear();
+						}
+					}
+				}
+
+				if (!buffer.empty())
+					stream.Write(buffer.data(), (std::uint32_t)buffer.length());
 			}
 			catch (const std::exception& e)
 			{
 				_ERROR(e.what());
-				return false;
+				result = false;
 			}
+
+			if (locked)
+				_slines_section.Unlock();
+
+			return result;
 		}
 
 		void LogWindow::InputLog(const std::string_view& formatted_message, ...)
@@ -593,8 +1216,35 @@ namespace CKPE
 			va_end(va);
 		}
 
+		bool LogWindow::IsFormatBlacklisted(const char* format, const void* call_site) noexcept(true)
+		{
+			if (_formatBlacklist.empty() || !format)
+				return false;
+
+			auto hash = GetFormatHash(format, strlen(format));
+			auto it = _formatBlacklist.end();
+
+			if (call_site && _sformat_has_sites)
+				it = _formatBlacklist.find(GetFormatSiteKey(hash, (std::uintptr_t)call_site - _seditor_base));
+
+			if (it == _formatBlacklist.end())
+			{
+				it = _formatBlacklist.find(hash);
+				if (it == _formatBlacklist.end())
+					return false;
+			}
+
+			it->second.hits.fetch_add(1, std::memory_order_relaxed);
+			_ssuppressed.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+
 		void LogWindow::InputLogVa(const std::string_view& formatted_message, va_list va)
 		{
+			// Отсеять по строке формата, пока ничего не форматировали
+			if (IsFormatBlacklisted(formatted_message.data()))
+				return;
+
 			int len = _vscprintf(formatted_message.data(), va);
 			if (len <= 0)
 				return;
@@ -611,21 +1261,39 @@ namespace CKPE
 					return;
 
 				auto HashMsg = HashUtils::MurmurHash64A(sbuffer.c_str(), sbuffer.length());
-				if ((_last_hash == HashMsg) || (_messageBlacklist.count(HashMsg) > 0))
+				if (_last_hash == HashMsg)
+					return;
+
+				if (auto it = _messageBlacklist.find(HashMsg); it != _messageBlacklist.end())
+				{
+					it->second.hits.fetch_add(1, std::memory_order_relaxed);
+					it->second.bytes.fetch_add((std::uint64_t)len, std::memory_order_relaxed);
+					_ssuppressed.fetch_add(1, std::memory_order_relaxed);
 					return;
+				}
 
 				_last_hash = HashMsg;
 				// fix length string sbuffer
-				sbuffer = std::string(sbuffer.c_str()).append("\n");
+				sbuffer = std::string(sbuffer.c_str());
 
 				if (_output_file)
 				{
 					fputs(sbuffer.c_str(), _output_file);
+					fputc('\n', _output_file);
 					fflush(_output_file);
 				}
 
-				if (_pendingMessages.size() < LINECOUNT_MAX)
-					_pendingMessages.push_back(CKPE::strdup(sbuffer.c_str()));
+				if (auto logger = Logger::GetSingleton(); logger->HasStructured())
+				{
+					// Структурированный лог в UTF-8, уровень тот же, что и для подсветки в окне
+					auto severity = GetSeverity(sbuffer.c_str());
+					auto text = StringUtils::WinCPToUtf8(sbuffer);
+					logger->WriteStructured((severity == lsError) ? Logger::tError :
+						((severity == lsWarning) ? Logger::tWarning : Logger::tMessage), "console",
+						text.c_str(), text.length());
+				}
+
+				PushLine(sbuffer.c_str(), sbuffer.length());
 			}
 		}
 
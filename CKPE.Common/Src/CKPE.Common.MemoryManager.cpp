@@ -5,16 +5,21 @@
 #include <CKPE.ErrorHandler.h>
 #include <CKPE.Asserts.h>
 #include <CKPE.Common.MemoryManager.h>
+#include <CKPE.Common.AllocationTracker.h>
+#include <CKPE.Common.ScrapHeap.h>
 #include <Voltek.MemoryManager.h>
 #include <memory.h>
 #include <format>
 #include <algorithm>
+#include <atomic>
 
 namespace CKPE
 {
 	namespace Common
 	{
 		static MemoryManager smemmgr;
+		static std::atomic_uint64_t _srealloc_count = 0;
+		static std::atomic_uint64_t _srealloc_copied = 0;
 
 		MemoryManager::MemoryManager() noexcept(true)
 		{
@@ -54,6 +59,8 @@ namespace CKPE
 			void* ptr = voltek::scalable_alloc(size);
 			if (ptr && zeroed) memset(ptr, 0, size);
 
+			AllocationTracker::OnAlloc(ptr, size);
+
 			if (!ptr && size <= (128llu * 1024 * 1024))
 				CKPE_ASSERT_MSG_FMT(false, "A memory allocation failed. This is due to memory leaks in the Creation Kit or not"
 					" having enough free RAM.\n\nRequested chunk size: %llu bytes.", size);
@@ -63,14 +70,60 @@ namespace CKPE
 
 		std::size_t MemoryManager::MemSize(void* mem) noexcept(true)
 		{
+			if (ScrapHeap::Owns(mem))
+				return ScrapHeap::Size(mem);
+
 			return voltek::scalable_msize(mem);
 		}
 
 		void MemoryManager::MemFree(void* mem) noexcept(true)
 		{
+			// Scrap blocks that the editor releases through the general allocator
+			if (ScrapHeap::Owns(mem))
+			{
+				ScrapHeap::Deallocate(mem);
+				return;
+			}
+
+			AllocationTracker::OnFree(mem);
 			voltek::scalable_free(mem);
 		}
 
+		void* MemoryManager::MemRealloc(void* mem, std::size_t size) noexcept(true)
+		{
+			if (!mem)
+				return size ? MemAlloc(size, 0, false) : nullptr;
+
+			if (!size)
+			{
+				MemFree(mem);
+				return nullptr;
+			}
+
+			_srealloc_count.fetch_add(1, std::memory_order_relaxed);
+
+			// Always moved: the block doesn't know the size that was requested for it, so the growth into the rest
+			// of a pool block could hand out the stale bytes, while recalloc must return it zeroed
+			auto old_size = MemSize(mem);
+			auto ptr = MemAlloc(size, 0, false, false);
+			if (!ptr)
+				return nullptr;
+
+			auto copy_size = std::min(old_size, size);
+			memcpy(ptr, mem, copy_size);
+			// Recalloc behaves like calloc if there's no existing allocation. Realloc doesn't. Zero it either way.
+			memset((std::uint8_t*)ptr + copy_size, 0, size - copy_size);
+			_srealloc_copied.fetch_add(copy_size, std::memory_order_relaxed);
+
+			MemFree(mem);
+			return ptr;
+		}
+
+		MemoryManager::ReallocStats MemoryManager::GetReallocStats() noexcept(true)
+		{
+			return { _srealloc_count.load(std::memory_order_relaxed), _srealloc_copied.load(std::memory_order_relaxed) };
+		}
+
 		MemoryManager* MemoryManager::GetSingleton() noexcept(true)
 		{
 			return &smemmgr;
@@ -84,17 +137,7 @@ namespace CKPE
 
 	CKPE_COMMON_API void* realloc(void* m, std::size_t s) noexcept(true)
 	{
-		void* newMemory = nullptr;
-
-		if (s > 0)
-		{
-			// Recalloc behaves like calloc if there's no existing allocation. Realloc doesn't. Zero it either way.
-			newMemory = Common::smemmgr.MemAlloc(s, 0, false);
-			if (m) memcpy(newMemory, m, std::min(s, voltek::scalable_msize(m)));
-		}
-
-		Common::smemmgr.MemFree(m);
-		return newMemory;
+		return Common::smemmgr.MemRealloc(m, s);
 	}
 
 	CKPE_COMMON_API void* calloc(std::size_t s, std::size_t c) noexcept(true)
@@ -0,0 +1,200 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#include <windows.h>
+#include <malloc.h>
+#include <CKPE.CriticalSection.h>
+#include <CKPE.Common.Interface.h>
+#include <CKPE.Common.MemoryPressure.h>
+#include <Voltek.MemoryManager.h>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <thread>
+
+namespace CKPE
+{
+	namespace Common
+	{
+		// Do not trim again more often than this while the pressure lasts
+		constexpr static std::uint64_t MEMPRESSURE_COOLDOWN_MS = 30000;
+
+		struct TrimCallbackEntry
+		{
+			std::uint32_t id;
+			std::int32_t priority;
+			std::string name;
+			MemoryPressure::TrimCallback callback;
+			void* user_data;
+		};
+
+		static CriticalSection _ssection;
+		static std::vector<TrimCallbackEntry> _scallbacks;
+		static std::uint32_t _snext_id = 1;
+		static std::atomic<MemoryPressure::Level> _slevel = MemoryPressure::plNone;
+		static float _savailable_ratio = 0.10f;
+		static float _scommit_ratio = 0.90f;
+		static HANDLE _sclose_event = nullptr;
+		static HANDLE _slow_memory_notify = nullptr;
+		static std::thread* _smonitor_thread = nullptr;
+
+		[[nodiscard]] static MemoryPressure::Level QueryLevel() noexcept(true)
+		{
+			MEMORYSTATUSEX status{ .dwLength = sizeof(MEMORYSTATUSEX) };
+			if (!GlobalMemoryStatusEx(&status) || !status.ullTotalPhys || !status.ullTotalPageFile)
+				return MemoryPressure::plNone;
+
+			auto available = (double)status.ullAvailPhys / (double)status.ullTotalPhys;
+			auto commit = (double)(status.ullTotalPageFile - status.ullAvailPageFile) / (double)status.ullTotalPageFile;
+
+			// Critical: half of the threshold of free memory is left or the commit limit is almost reached
+			if ((available < (_savailable_ratio * 0.5)) || (commit > (1.0 - (1.0 - _scommit_ratio) * 0.5)))
+				return MemoryPressure::plCritical;
+
+			if ((available < _savailable_ratio) || (commit > _scommit_ratio))
+				return MemoryPressure::plModerate;
+
+			return MemoryPressure::plNone;
+		}
+
+		void MemoryPressure::Initialize() noexcept(true)
+		{
+			if (_smonitor_thread || !_READ_OPTION_BOOL("Memory", "bMemoryPressureMonitor", true))
+				return;
+
+			_savailable_ratio = std::clamp(_READ_OPTION_FLOAT("Memory", "fMemoryPressureAvailableRatio", 0.10f), 0.01f, 0.9f);
+			_scommit_ratio = std::clamp(_READ_OPTION_FLOAT("Memory", "fMemoryPressureCommitRatio", 0.90f), 0.1f, 0.99f);
+			auto interval = std::max(_READ_OPTION_UINT("Memory", "uMemoryPressurePollInterval", 2000), 250ul);
+
+			_sclose_event = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+			_slow_memory_notify = CreateMemoryResourceNotification(LowMemoryResourceNotification);
+
+			_smonitor_thread = new std::thread([](std::uint32_t interval)
+				{
+					std::uint64_t last_trim = 0;
+					HANDLE handles[2] = { _sclose_event, _slow_memory_notify };
+					DWORD count = _slow_memory_notify ? 2 : 1;
+
+					while (true)
+					{
+						auto result = WaitForMultipleObjects(count, handles, FALSE, interval);
+						if (result == WAIT_OBJECT_0)
+							break;
+
+						auto level = QueryLevel();
+						// The system signals low memory on its own, don't wait for our thresholds
+						if ((result == (WAIT_OBJECT_0 + 1)) && (level == plNone))
+							level = plModerate;
+
+						auto prev = _slevel.exchange(level);
+						if (level == plNone)
+						{
+							// The trim has paused the prefill of the allocator caches, they're allowed to fill again
+							if (prev != plNone)
+								voltek::scalable_memory_resume_prefill();
+							continue;
+						}
+
+						auto now = GetTickCount64();
+						if ((level > prev) || ((now - last_trim) >= MEMPRESSURE_COOLDOWN_MS))
+						{
+							last_trim = now;
+							Trim(level);
+						}
+
+						// The notification stays signaled while memory is low, don't spin on it
+						if (result == (WAIT_OBJECT_0 + 1))
+							WaitForSingleObject(_sclose_event, interval);
+					}
+				}, interval);
+
+			_MESSAGE("Memory pressure monitor: enabled (available < %.0f%%, commit > %.0f%%)",
+				_savailable_ratio * 100.f, _scommit_ratio * 100.f);
+		}
+
+		void MemoryPressure::Shutdown() noexcept(true)
+		{
+			if (_smonitor_thread)
+			{
+				SetEvent(_sclose_event);
+				if (_smonitor_thread->joinable())
+					_smonitor_thread->join();
+
+				delete _smonitor_thread;
+				_smonitor_thread = nullptr;
+			}
+
+			if (_slow_memory_notify)
+			{
+				CloseHandle(_slow_memory_notify);
+				_slow_memory_notify = nullptr;
+			}
+
+			if (_sclose_event)
+			{
+				CloseHandle(_sclose_event);
+				_sclose_event = nullptr;
+			}
+		}
+
+		std::uint32_t MemoryPressure::RegisterTrimCallback(const char* name, std::int32_t priority,
+			TrimCallback callback, void* user_data) noexcept(true)
+		{
+			if (!callback)
+				return 0;
+
+			ScopeCriticalSection guard(_ssection);
+
+			auto id = _snext_id++;
+			_scallbacks.emplace_back(TrimCallbackEntry{ id, priority, name ? name : "", callback, user_data });
+			std::stable_sort(_scallbacks.begin(), _scallbacks.end(),
+				[](const TrimCallbackEntry& a, const TrimCallbackEntry& b) { return a.priority < b.priority; });
+
+			return id;
+		}
+
+		void MemoryPressure::UnregisterTrimCallback(std::uint32_t id) noexcept(true)
+		{
+			ScopeCriticalSection guard(_ssection);
+
+			auto it = std::find_if(_scallbacks.begin(), _scallbacks.end(),
+				[id](const TrimCallbackEntry& entry) { return entry.id == id; });
+			if (it != _scallbacks.end())
+				_scallbacks.erase(it);
+		}
+
+		MemoryPressure::Level MemoryPressure::GetLevel() noexcept(true)
+		{
+			return _slevel;
+		}
+
+		std::size_t MemoryPressure::Trim(Level level) noexcept(true)
+		{
+			std::size_t total = 0;
+
+			{
+				ScopeCriticalSection guard(_ssection);
+
+				for (auto& entry : _scallbacks)
+				{
+					auto released = entry.callback(level, entry.user_data);
+					if (released)
+						_MESSAGE("Memory pressure: \"%s\" released %.2f MB", entry.name.c_str(),
+							(double)released / (1024.0 * 1024.0));
+					total += released;
+				}
+			}
+
+			// After the caches, return the empty pages of the allocators to the OS
+			auto pages = voltek::scalable_memory_trim();
+			_heapmin();
+
+			_MESSAGE("Memory pressure (%s): trim callbacks released %.2f MB, allocator released %llu pages",
+				(level == plCritical) ? "critical" : "moderate", (double)total / (1024.0 * 1024.0), pages);
+
+			return total;
+		}
+	}
+}
\ No newline at end of file
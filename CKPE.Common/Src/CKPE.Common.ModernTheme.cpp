@@ -12,6 +12,7 @@
 #include <CKPE.Exception.h>
 #include <CKPE.Detours.h>
 #include <CKPE.Common.Interface.h>
+#include <CKPE.Common.SettingHandle.h>
 #include <CKPE.Common.ModernTheme.h>
 #include <CKPE.Common.UIVarCommon.h>
 #include <CKPE.Graphics.h>
@@ -212,6 +213,8 @@ namespace CKPE
 		static HBRUSH g_brItemBackgroundHot = nullptr;
 		static HBRUSH g_brItemBackgroundSelected = nullptr;
 		static HICON g_AppIcon = nullptr;
+		// Fonts are created all the time while the editor is working
+		static SettingHandle<long> g_Charset("CreationKit:nCharset", DEFAULT_CHARSET);
 
 		struct string_equal_to {
 			inline bool operator()(const std::string_view& lhs, const std::string_view& rhs) const
@@ -363,7 +366,7 @@ namespace CKPE
 				auto f = UI::ThemeData::GetSingleton()->ThemeFont;
 
 				return (HFONT)::CreateFontA(f->Height, 0, cEscapement, cOrientation, cWeight, bItalic, bUnderline, 
-					bStrikeOut, _READ_OPTION_INT("CreationKit", "nCharset", DEFAULT_CHARSET), iOutPrecision, 
+					bStrikeOut, g_Charset.Get(), iOutPrecision, 
 					iClipPrecision, CLEARTYPE_NATURAL_QUALITY, VARIABLE_PITCH, f->GetName().c_str());
 			}
 
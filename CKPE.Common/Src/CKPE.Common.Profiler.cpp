@@ -0,0 +1,462 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#include <windows.h>
+#include <tlhelp32.h>
+#include <psapi.h>
+#include <CKPE.Stream.h>
+#include <CKPE.PathUtils.h>
+#include <CKPE.StringUtils.h>
+#include <CKPE.PESymbolizer.h>
+#include <CKPE.CollapsedStacks.h>
+#include <CKPE.Common.Interface.h>
+#include <CKPE.Common.CrashHandler.h>
+#include <CKPE.Common.ThreadSampler.h>
+#include <CKPE.Common.Profiler.h>
+#include <algorithm>
+#include <vector>
+#include <atomic>
+#include <thread>
+
+namespace CKPE
+{
+	namespace Common
+	{
+		constexpr static std::uint32_t PROFILER_MAX_FRAMES = 128;
+		constexpr static std::uint32_t PROFILER_REFRESH_MS = 1000;
+		constexpr static int PROFILER_HOTKEY_ID = 0x4350;
+
+		struct ProfilerThread
+		{
+			DWORD id;
+			HANDLE handle;
+			std::uint64_t cycles;
+			bool alive;
+		};
+
+		struct ProfilerSession
+		{
+			std::vector<ProfilerThread> threads;
+			// The stacks are unwound and named by this table
+			PESymbolizer::ModuleTable modules;
+			DWORD count_modules{ 0 };
+			ThreadSampler sampler;
+			CollapsedStacks::Aggregator samples;
+			std::uint64_t started{ 0 };
+			std::uint64_t refreshed{ 0 };
+		};
+
+		static bool _senabled = false;
+		static std::atomic_bool _srunning = false;
+		static DWORD _smain_thread_id = 0;
+		static std::uint32_t _sinterval = 5;
+		static bool _sall_threads = false;
+		static std::string _shotkey;
+		static UINT _shotkey_modifiers = 0;
+		static UINT _shotkey_key = 0;
+		static HANDLE _sclose_event = nullptr;
+		static std::thread* _sprofiler_thread = nullptr;
+
+		// "CTRL+ALT+P", "SHIFT+F11"
+		[[nodiscard]] static bool ParseHotkey(const std::string& text, UINT& modifiers, UINT& key) noexcept(true)
+		{
+			modifiers = MOD_NOREPEAT;
+			key = 0;
+
+			std::string hotkey;
+			for (auto ch : text)
+				if ((ch != ' ') && (ch != '"') && (ch != '\''))
+					hotkey.push_back((char)toupper((unsigned char)ch));
+
+			std::size_t start = 0;
+			while (start < hotkey.length())
+			{
+				auto end = hotkey.find('+', start);
+				if (end == std::string::npos)
+					end = hotkey.length();
+
+				auto token = hotkey.substr(start, end - start);
+				start = end + 1;
+
+				if (token == "CTRL")
+					modifiers |= MOD_CONTROL;
+				else if (token == "SHIFT")
+					modifiers |= MOD_SHIFT;
+				else if (token == "ALT")
+					modifiers |= MOD_ALT;
+				else if ((token.length() > 1) && (token[0] == 'F'))
+				{
+					auto index = atoi(token.c_str() + 1);
+					if ((index < 1) || (index > 24))
+						return false;
+
+					key = VK_F1 + index - 1;
+				}
+				else if ((token.length() == 1) && isalnum((unsigned char)token[0]))
+					key = token[0];
+				else
+					return false;
+			}
+
+			return key != 0;
+		}
+
+		[[nodiscard]] static std::string FormatFrame(const PESymbolizer::ModuleTable& modules,
+			std::uintptr_t address) noexcept(true)
+		{
+			PESymbolizer::Symbol symbol;
+			if (!modules.Symbolize(address, symbol))
+				return StringUtils::FormatString("0x%llX", address);
+
+			if (!symbol.has_function)
+				return StringUtils::FormatString("%s!0x%X", symbol.module->name.c_str(), symbol.rva);
+
+			// Without offsets, all samples of a function are merged
+			auto& function = symbol.function;
+			std::string name;
+			std::string known;
+			std::string patches;
+			const char* last_patch = nullptr;
+
+			symbol.module->ForEachAnnotation(function.begin, function.end, [&](const PESymbolizer::Annotation& entry)
+				{
+					if (entry.tag == CrashHandler::atVirtualFunction)
+					{
+						if (name.empty() && (entry.rva == function.begin))
+							name = StringUtils::FormatString("%s::vfunc_%u", entry.name, entry.index);
+					}
+					else if (entry.tag == CrashHandler::atKnownFunction)
+					{
+						if (known.empty() && (entry.rva == function.begin))
+							known = StringUtils::FormatString("%s#%u", entry.name, entry.index);
+					}
+					else if (entry.name != last_patch)
+					{
+						last_patch = entry.name;
+						patches.append(StringUtils::FormatString(" [patch:%s]", entry.name));
+					}
+				});
+
+			// The class of a virtual function says more than the patch that knows the function
+			if (name.empty())
+				name = known.empty() ? StringUtils::FormatString("sub_%X", function.begin) : known;
+
+			return symbol.module->name + "!" + name + patches;
+		}
+
+		static void CloseThreads(ProfilerSession& session) noexcept(true)
+		{
+			for (auto& thread : session.threads)
+				CloseHandle(thread.handle);
+
+			session.threads.clear();
+		}
+
+		// Never while a thread is suspended: the loader lock is taken
+		static void RefreshModules(ProfilerSession& session) noexcept(true)
+		{
+			// The frames of the modules loaded after the table was built would end the stacks
+			HMODULE module;
+			DWORD needed = 0;
+			if (!EnumProcessModules(GetCurrentProcess(), &module, sizeof(module), &needed) ||
+				(needed == session.count_modules))
+				return;
+
+			session.count_modules = needed;
+			session.modules.Clear();
+			CrashHandler::BuildModuleTable(session.modules);
+		}
+
+		static void RefreshThreads(ProfilerSession& session) noexcept(true)
+		{
+			auto snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+			if (snapshot == INVALID_HANDLE_VALUE)
+				return;
+
+			for (auto& thread : session.threads)
+				thread.alive = false;
+
+			auto process_id = GetCurrentProcessId();
+			auto self_id = GetCurrentThreadId();
+
+			THREADENTRY32 entry;
+			entry.dwSize = sizeof(entry);
+
+			if (Thread32First(snapshot, &entry))
+			{
+				do
+				{
+					if ((entry.th32OwnerProcessID != process_id) || (entry.th32ThreadID == self_id))
+						continue;
+
+					auto it = std::find_if(session.threads.begin(), session.threads.end(),
+						[&entry](const ProfilerThread& thread) { return thread.id == entry.th32ThreadID; });
+					if (it != session.threads.end())
+					{
+						it->alive = true;
+						continue;
+					}
+
+					auto handle = OpenThread(THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT |
+						THREAD_QUERY_LIMITED_INFORMATION, FALSE, entry.th32ThreadID);
+					if (handle)
+						session.threads.push_back({ entry.th32ThreadID, handle, 0, true });
+				} while (Thread32Next(snapshot, &entry));
+			}
+
+			CloseHandle(snapshot);
+
+			for (auto it = session.threads.begin(); it != session.threads.end();)
+			{
+				if (!it->alive)
+				{
+					CloseHandle(it->handle);
+					it = session.threads.erase(it);
+				}
+				else
+					it++;
+			}
+		}
+
+		static void Sample(ProfilerSession& session) noexcept(true)
+		{
+			if ((GetTickCount64() - session.refreshed) >= PROFILER_REFRESH_MS)
+			{
+				session.refreshed = GetTickCount64();
+				RefreshModules(session);
+
+				if (_sall_threads)
+					RefreshThreads(session);
+			}
+
+			std::uintptr_t frames[PROFILER_MAX_FRAMES];
+
+			for (auto& thread : session.threads)
+			{
+				// The main thread is sampled always (it shows where the editor waits), the others
+				// only if they have run since the previous sample, the waiting workers are noise
+				if (thread.id != _smain_thread_id)
+				{
+					ULONG64 cycles = 0;
+					if (!QueryThreadCycleTime(thread.handle, &cycles) || (cycles == thread.cycles))
+						continue;
+
+					thread.cycles = cycles;
+				}
+
+				auto count = session.sampler.Capture(thread.handle, session.modules, frames, PROFILER_MAX_FRAMES);
+				if (!count)
+					continue;
+
+				// Return addresses point after the call, it can be the last instruction of the function
+				for (std::uint32_t i = 1; i < count; i++)
+					frames[i]--;
+
+				session.samples.Add(thread.id, frames, count);
+			}
+		}
+
+		static bool Start(ProfilerSession& session, HANDLE timer) noexcept(true)
+		{
+			session.samples.Clear();
+			session.started = GetTickCount64();
+			session.refreshed = session.started;
+
+			// Before any thread is suspended
+			session.count_modules = 0;
+			RefreshModules(session);
+
+			if (_sall_threads)
+				RefreshThreads(session);
+			else
+			{
+				auto handle = OpenThread(THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT |
+					THREAD_QUERY_LIMITED_INFORMATION, FALSE, _smain_thread_id);
+				if (handle)
+					session.threads.push_back({ _smain_thread_id, handle, 0, true });
+			}
+
+			LARGE_INTEGER due;
+			due.QuadPart = -(LONGLONG)_sinterval * 10000;
+			if (session.threads.empty() || !SetWaitableTimer(timer, &due, (LONG)_sinterval, nullptr, nullptr, FALSE))
+			{
+				_ERROR("Profiler: failed to start (error: %u)", GetLastError());
+				CloseThreads(session);
+				return false;
+			}
+
+			_MESSAGE("Profiler: started (interval: %u ms, %s)", _sinterval,
+				_sall_threads ? "all threads" : "main thread");
+			return true;
+		}
+
+		static void Stop(ProfilerSession& session, HANDLE timer) noexcept(true)
+		{
+			CancelWaitableTimer(timer);
+			CloseThreads(session);
+
+			auto duration = (double)(GetTickCount64() - session.started) / 1000.0;
+			if (!session.samples.GetSamples())
+			{
+				_MESSAGE("Profiler: stopped, there are no samples");
+				return;
+			}
+
+			auto& modules = session.modules;
+			auto text = session.samples.Collapse(
+				[](std::uint32_t thread) -> std::string
+				{
+					return (thread == _smain_thread_id) ? "main thread" : StringUtils::FormatString("thread %u", thread);
+				},
+				[&modules](std::uintptr_t address) -> std::string
+				{
+					return FormatFrame(modules, address);
+				});
+
+			SYSTEMTIME sysTime;
+			GetSystemTime(&sysTime);
+
+			auto fname = StringUtils::FormatString(L"%s_%4d%02d%02d_%02d%02d%02d.folded",
+				PathUtils::ExtractFileName(PathUtils::GetApplicationFileName()).c_str(), sysTime.wYear, sysTime.wMonth,
+				sysTime.wDay, sysTime.wHour, sysTime.wMinute, sysTime.wSecond);
+			PathUtils::CreateFolder(PathUtils::GetCKPELogsPath() + L"Profiles");
+			fname = PathUtils::GetCKPELogsPath() + L"Profiles\\" + fname;
+
+			try
+			{
+				FileStream stream(fname, FileStream::fmCreate);
+				stream.Write(text.data(), (std::uint32_t)text.length());
+			}
+			catch (const std::exception& e)
+			{
+				_ERROR("Profiler: %s", e.what());
+				return;
+			}
+
+			_MESSAGE("Profiler: stopped, %llu samples (unique stacks: %llu) in %.1f sec, the profile is \"%s\"",
+				session.samples.GetSamples(), session.samples.GetUniqueStacks(), duration,
+				StringUtils::Utf16ToWinCP(fname).c_str());
+		}
+
+		static void ProfilerProc() noexcept(true)
+		{
+			// WM_HOTKEY is posted to the thread that has registered the hotkey
+			if (!RegisterHotKey(nullptr, PROFILER_HOTKEY_ID, _shotkey_modifiers, _shotkey_key))
+			{
+				_ERROR("Profiler: the hotkey \"%s\" can't be registered (error: %u)", _shotkey.c_str(), GetLastError());
+				return;
+			}
+
+			// The default timer resolution is ~15 ms, too coarse for the sampling
+			auto timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+			if (!timer)
+				timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+
+			if (!timer)
+			{
+				_ERROR("Profiler: CreateWaitableTimer failed (error: %u)", GetLastError());
+				UnregisterHotKey(nullptr, PROFILER_HOTKEY_ID);
+				return;
+			}
+
+			ProfilerSession session;
+			HANDLE handles[2] = { _sclose_event, timer };
+
+			for (;;)
+			{
+				auto result = MsgWaitForMultipleObjects(2, handles, FALSE, INFINITE, QS_ALLINPUT);
+				if (result == (WAIT_OBJECT_0 + 1))
+					Sample(session);
+				else if (result == (WAIT_OBJECT_0 + 2))
+				{
+					MSG msg;
+					while (PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE))
+					{
+						if ((msg.message != WM_HOTKEY) || (msg.wParam != PROFILER_HOTKEY_ID))
+							continue;
+
+						if (_srunning)
+						{
+							_srunning = false;
+							Stop(session, timer);
+						}
+						else
+							_srunning = Start(session, timer);
+					}
+				}
+				else
+					break;
+			}
+
+			if (_srunning)
+			{
+				// The editor is closing, it's too late to symbolize
+				_srunning = false;
+				CancelWaitableTimer(timer);
+				CloseThreads(session);
+			}
+
+			CloseHandle(timer);
+			UnregisterHotKey(nullptr, PROFILER_HOTKEY_ID);
+		}
+
+		void Profiler::Initialize() noexcept(true)
+		{
+			if (_senabled || !_READ_OPTION_BOOL("Crashes", "bProfiler", false))
+				return;
+
+			_shotkey = _READ_OPTION_STR("Crashes", "sProfilerHotkey", "CTRL+ALT+P");
+			if (!ParseHotkey(_shotkey, _shotkey_modifiers, _shotkey_key))
+			{
+				_ERROR("Profiler: invalid hotkey \"%s\"", _shotkey.c_str());
+				return;
+			}
+
+			_sinterval = std::clamp(_READ_OPTION_UINT("Crashes", "uProfilerInterval", 5), 1ul, 1000ul);
+			_sall_threads = _READ_OPTION_BOOL("Crashes", "bProfilerAllThreads", false);
+			_smain_thread_id = GetCurrentThreadId();
+
+			_sclose_event = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+			_sprofiler_thread = new std::thread(&ProfilerProc);
+
+			_senabled = true;
+
+			_MESSAGE("Profiler: enabled (hotkey: %s)", _shotkey.c_str());
+		}
+
+		void Profiler::Shutdown() noexcept(true)
+		{
+			if (!_senabled)
+				return;
+
+			_senabled = false;
+
+			if (_sprofiler_thread)
+			{
+				SetEvent(_sclose_event);
+				if (_sprofiler_thread->joinable())
+					_sprofiler_thread->join();
+
+				delete _sprofiler_thread;
+				_sprofiler_thread = nullptr;
+			}
+
+			if (_sclose_event)
+			{
+				CloseHandle(_sclose_event);
+				_sclose_event = nullptr;
+			}
+		}
+
+		bool Profiler::HasEnabled() noexcept(true)
+		{
+			return _senabled;
+		}
+
+		bool Profiler::IsRunning() noexcept(true)
+		{
+			return _srunning;
+		}
+	}
+}
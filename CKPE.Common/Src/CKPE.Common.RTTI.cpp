@@ -11,6 +11,8 @@
 #include <CKPE.ErrorHandler.h>
 #include <CKPE.Common.MemoryManager.h>
 #include <unordered_map>
+#include <algorithm>
+#include <vector>
 #include <format>
 
 extern "C"
@@ -28,6 +30,8 @@ namespace CKPE
 		static RTTI srtti;
 
 		std::unordered_map<std::uint32_t, RTTI::Info> srtti_data;
+		// Sorted by the address of the vtable, the crash handler looks up every stack slot
+		std::vector<const RTTI::Info*> srtti_vtables;
 
 		bool RTTI::IsWithinDATA(std::uintptr_t addr) const noexcept(true)
 		{
@@ -73,6 +77,7 @@ namespace CKPE
 			segtext  = _sapp->GetSegment(Segment::text);
 
 			srtti_data.clear();
+			srtti_vtables.clear();
 
 			for (uintptr_t i = segrdata.GetAddress(); 
 				i < (segrdata.GetEndAddress() - (sizeof(uintptr_t) << 1)); 
@@ -116,6 +121,13 @@ namespace CKPE
 
 				srtti_data.insert({ HashUtils::MurmurHash32(info.Name), info});
 			}
+
+			srtti_vtables.reserve(srtti_data.size());
+			for (const auto& info : srtti_data)
+				srtti_vtables.push_back(&info.second);
+
+			std::sort(srtti_vtables.begin(), srtti_vtables.end(), [](const Info* a, const Info* b)
+				{ return a->VTableAddress < b->VTableAddress; });
 		}
 
 		void RTTI::Dump(const std::wstring& fname) const noexcept(true)
@@ -164,15 +176,25 @@ namespace CKPE
 
 		const RTTI::Info* RTTI::Find(const std::uintptr_t address, bool error_if_no_found) const noexcept(true)
 		{
-			for (const auto& info : srtti_data)
-				if (info.second.VTableAddress == address)
-					return &info.second;
+			auto it = std::lower_bound(srtti_vtables.begin(), srtti_vtables.end(), address,
+				[](const Info* info, std::uintptr_t address) { return info->VTableAddress < address; });
+			if ((it != srtti_vtables.end()) && ((*it)->VTableAddress == address))
+				return *it;
 
 			if (error_if_no_found)
 				ErrorHandler::Trigger(std::format("RTTI::Find \"{:x}\" had no results", address));
 			return nullptr;
 		}
 
+		void RTTI::Enum(EnumCallback callback, void* user_data) const noexcept(true)
+		{
+			if (!callback)
+				return;
+
+			for (auto info : srtti_vtables)
+				callback(info, user_data);
+		}
+
 		void* RTTI::Cast(const void* InPtr, long VfDelta, const char* lpstrFromType, const char* lpstrTargetType,
 			bool isReference)
 		{
@@ -0,0 +1,251 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#include <windows.h>
+#include <CKPE.Common.Interface.h>
+#include <CKPE.Common.MemoryManager.h>
+#include <CKPE.Common.ScrapHeap.h>
+#include <algorithm>
+#include <atomic>
+
+namespace CKPE
+{
+	namespace Common
+	{
+		constexpr static std::uint32_t SCRAPHEAP_MAX_ARENAS = 64;
+		constexpr static std::size_t SCRAPHEAP_COMMIT_STEP = 64 * 1024;
+		constexpr static std::size_t SCRAPHEAP_MIN_ALIGNMENT = 16;
+		constexpr static std::size_t SCRAPHEAP_REPORT_MIN = 1024 * 1024;
+		constexpr static std::uint32_t SCRAPHEAP_NONE = 0xFFFFFFFF;
+
+		// Lies right before the block
+		struct ScrapBlockHeader
+		{
+			std::uint32_t prev_top;			// top of the arena before the block
+			std::uint32_t prev_last;		// header of the block below
+			std::uint32_t size;
+			std::atomic_uint32_t freed;
+		};
+
+		static_assert(sizeof(ScrapBlockHeader) == 0x10);
+
+		struct ScrapArena
+		{
+			std::uint8_t* base{ nullptr };
+			// Only the owner thread moves the top
+			std::uint32_t top{ 0 };
+			std::uint32_t last{ SCRAPHEAP_NONE };
+			std::size_t committed{ 0 };
+			// Blocks can be freed by other threads
+			std::atomic_int64_t live{ 0 };
+			std::atomic_bool used{ false };
+			// The owner thread has exited with live blocks, the last free releases the slot
+			std::atomic_bool orphaned{ false };
+		};
+
+		// Counts the slots given back, a thread left without a slot looks again only after a release
+		static std::atomic_uint64_t _sreleases = 0;
+
+		static void ReleaseArena(ScrapArena* arena) noexcept(true)
+		{
+			arena->top = 0;
+			arena->last = SCRAPHEAP_NONE;
+			arena->used.store(false, std::memory_order_release);
+			_sreleases.fetch_add(1, std::memory_order_release);
+		}
+
+		struct ScrapArenaOwner
+		{
+			ScrapArena* arena{ nullptr };
+			// The count of releases when all the slots were found taken
+			std::uint64_t tried_releases{ UINT64_MAX };
+
+			~ScrapArenaOwner()
+			{
+				if (!arena)
+					return;
+
+				// The slot is given to another thread once nothing is left in it, either now or by the last free
+				arena->orphaned.store(true, std::memory_order_seq_cst);
+				if (!arena->live.load(std::memory_order_seq_cst) && arena->orphaned.exchange(false))
+					ReleaseArena(arena);
+			}
+		};
+
+		static bool _senabled = false;
+		static std::uint8_t* _sregion = nullptr;
+		static std::uint8_t* _sregion_end = nullptr;
+		static std::size_t _sarena_size = 0;
+		static ScrapArena _sarenas[SCRAPHEAP_MAX_ARENAS];
+		static std::atomic_size_t _shigh_water = 0;
+		static std::atomic_size_t _sreported_high_water = SCRAPHEAP_REPORT_MIN >> 1;
+		static std::atomic_uint64_t _soverflows = 0;
+		static thread_local ScrapArenaOwner _sowner;
+
+		[[nodiscard]] static ScrapArena* GetThreadArena() noexcept(true)
+		{
+			if (_sowner.arena)
+				return _sowner.arena;
+
+			// Read before the search, so that a slot released during it is looked for the next time
+			auto releases = _sreleases.load(std::memory_order_acquire);
+			if (_sowner.tried_releases == releases)
+				return nullptr;
+
+			_sowner.tried_releases = releases;
+			for (auto& arena : _sarenas)
+			{
+				bool expected = false;
+				if (arena.used.compare_exchange_strong(expected, true))
+				{
+					_sowner.arena = &arena;
+					break;
+				}
+			}
+
+			return _sowner.arena;
+		}
+
+		static void UpdateHighWater(std::size_t top) noexcept(true)
+		{
+			auto high_water = _shigh_water.load(std::memory_order_relaxed);
+			while ((top > high_water) && !_shigh_water.compare_exchange_weak(high_water, top));
+
+			// Report each doubling starting from 1 MB
+			auto reported = _sreported_high_water.load(std::memory_order_relaxed);
+			if ((top >= (reported << 1)) && _sreported_high_water.compare_exchange_strong(reported, top))
+				_MESSAGE("Scrap heap: high-water mark %.2f MB per thread (overflows to the general allocator: %llu)",
+					(double)top / (1024.0 * 1024.0), _soverflows.load(std::memory_order_relaxed));
+		}
+
+		void ScrapHeap::Initialize() noexcept(true)
+		{
+			if (_senabled || !_READ_OPTION_BOOL("Memory", "bScrapHeapArena", true))
+				return;
+
+			auto size_mb = std::clamp(_READ_OPTION_UINT("Memory", "uScrapHeapArenaSizeMB", 4), 1ul, 64ul);
+			_sarena_size = (std::size_t)size_mb * 1024 * 1024;
+
+			// Address space only, pages are committed as the arenas grow
+			_sregion = (std::uint8_t*)VirtualAlloc(nullptr, _sarena_size * SCRAPHEAP_MAX_ARENAS, MEM_RESERVE,
+				PAGE_READWRITE);
+			if (!_sregion)
+			{
+				_MESSAGE("Scrap heap: failed to reserve the address space, the general allocator is used");
+				return;
+			}
+
+			_sregion_end = _sregion + _sarena_size * SCRAPHEAP_MAX_ARENAS;
+			for (std::uint32_t i = 0; i < SCRAPHEAP_MAX_ARENAS; i++)
+				_sarenas[i].base = _sregion + _sarena_size * i;
+
+			_senabled = true;
+
+			_MESSAGE("Scrap heap: enabled (%u MB per thread, up to %u threads)", size_mb, SCRAPHEAP_MAX_ARENAS);
+		}
+
+		bool ScrapHeap::HasEnabled() noexcept(true)
+		{
+			return _senabled;
+		}
+
+		bool ScrapHeap::Owns(const void* block) noexcept(true)
+		{
+			return (block >= _sregion) && (block < _sregion_end);
+		}
+
+		void* ScrapHeap::Allocate(std::size_t size, std::size_t alignment) noexcept(true)
+		{
+			auto arena = _senabled ? GetThreadArena() : nullptr;
+			if (arena && !(alignment & (alignment - 1)))
+			{
+				// Everything is freed, start from the beginning
+				if (!arena->live.load(std::memory_order_acquire))
+				{
+					arena->top = 0;
+					arena->last = SCRAPHEAP_NONE;
+				}
+
+				alignment = std::max(alignment, SCRAPHEAP_MIN_ALIGNMENT);
+				auto offset = (arena->top + sizeof(ScrapBlockHeader) + alignment - 1) & ~(alignment - 1);
+				auto end = offset + size;
+
+				if (end <= _sarena_size)
+				{
+					if (end > arena->committed)
+					{
+						auto commit = std::min((end + SCRAPHEAP_COMMIT_STEP - 1) & ~(SCRAPHEAP_COMMIT_STEP - 1), 
+							_sarena_size);
+						if (VirtualAlloc(arena->base + arena->committed, commit - arena->committed, MEM_COMMIT, 
+							PAGE_READWRITE))
+							arena->committed = commit;
+					}
+
+					if (end <= arena->committed)
+					{
+						auto header = (ScrapBlockHeader*)(arena->base + offset) - 1;
+						header->prev_top = arena->top;
+						header->prev_last = arena->last;
+						header->size = (std::uint32_t)size;
+						header->freed.store(0, std::memory_order_relaxed);
+
+						arena->last = (std::uint32_t)((std::uint8_t*)header - arena->base);
+						arena->top = (std::uint32_t)end;
+						arena->live.fetch_add(1, std::memory_order_relaxed);
+
+						if (end > _shigh_water.load(std::memory_order_relaxed))
+							UpdateHighWater(end);
+
+						// Zeroed, the editor got zeroed blocks from the general allocator before
+						memset(arena->base + offset, 0, size);
+						return arena->base + offset;
+					}
+				}
+
+				_soverflows.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			return MemoryManager::GetSingleton()->MemAlloc(size, alignment, alignment != 0);
+		}
+
+		void ScrapHeap::Deallocate(void* block) noexcept(true)
+		{
+			if (!Owns(block))
+			{
+				MemoryManager::GetSingleton()->MemFree(block);
+				return;
+			}
+
+			auto arena = &_sarenas[((std::uint8_t*)block - _sregion) / _sarena_size];
+			auto header = (ScrapBlockHeader*)block - 1;
+			header->freed.store(1, std::memory_order_relaxed);
+
+			// Only the owner moves the top back, over every freed block at the top
+			if (arena == _sowner.arena)
+			{
+				while (arena->last != SCRAPHEAP_NONE)
+				{
+					auto top_header = (ScrapBlockHeader*)(arena->base + arena->last);
+					if (!top_header->freed.load(std::memory_order_relaxed))
+						break;
+
+					arena->top = top_header->prev_top;
+					arena->last = top_header->prev_last;
+				}
+			}
+
+			if ((arena->live.fetch_sub(1, std::memory_order_seq_cst) == 1) &&
+				arena->orphaned.load(std::memory_order_seq_cst) && arena->orphaned.exchange(false))
+				ReleaseArena(arena);
+		}
+
+		std::size_t ScrapHeap::Size(const void* block) noexcept(true)
+		{
+			if (!Owns(block))
+				return MemoryManager::GetSingleton()->MemSize(const_cast<void*>(block));
+
+			return ((const ScrapBlockHeader*)block - 1)->size;
+		}
+	}
+}
@@ -9,6 +9,7 @@
 #include <CKPE.DirUtils.h>
 #include <CKPE.Exception.h>
 #include <CKPE.Common.SettingCollection.h>
+#include <CKPE.Common.INIIndex.h>
 #include <CKPE.Common.Interface.h>
 #include <algorithm>
 
@@ -1072,11 +1073,60 @@ namespace CKPE
 			OpenRelative(folderID, relPath);
 		}
 
+		INISettingCollection::~INISettingCollection()
+		{
+			if (_index)
+			{
+				delete _index;
+				_index = nullptr;
+			}
+		}
+
+		void INISettingCollection::Materialize() const noexcept(true)
+		{
+			if (_iniData.data)
+				return;
+
+			_iniData.data = new INIStructure::_Mbase;
+			if (!_index)
+				return;
+
+			// The index keeps only the last of the duplicates, as the tree always did
+			_index->ForEach([this](std::string_view section, std::string_view key, std::string_view value)
+				{
+					(*(_iniData.data))[std::string(section)].try_emplace(std::string(key), value);
+				});
+		}
+
+		bool INISettingCollection::FindValue(const std::string& section, const std::string& option,
+			std::string_view& value) const noexcept(true)
+		{
+			if (!_iniData.data)
+				return _index && _index->Find(section, option, value);
+
+			auto it = ReadSection(section);
+			if (it == _iniData.data->end())
+				return false;
+
+			for (auto& INIValue : it->second)
+			{
+				if (_stricmp(INIValue.first.c_str(), option.c_str()))
+					continue;
+
+				value = INIValue.second;
+				return true;
+			}
+
+			return false;
+		}
+
 		void INISettingCollection::Dump(TextFileStream& Stream) const noexcept(true)
 		{
 			if (!IsOpen())
 				return;
 
+			Materialize();
+
 			for (auto& INISection : *(_iniData.data))
 			{
 				if (!INISection.first.length() || !INISection.first.size() || !_stricmp(INISection.first.c_str(), "hotkeys"))
@@ -1097,27 +1147,16 @@ namespace CKPE
 
 		bool INISettingCollection::IsEmpty() const noexcept(true)
 		{
-			return !IsOpen() || (!_iniData.data->size());
+			if (!IsOpen())
+				return true;
+
+			return _iniData.data ? !_iniData.data->size() : (!_index || _index->IsEmpty());
 		}
 
 		bool INISettingCollection::Has(const std::string& section, const std::string& option) const noexcept(true)
 		{
-			if (!IsOpen())
-				return false;
-
-			auto ip = ReadSection(section);
-			if (ip == _iniData.data->end())
-				return false;
-
-			for (auto it = ip->second.begin(); it != ip->second.end(); it++)
-			{
-				if (_stricmp(it->first.c_str(), option.c_str()))
-					continue;
-
-				return true;
-			}
-
-			return false;
+			std::string_view value;
+			return IsOpen() && FindValue(section, option, value);
 		}
 
 		bool INISettingCollection::Remove(const std::string& section) noexcept(true)
@@ -1139,6 +1178,8 @@ namespace CKPE
 			if (!IsOpen())
 				return false;
 
+			Materialize();
+
 			for (auto ip = _iniData.data->begin(); ip != _iniData.data->end(); ip++)
 			{
 				if (_stricmp(ip->first.c_str(), section.c_str()))
@@ -1162,6 +1203,8 @@ namespace CKPE
 			if (!IsOpen())
 				return false;
 
+			Materialize();
+
 			_iniData.data->clear();
 
 			return true;
@@ -1170,6 +1213,8 @@ namespace CKPE
 		INISettingCollection::INIStructure::_Mbase::const_iterator INISettingCollection::ReadSection
 			(const std::string& section) const noexcept(true)
 		{
+			Materialize();
+
 			for (auto it = _iniData.data->begin(); it != _iniData.data->end(); it++)
 			{
 				if (_stricmp(it->first.c_str(), section.c_str()))
@@ -1186,19 +1231,11 @@ namespace CKPE
 			if (!IsOpen() || (GetOptionTypeByName(option) != sotBool))
 				return def;
 
-			auto it = ReadSection(section);
-			if (it == _iniData.data->end())
+			std::string_view value;
+			if (!FindValue(section, option, value))
 				return def;
 
-			for (auto& INIValue : it->second)
-			{
-				if (_stricmp(INIValue.first.c_str(), option.c_str()))
-					continue;
-
-				return !strcmp(INIValue.second.c_str(), "1") || !_stricmp(INIValue.second.c_str(), "true");
-			}
-
-			return def;
+			return !strcmp(value.data(), "1") || !_stricmp(value.data(), "true");
 		}
 
 		char INISettingCollection::ReadChar(const std::string& section, const std::string& option, char def) const noexcept(true)
@@ -1206,19 +1243,11 @@ namespace CKPE
 			if (!IsOpen() || (GetOptionTypeByName(option) != sotChar))
 				return def;
 
-			auto it = ReadSection(section);
-			if (it == _iniData.data->end())
+			std::string_view value;
+			if (!FindValue(section, option, value))
 				return def;
 
-			for (auto& INIValue : it->second)
-			{
-				if (_stricmp(INIValue.first.c_str(), option.c_str()))
-					continue;
-
-				return INIValue.second.empty() ? ' ' : INIValue.second.c_str()[0];
-			}
-
-			return def;
+			return value.empty() ? ' ' : value[0];
 		}
 
 		long INISettingCollection::ReadInt(const std::string& section, const std::string& option, 
@@ -1227,19 +1256,11 @@ namespace CKPE
 			if (!IsOpen() || (GetOptionTypeByName(option) != sotInteger))
 				return def;
 
-			auto it = ReadSection(section);
-			if (it == _iniData.data->end())
+			std::string_view value;
+			if (!FindValue(section, option, value))
 				return def;
 
-			for (auto& INIValue : it->second)
-			{
-				if (_stricmp(INIValue.first.c_str(), option.c_str()))
-					continue;
-
-				return INIValue.second.empty() ? 0l : strtol(INIValue.second.c_str(), nullptr, 10);
-			}
-
-			return def;
+			return value.empty() ? 0l : strtol(value.data(), nullptr, 10);
 		}
 
 		unsigned long INISettingCollection::ReadUInt(const std::string& section, const std::string& option, 
@@ -1248,19 +1269,11 @@ namespace CKPE
 			if (!IsOpen() || (GetOptionTypeByName(option) != sotUnsignedInteger))
 				return def;
 
-			auto it = ReadSection(section);
-			if (it == _iniData.data->end())
+			std::string_view value;
+			if (!FindValue(section, option, value))
 				return def;
 
-			for (auto& INIValue : it->second)
-			{
-				if (_stricmp(INIValue.first.c_str(), option.c_str()))
-					continue;
-
-				return INIValue.second.empty() ? 0ul : strtoul(INIValue.second.c_str(), nullptr, 10);
-			}
-
-			return def;
+			return value.empty() ? 0ul : strtoul(value.data(), nullptr, 10);
 		}
 
 		unsigned long INISettingCollection::ReadHex(const std::string& section, const std::string& option, 
@@ -1269,19 +1282,11 @@ namespace CKPE
 			if (!IsOpen() || (GetOptionTypeByName(option) != sotHexadecimal))
 				return def;
 
-			auto it = ReadSection(section);
-			if (it == _iniData.data->end())
+			std::string_view value;
+			if (!FindValue(section, option, value))
 				return def;
 
-			for (auto& INIValue : it->second)
-			{
-				if (_stricmp(INIValue.first.c_str(), option.c_str()))
-					continue;
-
-				return INIValue.second.empty() ? 0ul : strtoul(INIValue.second.c_str(), nullptr, 16);
-			}
-
-			return def;
+			return value.empty() ? 0ul : strtoul(value.data(), nullptr, 16);
 		}
 
 		float INISettingCollection::ReadFloat(const std::string& section, const std::string& option, 
@@ -1290,19 +1295,11 @@ namespace CKPE
 			if (!IsOpen() || (GetOptionTypeByName(option) != sotFloat))
 				return def;
 
-			auto it = ReadSection(section);
-			if (it == _iniData.data->end())
+			std::string_view value;
+			if (!FindValue(section, option, value))
 				return def;
 
-			for (auto& INIValue : it->second)
-			{
-				if (_stricmp(INIValue.first.c_str(), option.c_str()))
-					continue;
-
-				return INIValue.second.empty() ? .0f : strtof(INIValue.second.c_str(), nullptr);
-			}
-
-			return def;
+			return value.empty() ? .0f : strtof(value.data(), nullptr);
 		}
 
 		INISettingCollection::color_value INISettingCollection::ReadRgbColor(const std::string& section, const std::string& option, 
@@ -1311,31 +1308,23 @@ namespace CKPE
 			if (!IsOpen() || (GetOptionTypeByName(option) != sotColorRGB))
 				return def;
 
-			auto it = ReadSection(section);
-			if (it == _iniData.data->end())
+			std::string_view value;
+			if (!FindValue(section, option, value))
 				return def;
 
-			for (auto& INIValue : it->second)
-			{
-				if (_stricmp(INIValue.first.c_str(), option.c_str()))
-					continue;
-
-				INISettingCollection::color_value c;
-				if (!INIValue.second.empty())
-					return c;
-
-				uint32_t a[3]{};
-				if (sscanf(INIValue.second.c_str(), "%u,%u,%u", &a[0], &a[1], &a[2]) != 3)
-					return c;
+			INISettingCollection::color_value c;
+			if (value.empty())
+				return c;
 
-				c.r = a[0];
-				c.g = a[1];
-				c.b = a[2];
-				c.a = 255;
+			uint32_t a[3]{};
+			if (sscanf(value.data(), "%u,%u,%u", &a[0], &a[1], &a[2]) != 3)
 				return c;
-			}
 
-			return def;
+			c.r = a[0];
+			c.g = a[1];
+			c.b = a[2];
+			c.a = 255;
+			return c;
 		}
 
 		INISettingCollection::color_value INISettingCollection::ReadRgbaColor(const std::string& section, const std::string& option, 
@@ -1344,31 +1333,23 @@ namespace CKPE
 			if (!IsOpen() || (GetOptionTypeByName(option) != sotColorRGBA))
 				return def;
 
-			auto it = ReadSection(section);
-			if (it == _iniData.data->end())
+			std::string_view value;
+			if (!FindValue(section, option, value))
 				return def;
 
-			for (auto& INIValue : it->second)
-			{
-				if (_stricmp(INIValue.first.c_str(), option.c_str()))
-					continue;
-
-				INISettingCollection::color_value c;
-				if (!INIValue.second.empty())
-					return c;
-
-				uint32_t a[4]{};
-				if (sscanf(INIValue.second.c_str(), "%u,%u,%u,%u", &a[0], &a[1], &a[2], &a[3]) != 4)
-					return c;
+			INISettingCollection::color_value c;
+			if (value.empty())
+				return c;
 
-				c.r = a[0];
-				c.g = a[1];
-				c.b = a[2];
-				c.a = a[3];
+			uint32_t a[4]{};
+			if (sscanf(value.data(), "%u,%u,%u,%u", &a[0], &a[1], &a[2], &a[3]) != 4)
 				return c;
-			}
 
-			return def;
+			c.r = a[0];
+			c.g = a[1];
+			c.b = a[2];
+			c.a = a[3];
+			return c;
 		}
 
 		std::string INISettingCollection::ReadString(const std::string& section, const std::string& option,
@@ -1377,19 +1358,11 @@ namespace CKPE
 			if (!IsOpen()/* || (GetOptionTypeByName(option) != sotString)*/)
 				return def;
 
-			auto it = ReadSection(section);
-			if (it == _iniData.data->end())
+			std::string_view value;
+			if (!FindValue(section, option, value))
 				return def;
 
-			for (auto& INIValue : it->second)
-			{
-				if (_stricmp(INIValue.first.c_str(), option.c_str()))
-					continue;
-
-				return INIValue.second.empty() ? "" : StringUtils::QuoteRemove(INIValue.second);
-			}
-
-			return def;
+			return value.empty() ? "" : StringUtils::QuoteRemove(value.data());
 		}
 
 		std::wstring INISettingCollection::ReadUnicodeString(const std::string& section, const std::string& option, 
@@ -1398,19 +1371,11 @@ namespace CKPE
 			if (!IsOpen()/* || (GetOptionTypeByName(option) != sotString)*/)
 				return def;
 
-			auto it = ReadSection(section);
-			if (it == _iniData.data->end())
+			std::string_view value;
+			if (!FindValue(section, option, value))
 				return def;
 
-			for (auto& INIValue : it->second)
-			{
-				if (_stricmp(INIValue.first.c_str(), option.c_str()))
-					continue;
-
-				return INIValue.second.empty() ? L"" : StringUtils::Utf8ToUtf16(StringUtils::QuoteRemove(INIValue.second));
-			}
-
-			return def;
+			return value.empty() ? L"" : StringUtils::Utf8ToUtf16(StringUtils::QuoteRemove(value.data()));
 		}
 
 		void INISettingCollection::WriteBool(const std::string& section, const std::string& option,
@@ -1419,6 +1384,8 @@ namespace CKPE
 			if (!IsOpen() || (GetOptionTypeByName(option) != sotBool))
 				return;
 
+			Materialize();
+
 			for (auto& INISection : *(_iniData.data))
 			{
 				if (_stricmp(INISection.first.c_str(), section.c_str()))
@@ -1442,6 +1409,8 @@ namespace CKPE
 			if (!IsOpen() || (GetOptionTypeByName(option) != sotChar))
 				return;
 
+			Materialize();
+
 			for (auto& INISection : *(_iniData.data))
 			{
 				if (_stricmp(INISection.first.c_str(), section.c_str()))
@@ -1466,6 +1435,8 @@ namespace CKPE
 			if (!IsOpen() || (GetOptionTypeByName(option) != sotInteger))
 				return;
 
+			Materialize();
+
 			for (auto& INISection : *(_iniData.data))
 			{
 				if (_stricmp(INISection.first.c_str(), section.c_str()))
@@ -1491,6 +1462,8 @@ namespace CKPE
 			if (!IsOpen() || (GetOptionTypeByName(option) != sotUnsignedInteger))
 				return;
 
+			Materialize();
+
 			for (auto& INISection : *(_iniData.data))
 			{
 				if (_stricmp(INISection.first.c_str(), section.c_str()))
@@ -1516,6 +1489,8 @@ namespace CKPE
 			if (!IsOpen() || (GetOptionTypeByName(option) != sotHexadecimal))
 				return;
 
+			Materialize();
+
 			for (auto& INISection : *(_iniData.data))
 			{
 				if (_stricmp(INISection.first.c_str(), section.c_str()))
@@ -1541,6 +1516,8 @@ namespace CKPE
 			if (!IsOpen() || (GetOptionTypeByName(option) != sotFloat))
 				return;
 
+			Materialize();
+
 			for (auto& INISection : *(_iniData.data))
 			{
 				if (_stricmp(INISection.first.c_str(), section.c_str()))
@@ -1566,6 +1543,8 @@ namespace CKPE
 			if (!IsOpen() || (GetOptionTypeByName(option) != sotColorRGB))
 				return;
 
+			Materialize();
+
 			for (auto& INISection : *(_iniData.data))
 			{
 				if (_stricmp(INISection.first.c_str(), section.c_str()))
@@ -1591,6 +1570,8 @@ namespace CKPE
 			if (!IsOpen() || (GetOptionTypeByName(option) != sotColorRGBA))
 				return;
 
+			Materialize();
+
 			for (auto& INISection : *(_iniData.data))
 			{
 				if (_stricmp(INISection.first.c_str(), section.c_str()))
@@ -1616,6 +1597,8 @@ namespace CKPE
 			if (!IsOpen()/* || (GetOptionTypeByName(option) != sotString)*/)
 				return;
 
+			Materialize();
+
 			for (auto& INISection : *(_iniData.data))
 			{
 				if (_stricmp(INISection.first.c_str(), section.c_str()))
@@ -1639,6 +1622,8 @@ namespace CKPE
 			if (!IsOpen()/* || (GetOptionTypeByName(option) != sotString)*/)
 				return;
 
+			Materialize();
+
 			for (auto& INISection : *(_iniData.data))
 			{
 				if (_stricmp(INISection.first.c_str(), section.c_str()))
@@ -1663,19 +1648,19 @@ namespace CKPE
 				if (!PathUtils::FileExists(filename))
 					throw RuntimeError(L"Error the settings file \"{}\" no found.", filename);
 
-				MemoryStream stream ;
-				if (!stream.LoadFromFile(filename))
-					throw RuntimeError(L"Error reading the settings file \"{}\".", filename);
-
-				auto buff = stream.Data();
-				auto buffSize = stream.GetSize();
-				if (!buff || !buffSize)
-					throw RuntimeError("Out of memory");
+				if (!_index)
+					_index = new INIIndex(INIParser::Syntax::Settings);
 
-				_iniData.data = new INIStructure::_Mbase;
-				if (!DoOpenSerialization((const char*)buff, (size_t)buffSize))
+				if (!_index->Open(filename))
 					throw RuntimeError(L"Error reading the settings file \"{}\".", filename);
 
+				// The tree is built again from the index on the first write
+				if (_iniData.data)
+				{
+					delete _iniData.data;
+					_iniData.data = nullptr;
+				}
+
 				*_fileName = filename;
 				_needSaves = false;
 			}
@@ -1693,43 +1678,16 @@ namespace CKPE
 			if (!text || !len)
 				return false;
 
-			std::string currentSection, nameOption, valueOption;
+			if (!_index)
+				_index = new INIIndex(INIParser::Syntax::Settings);
 
-			char* next_line = nullptr, * line = strtok_s(const_cast<char*>(text), "\n", &next_line);
-			do
+			if (_iniData.data)
 			{
-				if (!line)
-					break;
-
-				auto lineS = StringUtils::Trim(line);
-
-				switch (lineS[0])
-				{
-					// Skips comments
-				case ';':
-				case '#':
-					break;
-					// Sections
-				case '[':
-					currentSection = lineS.substr(1, lineS.length() - 2);
-					break;
-				default:
-					auto sep = lineS.find_first_of("=:");
-					if (sep == std::string::npos) break;
-					nameOption = StringUtils::Trim(lineS.substr(0, sep));
-					valueOption = StringUtils::Trim(lineS.substr(sep + 1));
-	
-					if (!currentSection.empty() && !nameOption.empty())
-						(*(_iniData.data))[currentSection][nameOption] = valueOption;
-					else
-						_WARNING("The option has an incorrect name \"%s:%s\".",
-							(nameOption.empty() ? "" : nameOption.c_str()),
-							(currentSection.empty() ? "" : currentSection.c_str()));
-					break;
-				}
-			} while (line = strtok_s(nullptr, "\n", &next_line));
+				delete _iniData.data;
+				_iniData.data = nullptr;
+			}
 
-			return true;
+			return _index->Parse(text, len);
 		}
 
 		bool INISettingCollection::DoSave() const noexcept(true)
@@ -1737,6 +1695,8 @@ namespace CKPE
 			if (!IsOpen())
 				return false;
 
+			Materialize();
+
 			try
 			{
 				TextFileStream stream(*_fileName, FileStream::fmCreate);
@@ -0,0 +1,266 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#include <windows.h>
+#include <CKPE.CriticalSection.h>
+#include <CKPE.Common.Interface.h>
+#include <CKPE.Common.SettingHandle.h>
+#include <filesystem>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <thread>
+
+namespace CKPE
+{
+	namespace Common
+	{
+		// Editors save in several steps, wait until the file is quiet
+		constexpr static std::uint32_t SETTINGHANDLE_RELOAD_DELAY_MS = 250;
+		constexpr static std::uint32_t SETTINGHANDLE_NOTIFY_BUFFER = 4096;
+
+		struct SettingHandleRegistry
+		{
+			CriticalSection section;
+			std::vector<CustomSettingHandle*> handles;
+		};
+
+		static HANDLE _sclose_event = nullptr;
+		static std::thread* _swatcher_thread = nullptr;
+
+		// Handles are mostly static objects of other modules, the registry must exist before them
+		[[nodiscard]] static SettingHandleRegistry& GetRegistry() noexcept(true)
+		{
+			static SettingHandleRegistry registry;
+			return registry;
+		}
+
+		[[nodiscard]] static std::uint64_t GetLastWriteTime(const std::wstring& fname) noexcept(true)
+		{
+			WIN32_FILE_ATTRIBUTE_DATA data;
+			if (!GetFileAttributesExW(fname.c_str(), GetFileExInfoStandard, &data))
+				return 0;
+
+			return ((std::uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+		}
+
+		CustomSettingHandle::CustomSettingHandle(const char* name) noexcept(true) :
+			_name(name)
+		{
+			if (auto split = strchr(_name, ':'); split)
+				_section_length = (std::uint32_t)(split - _name);
+		}
+
+		void CustomSettingHandle::Register() noexcept(true)
+		{
+			auto& registry = GetRegistry();
+			ScopeCriticalSection guard(registry.section);
+
+			registry.handles.push_back(this);
+
+			// Created after the settings were loaded
+			if (auto settings = Interface::GetSingleton()->GetSettings(); settings)
+				Update(settings);
+		}
+
+		void CustomSettingHandle::Unregister() noexcept(true)
+		{
+			auto& registry = GetRegistry();
+			ScopeCriticalSection guard(registry.section);
+
+			auto it = std::find(registry.handles.begin(), registry.handles.end(), this);
+			if (it != registry.handles.end())
+				registry.handles.erase(it);
+		}
+
+		bool CustomSettingHandle::ReadValue(const CustomSettingCollection* settings, bool def) const noexcept(true)
+		{
+			if (!_section_length) return def;
+			return settings->ReadBool(std::string(_name, _section_length), _name + _section_length + 1, def);
+		}
+
+		long CustomSettingHandle::ReadValue(const CustomSettingCollection* settings, long def) const noexcept(true)
+		{
+			if (!_section_length) return def;
+			return settings->ReadInt(std::string(_name, _section_length), _name + _section_length + 1, def);
+		}
+
+		unsigned long CustomSettingHandle::ReadValue(const CustomSettingCollection* settings,
+			unsigned long def) const noexcept(true)
+		{
+			if (!_section_length) return def;
+
+			auto option = _name + _section_length + 1;
+			if (CustomSettingCollection::GetOptionTypeByName(option) == sotHexadecimal)
+				return settings->ReadHex(std::string(_name, _section_length), option, def);
+			return settings->ReadUInt(std::string(_name, _section_length), option, def);
+		}
+
+		float CustomSettingHandle::ReadValue(const CustomSettingCollection* settings, float def) const noexcept(true)
+		{
+			if (!_section_length) return def;
+			return settings->ReadFloat(std::string(_name, _section_length), _name + _section_length + 1, def);
+		}
+
+		std::uint32_t CustomSettingHandle::Refresh(const CustomSettingCollection* settings) noexcept(true)
+		{
+			if (!settings)
+				return 0;
+
+			std::uint32_t changed = 0;
+			auto& registry = GetRegistry();
+			ScopeCriticalSection guard(registry.section);
+
+			for (auto handle : registry.handles)
+				if (handle->Update(settings))
+					changed++;
+
+			return changed;
+		}
+
+		void CustomSettingHandle::Initialize() noexcept(true)
+		{
+			auto settings = Interface::GetSingleton()->GetSettings();
+			if (_swatcher_thread || !settings || !_READ_OPTION_BOOL("CreationKit", "bSettingsHotReload", false))
+				return;
+
+			auto fname = settings->GetFileName();
+			if (fname.empty())
+				return;
+
+			_sclose_event = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+			_swatcher_thread = new std::thread([](std::wstring fname)
+				{
+					// Other files of the directory (the log is rewritten all the time) must not delay the reload
+					auto path = std::filesystem::path(fname);
+					auto name = path.filename().wstring();
+					auto dir = CreateFileW(path.parent_path().c_str(), FILE_LIST_DIRECTORY,
+						FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+						FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+					if (dir == INVALID_HANDLE_VALUE)
+					{
+						_MESSAGE("Settings: the directory can't be watched, hot reload is disabled");
+						return;
+					}
+
+					OVERLAPPED overlapped{};
+					overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+					alignas(DWORD) std::uint8_t buffer[SETTINGHANDLE_NOTIFY_BUFFER];
+
+					auto listen = [&]() -> bool
+						{
+							ResetEvent(overlapped.hEvent);
+							return ReadDirectoryChangesW(dir, buffer, sizeof(buffer), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE |
+								FILE_NOTIFY_CHANGE_FILE_NAME, nullptr, &overlapped, nullptr);
+						};
+
+					// Saved in place or renamed over it
+					auto has_settings_file = [&]() -> bool
+						{
+							DWORD size = 0;
+							if (!GetOverlappedResult(dir, &overlapped, &size, FALSE))
+								return false;
+
+							// The buffer overflowed, the time of the file decides
+							if (!size)
+								return true;
+
+							for (auto info = (const FILE_NOTIFY_INFORMATION*)buffer;;
+								info = (const FILE_NOTIFY_INFORMATION*)((const std::uint8_t*)info + info->NextEntryOffset))
+							{
+								if (CompareStringOrdinal(info->FileName, (int)(info->FileNameLength / sizeof(wchar_t)),
+									name.c_str(), (int)name.length(), TRUE) == CSTR_EQUAL)
+									return true;
+
+								if (!info->NextEntryOffset)
+									return false;
+							}
+						};
+
+					if (!overlapped.hEvent || !listen())
+					{
+						_MESSAGE("Settings: the directory can't be watched, hot reload is disabled");
+						if (overlapped.hEvent) CloseHandle(overlapped.hEvent);
+						CloseHandle(dir);
+						return;
+					}
+
+					HANDLE handles[2] = { _sclose_event, overlapped.hEvent };
+					auto last_write = GetLastWriteTime(fname);
+					std::uint64_t reload_time = 0;
+					bool listening = true;
+
+					while (listening)
+					{
+						DWORD timeout = INFINITE;
+						if (reload_time)
+						{
+							auto now = GetTickCount64();
+							timeout = (reload_time > now) ? (DWORD)(reload_time - now) : 0;
+						}
+
+						auto result = WaitForMultipleObjects(2, handles, FALSE, timeout);
+						if (result == (WAIT_OBJECT_0 + 1))
+						{
+							// Only the changes of the settings file postpone the reload
+							if (has_settings_file())
+								reload_time = GetTickCount64() + SETTINGHANDLE_RELOAD_DELAY_MS;
+
+							listening = listen();
+							continue;
+						}
+
+						if (result != WAIT_TIMEOUT)
+							break;
+
+						reload_time = 0;
+
+						auto write = GetLastWriteTime(fname);
+						if (!write || (write == last_write))
+							continue;
+
+						last_write = write;
+
+						// The options read by name keep the values they had at startup, 
+						// the collection of the interface is not replaced under its readers
+						TOMLSettingCollection fresh(fname);
+						if (!fresh.IsOpen())
+						{
+							_WARNING("Settings: the file can't be parsed, the changes are not applied");
+							continue;
+						}
+
+						_MESSAGE("Settings: the file was changed, %u options applied", Refresh(&fresh));
+					}
+
+					// The buffer is on this stack, the request must be finished before it is gone
+					DWORD size;
+					if (CancelIoEx(dir, &overlapped))
+						GetOverlappedResult(dir, &overlapped, &size, TRUE);
+
+					CloseHandle(overlapped.hEvent);
+					CloseHandle(dir);
+				}, fname);
+		}
+
+		void CustomSettingHandle::Shutdown() noexcept(true)
+		{
+			if (_swatcher_thread)
+			{
+				SetEvent(_sclose_event);
+				if (_swatcher_thread->joinable())
+					_swatcher_thread->join();
+
+				delete _swatcher_thread;
+				_swatcher_thread = nullptr;
+			}
+
+			if (_sclose_event)
+			{
+				CloseHandle(_sclose_event);
+				_sclose_event = nullptr;
+			}
+		}
+	}
+}
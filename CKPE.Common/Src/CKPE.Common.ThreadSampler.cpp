@@ -0,0 +1,97 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#include <windows.h>
+#include <CKPE.Common.ThreadSampler.h>
+#include <algorithm>
+#include <cstddef>
+
+namespace CKPE
+{
+	namespace Common
+	{
+		// Top of the stack that is copied, the frames above it are lost
+		constexpr static std::size_t THREADSAMPLER_STACK_SIZE = 128 * 1024;
+
+		static_assert((offsetof(CONTEXT, R15) - offsetof(CONTEXT, Rax)) == (15 * sizeof(DWORD64)),
+			"CONTEXT has the integer registers in the order of the x64 encoding");
+
+		// Only system calls, no lock of the process is taken
+		static std::size_t CopyStack(std::uintptr_t rsp, std::uint8_t* buffer) noexcept(true)
+		{
+			// The stack is committed from the top of the stack to its base
+			MEMORY_BASIC_INFORMATION info;
+			if (!VirtualQuery((LPCVOID)rsp, &info, sizeof(info)) || (info.State != MEM_COMMIT))
+				return 0;
+
+			auto size = std::min((std::size_t)((std::uintptr_t)info.BaseAddress + info.RegionSize - rsp),
+				THREADSAMPLER_STACK_SIZE);
+
+			__try
+			{
+				memcpy(buffer, (const void*)rsp, size);
+			}
+			__except (EXCEPTION_EXECUTE_HANDLER)
+			{
+				return 0;
+			}
+
+			return size;
+		}
+
+		static std::uint32_t WalkStack(const PESymbolizer::ModuleTable& modules, PESymbolizer::Context& context,
+			const PESymbolizer::StackView& stack, std::uintptr_t* frames, std::uint32_t max_frames) noexcept(true)
+		{
+			__try
+			{
+				return modules.Unwind(context, stack, frames, max_frames);
+			}
+			__except (EXCEPTION_EXECUTE_HANDLER)
+			{
+				// The code of a module unloaded after the table was built
+				return 0;
+			}
+		}
+
+		ThreadSampler::ThreadSampler() noexcept(true)
+		{
+			_stack = (std::uint8_t*)VirtualAlloc(nullptr, THREADSAMPLER_STACK_SIZE, MEM_RESERVE | MEM_COMMIT,
+				PAGE_READWRITE);
+		}
+
+		ThreadSampler::~ThreadSampler() noexcept(true)
+		{
+			if (_stack)
+				VirtualFree(_stack, 0, MEM_RELEASE);
+		}
+
+		std::uint32_t ThreadSampler::Capture(void* Thread, const PESymbolizer::ModuleTable& Modules,
+			std::uintptr_t* Frames, std::uint32_t MaxFrames) noexcept(true)
+		{
+			if (!_stack || !Thread || !Frames || !MaxFrames || (SuspendThread((HANDLE)Thread) == (DWORD)-1))
+				return 0;
+
+			CONTEXT context;
+			ZeroMemory(&context, sizeof(context));
+			context.ContextFlags = CONTEXT_INTEGER | CONTEXT_CONTROL;
+
+			// SuspendThread is asynchronous, GetThreadContext waits until the thread is really suspended
+			std::size_t size = 0;
+			if (GetThreadContext((HANDLE)Thread, &context))
+				size = CopyStack((std::uintptr_t)context.Rsp, _stack);
+
+			ResumeThread((HANDLE)Thread);
+
+			if (!size)
+				return 0;
+
+			PESymbolizer::Context unwind_context;
+			unwind_context.rip = context.Rip;
+			memcpy(unwind_context.gpr, &context.Rax, sizeof(unwind_context.gpr));
+
+			PESymbolizer::StackView stack{ context.Rsp, _stack, size };
+			return WalkStack(Modules, unwind_context, stack, Frames, MaxFrames);
+		}
+	}
+}
@@ -0,0 +1,40 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace CKPE
+{
+	namespace SkyrimSE
+	{
+		// Index of the archives in the "Data" folder, listed once with their sizes.
+		class ArchiveIndex
+		{
+			ArchiveIndex(const ArchiveIndex&) = delete;
+			ArchiveIndex& operator=(const ArchiveIndex&) = delete;
+		public:
+			struct Info
+			{
+				std::string name;
+				std::uint64_t size;
+			};
+
+			constexpr ArchiveIndex() noexcept(true) = default;
+
+			static void Initialize(const std::string& data_path) noexcept(true);
+			[[nodiscard]] static const std::vector<Info>& GetArchives() noexcept(true);
+			[[nodiscard]] static const Info* Find(const std::string& name) noexcept(true);
+
+			// Reads the directories of the archives in the given order on a worker pool so that the editor,
+			// which still registers them one by one, parses them from the file cache
+			static void Prefetch(std::vector<std::string> names, std::uint32_t threads) noexcept(true);
+			// Cancels the reads that are left and joins the workers
+			static void StopPrefetch() noexcept(true);
+		};
+	}
+}
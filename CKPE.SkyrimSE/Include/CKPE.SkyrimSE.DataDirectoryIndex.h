@@ -0,0 +1,44 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#pragma once
+
+#include <cstdint>
+
+namespace CKPE
+{
+	namespace SkyrimSE
+	{
+		// In-memory index of the "Data" folder and all its subfolders.
+		// Built in the background with a parallel directory walk and rebuilt when the directory-change
+		// watcher reports changes, while it isn't valid the lookups are answered by the file system.
+		class DataDirectoryIndex
+		{
+			DataDirectoryIndex(const DataDirectoryIndex&) = delete;
+			DataDirectoryIndex& operator=(const DataDirectoryIndex&) = delete;
+		public:
+			struct Entry
+			{
+				std::uint32_t attributes;
+				std::uint64_t size;
+				std::uint64_t last_write_time;
+			};
+
+			enum LookupResult : std::uint32_t
+			{
+				lrUnknown = 0,		// The path is outside "Data" or the index isn't ready
+				lrMissing,
+				lrFound,
+			};
+
+			constexpr DataDirectoryIndex() noexcept(true) = default;
+
+			static void Initialize() noexcept(true);
+			static void Shutdown() noexcept(true);
+			[[nodiscard]] static bool HasValid() noexcept(true);
+
+			[[nodiscard]] static LookupResult Lookup(const char* full_path, Entry& entry) noexcept(true);
+		};
+	}
+}
@@ -0,0 +1,38 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#pragma once
+
+#include <cstdint>
+#include <EditorAPI/TESFile.h>
+
+namespace CKPE
+{
+	namespace SkyrimSE
+	{
+		// Plugin load profiler.
+		// Collects the wall time, loaded forms and inflated bytes per plugin file, and per signature of each
+		// plugin as the editor reads and inflates the records, at the end of the load prints the tables sorted
+		// by time to the log window and dumps them as CSV next to the CKPE log.
+		class LoadProfiler
+		{
+			LoadProfiler(const LoadProfiler&) = delete;
+			LoadProfiler& operator=(const LoadProfiler&) = delete;
+
+			inline static bool _enabled = false;
+		public:
+			constexpr LoadProfiler() noexcept(true) = default;
+
+			static void Initialize() noexcept(true);
+			[[nodiscard]] inline static bool HasEnabled() noexcept(true) { return _enabled; }
+
+			static void BeginFile(const EditorAPI::TESFile* file) noexcept(true);
+			static void EndFile() noexcept(true);
+			static void EndLoad() noexcept(true);
+
+			static void OnFormLoaded() noexcept(true);
+			static void OnInflate(std::uint32_t in_size, std::uint32_t out_size, std::int64_t ticks) noexcept(true);
+		};
+	}
+}
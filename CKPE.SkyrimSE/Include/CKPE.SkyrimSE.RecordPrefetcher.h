@@ -0,0 +1,34 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace CKPE
+{
+	namespace SkyrimSE
+	{
+		// Read-ahead of the compressed records of the plugins being loaded.
+		// A scanner walks the GRUP/record headers of the files in load order, the compressed records
+		// are inflated on a worker pool into a bounded queue, the inflate hook only copies the ready data.
+		class RecordPrefetcher
+		{
+			RecordPrefetcher(const RecordPrefetcher&) = delete;
+			RecordPrefetcher& operator=(const RecordPrefetcher&) = delete;
+		public:
+			constexpr RecordPrefetcher() noexcept(true) = default;
+
+			static void Start(std::vector<std::string> files) noexcept(true);
+			static void Stop() noexcept(true);
+			[[nodiscard]] static bool HasActive() noexcept(true);
+
+			// Returns false if the record isn't prefetched, the caller must inflate it on its own
+			[[nodiscard]] static bool Take(const void* in, std::uint32_t in_size, void* out, std::uint32_t out_size,
+				std::uint32_t& out_bytes) noexcept(true);
+		};
+	}
+}
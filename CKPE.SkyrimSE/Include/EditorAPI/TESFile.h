@@ -47,7 +47,9 @@ namespace CKPE
 				/* 15C */ char m_FilePath[MAX_PATH];
 				/* 260 */ char _pad1[0x8];
 				/* 268 */ std::uint32_t m_bufsize;
-				/* 26C */ char _pad2[0x38];
+				/* 26C */ char _pad2[0x18];
+				/* 284 */ TESChunk m_currentForm;		// header of the record being read
+				/* 29C */ char _pad2a[0x8];
 				/* 2A4 */ std::uint32_t m_fileSize;
 				/* 2A8 */ char _pad3[0x48];
 
@@ -108,6 +110,7 @@ namespace CKPE
 				[[nodiscard]] inline TESFile** GetDependArray() const noexcept(true) { return m_dependArray; }
 				[[nodiscard]] inline std::uint32_t GetDependCount() const noexcept(true) { return m_dependCount; }
 				[[nodiscard]] inline std::uint32_t GetFileSize() const noexcept(true) { return m_fileSize; }
+				[[nodiscard]] inline const TESChunk& GetCurrentForm() const noexcept(true) { return m_currentForm; }
 				[[nodiscard]] inline FileHeaderInfo GetHeaderInfo() const noexcept(true) { return m_fileHeader; }
 				[[nodiscard]] inline bool IsLoaded() const noexcept(true) { return m_fileIndex != 0xFF; }
 				[[nodiscard]] inline bool IsMaster() const noexcept(true) { return m_RecordFlags & FILE_RECORD_ESM; }
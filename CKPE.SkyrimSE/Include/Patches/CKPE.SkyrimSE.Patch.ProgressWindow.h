@@ -23,6 +23,8 @@ namespace CKPE
 
 				ProgressWindow(const ProgressWindow&) = delete;
 				ProgressWindow& operator=(const ProgressWindow&) = delete;
+
+				static void UpdateLoadProgress(HWND Hwnd) noexcept(true);
 			protected:
 				virtual bool DoActive(Common::RelocatorDB::PatchDB* db) noexcept(true);
 				virtual bool DoQuery() const noexcept(true);
@@ -33,7 +35,10 @@ namespace CKPE
 				static INT_PTR CALLBACK HKWndProc(HWND Hwnd, UINT Message, WPARAM wParam, LPARAM lParam);
 
 				static void sub1(std::uint32_t nPartId, LPCSTR lpcstrText) noexcept(true);
-				static void step() noexcept(true);
+				// Only publishes the progress (0..LOAD_PROGRESS_TOTAL), the window samples it on its own timer
+				static void SetLoadProgress(std::uint32_t value) noexcept(true);
+
+				constexpr static std::uint32_t LOAD_PROGRESS_TOTAL = 100 * 4;
 
 				virtual bool HasOption() const noexcept(true);
 				virtual const char* GetOptionName() const noexcept(true);
@@ -4,7 +4,11 @@
 
 #pragma once
 
-#include <list>
+#include <memory>
+#include <vector>
+#include <string_view>
+#include <unordered_set>
+#include <CKPE.CriticalSection.h>
 #include <CKPE.Common.Patch.h>
 
 namespace CKPE
@@ -13,17 +17,37 @@ namespace CKPE
 	{
 		namespace Patch
 		{
+			// Strings are placed one after another in large chunks, identical strings are stored once,
+			// so the same text always gets the same pointer. Pointers stay valid until Clear(), 
+			// which releases the whole generation at once.
 			class StringCache
 			{
-				std::list<std::string> cache;
+				constexpr static std::size_t CHUNK_SIZE = 64 * 1024;
+
+				std::vector<std::unique_ptr<char[]>> chunks;
+				std::unordered_set<std::string_view> table;
+				char* cursor{ nullptr };
+				std::size_t available{ 0 };
+				const char* last{ nullptr };
+				std::uint32_t generation{ 0 };
+				std::uint64_t requests{ 0 };
+				std::uint64_t requested_bytes{ 0 };
+				std::uint64_t stored_bytes{ 0 };
+				// Trim() comes from the memory pressure monitor thread
+				CriticalSection section;
+
+				[[nodiscard]] char* Allocate(std::size_t size) noexcept(true);
 			public:
 				StringCache() = default;
 				~StringCache() = default;
 			public:
-				inline std::size_t Size() const noexcept(true) { return cache.size(); }
-				inline void Clear() noexcept(true) { cache.clear(); }
-				inline void Push(const std::string& s) noexcept(true) { cache.push_back(s); }
-				inline const char* Last() const noexcept(true) { return &cache.back()[0]; }
+				inline std::size_t Size() const noexcept(true) { return table.size(); }
+				inline std::uint32_t GetGeneration() const noexcept(true) { return generation; }
+				void Clear() noexcept(true);
+				const char* Push(const std::string& s) noexcept(true);
+				// Releases the storage kept after Clear(), the strings of the current generation are in use
+				std::size_t Trim() noexcept(true);
+				inline const char* Last() const noexcept(true) { return last; }
 			};
 
 			class ConvertorString
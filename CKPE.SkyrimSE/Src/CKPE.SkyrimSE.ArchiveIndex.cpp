@@ -0,0 +1,178 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#include <windows.h>
+#include <CKPE.Common.Interface.h>
+#include <CKPE.SkyrimSE.ArchiveIndex.h>
+#include <unordered_map>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <atomic>
+
+namespace CKPE
+{
+	namespace SkyrimSE
+	{
+		constexpr static std::uint32_t BSA_MAGIC = 'B' | ('S' << 8) | ('A' << 16);
+		constexpr static std::uint32_t BSA_FOLDER_RECORD_SIZE = 0x18;
+		constexpr static std::uint32_t BSA_FILE_RECORD_SIZE = 0x10;
+		constexpr static std::uint64_t BSA_MAX_DIRECTORY_SIZE = 64 * 1024 * 1024;
+		constexpr static std::uint32_t ARCHIVEINDEX_PREFETCH_CHUNK = 1024 * 1024;
+
+#pragma pack(push, 1)
+		struct BSAHeader
+		{
+			std::uint32_t magic;
+			std::uint32_t version;
+			std::uint32_t folder_offset;
+			std::uint32_t archive_flags;
+			std::uint32_t folder_count;
+			std::uint32_t file_count;
+			std::uint32_t total_folder_name_length;
+			std::uint32_t total_file_name_length;
+			std::uint16_t file_flags;
+			std::uint16_t padding;
+		};
+#pragma pack(pop)
+		static_assert(sizeof(BSAHeader) == 0x24);
+
+		static std::string _sdata_path;
+		static std::vector<ArchiveIndex::Info> _sarchives;
+		static std::unordered_map<std::string, std::size_t> _snames;
+		// Not destroyed at exit, the workers may still run if the editor is closed during the load
+		static std::vector<std::thread>* _sprefetch_threads = nullptr;
+		static std::atomic_bool _sprefetch_stop = false;
+
+		[[nodiscard]] static std::string ToLowerName(std::string name) noexcept(true)
+		{
+			for (auto& c : name)
+				if ((c >= 'A') && (c <= 'Z'))
+					c += 'a' - 'A';
+			return name;
+		}
+
+		static void PrefetchDirectory(const std::string& name, std::uint8_t* buffer) noexcept(true)
+		{
+			auto file = CreateFileA((_sdata_path + name).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+				nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				return;
+
+			BSAHeader header{};
+			DWORD readed = 0;
+			if (ReadFile(file, &header, sizeof(BSAHeader), &readed, nullptr) && (readed == sizeof(BSAHeader)) &&
+				(header.magic == BSA_MAGIC))
+			{
+				// Everything the editor parses on registration lies before the data of the first file:
+				// folder records, folder names with file records, file names
+				auto remaining = std::min((std::uint64_t)header.folder_count * (BSA_FOLDER_RECORD_SIZE + 1) +
+					header.total_folder_name_length + (std::uint64_t)header.file_count * BSA_FILE_RECORD_SIZE +
+					header.total_file_name_length, BSA_MAX_DIRECTORY_SIZE);
+
+				while (remaining && !_sprefetch_stop)
+				{
+					auto chunk = (DWORD)std::min(remaining, (std::uint64_t)ARCHIVEINDEX_PREFETCH_CHUNK);
+					if (!ReadFile(file, buffer, chunk, &readed, nullptr) || !readed)
+						break;
+
+					remaining -= std::min((std::uint64_t)readed, remaining);
+				}
+			}
+
+			CloseHandle(file);
+		}
+
+		void ArchiveIndex::Initialize(const std::string& data_path) noexcept(true)
+		{
+			_sdata_path = data_path;
+			_sarchives.clear();
+			_snames.clear();
+
+			// Only the directory is listed, the archives aren't opened
+			WIN32_FIND_DATAA FileFindData{};
+			HANDLE hFindFile = FindFirstFileExA((_sdata_path + "*.bsa").c_str(), FindExInfoBasic, &FileFindData,
+				FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+			if (hFindFile != INVALID_HANDLE_VALUE)
+			{
+				do
+				{
+					if (FileFindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+						continue;
+
+					_snames.emplace(ToLowerName(FileFindData.cFileName), _sarchives.size());
+					_sarchives.emplace_back(Info
+						{
+							FileFindData.cFileName,
+							((std::uint64_t)FileFindData.nFileSizeHigh << 32) | FileFindData.nFileSizeLow
+						});
+				} while (FindNextFileA(hFindFile, &FileFindData));
+
+				FindClose(hFindFile);
+			}
+
+			_MESSAGE("Archive index: %llu archives", _sarchives.size());
+		}
+
+		const std::vector<ArchiveIndex::Info>& ArchiveIndex::GetArchives() noexcept(true)
+		{
+			return _sarchives;
+		}
+
+		const ArchiveIndex::Info* ArchiveIndex::Find(const std::string& name) noexcept(true)
+		{
+			auto it = _snames.find(ToLowerName(name));
+			return (it != _snames.end()) ? &_sarchives[it->second] : nullptr;
+		}
+
+		void ArchiveIndex::Prefetch(std::vector<std::string> names, std::uint32_t threads) noexcept(true)
+		{
+			// Left from the previous load
+			StopPrefetch();
+
+			if (names.empty())
+				return;
+
+			struct PrefetchQueue
+			{
+				std::vector<std::string> names;
+				std::atomic_size_t next{ 0 };
+			};
+
+			auto queue = std::make_shared<PrefetchQueue>();
+			queue->names = std::move(names);
+
+			_sprefetch_stop = false;
+			if (!_sprefetch_threads)
+				_sprefetch_threads = new std::vector<std::thread>;
+
+			threads = std::clamp(threads, 1u, (std::uint32_t)queue->names.size());
+			for (std::uint32_t i = 0; i < threads; i++)
+			{
+				// The names are taken in order, so the first archives to register are ready first
+				_sprefetch_threads->emplace_back([queue]
+					{
+						auto buffer = std::make_unique<std::uint8_t[]>(ARCHIVEINDEX_PREFETCH_CHUNK);
+						for (auto index = queue->next++; (index < queue->names.size()) && !_sprefetch_stop;
+							index = queue->next++)
+							PrefetchDirectory(queue->names[index], buffer.get());
+					});
+			}
+		}
+
+		void ArchiveIndex::StopPrefetch() noexcept(true)
+		{
+			if (!_sprefetch_threads)
+				return;
+
+			_sprefetch_stop = true;
+
+			for (auto& thread : *_sprefetch_threads)
+				if (thread.joinable())
+					thread.join();
+
+			_sprefetch_threads->clear();
+		}
+	}
+}
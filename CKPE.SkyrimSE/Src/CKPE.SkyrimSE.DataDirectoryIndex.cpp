@@ -0,0 +1,304 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#include <windows.h>
+#include <CKPE.HashUtils.h>
+#include <CKPE.HardwareInfo.h>
+#include <CKPE.Common.Interface.h>
+#include <CKPE.SkyrimSE.DataDirectoryIndex.h>
+#include <unordered_map>
+#include <condition_variable>
+#include <shared_mutex>
+#include <string_view>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+namespace CKPE
+{
+	namespace SkyrimSE
+	{
+		// Directory junctions may loop, don't go deeper than this
+		constexpr static std::uint32_t DATAINDEX_MAX_DEPTH = 64;
+		// Wait out a burst of changes (copying a mod) before rebuilding
+		constexpr static std::uint32_t DATAINDEX_REBUILD_DELAY_MS = 500;
+
+		struct DataPathHash
+		{
+			using is_transparent = void;
+
+			[[nodiscard]] inline std::size_t operator()(std::string_view path) const noexcept(true)
+			{
+				return (std::size_t)HashUtils::MurmurHash64A(path.data(), path.length());
+			}
+		};
+
+		using DataIndexMap = std::unordered_map<std::string, DataDirectoryIndex::Entry, DataPathHash, std::equal_to<>>;
+
+		struct DataDirectoryTask
+		{
+			std::string path;
+			std::uint32_t depth;
+		};
+
+		static std::shared_mutex _slock;
+		static std::unique_ptr<DataIndexMap> _sindex;
+		static std::atomic_bool _svalid = false;
+		static std::string _sroot;
+		static std::uint32_t _sthreads = 1;
+		static HANDLE _sclose_event = nullptr;
+		static HANDLE _schange = nullptr;
+		static std::thread* _swatcher_thread = nullptr;
+
+		// Returns false if the path has non-ASCII characters, the file system folds their case by its own table
+		static inline bool ToLowerPath(char* path, std::size_t length) noexcept(true)
+		{
+			for (std::size_t i = 0; i < length; i++)
+			{
+				auto c = path[i];
+				if ((c >= 'A') && (c <= 'Z'))
+					path[i] = c + ('a' - 'A');
+				else if (c == '/')
+					path[i] = '\\';
+				else if ((std::uint8_t)c >= 0x80)
+					return false;
+			}
+
+			return true;
+		}
+
+		[[nodiscard]] static DataIndexMap* BuildIndex() noexcept(true)
+		{
+			std::mutex lock;
+			std::condition_variable cond;
+			std::vector<DataDirectoryTask> pending{ { "", 0 } };
+			std::vector<std::vector<std::pair<std::string, DataDirectoryIndex::Entry>>> results(_sthreads);
+			std::uint32_t busy = 0;
+
+			auto worker = [&](std::uint32_t id)
+				{
+					auto& out = results[id];
+					WIN32_FIND_DATAA data;
+
+					std::unique_lock guard(lock);
+					while (true)
+					{
+						cond.wait(guard, [&] { return !pending.empty() || !busy; });
+						if (pending.empty())
+							break;
+
+						auto task = std::move(pending.back());
+						pending.pop_back();
+						busy++;
+						guard.unlock();
+
+						std::vector<DataDirectoryTask> subdirs;
+						auto handle = FindFirstFileExA((_sroot + task.path + "*").c_str(), FindExInfoBasic, &data,
+							FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+						if (handle != INVALID_HANDLE_VALUE)
+						{
+							do
+							{
+								if ((data.cFileName[0] == '.') &&
+									(!data.cFileName[1] || ((data.cFileName[1] == '.') && !data.cFileName[2])))
+									continue;
+
+								// Lookup leaves the non-ASCII names to the file system, they're never asked from the index
+								auto path = task.path + data.cFileName;
+								if (!ToLowerPath(path.data(), path.length()))
+									continue;
+
+								out.emplace_back(path, DataDirectoryIndex::Entry
+									{
+										data.dwFileAttributes,
+										((std::uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow,
+										((std::uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) |
+											data.ftLastWriteTime.dwLowDateTime
+									});
+
+								if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && (task.depth < DATAINDEX_MAX_DEPTH))
+									subdirs.emplace_back(DataDirectoryTask{ path + '\\', task.depth + 1 });
+							} while (FindNextFileA(handle, &data));
+
+							FindClose(handle);
+						}
+
+						guard.lock();
+						busy--;
+						for (auto& subdir : subdirs)
+							pending.emplace_back(std::move(subdir));
+						cond.notify_all();
+					}
+				};
+
+			std::vector<std::thread> threads;
+			for (std::uint32_t i = 1; i < _sthreads; i++)
+				threads.emplace_back(worker, i);
+			worker(0);
+			for (auto& thread : threads)
+				thread.join();
+
+			std::size_t total = 0;
+			for (auto& result : results)
+				total += result.size();
+
+			auto index = new DataIndexMap;
+			index->reserve(total);
+			for (auto& result : results)
+				for (auto& entry : result)
+					index->emplace(std::move(entry.first), entry.second);
+
+			return index;
+		}
+
+		static void RebuildIndex(HANDLE change) noexcept(true)
+		{
+			auto start = GetTickCount64();
+			auto index = BuildIndex();
+
+			{
+				std::unique_lock guard(_slock);
+				_sindex.reset(index);
+				// Something has changed during the walk, the next pass of the watcher will catch it
+				_svalid = WaitForSingleObject(change, 0) != WAIT_OBJECT_0;
+			}
+
+			_MESSAGE("Data directory index: %llu entries (%llu ms)", index->size(), GetTickCount64() - start);
+		}
+
+		void DataDirectoryIndex::Initialize() noexcept(true)
+		{
+			if (_swatcher_thread || !_READ_OPTION_BOOL("CreationKit", "bDataDirectoryIndex", false))
+				return;
+
+			char path[MAX_PATH];
+			auto length = GetCurrentDirectoryA(MAX_PATH, path);
+			if (!length || (length >= MAX_PATH))
+				return;
+
+			_sroot = path;
+			if (_sroot.back() != '\\')
+				_sroot += '\\';
+			_sroot += "Data\\";
+
+			_sthreads = std::clamp(HardwareInfo::CPU::GetTotalCores(), 1u, 8u);
+			_sclose_event = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+
+			_swatcher_thread = new std::thread([]
+				{
+					// Subscribe before the first walk so that nothing is missed
+					auto change = FindFirstChangeNotificationA(_sroot.c_str(), TRUE, FILE_NOTIFY_CHANGE_FILE_NAME |
+						FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE);
+					if (change == INVALID_HANDLE_VALUE)
+					{
+						_MESSAGE("Data directory index: the directory can't be watched, disabled");
+						return;
+					}
+
+					{
+						std::unique_lock guard(_slock);
+						_schange = change;
+					}
+
+					HANDLE handles[2] = { _sclose_event, change };
+
+					RebuildIndex(change);
+
+					while (WaitForMultipleObjects(2, handles, FALSE, INFINITE) == (WAIT_OBJECT_0 + 1))
+					{
+						_svalid = false;
+
+						DWORD result;
+						do
+						{
+							FindNextChangeNotification(change);
+							result = WaitForMultipleObjects(2, handles, FALSE, DATAINDEX_REBUILD_DELAY_MS);
+						} while (result == (WAIT_OBJECT_0 + 1));
+
+						if (result == WAIT_OBJECT_0)
+							break;
+
+						RebuildIndex(change);
+					}
+
+					std::unique_lock guard(_slock);
+					_svalid = false;
+					_schange = nullptr;
+					FindCloseChangeNotification(change);
+				});
+		}
+
+		void DataDirectoryIndex::Shutdown() noexcept(true)
+		{
+			if (_swatcher_thread)
+			{
+				SetEvent(_sclose_event);
+				if (_swatcher_thread->joinable())
+					_swatcher_thread->join();
+
+				delete _swatcher_thread;
+				_swatcher_thread = nullptr;
+			}
+
+			if (_sclose_event)
+			{
+				CloseHandle(_sclose_event);
+				_sclose_event = nullptr;
+			}
+
+			std::unique_lock guard(_slock);
+			_svalid = false;
+			_sindex.reset();
+		}
+
+		bool DataDirectoryIndex::HasValid() noexcept(true)
+		{
+			return _svalid;
+		}
+
+		DataDirectoryIndex::LookupResult DataDirectoryIndex::Lookup(const char* full_path, Entry& entry) noexcept(true)
+		{
+			if (!_svalid || !full_path)
+				return lrUnknown;
+
+			auto length = strlen(full_path);
+			auto root_length = _sroot.length();
+			if ((length <= root_length) || _strnicmp(full_path, _sroot.c_str(), root_length))
+				return lrUnknown;
+
+			char key[MAX_PATH * 2];
+			auto key_length = length - root_length;
+			if (key_length >= std::size(key))
+				return lrUnknown;
+
+			memcpy(key, full_path + root_length, key_length);
+			key[key_length] = 0;
+			if (!ToLowerPath(key, key_length))
+				return lrUnknown;
+
+			// Not canonical, let the file system resolve it
+			if (strstr(key, "\\\\") || strstr(key, ".\\"))
+				return lrUnknown;
+
+			std::shared_lock guard(_slock);
+			if (!_svalid || !_sindex)
+				return lrUnknown;
+
+			// The notification is signaled as soon as a file is created or removed, while the watcher wakes up
+			// later, so the files the editor has just written are answered by the file system
+			if (!_schange || (WaitForSingleObject(_schange, 0) == WAIT_OBJECT_0))
+				return lrUnknown;
+
+			auto it = _sindex->find(std::string_view(key, key_length));
+			if (it == _sindex->end())
+				return lrMissing;
+
+			entry = it->second;
+			return lrFound;
+		}
+	}
+}
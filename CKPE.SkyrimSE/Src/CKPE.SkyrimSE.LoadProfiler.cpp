@@ -0,0 +1,296 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#include <windows.h>
+#include <share.h>
+#include <CKPE.PathUtils.h>
+#include <CKPE.StringUtils.h>
+#include <CKPE.Common.Interface.h>
+#include <CKPE.SkyrimSE.LoadProfiler.h>
+#include <unordered_map>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace CKPE
+{
+	namespace SkyrimSE
+	{
+		struct SignatureProfile
+		{
+			std::uint32_t type;
+			std::uint64_t records;
+			std::uint64_t bytes;
+			std::int64_t ticks;
+			std::uint64_t inflates;
+			std::uint64_t decompressed_bytes;
+			std::int64_t inflate_ticks;
+
+			void Add(const SignatureProfile& other) noexcept(true)
+			{
+				records += other.records;
+				bytes += other.bytes;
+				ticks += other.ticks;
+				inflates += other.inflates;
+				decompressed_bytes += other.decompressed_bytes;
+				inflate_ticks += other.inflate_ticks;
+			}
+		};
+
+		struct PluginProfile
+		{
+			const EditorAPI::TESFile* file;
+			std::string name;
+			std::int64_t ticks;
+			std::uint64_t forms;
+			std::uint64_t file_size;
+			std::uint64_t inflates;
+			std::uint64_t in_bytes;
+			std::uint64_t out_bytes;
+			std::int64_t inflate_ticks;
+			std::unordered_map<std::uint32_t, SignatureProfile> signatures;
+		};
+
+		static std::vector<std::unique_ptr<PluginProfile>> _splugins;
+		static PluginProfile* _scurrent = nullptr;
+		static std::int64_t _scurrent_start = 0;
+		// The end of the previous record of the current file
+		static std::int64_t _slast_form = 0;
+		static double _sfrequency = 1.0;
+		static std::uint32_t _stop = 20;
+
+		[[nodiscard]] static inline std::int64_t GetTicks() noexcept(true)
+		{
+			LARGE_INTEGER counter;
+			QueryPerformanceCounter(&counter);
+			return counter.QuadPart;
+		}
+
+		[[nodiscard]] static inline double TicksToMs(std::int64_t ticks) noexcept(true)
+		{
+			return (double)ticks * 1000.0 / _sfrequency;
+		}
+
+		[[nodiscard]] static inline std::string SignatureToString(std::uint32_t type) noexcept(true)
+		{
+			char name[5] = {};
+			memcpy(name, &type, 4);
+			for (std::uint32_t i = 0; i < 4; i++)
+				if ((name[i] < 0x20) || (name[i] > 0x7E))
+					name[i] = '?';
+			return name;
+		}
+
+		[[nodiscard]] static SignatureProfile& GetCurrentSignature() noexcept(true)
+		{
+			// The header of the record the editor is reading now
+			std::uint32_t type;
+			memcpy(&type, _scurrent->file->GetCurrentForm().type, sizeof(type));
+
+			auto& signature = _scurrent->signatures[type];
+			signature.type = type;
+			return signature;
+		}
+
+		static void CloseCurrentFile(std::int64_t now) noexcept(true)
+		{
+			if (_scurrent)
+				_scurrent->ticks += now - _scurrent_start;
+			_scurrent = nullptr;
+		}
+
+		void LoadProfiler::Initialize() noexcept(true)
+		{
+			_enabled = _READ_OPTION_BOOL("Log", "bLoadProfiler", false);
+			if (!_enabled)
+				return;
+
+			LARGE_INTEGER frequency;
+			QueryPerformanceFrequency(&frequency);
+			_sfrequency = (double)frequency.QuadPart;
+			_stop = std::max(_READ_OPTION_UINT("Log", "uLoadProfilerTop", 20), 1ul);
+		}
+
+		void LoadProfiler::BeginFile(const EditorAPI::TESFile* file) noexcept(true)
+		{
+			if (!_enabled || !file || (_scurrent && (_scurrent->file == file)))
+				return;
+
+			auto now = GetTicks();
+			CloseCurrentFile(now);
+
+			auto it = std::find_if(_splugins.begin(), _splugins.end(),
+				[file](const std::unique_ptr<PluginProfile>& plugin) { return plugin->file == file; });
+			if (it == _splugins.end())
+			{
+				auto plugin = std::make_unique<PluginProfile>();
+				plugin->file = file;
+				plugin->name = file->GetFileName().c_str();
+				plugin->file_size = file->GetFileSize();
+
+				_splugins.emplace_back(std::move(plugin));
+				it = _splugins.end() - 1;
+			}
+
+			_scurrent = it->get();
+			_scurrent_start = now;
+			_slast_form = now;
+		}
+
+		void LoadProfiler::EndFile() noexcept(true)
+		{
+			if (_enabled)
+				CloseCurrentFile(GetTicks());
+		}
+
+		void LoadProfiler::EndLoad() noexcept(true)
+		{
+			if (!_enabled || _splugins.empty())
+				return;
+
+			CloseCurrentFile(GetTicks());
+
+			struct PluginSignature
+			{
+				const PluginProfile* plugin;
+				const SignatureProfile* signature;
+			};
+
+			std::vector<PluginProfile*> plugins;
+			std::vector<PluginSignature> plugin_signatures;
+			std::unordered_map<std::uint32_t, SignatureProfile> signatures;
+			std::int64_t total_ticks = 0;
+			std::uint64_t total_forms = 0;
+
+			for (auto& plugin : _splugins)
+			{
+				plugins.push_back(plugin.get());
+				total_ticks += plugin->ticks;
+				total_forms += plugin->forms;
+
+				for (auto& [type, signature] : plugin->signatures)
+				{
+					plugin_signatures.push_back({ plugin.get(), &signature });
+
+					auto& total = signatures[type];
+					total.type = type;
+					total.Add(signature);
+				}
+			}
+
+			std::sort(plugins.begin(), plugins.end(),
+				[](const PluginProfile* a, const PluginProfile* b) { return a->ticks > b->ticks; });
+			std::sort(plugin_signatures.begin(), plugin_signatures.end(),
+				[](const PluginSignature& a, const PluginSignature& b) { return a.signature->ticks > b.signature->ticks; });
+
+			std::vector<SignatureProfile> sorted_signatures;
+			sorted_signatures.reserve(signatures.size());
+			for (auto& signature : signatures)
+				sorted_signatures.push_back(signature.second);
+			std::sort(sorted_signatures.begin(), sorted_signatures.end(),
+				[](const SignatureProfile& a, const SignatureProfile& b) { return a.ticks > b.ticks; });
+
+			_CONSOLE("[LOADPROFILE] %llu plugins, %llu forms loaded in %.2f sec", plugins.size(), total_forms,
+				TicksToMs(total_ticks) / 1000.0);
+			_CONSOLE("[LOADPROFILE] %-48s %10s %10s %12s %12s %10s", "Plugin", "Time, ms", "Forms", "Size, KB",
+				"Inflated, KB", "Infl., ms");
+
+			auto count = std::min((std::size_t)_stop, plugins.size());
+			for (std::size_t i = 0; i < count; i++)
+			{
+				auto plugin = plugins[i];
+				_CONSOLE("[LOADPROFILE] %-48s %10.1f %10llu %12llu %12llu %10.1f", plugin->name.c_str(),
+					TicksToMs(plugin->ticks), plugin->forms, plugin->file_size / 1024, plugin->out_bytes / 1024,
+					TicksToMs(plugin->inflate_ticks));
+			}
+
+			_CONSOLE("[LOADPROFILE] %-6s %10s %10s %12s %12s %10s", "Record", "Time, ms", "Count", "Size, KB",
+				"Inflated, KB", "Infl., ms");
+
+			count = std::min((std::size_t)_stop, sorted_signatures.size());
+			for (std::size_t i = 0; i < count; i++)
+			{
+				auto& signature = sorted_signatures[i];
+				_CONSOLE("[LOADPROFILE] %-6s %10.1f %10llu %12llu %12llu %10.1f", SignatureToString(signature.type).c_str(),
+					TicksToMs(signature.ticks), signature.records, signature.bytes / 1024,
+					signature.decompressed_bytes / 1024, TicksToMs(signature.inflate_ticks));
+			}
+
+			_CONSOLE("[LOADPROFILE] %-48s %-6s %10s %10s %12s %12s", "Plugin", "Record", "Time, ms", "Count", "Size, KB",
+				"Inflated, KB");
+
+			count = std::min((std::size_t)_stop, plugin_signatures.size());
+			for (std::size_t i = 0; i < count; i++)
+			{
+				auto& [plugin, signature] = plugin_signatures[i];
+				_CONSOLE("[LOADPROFILE] %-48s %-6s %10.1f %10llu %12llu %12llu", plugin->name.c_str(),
+					SignatureToString(signature->type).c_str(), TicksToMs(signature->ticks), signature->records,
+					signature->bytes / 1024, signature->decompressed_bytes / 1024);
+			}
+
+			auto fname = PathUtils::GetCKPELogsPath() + L"LoadProfile.csv";
+			auto stream = _wfsopen(fname.c_str(), L"wt", _SH_DENYWR);
+			if (stream)
+			{
+				fputs("Plugin,Time ms,Forms,Size bytes,Inflates,Compressed bytes,Inflated bytes,Inflate ms\n", stream);
+				for (auto plugin : plugins)
+					fprintf(stream, "\"%s\",%.3f,%llu,%llu,%llu,%llu,%llu,%.3f\n", plugin->name.c_str(),
+						TicksToMs(plugin->ticks), plugin->forms, plugin->file_size, plugin->inflates, plugin->in_bytes,
+						plugin->out_bytes, TicksToMs(plugin->inflate_ticks));
+
+				fputs("\nRecord,Time ms,Count,Size bytes,Inflates,Inflated bytes,Inflate ms\n", stream);
+				for (auto& signature : sorted_signatures)
+					fprintf(stream, "%s,%.3f,%llu,%llu,%llu,%llu,%.3f\n", SignatureToString(signature.type).c_str(),
+						TicksToMs(signature.ticks), signature.records, signature.bytes, signature.inflates,
+						signature.decompressed_bytes, TicksToMs(signature.inflate_ticks));
+
+				fputs("\nPlugin,Record,Time ms,Count,Size bytes,Inflates,Inflated bytes,Inflate ms\n", stream);
+				for (auto& [plugin, signature] : plugin_signatures)
+					fprintf(stream, "\"%s\",%s,%.3f,%llu,%llu,%llu,%llu,%.3f\n", plugin->name.c_str(),
+						SignatureToString(signature->type).c_str(), TicksToMs(signature->ticks), signature->records,
+						signature->bytes, signature->inflates, signature->decompressed_bytes,
+						TicksToMs(signature->inflate_ticks));
+
+				fclose(stream);
+				_CONSOLE("[LOADPROFILE] Saved to \"%s\"", StringUtils::Utf16ToWinCP(fname).c_str());
+			}
+
+			_splugins.clear();
+		}
+
+		void LoadProfiler::OnFormLoaded() noexcept(true)
+		{
+			if (!_scurrent)
+				return;
+
+			// The editor reports every form it has read, the time since the previous one is charged to
+			// the record whose header is current
+			auto now = GetTicks();
+			auto& signature = GetCurrentSignature();
+			signature.records++;
+			signature.bytes += _scurrent->file->GetCurrentForm().size;
+			signature.ticks += now - _slast_form;
+
+			_slast_form = now;
+			_scurrent->forms++;
+		}
+
+		void LoadProfiler::OnInflate(std::uint32_t in_size, std::uint32_t out_size, std::int64_t ticks) noexcept(true)
+		{
+			if (!_scurrent)
+				return;
+
+			_scurrent->inflates++;
+			_scurrent->in_bytes += in_size;
+			_scurrent->out_bytes += out_size;
+			_scurrent->inflate_ticks += ticks;
+
+			auto& signature = GetCurrentSignature();
+			signature.inflates++;
+			signature.decompressed_bytes += out_size;
+			signature.inflate_ticks += ticks;
+		}
+	}
+}
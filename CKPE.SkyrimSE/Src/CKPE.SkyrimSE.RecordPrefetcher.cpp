@@ -0,0 +1,423 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#include <windows.h>
+#include <libdeflate.h>
+#include <CKPE.HashUtils.h>
+#include <CKPE.HardwareInfo.h>
+#include <CKPE.Common.Interface.h>
+#include <CKPE.Common.MemoryPressure.h>
+#include <CKPE.SkyrimSE.RecordPrefetcher.h>
+#include <unordered_map>
+#include <condition_variable>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <deque>
+#include <thread>
+#include <atomic>
+
+namespace CKPE
+{
+	namespace SkyrimSE
+	{
+		constexpr static std::uint32_t PREFETCH_RECORD_COMPRESSED = 0x00040000;
+		constexpr static std::uint32_t PREFETCH_MAX_RECORD_SIZE = 64 * 1024 * 1024;
+		// Consecutive misses after which the editor is considered to read something else
+		constexpr static std::uint32_t PREFETCH_MAX_MISS_STREAK = 8192;
+
+#pragma pack(push, 1)
+		struct RecordHeader
+		{
+			char type[4];
+			std::uint32_t size;
+			std::uint32_t flags;
+			std::uint32_t id;
+			std::uint32_t vercontrol;
+			std::uint16_t version;
+			std::uint16_t unk;
+		};
+#pragma pack(pop)
+		static_assert(sizeof(RecordHeader) == 0x18);
+
+		class MappedFile
+		{
+			HANDLE _file{ INVALID_HANDLE_VALUE };
+			HANDLE _mapping{ nullptr };
+			const std::uint8_t* _view{ nullptr };
+			std::size_t _size{ 0 };
+		public:
+			MappedFile(const char* path) noexcept(true)
+			{
+				_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+					nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+				if (_file == INVALID_HANDLE_VALUE)
+					return;
+
+				LARGE_INTEGER size{};
+				if (!GetFileSizeEx(_file, &size) || (size.QuadPart < (LONGLONG)sizeof(RecordHeader)))
+					return;
+
+				_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (!_mapping)
+					return;
+
+				_view = (const std::uint8_t*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+				if (_view)
+					_size = (std::size_t)size.QuadPart;
+			}
+
+			~MappedFile() noexcept(true)
+			{
+				if (_view)
+					UnmapViewOfFile(_view);
+				if (_mapping)
+					CloseHandle(_mapping);
+				if (_file != INVALID_HANDLE_VALUE)
+					CloseHandle(_file);
+			}
+
+			[[nodiscard]] inline const std::uint8_t* GetData() const noexcept(true) { return _view; }
+			[[nodiscard]] inline std::size_t GetSize() const noexcept(true) { return _size; }
+		};
+
+		enum PrefetchRecordState : std::uint32_t
+		{
+			prsPending = 0,
+			prsWorking,
+			prsReady,
+			prsDone,
+		};
+
+		struct PrefetchRecord
+		{
+			std::uint64_t seq;
+			// Keeps the file mapped until the record is taken, the compressed data is compared then
+			std::shared_ptr<MappedFile> source;
+			const std::uint8_t* in;
+			std::uint32_t in_size;
+			std::uint32_t out_size;
+			std::uint32_t out_bytes;
+			std::uint64_t key;
+			std::unique_ptr<std::uint8_t[]> out;
+			PrefetchRecordState state;
+		};
+
+		static std::mutex _slock;
+		static std::condition_variable _swork_cond;
+		static std::condition_variable _sspace_cond;
+		static std::condition_variable _sexit_cond;
+		static std::deque<std::unique_ptr<PrefetchRecord>> _squeue;
+		static std::unordered_map<std::uint64_t, PrefetchRecord*> _sready;
+		static std::uint64_t _sbase_seq = 0;
+		static std::uint64_t _snext_seq = 0;
+		static std::uint64_t _snext_job = 0;
+		static std::uint64_t _sconsumed_seq = 0;
+		static std::size_t _squeued_bytes = 0;
+		static std::size_t _slimit_bytes = 0;
+		static std::uint32_t _sthreads = 0;
+		static std::uint32_t _smiss_streak = 0;
+		static std::uint64_t _shits = 0;
+		static std::uint64_t _smisses = 0;
+		static std::uint32_t _strim_id = 0;
+		static bool _sstop = false;
+		static bool _sscan_done = false;
+		static std::atomic_bool _sactive = false;
+
+		[[nodiscard]] static inline std::uint64_t GetRecordKey(const void* in, std::uint32_t in_size) noexcept(true)
+		{
+			return HashUtils::MurmurHash64A(in, in_size, in_size);
+		}
+
+		static void PrintStats() noexcept(true)
+		{
+			_MESSAGE("Record prefetch: %llu records taken, %llu inflated by the editor", _shits, _smisses);
+		}
+
+		// Must be called under _slock
+		static void ReleaseObsolete() noexcept(true)
+		{
+			// Records before the last taken one were skipped by the editor, they're no longer needed
+			while (!_squeue.empty())
+			{
+				auto record = _squeue.front().get();
+				if ((record->state == prsWorking) || ((record->state != prsDone) && (record->seq >= _sconsumed_seq)))
+					break;
+
+				if (record->state == prsReady)
+				{
+					auto it = _sready.find(record->key);
+					if ((it != _sready.end()) && (it->second == record))
+						_sready.erase(it);
+				}
+
+				_squeued_bytes -= record->out_size;
+				_squeue.pop_front();
+				_sbase_seq++;
+			}
+
+			_snext_job = std::max(_snext_job, _sbase_seq);
+			_sspace_cond.notify_one();
+
+			if (_sscan_done && _squeue.empty() && _sactive)
+			{
+				_sactive = false;
+				PrintStats();
+			}
+		}
+
+		// Must be called under _slock
+		static void OnThreadExit() noexcept(true)
+		{
+			if (!--_sthreads)
+				_sexit_cond.notify_all();
+		}
+
+		static void ScanThread(std::vector<std::string> files) noexcept(true)
+		{
+			for (auto& path : files)
+			{
+				auto file = std::make_shared<MappedFile>(path.c_str());
+				auto data = file->GetData();
+				auto size = file->GetSize();
+				if (!data)
+					continue;
+
+				std::size_t pos = 0;
+				while ((pos + sizeof(RecordHeader)) <= size)
+				{
+					auto header = (const RecordHeader*)(data + pos);
+					pos += sizeof(RecordHeader);
+
+					// The contents of a group follow its header, just step into it
+					if (!memcmp(header->type, "GRUP", 4))
+						continue;
+
+					// Damaged file, the editor will tell about it
+					if ((pos + header->size) > size)
+						break;
+
+					if ((header->flags & PREFETCH_RECORD_COMPRESSED) && (header->size > sizeof(std::uint32_t)))
+					{
+						// The compressed data is preceded by the size of the decompressed one
+						auto out_size = *(const std::uint32_t*)(data + pos);
+						if (out_size && (out_size <= PREFETCH_MAX_RECORD_SIZE))
+						{
+							std::unique_lock guard(_slock);
+							_sspace_cond.wait(guard, [out_size] {
+								return _sstop || _squeue.empty() || ((_squeued_bytes + out_size) <= _slimit_bytes); });
+							if (_sstop)
+							{
+								_sscan_done = true;
+								OnThreadExit();
+								return;
+							}
+
+							auto record = std::make_unique<PrefetchRecord>();
+							record->seq = _snext_seq++;
+							record->source = file;
+							record->in = data + pos + sizeof(std::uint32_t);
+							record->in_size = header->size - sizeof(std::uint32_t);
+							record->out_size = out_size;
+							record->state = prsPending;
+
+							_squeued_bytes += out_size;
+							_squeue.emplace_back(std::move(record));
+							_swork_cond.notify_one();
+						}
+					}
+
+					pos += header->size;
+				}
+			}
+
+			std::lock_guard guard(_slock);
+			_sscan_done = true;
+			_swork_cond.notify_all();
+			ReleaseObsolete();
+			OnThreadExit();
+		}
+
+		static void WorkerThread() noexcept(true)
+		{
+			auto decompressor = libdeflate_alloc_decompressor();
+
+			std::unique_lock guard(_slock);
+			while (decompressor)
+			{
+				_swork_cond.wait(guard, [] { return _sstop || _sscan_done || (_snext_job < _snext_seq); });
+				if (_sstop)
+					break;
+
+				if (_snext_job >= _snext_seq)
+				{
+					if (_sscan_done)
+						break;
+					continue;
+				}
+
+				auto record = _squeue[_snext_job++ - _sbase_seq].get();
+				record->state = prsWorking;
+				guard.unlock();
+
+				std::size_t out_bytes = 0;
+				auto out = std::unique_ptr<std::uint8_t[]>(new (std::nothrow) std::uint8_t[record->out_size]);
+				auto result = out ? libdeflate_zlib_decompress(decompressor, record->in, record->in_size, out.get(),
+					record->out_size, &out_bytes) : LIBDEFLATE_INSUFFICIENT_SPACE;
+				auto key = GetRecordKey(record->in, record->in_size);
+
+				guard.lock();
+
+				if (result == LIBDEFLATE_SUCCESS)
+				{
+					record->key = key;
+					record->out = std::move(out);
+					record->out_bytes = (std::uint32_t)out_bytes;
+					record->state = prsReady;
+					// Identical records are served by the first one
+					_sready.try_emplace(key, record);
+				}
+				else
+				{
+					// The editor will inflate it on its own and report the error
+					record->source.reset();
+					record->state = prsDone;
+				}
+
+				ReleaseObsolete();
+			}
+
+			OnThreadExit();
+			guard.unlock();
+
+			if (decompressor)
+				libdeflate_free_decompressor(decompressor);
+		}
+
+		static std::size_t TrimQueue(Common::MemoryPressure::Level level, void* user_data) noexcept(true)
+		{
+			std::size_t released = 0;
+
+			{
+				std::lock_guard guard(_slock);
+				released = _squeued_bytes;
+			}
+
+			RecordPrefetcher::Stop();
+			return released;
+		}
+
+		void RecordPrefetcher::Start(std::vector<std::string> files) noexcept(true)
+		{
+			if (files.empty())
+				return;
+
+			auto workers = _READ_OPTION_UINT("CreationKit", "uRecordPrefetchThreads", 0);
+			if (!workers)
+				workers = std::max(HardwareInfo::CPU::GetTotalCores(), 2u) - 1;
+			workers = std::clamp(workers, 1ul, 32ul);
+
+			std::lock_guard guard(_slock);
+			if (_sactive || _sthreads)
+				return;
+
+			_slimit_bytes = (std::size_t)std::clamp(_READ_OPTION_UINT("CreationKit", "uRecordPrefetchBufferMB", 128),
+				16ul, 2048ul) * 1024 * 1024;
+			_sbase_seq = _snext_seq = _snext_job = _sconsumed_seq = 0;
+			_squeued_bytes = 0;
+			_smiss_streak = 0;
+			_shits = _smisses = 0;
+			_sstop = false;
+			_sscan_done = false;
+			_sthreads = workers + 1;
+			_sactive = true;
+
+			std::thread(ScanThread, std::move(files)).detach();
+			for (std::uint32_t i = 0; i < workers; i++)
+				std::thread(WorkerThread).detach();
+
+			if (!_strim_id)
+				_strim_id = Common::MemoryPressure::RegisterTrimCallback("Record prefetch", 10, &TrimQueue);
+
+			_MESSAGE("Record prefetch: started (%u workers, buffer %llu MB)", workers, _slimit_bytes / (1024 * 1024));
+		}
+
+		void RecordPrefetcher::Stop() noexcept(true)
+		{
+			std::unique_lock guard(_slock);
+			if (!_sthreads && _squeue.empty())
+				return;
+
+			auto active = _sactive.exchange(false);
+			_sstop = true;
+			_swork_cond.notify_all();
+			_sspace_cond.notify_all();
+			_sexit_cond.wait(guard, [] { return !_sthreads; });
+
+			_sready.clear();
+			_squeue.clear();
+			_squeued_bytes = 0;
+
+			if (active)
+				PrintStats();
+		}
+
+		bool RecordPrefetcher::HasActive() noexcept(true)
+		{
+			return _sactive;
+		}
+
+		bool RecordPrefetcher::Take(const void* in, std::uint32_t in_size, void* out, std::uint32_t out_size,
+			std::uint32_t& out_bytes) noexcept(true)
+		{
+			if (!_sactive || !in || !in_size || !out)
+				return false;
+
+			auto key = GetRecordKey(in, in_size);
+			std::unique_ptr<std::uint8_t[]> data;
+			bool giveup = false;
+
+			{
+				std::lock_guard guard(_slock);
+
+				// The hash only narrows the search, a collision must not hand out the data of another record
+				auto it = _sready.find(key);
+				if ((it != _sready.end()) && (it->second->in_size == in_size) && (it->second->out_bytes <= out_size) &&
+					!memcmp(it->second->in, in, in_size))
+				{
+					auto record = it->second;
+					_sready.erase(it);
+
+					data = std::move(record->out);
+					out_bytes = record->out_bytes;
+					record->source.reset();
+					record->state = prsDone;
+
+					_sconsumed_seq = std::max(_sconsumed_seq, record->seq + 1);
+					_smiss_streak = 0;
+					_shits++;
+
+					ReleaseObsolete();
+				}
+				else
+				{
+					_smisses++;
+					// The editor reads something else, don't keep the queue filled for nothing
+					giveup = (++_smiss_streak >= PREFETCH_MAX_MISS_STREAK) &&
+						(_sscan_done || ((_squeued_bytes << 1) >= _slimit_bytes));
+				}
+			}
+
+			if (!data)
+			{
+				if (giveup)
+					Stop();
+				return false;
+			}
+
+			memcpy(out, data.get(), out_bytes);
+			return true;
+		}
+	}
+}
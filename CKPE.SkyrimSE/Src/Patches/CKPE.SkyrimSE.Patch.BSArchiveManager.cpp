@@ -12,9 +12,14 @@
 #include <CKPE.Common.Interface.h>
 #include <CKPE.Common.SettingCollection.h>
 #include <CKPE.SkyrimSE.VersionLists.h>
+#include <CKPE.SkyrimSE.LoadProfiler.h>
+#include <CKPE.SkyrimSE.ArchiveIndex.h>
 #include <EditorAPI/BSString.h>
 #include <EditorAPI/TESFile.h>
+#include <EditorAPI/TESDataHandler.h>
 #include <Patches/CKPE.SkyrimSE.Patch.BSArchiveManager.h>
+#include <unordered_set>
+#include <string_view>
 
 namespace CKPE
 {
@@ -23,7 +28,8 @@ namespace CKPE
 		namespace Patch
 		{
 			std::vector<const EditorAPI::TESFile*> g_SelectedFilesArray;
-			std::vector<EditorAPI::BSString*> g_arrayArchivesAvailable;
+			// Lower case names of the archives that are loaded for plugins
+			std::unordered_set<std::string> g_setArchivesAvailable;
 			std::uintptr_t pointer_BSArchiveManagerModded_sub = 0;
 			bool loaded_BSArchiveManagerModded_active = false;
 
@@ -50,8 +56,10 @@ namespace CKPE
 				{
 					CKPE_ASSERT_MSG(file_name, "There is no name of the load archive");
 
-					EditorAPI::BSString filePath = EditorAPI::BSString::Utils::GetDataPath() + file_name, fileSizeStr;
-					auto fileSize = FileUtils::GetFileSize(*filePath);
+					EditorAPI::BSString fileSizeStr;
+					auto archive = ArchiveIndex::Find(file_name);
+					auto fileSize = archive ? archive->size :
+						FileUtils::GetFileSize(*(EditorAPI::BSString::Utils::GetDataPath() + file_name));
 					if (fileSize > 0)
 					{
 						GetFileSizeStr(fileSize, fileSizeStr);
@@ -67,55 +75,37 @@ namespace CKPE
 						((void(__fastcall*)(const char*, int, int))OldLoadArchive)(file_name, 0, 0);
 				}
 
+				[[nodiscard]] static std::string ToLowerName(std::string_view name)
+				{
+					std::string result(name);
+					for (auto& c : result)
+						if ((c >= 'A') && (c <= 'Z'))
+							c += 'a' - 'A';
+					return result;
+				}
+
 				static void Initialize()
 				{
 					auto pathData = EditorAPI::BSString::Utils::GetDataPath();
 
-					WIN32_FIND_DATA	FileFindData{};
-					HANDLE hFindFile = FindFirstFileExA(*(pathData + "*.bsa"), FindExInfoStandard, &FileFindData,
-						FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
-					if (hFindFile != INVALID_HANDLE_VALUE) 
+					ArchiveIndex::Initialize(pathData.c_str());
+					for (auto& archive : ArchiveIndex::GetArchives())
+						g_setArchivesAvailable.emplace(ToLowerName(archive.name));
+
+					// The archives from the INI lists are loaded by the editor itself
+					auto func = [](std::string_view svalue) 
 					{
-						do
+						while (!svalue.empty())
 						{
-							g_arrayArchivesAvailable.push_back(new EditorAPI::BSString(FileFindData.cFileName));
-						} while (FindNextFile(hFindFile, &FileFindData));
-					}
+							auto pos = svalue.find(',');
+							auto fname = StringUtils::Trim(std::string(svalue.substr(0, pos)));
+							if (!fname.empty())
+								g_setArchivesAvailable.erase(ToLowerName(fname));
 
-					auto func = [](const std::string& svalue) 
-					{
-						EditorAPI::BSString strName;
+							if (pos == std::string_view::npos)
+								break;
 
-						if (svalue.length() > 0) 
-						{
-							LPSTR s_c = new CHAR[svalue.length() + 1];
-							strcpy(s_c, svalue.c_str());
-
-							LPSTR stoken = strtok(s_c, ",");
-							if (stoken)
-							{
-								do 
-								{
-									auto index = g_arrayArchivesAvailable.begin();
-									auto fname = StringUtils::Trim(stoken);
-
-									for (; index != g_arrayArchivesAvailable.end(); index++)
-									{
-										if (!_stricmp(fname.c_str(), (*index)->c_str()))
-											break;
-									}
-
-									if (index != g_arrayArchivesAvailable.end())
-									{
-										delete* index;
-										g_arrayArchivesAvailable.erase(index);
-									}
-
-									stoken = strtok(NULL, ",");
-								} while (stoken);
-							}
-
-							delete[] s_c;
+							svalue.remove_prefix(pos + 1);
 						}
 					};
 
@@ -194,16 +184,37 @@ namespace CKPE
 
 				static bool IsAvailableForLoad(LPCSTR ArchiveName)
 				{
-					auto index = g_arrayArchivesAvailable.begin();
-					auto fname = StringUtils::Trim(ArchiveName);
+					return g_setArchivesAvailable.contains(ToLowerName(StringUtils::Trim(ArchiveName)));
+				}
+
+				static void PrefetchForSelectedFiles()
+				{
+					auto threads = _READ_OPTION_UINT("CreationKit", "uArchivePrefetchThreads", 0);
+					if (!threads || EditorAPI::TESDataHandler::Singleton.Empty())
+						return;
 
-					for (; index != g_arrayArchivesAvailable.end(); index++)
+					std::vector<std::string> names;
+
+					// Same names and order as attached by LoadTesFile
+					auto it = EditorAPI::TESDataHandler::Singleton->GetMods()->Begin();
+					for (; !it.End(); ++it)
 					{
-						if (!_stricmp(fname.c_str(), (*index)->c_str()))
-							break;
+						auto file = it.Get();
+						if (!file || !file->IsSelected())
+							continue;
+
+						auto sname = file->GetFileName();
+						sname.Copy(0, sname.FindLastOf('.'));
+
+						for (auto suffix : { ".bsa", " - Textures.bsa" })
+						{
+							std::string name = *(sname + suffix);
+							if (IsAvailableForLoad(name.c_str()))
+								names.emplace_back(std::move(name));
+						}
 					}
 
-					return index != g_arrayArchivesAvailable.end();
+					ArchiveIndex::Prefetch(std::move(names), threads);
 				}
 			};
 
@@ -289,6 +300,10 @@ namespace CKPE
 				bool loaded = true;
 				auto lf = (EditorAPI::TESFile*)load_file;
 
+				// The first file of the load, warm up the archives of all the files to be loaded
+				if (g_SelectedFilesArray.empty())
+					BSResourceArchive::PrefetchForSelectedFiles();
+
 				// Sometimes duplicated
 				if (std::find(g_SelectedFilesArray.begin(), g_SelectedFilesArray.end(), load_file) ==
 					g_SelectedFilesArray.end())
@@ -321,6 +336,9 @@ namespace CKPE
 
 			void BSArchiveManager::LoadTesFileFinal() noexcept(true)
 			{
+				// Normally done long before
+				ArchiveIndex::StopPrefetch();
+				LoadProfiler::EndLoad();
 				g_SelectedFilesArray.clear();
 			}
 		}
@@ -7,6 +7,7 @@
 #include <CKPE.Common.LogWindow.h>
 #include <CKPE.Common.Interface.h>
 #include <CKPE.SkyrimSE.VersionLists.h>
+#include <intrin.h>
 #include <Patches/CKPE.SkyrimSE.Patch.Console.h>
 
 namespace CKPE
@@ -119,6 +120,10 @@ namespace CKPE
 
 			void Console::LogWarning(MsgType Type, const char* Format, ...) noexcept(true)
 			{
+				// Blacklisted spam is dropped before it is formatted
+				if (Common::LogWindow::IsFormatBlacklisted(Format, _ReturnAddress()))
+					return;
+
 				va_list va;
 				va_start(va, Format);
 				LogWarningVa(Type, Format, va);
@@ -135,6 +140,9 @@ namespace CKPE
 
 			void Console::LogWarningUnknown1(const char* Format, ...) noexcept(true)
 			{
+				if (Common::LogWindow::IsFormatBlacklisted(Format, _ReturnAddress()))
+					return;
+
 				va_list va;
 				va_start(va, Format);
 				LogVa(Format, va);
@@ -143,6 +151,9 @@ namespace CKPE
 
 			void Console::LogWarningUnknown2(__int64 Unused, const char* Format, ...) noexcept(true)
 			{
+				if (Common::LogWindow::IsFormatBlacklisted(Format, _ReturnAddress()))
+					return;
+
 				va_list va;
 				va_start(va, Format);
 				LogVa(Format, va);
@@ -154,6 +165,9 @@ namespace CKPE
 				if (!Message || !Message[0])
 					Message = "<No message>";
 
+				if (Common::LogWindow::IsFormatBlacklisted(Message, _ReturnAddress()))
+					return;
+
 				char buffer[1024];
 				va_list va;
 
@@ -5,6 +5,8 @@
 #include <windows.h>
 #include <libdeflate.h>
 #include <intrin.h>
+#include <memory>
+#include <unordered_map>
 #include <CKPE.Detours.h>
 #include <CKPE.SafeWrite.h>
 #include <CKPE.HardwareInfo.h>
@@ -12,7 +14,11 @@
 #include <CKPE.Application.h>
 #include <CKPE.Common.Interface.h>
 #include <CKPE.SkyrimSE.VersionLists.h>
+#include <CKPE.SkyrimSE.RecordPrefetcher.h>
+#include <CKPE.SkyrimSE.DataDirectoryIndex.h>
+#include <CKPE.SkyrimSE.LoadProfiler.h>
 #include <EditorAPI/BSTArray.h>
+#include <EditorAPI/TESDataHandler.h>
 #include <Patches/CKPE.SkyrimSE.Patch.ProgressWindow.h>
 #include <Patches/CKPE.SkyrimSE.Patch.LoadOptimization.h>
 
@@ -34,11 +40,39 @@ namespace CKPE
 				struct internal_state* state;
 			};
 
-			thread_local WIN32_FIND_DATAA CachedFileInfo;
-			thread_local char CachedBasePath[MAX_PATH];
-			thread_local bool CachedFileInfoValid;
+			struct DecompressorDeleter
+			{
+				void operator()(libdeflate_decompressor* decompressor) const noexcept(true)
+				{
+					libdeflate_free_decompressor(decompressor);
+				}
+			};
+
+			// One decompressor per thread, it's reused for every record instead of alloc/free on each call
+			thread_local std::unique_ptr<libdeflate_decompressor, DecompressorDeleter> ThreadDecompressor;
+			struct SearchArrayIndex
+			{
+				const void* array{ nullptr };
+				void* const* data{ nullptr };
+				std::uint32_t size{ 0 };
+				void* last{ nullptr };
+				std::uint64_t stamp{ 0 };
+				// Next element checked against the positions
+				std::uint32_t probe{ 0 };
+				// Pointer -> index of its first occurrence
+				std::unordered_map<void*, std::uint32_t> positions;
+			};
+
+			constexpr static std::uint32_t SEARCH_ARRAY_INDEX_SLOTS = 4;
+			thread_local SearchArrayIndex SearchArrayIndices[SEARCH_ARRAY_INDEX_SLOTS];
+			thread_local std::uint64_t SearchArrayIndexStamp = 0;
+			std::uint32_t SearchArrayIndexThreshold = 0;
+			DWORD(*SearchArrayScan)(EditorAPI::BSTArray<void*>&, void*&, DWORD, std::int64_t) = nullptr;
+			// ~30 updates per second
+			constexpr static std::uint64_t LOAD_PROGRESS_UPDATE_INTERVAL = 33;
 			float* pProgress1 = 0;
 			float* pProgress2 = 0;
+			bool RecordPrefetchEnabled = false;
 
 			static bool sub_141589150(std::int64_t a1, uint32_t* a2) noexcept(true)
 			{
@@ -47,21 +81,72 @@ namespace CKPE
 				return a1 != 0;
 			}
 
+			static void StartRecordPrefetch() noexcept(true)
+			{
+				static bool started = false;
+				if (started || EditorAPI::TESDataHandler::Singleton.Empty())
+					return;
+
+				started = true;
+				std::vector<std::string> files;
+
+				// Files checked in the Data dialog in load order
+				auto it = EditorAPI::TESDataHandler::Singleton->GetMods()->Begin();
+				for (; !it.End(); ++it)
+				{
+					auto file = it.Get();
+					if (!file || !file->IsSelected())
+						continue;
+
+					std::string path = file->GetFilePath().c_str();
+					if (path.empty())
+						path = "Data\\";
+					else if (path.back() != '\\')
+						path += '\\';
+
+					files.emplace_back(path + file->GetFileName().c_str());
+				}
+
+				RecordPrefetcher::Start(std::move(files));
+			}
+
 			static std::int32_t HKInflateInit(z_stream_s* Stream, const char* Version, std::int32_t Mode) noexcept(true)
 			{
+				if (RecordPrefetchEnabled)
+					StartRecordPrefetch();
+
 				// Force inflateEnd to error out and skip frees
 				Stream->state = nullptr;
 				return 0;
 			}
 
-			static std::int32_t HKInflate(z_stream_s* Stream, std::int32_t Flush) noexcept(true)
+			[[nodiscard]] static libdeflate_decompressor* GetThreadDecompressor() noexcept(true)
+			{
+				if (!ThreadDecompressor)
+					ThreadDecompressor.reset(libdeflate_alloc_decompressor());
+				return ThreadDecompressor.get();
+			}
+
+			static std::int32_t InflateStream(z_stream_s* Stream) noexcept(true)
 			{
+				std::uint32_t prefetchedBytes = 0;
+				if (RecordPrefetcher::Take(Stream->next_in, Stream->avail_in, Stream->next_out, Stream->avail_out,
+					prefetchedBytes))
+				{
+					Stream->total_in = Stream->avail_in;
+					Stream->total_out = prefetchedBytes;
+
+					return 1;
+				}
+
 				std::size_t outBytes = 0;
-				libdeflate_decompressor* decompressor = libdeflate_alloc_decompressor();
+				libdeflate_decompressor* decompressor = GetThreadDecompressor();
+				if (!decompressor)
+					// Z_MEM_ERROR
+					return -4;
 
 				libdeflate_result result = libdeflate_zlib_decompress(decompressor, Stream->next_in,
 					Stream->avail_in, Stream->next_out, Stream->avail_out, &outBytes);
-				libdeflate_free_decompressor(decompressor);
 
 				if (result == LIBDEFLATE_SUCCESS)
 				{
@@ -79,19 +164,55 @@ namespace CKPE
 				return -2;
 			}
 
+			static std::int32_t HKInflate(z_stream_s* Stream, std::int32_t Flush) noexcept(true)
+			{
+				if (!LoadProfiler::HasEnabled())
+					return InflateStream(Stream);
+
+				LARGE_INTEGER start, end;
+				QueryPerformanceCounter(&start);
+				auto result = InflateStream(Stream);
+				QueryPerformanceCounter(&end);
+
+				if (result == 1)
+					LoadProfiler::OnInflate(Stream->avail_in, Stream->total_out, end.QuadPart - start.QuadPart);
+
+				return result;
+			}
+
 			inline static void (*UpdateProgressBar)(void);
 			static void UpdateLoadProgressBar() noexcept(true)
 			{
-				static float lastPercent = 0.0f;
+				static std::uint64_t lastUpdate = 0;
+				static std::uint32_t lastProgress = 0;
+
+				LoadProfiler::OnFormLoaded();
 
-				// Only update every quarter percent, rather than every single form load
-				float newPercent = ((*pProgress2) / (*pProgress1)) * 100.0f;
-				if (abs(lastPercent - newPercent) <= 0.25f)
+				if (*pProgress1 <= 0.0f)
+					return;
+
+				// The loader only publishes the progress, the window and the taskbar sample it on their own timer
+				auto progress = (std::uint32_t)(((*pProgress2) / (*pProgress1)) * (float)ProgressWindow::LOAD_PROGRESS_TOTAL);
+				ProgressWindow::SetLoadProgress(progress);
+
+				// The editor's update also pumps the window messages (the window timer among them), it runs only
+				// when the progress has moved by a step and not faster than the UI rate, so a load never makes
+				// more than LOAD_PROGRESS_TOTAL calls however long it takes
+				auto now = GetTickCount64();
+				if ((progress == lastProgress) || ((now - lastUpdate) < LOAD_PROGRESS_UPDATE_INTERVAL))
 					return;
 
-				ProgressWindow::Singleton->step();
 				UpdateProgressBar();
-				lastPercent = newPercent;
+				lastUpdate = now;
+				lastProgress = progress;
+			}
+
+			inline static void (*LoadTesFile)(const EditorAPI::TESFile*);
+			static void HKLoadTesFile(const EditorAPI::TESFile* File) noexcept(true)
+			{
+				LoadProfiler::BeginFile(File);
+				LoadTesFile(File);
+				LoadProfiler::EndFile();
 			}
 
 			static std::uint32_t BSSystemDir_NextEntry(std::int64_t a1, bool* IsComplete)
@@ -100,8 +221,6 @@ namespace CKPE
 				auto findData = (LPWIN32_FIND_DATAA)(a1 + 8);
 				auto& status = *(std::uint32_t*)(a1 + 0x24C);
 
-				CachedFileInfoValid = true;
-
 				if (findHandle == INVALID_HANDLE_VALUE)
 				{
 					// Attempting to iterate directory on an already invalid handle
@@ -110,30 +229,43 @@ namespace CKPE
 				else if (findHandle)
 				{
 					*IsComplete = FindNextFileA(findHandle, findData) == FALSE;
-					memcpy(&CachedFileInfo, findData, sizeof(WIN32_FIND_DATAA));
-
-					if (*IsComplete)
-						CachedFileInfoValid = false;
 				}
 				else
 				{
 					findHandle = FindFirstFileExA((LPCSTR)(a1 + 0x148), FindExInfoStandard, findData,
 						FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
-					memcpy(&CachedFileInfo, findData, sizeof(WIN32_FIND_DATAA));
-
-					strcpy_s(CachedBasePath, (LPCSTR)(a1 + 0x148));
-					*strrchr(CachedBasePath, '\\') = '\0';
 
 					// status = x ? EC_INVALID_PARAM : EC_NONE;
 					status = (findHandle == INVALID_HANDLE_VALUE) ? 6 : 0;
 				}
 
-				if (status != 0)
-					CachedFileInfoValid = false;
-
 				return status;
 			}
 
+			static bool QueryLooseFileInfo(const char* CanonicalFullPath, WIN32_FILE_ATTRIBUTE_DATA& fileInfo) noexcept(true)
+			{
+				const static std::uint32_t cwdLength = GetCurrentDirectoryA(0, nullptr);
+
+				// Anything under "<CWD>\\Data\\data\\" will never be valid, so discard all calls with it
+				if ((strlen(CanonicalFullPath) > cwdLength) && !_strnicmp(CanonicalFullPath + cwdLength, "Data\\data\\", 10))
+					return false;
+
+				DataDirectoryIndex::Entry entry;
+				switch (DataDirectoryIndex::Lookup(CanonicalFullPath, entry))
+				{
+				case DataDirectoryIndex::lrMissing:
+					return false;
+				case DataDirectoryIndex::lrFound:
+					fileInfo.dwFileAttributes = entry.attributes;
+					fileInfo.nFileSizeLow = (DWORD)entry.size;
+					fileInfo.nFileSizeHigh = (DWORD)(entry.size >> 32);
+					return true;
+				default:
+					// Outside of "Data" or the index is being rebuilt
+					return GetFileAttributesExA(CanonicalFullPath, GetFileExInfoStandard, &fileInfo);
+				}
+			}
+
 			static bool BSResource_LooseFileLocation_FileExists(const char* CanonicalFullPath, std::uint32_t* TotalSize)
 			{
 				WIN32_FILE_ATTRIBUTE_DATA fileInfo
@@ -141,34 +273,8 @@ namespace CKPE
 					.dwFileAttributes = INVALID_FILE_ATTRIBUTES
 				};
 
-				if (CachedFileInfoValid)
-				{
-					const static std::uint32_t cwdLength = GetCurrentDirectoryA(0, nullptr);
-					const std::size_t filePathLen = strlen(CanonicalFullPath);
-					const std::size_t basePathLen = strlen(CachedBasePath);
-
-					if (filePathLen > cwdLength)
-					{
-						// Anything under "<CWD>\\Data\\data\\" will never be valid, so discard all calls with it
-						if (!_strnicmp(CanonicalFullPath + cwdLength, "Data\\data\\", 10))
-							return false;
-
-						// Check if this file path matches the query from FindFirstFileExA
-						if (filePathLen > basePathLen && !_stricmp(CanonicalFullPath + basePathLen, CachedFileInfo.cFileName))
-						{
-							fileInfo.dwFileAttributes = CachedFileInfo.dwFileAttributes;
-							fileInfo.nFileSizeLow = CachedFileInfo.nFileSizeLow;
-							fileInfo.nFileSizeHigh = CachedFileInfo.nFileSizeHigh;
-						}
-					}
-				}
-
-				if (fileInfo.dwFileAttributes == INVALID_FILE_ATTRIBUTES)
-				{
-					// Cache miss
-					if (!GetFileAttributesExA(CanonicalFullPath, GetFileExInfoStandard, &fileInfo))
-						return false;
-				}
+				if (!QueryLooseFileInfo(CanonicalFullPath, fileInfo))
+					return false;
 
 				if (fileInfo.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
 					return false;
@@ -191,34 +297,8 @@ namespace CKPE
 					.dwFileAttributes = INVALID_FILE_ATTRIBUTES
 				};
 
-				if (CachedFileInfoValid)
-				{
-					const static std::uint32_t cwdLength = GetCurrentDirectoryA(0, nullptr);
-					const std::size_t filePathLen = strlen(CanonicalFullPath);
-					const std::size_t basePathLen = strlen(CachedBasePath);
-
-					if (filePathLen > cwdLength)
-					{
-						// Anything under "<CWD>\\Data\\data\\" will never be valid, so discard all calls with it
-						if (!_strnicmp(CanonicalFullPath + cwdLength, "Data\\data\\", 10))
-							return false;
-
-						// Check if this file path matches the query from FindFirstFileExA
-						if (filePathLen > basePathLen && !_stricmp(CanonicalFullPath + basePathLen, CachedFileInfo.cFileName))
-						{
-							fileInfo.dwFileAttributes = CachedFileInfo.dwFileAttributes;
-							fileInfo.nFileSizeLow = CachedFileInfo.nFileSizeLow;
-							fileInfo.nFileSizeHigh = CachedFileInfo.nFileSizeHigh;
-						}
-					}
-				}
-
-				if (fileInfo.dwFileAttributes == INVALID_FILE_ATTRIBUTES)
-				{
-					// Cache miss
-					if (!GetFileAttributesExA(CanonicalFullPath, GetFileExInfoStandard, &fileInfo))
-						return false;
-				}
+				if (!QueryLooseFileInfo(CanonicalFullPath, fileInfo))
+					return false;
 
 				if (fileInfo.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
 					return false;
@@ -240,8 +320,6 @@ namespace CKPE
 				// Compare 4 pointers per iteration - use SIMD instructions to generate a bit mask. Set
 				// bit 0 if 'array[i + 0]'=='target', set bit 1 if 'array[i + 1]'=='target', set bit X...
 				//
-				// AVX: mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(targets, _mm256_loadu_si256((__m256i *)&data[i]))));
-				//
 				const __m128i targets = _mm_set1_epi64x((std::int64_t)_target);
 
 				for (std::uint32_t iter = 0; iter < vectorizedIterations; iter++)
@@ -268,6 +346,71 @@ namespace CKPE
 				return 0xFFFFFFFF;
 			}
 
+			static DWORD SearchArrayItem_AVX2(EditorAPI::BSTArray<void*>& _array, void*& _target,
+				DWORD _start_index, std::int64_t Unused)
+			{
+				std::uint32_t index = _start_index;
+				std::int64_t* data = (std::int64_t*)_array.data();
+
+				// Same as SSE4.1, but 8 pointers per iteration
+				const std::uint32_t comparesPerIter = 8;
+				const std::uint32_t vectorizedIterations = (_array.size() - index) / comparesPerIter;
+
+				const __m256i targets = _mm256_set1_epi64x((std::int64_t)_target);
+
+				for (std::uint32_t iter = 0; iter < vectorizedIterations; iter++)
+				{
+					__m256i test1 = _mm256_cmpeq_epi64(targets, _mm256_loadu_si256((__m256i*)&data[index + 0]));
+					__m256i test2 = _mm256_cmpeq_epi64(targets, _mm256_loadu_si256((__m256i*)&data[index + 4]));
+
+					int mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_or_si256(test1, test2)));
+					if (mask != 0)
+						break;
+
+					index += comparesPerIter;
+				}
+
+				for (; index < _array.size(); index++)
+				{
+					if (data[index] == (std::int64_t)_target)
+						return index;
+				}
+
+				return 0xFFFFFFFF;
+			}
+
+			static DWORD SearchArrayItem_AVX512(EditorAPI::BSTArray<void*>& _array, void*& _target,
+				DWORD _start_index, std::int64_t Unused)
+			{
+				std::uint32_t index = _start_index;
+				std::int64_t* data = (std::int64_t*)_array.data();
+
+				// 16 pointers per iteration, the compare gives the bit mask directly
+				const std::uint32_t comparesPerIter = 16;
+				const std::uint32_t vectorizedIterations = (_array.size() - index) / comparesPerIter;
+
+				const __m512i targets = _mm512_set1_epi64((std::int64_t)_target);
+
+				for (std::uint32_t iter = 0; iter < vectorizedIterations; iter++)
+				{
+					__mmask8 mask1 = _mm512_cmpeq_epi64_mask(targets, _mm512_loadu_si512(&data[index + 0]));
+					__mmask8 mask2 = _mm512_cmpeq_epi64_mask(targets, _mm512_loadu_si512(&data[index + 8]));
+
+					if ((mask1 | mask2) != 0)
+						break;
+
+					index += comparesPerIter;
+				}
+
+				for (; index < _array.size(); index++)
+				{
+					if (data[index] == (std::int64_t)_target)
+						return index;
+				}
+
+				return 0xFFFFFFFF;
+			}
+
 			static DWORD SearchArrayItem(EditorAPI::BSTArray<void*>& _array, void*& _target,
 				DWORD _start_index, std::int64_t Unused)
 			{
@@ -280,6 +423,100 @@ namespace CKPE
 				return 0xFFFFFFFF;
 			}
 
+			[[nodiscard]] static bool HasOSSupportXState(std::uint64_t mask) noexcept(true)
+			{
+				// The OS must save the YMM/ZMM registers on context switches
+				return HardwareInfo::CPU::HasSupportOSXSAVE() && ((_xgetbv(0) & mask) == mask);
+			}
+
+			[[nodiscard]] static SearchArrayIndex& GetSearchArrayIndex(const EditorAPI::BSTArray<void*>& _array) noexcept(true)
+			{
+				// Only a few huge arrays are searched in turn, the least recently used slot is replaced
+				SearchArrayIndex* slot = &SearchArrayIndices[0];
+				for (auto& index : SearchArrayIndices)
+				{
+					if (index.array == &_array)
+					{
+						slot = &index;
+						break;
+					}
+
+					if (index.stamp < slot->stamp)
+						slot = &index;
+				}
+
+				if (slot->array != &_array)
+				{
+					slot->array = &_array;
+					slot->data = nullptr;
+					slot->size = 0;
+					slot->positions.clear();
+				}
+
+				slot->stamp = ++SearchArrayIndexStamp;
+				return *slot;
+			}
+
+			static DWORD SearchArrayItem_Indexed(EditorAPI::BSTArray<void*>& _array, void*& _target,
+				DWORD _start_index, std::int64_t Unused)
+			{
+				const std::uint32_t size = _array.size();
+				if (size < SearchArrayIndexThreshold)
+					return SearchArrayScan(_array, _target, _start_index, Unused);
+
+				auto& index = GetSearchArrayIndex(_array);
+				auto data = _array.data();
+
+				// Anything but appending to the same buffer invalidates the positions
+				bool stale = (index.data != data) || (index.size > size) ||
+					(index.size && (data[index.size - 1] != index.last));
+
+				// A pointer written in place over another one isn't seen by the check above, so one element
+				// per call is checked in turn: such an array is rebuilt after at most 'size' searches
+				if (!stale && index.size)
+				{
+					auto probe = index.probe++ % index.size;
+					auto it = index.positions.find(data[probe]);
+					stale = (it == index.positions.end()) || (it->second > probe);
+				}
+
+				auto update = [&](bool rebuild)
+					{
+						if (rebuild)
+						{
+							index.data = data;
+							index.size = 0;
+							index.positions.clear();
+						}
+
+						for (std::uint32_t i = index.size; i < size; i++)
+							index.positions.try_emplace(data[i], i);
+
+						index.size = size;
+						index.last = data[size - 1];
+					};
+
+				update(stale);
+
+				auto it = index.positions.find(_target);
+				if ((it != index.positions.end()) && (data[it->second] != _target))
+				{
+					// Overwritten in place, the positions are stale
+					update(true);
+					it = index.positions.find(_target);
+				}
+
+				// Every element of the array is in the positions, the miss is final
+				if (it == index.positions.end())
+					return 0xFFFFFFFF;
+
+				if (it->second >= _start_index)
+					return it->second;
+
+				// Only the first occurrence is kept, a later one is scanned for
+				return SearchArrayScan(_array, _target, _start_index, Unused);
+			}
+
 			LoadOptimization::LoadOptimization() : Common::Patch()
 			{
 				SetName("Load Optimization");
@@ -325,17 +562,33 @@ namespace CKPE
 				//
 				// - Fix an unoptimized function bottleneck (SearchArrayItem) (Large ESP files only)
 				// - Fix an unoptimized function bottleneck (sub_1415D5640)
-				// - Eliminate millions of calls to update the progress dialog, instead only updating 400 times (0% -> 100%)
+				// - Eliminate millions of calls to update the progress dialog, the loader publishes the progress
+				// and the dialog is updated once per step of the progress, at most ~30 times per second
 				// - Replace old zlib decompression code with optimized libdeflate
-				// - Cache results from FindFirstFile when GetFileAttributesExA is called immediately after 
-				// (BSSystemDir__NextEntry, BSResource__LooseFileLocation__FileExists)
+				// - Optionally inflate the compressed records ahead of the editor on a worker pool
+				// - Answer loose file checks from an index of the whole "Data" folder instead of GetFileAttributesExA
+				// (BSResource__LooseFileLocation__FileExists)
 				//
 
-				// Utilize SSE4.1 instructions if available
-				if (HardwareInfo::CPU::HasSupportSSE41())
-					Detours::DetourJump(__CKPE_OFFSET(10), (std::uintptr_t)&SearchArrayItem_SSE41);
+				// Utilize the widest vector instructions available
+				if (HardwareInfo::CPU::HasSupportAVX512F() && HasOSSupportXState(0xE6))
+					SearchArrayScan = &SearchArrayItem_AVX512;
+				else if (HardwareInfo::CPU::HasSupportAVX2() && HasOSSupportXState(0x06))
+					SearchArrayScan = &SearchArrayItem_AVX2;
+				else if (HardwareInfo::CPU::HasSupportSSE41())
+					SearchArrayScan = &SearchArrayItem_SSE41;
+				else
+					SearchArrayScan = &SearchArrayItem;
+
+				// Huge arrays are searched over and over while they grow, a hash of positions turns this into a lookup
+				SearchArrayIndexThreshold = _READ_OPTION_UINT("CreationKit", "uSearchArrayIndexThreshold", 0);
+				if (SearchArrayIndexThreshold)
+					Detours::DetourJump(__CKPE_OFFSET(10), (std::uintptr_t)&SearchArrayItem_Indexed);
 				else
-					Detours::DetourJump(__CKPE_OFFSET(10), (std::uintptr_t)&SearchArrayItem);
+					Detours::DetourJump(__CKPE_OFFSET(10), (std::uintptr_t)SearchArrayScan);
+
+				DataDirectoryIndex::Initialize();
+				LoadProfiler::Initialize();
 
 				pProgress1 = (float*)__CKPE_OFFSET(0);
 				pProgress2 = (float*)__CKPE_OFFSET(1);
@@ -345,6 +598,7 @@ namespace CKPE
 				Detours::DetourCall(__CKPE_OFFSET(4), (std::uintptr_t)&UpdateLoadProgressBar);
 				Detours::DetourCall(__CKPE_OFFSET(5), (std::uintptr_t)&HKInflateInit);
 				Detours::DetourCall(__CKPE_OFFSET(6), (std::uintptr_t)&HKInflate);
+				RecordPrefetchEnabled = _READ_OPTION_BOOL("CreationKit", "bRecordPrefetch", false);
 				Detours::DetourJump(__CKPE_OFFSET(7), (std::uintptr_t)&BSSystemDir_NextEntry);
 				
 				if (verPatch == 1)
@@ -352,6 +606,10 @@ namespace CKPE
 				else
 					Detours::DetourJump(__CKPE_OFFSET(8), (std::uintptr_t)&BSResource_LooseFileLocation_FileExistsEx);
 
+				// The load of a single plugin, also called by the own archive loader (bOwnArchiveLoader)
+				if (LoadProfiler::HasEnabled() && (db->GetCount() > 11))
+					*(std::uintptr_t*)&LoadTesFile = Detours::DetourJump(__CKPE_OFFSET(11), (std::uintptr_t)&HKLoadTesFile);
+
 				return true;
 			}
 		}
@@ -17,6 +17,7 @@
 #include <CKPE.Common.UIMenus.h>
 #include <CKPE.Common.RTTI.h>
 #include <CKPE.SkyrimSE.VersionLists.h>
+#include <CKPE.SkyrimSE.DataDirectoryIndex.h>
 #include <EditorAPI/BSString.h>
 #include <EditorAPI/Forms/TESObjectREFR.h>
 #include <EditorAPI/BSPointerHandleManager.h>
@@ -293,6 +294,10 @@ namespace CKPE
 								}
 							}
 							break;
+						case WM_DESTROY:
+							// The editor is closing, stop the watcher of the "Data" folder while its thread is still alive
+							DataDirectoryIndex::Shutdown();
+							break;
 						case WM_SIZE:
 						{
 							// Scale the status bar segments to fit the window size
@@ -10,6 +10,7 @@
 #include <CKPE.Application.h>
 #include <CKPE.Common.Interface.h>
 #include <CKPE.Common.MemoryManager.h>
+#include <CKPE.Common.ScrapHeap.h>
 #include <CKPE.SkyrimSE.VersionLists.h>
 #include <Patches/CKPE.SkyrimSE.Patch.MemoryManager.h>
 
@@ -52,7 +53,7 @@ namespace CKPE
 			public:
 				static void* Allocate(BSScrapHeap* manager, std::size_t size, std::uint32_t alignment)
 				{
-					auto ptr = Common::MemoryManager::GetSingleton()->MemAlloc(size, alignment, alignment != 0);
+					auto ptr = Common::ScrapHeap::Allocate(size, alignment);
 					//_CKPE_TracerPush("ScrapHeap", ptr, size);
 					return ptr;
 				}
@@ -60,7 +61,7 @@ namespace CKPE
 				static void Deallocate(BSScrapHeap* manager, void* memory)
 				{
 					//_CKPE_TracerPop(memory);
-					Common::MemoryManager::GetSingleton()->MemFree(memory);
+					Common::ScrapHeap::Deallocate(memory);
 				}
 			};
 
@@ -222,6 +223,8 @@ namespace CKPE
 				// Принудительный вылет с сообщением для пользователя.
 				CKPE_ASSERT_MSG(LowMemory(), "Not enough memory to run the program");
 
+				Common::ScrapHeap::Initialize();
+
 				Detours::DetourJump(__CKPE_OFFSET(0), (std::uintptr_t)&BSMemoryManager::Allocate);
 				Detours::DetourJump(__CKPE_OFFSET(1), (std::uintptr_t)&BSMemoryManager::Deallocate);
 				Detours::DetourJump(__CKPE_OFFSET(2), (std::uintptr_t)&BSMemoryManager::Size);
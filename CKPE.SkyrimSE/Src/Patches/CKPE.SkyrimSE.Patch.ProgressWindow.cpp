@@ -3,12 +3,14 @@
 // License: https://www.gnu.org/licenses/lgpl-3.0.html
 
 #include <windows.h>
+#include <atomic>
 #include <CKPE.Detours.h>
 #include <CKPE.Utils.h>
 #include <CKPE.Application.h>
 #include <CKPE.Common.Interface.h>
 #include <CKPE.Common.ProgressTaskBar.h>
 #include <CKPE.SkyrimSE.VersionLists.h>
+#include <CKPE.SkyrimSE.LoadProfiler.h>
 #include <Patches/CKPE.SkyrimSE.Patch.MainWindow.h>
 #include <Patches/CKPE.SkyrimSE.Patch.ProgressWindow.h>
 
@@ -23,8 +25,17 @@ namespace CKPE
 			std::uintptr_t pointer_ProgressWindow_sub = 0;
 			long value_ProgressWindow_pos = 0;
 
+			std::atomic_uint32_t value_ProgressWindow_load = 0;
+			std::uint32_t value_ProgressWindow_shown = 0;
+			std::uint64_t value_ProgressWindow_start = 0;
+			std::uint32_t value_ProgressWindow_start_value = 0;
+			char value_ProgressWindow_title[256];
+
 			constexpr std::uint32_t UI_PROGRESS_ID = 31007;
 			constexpr std::uint32_t UI_PROGRESS_LABEL_ID = 2217;
+			constexpr std::uint32_t UI_PROGRESS_TIMER_ID = 0x43504B50;
+			// ~30 updates per second
+			constexpr std::uint32_t UI_PROGRESS_TIMER_INTERVAL = 33;
 
 			ProgressWindow::ProgressWindow() : Common::PatchBaseWindow()
 			{
@@ -85,17 +96,36 @@ namespace CKPE
 					ProgressWindow::Singleton->ProgressLabel = GetDlgItem(Hwnd, UI_PROGRESS_LABEL_ID);
 					ProgressWindow::Singleton->Progress = GetDlgItem(Hwnd, UI_PROGRESS_ID);
 
-					ProgressTaskBarPtr = new Common::ProgressTaskBar(MainWindow::Singleton->Handle, 100 * 4);
+					ProgressTaskBarPtr = new Common::ProgressTaskBar(MainWindow::Singleton->Handle, LOAD_PROGRESS_TOTAL);
 					if (ProgressTaskBarPtr)
 					{
 						ProgressTaskBarPtr->Begin();
 						// default more often than not, we see uncertain progress
 						ProgressTaskBarPtr->SetMarquee(true);
 					}
+
+					value_ProgressWindow_load = 0;
+					value_ProgressWindow_shown = 0;
+					value_ProgressWindow_start = 0;
+					value_ProgressWindow_start_value = 0;
+					if (!GetWindowTextA(Hwnd, value_ProgressWindow_title, (int)std::size(value_ProgressWindow_title)))
+						value_ProgressWindow_title[0] = 0;
+
+					SetTimer(Hwnd, UI_PROGRESS_TIMER_ID, UI_PROGRESS_TIMER_INTERVAL, nullptr);
 				}
 				break;
+				case WM_TIMER:
+				{
+					if (wParam != UI_PROGRESS_TIMER_ID)
+						break;
+
+					UpdateLoadProgress(Hwnd);
+				}
+				return TRUE;
 				case WM_DESTROY:
 				{
+					KillTimer(Hwnd, UI_PROGRESS_TIMER_ID);
+
 					if (ProgressTaskBarPtr)
 					{
 						delete ProgressTaskBarPtr;
@@ -106,6 +136,9 @@ namespace CKPE
 					ProgressWindow::Singleton->m_hWnd = nullptr;
 					ProgressWindow::Singleton->ProgressLabel = nullptr;
 					ProgressWindow::Singleton->Progress = nullptr;
+
+					// The load is over, without the own archive loader there's nothing else to tell it
+					LoadProfiler::EndLoad();
 				}
 				break;
 				}
@@ -121,13 +154,47 @@ namespace CKPE
 				return fast_call<void>(pointer_ProgressWindow_sub, nPartId, lpcstrText);
 			}
 
-			void ProgressWindow::step() noexcept(true)
+			void ProgressWindow::SetLoadProgress(std::uint32_t value) noexcept(true)
 			{
-				if (ProgressWindow::Singleton->isOpen && ProgressTaskBarPtr)
+				value_ProgressWindow_load.store(value, std::memory_order_relaxed);
+			}
+
+			void ProgressWindow::UpdateLoadProgress(HWND Hwnd) noexcept(true)
+			{
+				auto value = std::min(value_ProgressWindow_load.load(std::memory_order_relaxed), LOAD_PROGRESS_TOTAL);
+				if (value == value_ProgressWindow_shown)
+					return;
+
+				// A new load or a reset of the progress starts the estimate over
+				auto now = GetTickCount64();
+				if (!value_ProgressWindow_start || (value < value_ProgressWindow_shown))
+				{
+					value_ProgressWindow_start = now;
+					value_ProgressWindow_start_value = value;
+				}
+
+				value_ProgressWindow_shown = value;
+
+				if (ProgressTaskBarPtr)
 				{
 					ProgressTaskBarPtr->SetMarquee(false);
-					ProgressTaskBarPtr->Step();
+					ProgressTaskBarPtr->SetPosition(value);
 				}
+
+				// Estimate from the average rate since the first progress
+				auto elapsed = now - value_ProgressWindow_start;
+				auto done = value - value_ProgressWindow_start_value;
+				char title[320];
+				if ((elapsed >= 1000) && (value > value_ProgressWindow_start_value) && (value < LOAD_PROGRESS_TOTAL))
+				{
+					auto remaining = (std::uint32_t)((elapsed * (LOAD_PROGRESS_TOTAL - value) / done) / 1000);
+					sprintf_s(title, "%s %u%% (~%u:%02u left)", value_ProgressWindow_title, value * 100 / LOAD_PROGRESS_TOTAL,
+						remaining / 60, remaining % 60);
+				}
+				else
+					sprintf_s(title, "%s %u%%", value_ProgressWindow_title, value * 100 / LOAD_PROGRESS_TOTAL);
+
+				SetWindowTextA(Hwnd, title);
 			}
 		}
 	}
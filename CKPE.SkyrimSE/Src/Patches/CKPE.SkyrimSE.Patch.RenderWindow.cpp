@@ -13,6 +13,7 @@
 #include <CKPE.Graphics.h>
 #include <CKPE.Application.h>
 #include <CKPE.Common.Interface.h>
+#include <CKPE.Common.SettingHandle.h>
 #include <CKPE.SkyrimSE.VersionLists.h>
 #include <EditorAPI/BGSRenderWindow.h>
 #include <Patches/CKPE.SkyrimSE.Patch.RenderWindow.h>
@@ -28,9 +29,14 @@ namespace CKPE
 			extern ImVec4 gImGuiGreyColor;
 			extern std::uintptr_t gGlobAddrDeviceContext;
 
-			static float StepInRender = 15.f;
+			static Common::SettingHandle<float> StepInRender("Graphics:fStepInRender", 15.f);
 			static bool HideMainImguiWnd = true;
 
+			[[nodiscard]] static inline float GetStepInRender() noexcept(true)
+			{
+				return std::min(std::max(StepInRender.Get(), 15.f), 100.f);
+			}
+
 			RenderWindow::RenderWindow() : Common::PatchBaseWindow()
 			{
 				SetName("Render Window");
@@ -70,9 +76,6 @@ namespace CKPE
 				auto _interface = Common::Interface::GetSingleton();
 				auto base = _interface->GetApplication()->GetBase();
 
-				StepInRender = _READ_OPTION_FLOAT("Graphics", "fStepInRender", 15.f);
-				StepInRender = std::min(std::max(StepInRender, 15.f), 100.f);
-
 				*(std::uintptr_t*)&_oldWndProc = Detours::DetourClassJump(__CKPE_OFFSET(0), (std::uintptr_t)&HKWndProc);
 				Detours::DetourJump(__CKPE_OFFSET(1), (std::uintptr_t)&RenderWindow::setFlagLoadCell);
 				EditorAPI::BGSRenderWindow::Singleton = __CKPE_OFFSET(2);
@@ -158,7 +161,7 @@ namespace CKPE
 							{
 							case 'W':
 							{
-								auto delta = StepInRender;
+								auto delta = GetStepInRender();
 								auto& local = const_cast<EditorAPI::NiAPI::NiTransform&>(
 									EditorAPI::BGSRenderWindow::Singleton->Camera->Node->GetLocalTransform());
 
@@ -170,7 +173,7 @@ namespace CKPE
 							}
 							case 'S':
 							{
-								auto delta = -StepInRender;
+								auto delta = -GetStepInRender();
 								auto& local = const_cast<EditorAPI::NiAPI::NiTransform&>(
 									EditorAPI::BGSRenderWindow::Singleton->Camera->Node->GetLocalTransform());
 
@@ -181,7 +184,7 @@ namespace CKPE
 							}
 							case 'A':
 							{
-								auto delta = -StepInRender;
+								auto delta = -GetStepInRender();
 								auto& local = const_cast<EditorAPI::NiAPI::NiTransform&>(
 									EditorAPI::BGSRenderWindow::Singleton->Camera->Node->GetLocalTransform());
 
@@ -194,7 +197,7 @@ namespace CKPE
 							}
 							case 'D':
 							{
-								auto delta = StepInRender;
+								auto delta = GetStepInRender();
 								auto& local = const_cast<EditorAPI::NiAPI::NiTransform&>(
 									EditorAPI::BGSRenderWindow::Singleton->Camera->Node->GetLocalTransform());
 
@@ -9,6 +9,7 @@
 #include <CKPE.SafeWrite.h>
 #include <CKPE.Application.h>
 #include <CKPE.Common.Interface.h>
+#include <CKPE.Common.MemoryPressure.h>
 #include <CKPE.SkyrimSE.VersionLists.h>
 #include <Patches/CKPE.SkyrimSE.Patch.Unicode.h>
 
@@ -33,6 +34,90 @@ namespace CKPE
 				}
 			};
 
+			char* StringCache::Allocate(std::size_t size) noexcept(true)
+			{
+				// Long strings get their own block so as not to waste the rest of the current chunk
+				if (size > (CHUNK_SIZE >> 2))
+				{
+					chunks.emplace_back(std::make_unique<char[]>(size));
+					return chunks.back().get();
+				}
+
+				if (size > available)
+				{
+					chunks.emplace_back(std::make_unique<char[]>(CHUNK_SIZE));
+					cursor = chunks.back().get();
+					available = CHUNK_SIZE;
+				}
+
+				auto block = cursor;
+				cursor += size;
+				available -= size;
+
+				return block;
+			}
+
+			void StringCache::Clear() noexcept(true)
+			{
+				ScopeCriticalSection guard(section);
+
+				if (requests)
+					_MESSAGE("Unicode string cache: generation %u, %llu strings (%llu unique), %.2f KB stored, "
+						"%.2f KB saved by deduplication", generation, requests, (std::uint64_t)table.size(),
+						(double)stored_bytes / 1024.0, (double)(requested_bytes - stored_bytes) / 1024.0);
+
+				table.clear();
+				chunks.clear();
+				cursor = nullptr;
+				available = 0;
+				last = nullptr;
+				requests = 0;
+				requested_bytes = 0;
+				stored_bytes = 0;
+				generation++;
+			}
+
+			const char* StringCache::Push(const std::string& s) noexcept(true)
+			{
+				auto size = s.length() + 1;
+
+				ScopeCriticalSection guard(section);
+
+				requests++;
+				requested_bytes += size;
+
+				auto it = table.find(s);
+				if (it != table.end())
+					return last = it->data();
+
+				auto block = Allocate(size);
+				memcpy(block, s.c_str(), size);
+				table.emplace(block, s.length());
+				stored_bytes += size;
+
+				return last = block;
+			}
+
+			std::size_t StringCache::Trim() noexcept(true)
+			{
+				ScopeCriticalSection guard(section);
+
+				if (!table.empty())
+					return 0;
+
+				// clear() keeps the buckets and the capacity
+				auto released = table.bucket_count() * sizeof(void*) + chunks.capacity() * sizeof(chunks[0]);
+				std::unordered_set<std::string_view>().swap(table);
+				std::vector<std::unique_ptr<char[]>>().swap(chunks);
+
+				return released;
+			}
+
+			static std::size_t TrimStringCache(Common::MemoryPressure::Level level, void* user_data) noexcept(true)
+			{
+				return UnicodeStringCache.Trim();
+			}
+
 			bool ConvertorString::IsValid(const char* s) const noexcept(true)
 			{
 				return ((s != nullptr) && (s != LPSTR_TEXTCALLBACKA) && (strlen(s) > 0));
@@ -72,13 +157,10 @@ namespace CKPE
 				std::string utf8_str = StringUtils::WinCPToUtf8(src);
 
 				// Unicode initially takes up more memory than ansi. 
-				// Therefore, a heap is created that will store memory for the duration of saving.
-				// Lists work quickly on adding items.
-				UnicodeStringCache.Push(utf8_str);
-
-				// pointer to the memory of the contents of the last line, it is of course unique
+				// Therefore, an arena is created that will store memory for the duration of saving.
+				// The same strings are repeated many times, they get one copy.
 				pre = src;
-				return UnicodeStringCache.Last();
+				return UnicodeStringCache.Push(utf8_str);
 			}
 
 			void ConvertorString::SetMode(Mode m) noexcept(true)
@@ -139,6 +221,8 @@ namespace CKPE
 				// Initially, the original state must be set
 				UnicodeConvertorString.SetMode(ConvertorString::MODE_ANSI);
 
+				Common::MemoryPressure::RegisterTrimCallback("Unicode string cache", 10, &TrimStringCache);
+
 				// Intercepting the receipt of a string
 				*(uintptr_t*)&UnicodeSub = Detours::DetourClassJump(__CKPE_OFFSET(0), &BGSLocalizedString::GetStr);
 
@@ -0,0 +1,389 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Benchmark of the archive prefetch (CKPE.SkyrimSE.ArchiveIndex.cpp, uArchivePrefetchThreads): the directories
+// of the given BSA archives are read one by one in order, as the editor registers them, alone and with worker
+// threads reading them ahead. The file cache of the archives is dropped before every pass (Windows: by opening
+// them without buffering, Linux: posix_fadvise), so both passes read from the disk. With --generate the
+// archives are synthetic ones written to the given folder first, so the numbers can be reproduced anywhere.
+// Builds on Windows and Linux:
+//   g++ -O2 -std=c++20 archivebench.cpp -o archivebench
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+constexpr static uint32_t BSA_MAGIC = 'B' | ('S' << 8) | ('A' << 16);
+constexpr static uint32_t BSA_FOLDER_RECORD_SIZE = 0x18;
+constexpr static uint32_t BSA_FILE_RECORD_SIZE = 0x10;
+constexpr static uint64_t BSA_MAX_DIRECTORY_SIZE = 64 * 1024 * 1024;
+constexpr static uint32_t PREFETCH_CHUNK = 1024 * 1024;
+
+#pragma pack(push, 1)
+struct BSAHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t folder_offset;
+    uint32_t archive_flags;
+    uint32_t folder_count;
+    uint32_t file_count;
+    uint32_t total_folder_name_length;
+    uint32_t total_file_name_length;
+    uint16_t file_flags;
+    uint16_t padding;
+};
+#pragma pack(pop)
+static_assert(sizeof(BSAHeader) == 0x24);
+
+class File
+{
+#ifdef _WIN32
+    HANDLE _handle = INVALID_HANDLE_VALUE;
+#else
+    int _fd = -1;
+#endif
+public:
+    File(const std::string& fname)
+    {
+#ifdef _WIN32
+        _handle = CreateFileA(fname.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+#else
+        _fd = open(fname.c_str(), O_RDONLY);
+#endif
+    }
+
+    ~File()
+    {
+#ifdef _WIN32
+        if (_handle != INVALID_HANDLE_VALUE)
+            CloseHandle(_handle);
+#else
+        if (_fd >= 0)
+            close(_fd);
+#endif
+    }
+
+    bool IsOpen() const
+    {
+#ifdef _WIN32
+        return _handle != INVALID_HANDLE_VALUE;
+#else
+        return _fd >= 0;
+#endif
+    }
+
+    uint32_t Read(uint64_t offset, void* buffer, uint32_t size)
+    {
+#ifdef _WIN32
+        OVERLAPPED overlapped{};
+        overlapped.Offset = (DWORD)offset;
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD readed = 0;
+        return ReadFile(_handle, buffer, size, &readed, &overlapped) ? readed : 0;
+#else
+        auto readed = pread(_fd, buffer, size, (off_t)offset);
+        return (readed > 0) ? (uint32_t)readed : 0;
+#endif
+    }
+
+    static void DropCache(const std::string& fname)
+    {
+#ifdef _WIN32
+        // The cached pages of a file are purged when it's opened without buffering
+        auto handle = CreateFileA(fname.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_FLAG_NO_BUFFERING, nullptr);
+        if (handle != INVALID_HANDLE_VALUE)
+            CloseHandle(handle);
+#else
+        int fd = open(fname.c_str(), O_RDONLY);
+        if (fd >= 0)
+        {
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(fd);
+        }
+#endif
+    }
+};
+
+// Reads the header and everything the editor parses on registration, returns the bytes read
+static uint64_t read_directory(const std::string& fname, uint8_t* buffer)
+{
+    File file(fname);
+    if (!file.IsOpen())
+        return 0;
+
+    auto readed = file.Read(0, buffer, sizeof(BSAHeader));
+    if (readed < sizeof(BSAHeader))
+        return readed;
+
+    BSAHeader header;
+    memcpy(&header, buffer, sizeof(BSAHeader));
+    if (header.magic != BSA_MAGIC)
+        return readed;
+
+    auto total = std::min(sizeof(BSAHeader) + (uint64_t)header.folder_count * (BSA_FOLDER_RECORD_SIZE + 1) +
+        header.total_folder_name_length + (uint64_t)header.file_count * BSA_FILE_RECORD_SIZE +
+        header.total_file_name_length, BSA_MAX_DIRECTORY_SIZE);
+
+    uint64_t offset = readed;
+    while (offset < total)
+    {
+        auto chunk = file.Read(offset, buffer, (uint32_t)std::min(total - offset, (uint64_t)PREFETCH_CHUNK));
+        if (!chunk)
+            break;
+
+        offset += chunk;
+    }
+
+    return offset;
+}
+
+// Writes a version 105 archive laid out as the editor expects it: folder records, folder names with the file
+// records, file names, then 'data_size' bytes of every file. The hashes are only kept in the sorted order.
+static bool write_archive(const std::string& fname, uint32_t index, uint32_t files, uint32_t data_size)
+{
+    constexpr static uint32_t FILES_PER_FOLDER = 100;
+
+    auto folders = std::max((files + FILES_PER_FOLDER - 1) / FILES_PER_FOLDER, 1u);
+    std::vector<std::string> folder_names;
+    std::string file_names;
+    uint32_t total_folder_name_length = 0;
+
+    for (uint32_t i = 0; i < folders; i++)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "textures\\synthetic%03u\\folder%05u", index, i);
+        folder_names.emplace_back(name);
+        total_folder_name_length += (uint32_t)strlen(name) + 1;
+    }
+
+    for (uint32_t i = 0; i < files; i++)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "file%06u.dds", i);
+        file_names.append(name, strlen(name) + 1);
+    }
+
+    BSAHeader header{ BSA_MAGIC, 105, sizeof(BSAHeader), 0x3, folders, files, total_folder_name_length,
+        (uint32_t)file_names.length(), 0x2, 0 };
+
+    auto directory_size = sizeof(BSAHeader) + (uint64_t)folders * (BSA_FOLDER_RECORD_SIZE + 1) +
+        total_folder_name_length + (uint64_t)files * BSA_FILE_RECORD_SIZE + file_names.length();
+
+    std::string out;
+    out.reserve(directory_size);
+    auto put = [&out](const void* data, size_t size) { out.append((const char*)data, size); };
+    put(&header, sizeof(header));
+
+    // The offset of a folder points at its name, counted past the file names as the game does
+    uint64_t offset = sizeof(BSAHeader) + (uint64_t)folders * BSA_FOLDER_RECORD_SIZE + file_names.length();
+    for (uint32_t i = 0; i < folders; i++)
+    {
+        uint32_t count = std::min(FILES_PER_FOLDER, files - std::min(files, i * FILES_PER_FOLDER));
+        uint64_t hash = ((uint64_t)index << 32) | i;
+        uint32_t padding = 0;
+        put(&hash, 8);
+        put(&count, 4);
+        put(&padding, 4);
+        put(&offset, 8);
+        offset += 1 + folder_names[i].length() + 1 + (uint64_t)count * BSA_FILE_RECORD_SIZE;
+    }
+
+    uint64_t data_offset = directory_size;
+    for (uint32_t i = 0, file = 0; i < folders; i++)
+    {
+        auto length = (uint8_t)(folder_names[i].length() + 1);
+        put(&length, 1);
+        put(folder_names[i].c_str(), length);
+
+        for (uint32_t j = 0; (j < FILES_PER_FOLDER) && (file < files); j++, file++)
+        {
+            uint64_t hash = ((uint64_t)i << 32) | j;
+            auto data = (uint32_t)data_offset;
+            put(&hash, 8);
+            put(&data_size, 4);
+            put(&data, 4);
+            data_offset += data_size;
+        }
+    }
+
+    out += file_names;
+
+    auto stream = fopen(fname.c_str(), "wb");
+    if (!stream)
+        return false;
+
+    bool result = fwrite(out.data(), 1, out.size(), stream) == out.size();
+
+    // The contents of the files, only the size of the archive matters
+    std::vector<uint8_t> data(PREFETCH_CHUNK, 0xCD);
+    for (auto remaining = data_offset - directory_size; result && remaining;)
+    {
+        auto chunk = (size_t)std::min(remaining, (uint64_t)data.size());
+        result = fwrite(data.data(), 1, chunk, stream) == chunk;
+        remaining -= chunk;
+    }
+
+    return !fclose(stream) && result;
+}
+
+static double run(const std::vector<std::string>& names, uint32_t threads, bool cold, uint64_t& bytes)
+{
+    if (cold)
+        for (auto& name : names)
+            File::DropCache(name);
+
+    std::atomic_size_t next{ 0 };
+    std::vector<std::thread> workers;
+    auto buffer = std::make_unique<uint8_t[]>(PREFETCH_CHUNK);
+
+    auto start = std::chrono::steady_clock::now();
+
+    // The workers take the names in order, so the first archives to register are ready first
+    for (uint32_t i = 0; i < threads; i++)
+        workers.emplace_back([&]()
+            {
+                auto buffer = std::make_unique<uint8_t[]>(PREFETCH_CHUNK);
+                for (auto index = next++; index < names.size(); index = next++)
+                    read_directory(names[index], buffer.get());
+            });
+
+    // The registration, the editor parses the archives one by one
+    bytes = 0;
+    for (auto& name : names)
+        bytes += read_directory(name, buffer.get());
+
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (auto& worker : workers)
+        worker.join();
+
+    return elapsed;
+}
+
+static void usage()
+{
+    fputs(
+        "Usage: archivebench [options] <archive.bsa>...\n"
+        "       archivebench [options] --generate <folder>\n"
+        "  The archives are registered in the given order.\n"
+        "  -t, --threads <count>   prefetch threads (default 4)\n"
+        "      --warm              keep the file cache, measures the CPU side only\n"
+        "  -g, --generate <folder> write synthetic archives to the existing folder and use them\n"
+        "  -a, --archives <count>  synthetic archives (default 32)\n"
+        "  -f, --files <count>     files per synthetic archive (default 20000)\n"
+        "  -d, --data <bytes>      bytes per synthetic file (default 256)\n", stderr);
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> names;
+    std::string generate;
+    uint32_t threads = 4, archives = 32, files = 20000, data_size = 256;
+    bool cold = true;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view arg = argv[i];
+
+        uint32_t* value = nullptr;
+        if ((arg == "-t") || (arg == "--threads"))
+            value = &threads;
+        else if ((arg == "-a") || (arg == "--archives"))
+            value = &archives;
+        else if ((arg == "-f") || (arg == "--files"))
+            value = &files;
+        else if ((arg == "-d") || (arg == "--data"))
+            value = &data_size;
+
+        if (value)
+        {
+            if ((++i >= argc) || (!(*value = (uint32_t)strtoul(argv[i], nullptr, 10)) && (value != &data_size)))
+            {
+                usage();
+                return 1;
+            }
+        }
+        else if ((arg == "-g") || (arg == "--generate"))
+        {
+            if (++i >= argc)
+            {
+                usage();
+                return 1;
+            }
+
+            generate = argv[i];
+        }
+        else if (arg == "--warm")
+            cold = false;
+        else if (!arg.empty() && (arg[0] == '-'))
+        {
+            usage();
+            return 1;
+        }
+        else
+            names.emplace_back(arg);
+    }
+
+    if (!generate.empty())
+    {
+        if (!names.empty())
+        {
+            usage();
+            return 1;
+        }
+
+        for (uint32_t i = 0; i < archives; i++)
+        {
+            char name[32];
+            snprintf(name, sizeof(name), "/Synthetic%03u.bsa", i);
+            names.emplace_back(generate + name);
+
+            if (!write_archive(names.back(), i, files, data_size))
+            {
+                fprintf(stderr, "Can't write \"%s\"\n", names.back().c_str());
+                return 1;
+            }
+        }
+
+        printf("%u synthetic archives of %u files (%u bytes each) in \"%s\"\n", archives, files, data_size,
+            generate.c_str());
+    }
+
+    if (names.empty())
+    {
+        usage();
+        return 1;
+    }
+
+    uint64_t bytes = 0;
+    auto sequential = run(names, 0, cold, bytes);
+    auto prefetched = run(names, threads, cold, bytes);
+
+    printf("%zu archives, %.2f MB of directories, %s\n", names.size(), bytes / 1048576.0,
+        cold ? "cold cache" : "warm cache");
+    printf("  sequential           %9.3f s\n", sequential);
+    printf("  %2u prefetch threads  %9.3f s  %.2fx\n", threads, prefetched, sequential / prefetched);
+
+    return 0;
+}
@@ -0,0 +1,182 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Checks the aggregation of the sampled stacks of the profiler (CKPE.CollapsedStacks.h): the collapsed text
+// of known stacks is compared with the expected lines, then random stacks are compared with a reference that
+// builds the lines directly. Builds on Windows and Linux:
+//   g++ -O2 -std=c++20 -I../../CKPE/Include foldcheck.cpp -o foldcheck
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+
+#include <CKPE.CollapsedStacks.h>
+
+using namespace CKPE;
+
+static size_t failures = 0;
+static size_t checks = 0;
+
+static void check(bool result, const char* what)
+{
+    checks++;
+    if (!result)
+    {
+        fprintf(stderr, "check failed: %s\n", what);
+        failures++;
+    }
+}
+
+static void check_text(const std::string& text, const std::string& expected, const char* what)
+{
+    checks++;
+    if (text != expected)
+    {
+        fprintf(stderr, "check failed: %s\n--- got:\n%s--- expected:\n%s", what, text.c_str(), expected.c_str());
+        failures++;
+    }
+}
+
+// Addresses 0x1000-0x1FFF are "main.exe!f<address / 0x100>", the offsets in a function are dropped
+// as the profiler does, 0x2000 and above have no name
+static std::string frame_name(uintptr_t address)
+{
+    if ((address < 0x1000) || (address >= 0x2000))
+        return "";
+
+    char name[32];
+    snprintf(name, sizeof(name), "main.exe!f%X", (unsigned)(address >> 8));
+    return name;
+}
+
+static std::string thread_name(uint32_t thread)
+{
+    return (thread == 1) ? "main thread" : "thread " + std::to_string(thread);
+}
+
+static void check_known()
+{
+    CollapsedStacks::Aggregator samples;
+
+    // The frames are the leaf first, the line is the root first
+    const uintptr_t a[] = { 0x1310, 0x1220, 0x1100 };
+    const uintptr_t a_other_offsets[] = { 0x1388, 0x12F0, 0x1104 };
+    const uintptr_t b[] = { 0x1410, 0x1100 };
+    const uintptr_t unnamed[] = { 0x1410, 0x2500, 0x1100 };
+
+    samples.Add(1, a, 3);
+    samples.Add(1, a, 3);
+    samples.Add(1, a_other_offsets, 3);
+    samples.Add(1, b, 2, 5);
+    samples.Add(7, b, 2);
+    samples.Add(1, unnamed, 3);
+    // Nothing is added without the frames or the weight
+    samples.Add(1, a, 0);
+    samples.Add(1, a, 3, 0);
+
+    check(samples.GetSamples() == 10, "the count of the samples");
+    check(samples.GetUniqueStacks() == 5, "the count of the unique stacks");
+
+    check_text(samples.Collapse(thread_name, frame_name),
+        "main thread;main.exe!f11;main.exe!f12;main.exe!f13 3\n"
+        "main thread;main.exe!f11;main.exe!f14 6\n"
+        "thread 7;main.exe!f11;main.exe!f14 1\n",
+        "the same functions are merged, the frames without a name are omitted");
+
+    check_text(samples.Collapse([](uint32_t) { return std::string(); }, frame_name),
+        "main.exe!f11;main.exe!f12;main.exe!f13 3\n"
+        "main.exe!f11;main.exe!f14 7\n",
+        "an empty thread name merges the threads");
+
+    check_text(samples.Collapse([](uint32_t thread) { return "thread;" + std::to_string(thread); },
+        [](uintptr_t address) { return ((address >> 8) == 0x11) ? std::string("a;b\nc\r") : frame_name(address); }),
+        "thread_1;a_b_c_;main.exe!f12;main.exe!f13 3\n"
+        "thread_1;a_b_c_;main.exe!f14 6\n"
+        "thread_7;a_b_c_;main.exe!f14 1\n",
+        "the separators in the names are replaced");
+
+    samples.Clear();
+    check(!samples.GetSamples() && !samples.GetUniqueStacks() && samples.Collapse(thread_name, frame_name).empty(),
+        "the aggregator is empty after Clear");
+}
+
+// Random stacks from a few functions of a few threads against the lines built directly
+static void check_random(uint64_t seed, size_t count)
+{
+    std::mt19937_64 rng(seed);
+    CollapsedStacks::Aggregator samples;
+    std::map<std::string, uint64_t> reference;
+    uint64_t total = 0;
+
+    for (size_t n = 0; n < count; n++)
+    {
+        uintptr_t frames[24];
+        auto depth = 1 + rng() % 24;
+        auto thread = (uint32_t)(1 + rng() % 4);
+        auto weight = 1 + rng() % 3;
+
+        for (size_t i = 0; i < depth; i++)
+        {
+            // One in 16 frames has no name
+            frames[i] = (rng() % 16) ? 0x1000 + rng() % 0x800 : 0x2000 + rng() % 0x100;
+        }
+
+        samples.Add(thread, frames, depth, weight);
+        total += weight;
+
+        std::string line = thread_name(thread);
+        for (size_t i = depth; i > 0; i--)
+        {
+            auto name = frame_name(frames[i - 1]);
+            if (!name.empty())
+                line += ";" + name;
+        }
+        reference[line] += weight;
+    }
+
+    std::string expected;
+    for (auto& it : reference)
+        expected += it.first + " " + std::to_string(it.second) + "\n";
+
+    check(samples.GetSamples() == total, "the count of the random samples");
+    check_text(samples.Collapse(thread_name, frame_name), expected, "the random stacks");
+}
+
+static void usage()
+{
+    fputs("usage: foldcheck [options]\n"
+        "  --stacks <n>    random stacks (default 100000)\n"
+        "  --seed <n>      random seed (default 1)\n", stderr);
+}
+
+int main(int argc, char** argv)
+{
+    size_t stacks = 100000;
+    uint64_t seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view arg = argv[i];
+        if ((arg == "--stacks") && ((i + 1) < argc))
+            stacks = strtoull(argv[++i], nullptr, 10);
+        else if ((arg == "--seed") && ((i + 1) < argc))
+            seed = strtoull(argv[++i], nullptr, 10);
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    check_known();
+    check_random(seed, stacks);
+
+    printf("checks: %zu, failures: %zu\n", checks, failures);
+    return failures ? 2 : 0;
+}
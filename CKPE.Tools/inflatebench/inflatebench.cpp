@@ -0,0 +1,281 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Benchmark of the HKInflate decompression (CKPE.SkyrimSE.Patch.LoadOptimization.cpp): a libdeflate decompressor
+// allocated and freed for every record, as it was, against one decompressor per thread reused for every record.
+// The records are the compressed records of the given plugins, or generated ones without them.
+// Builds on Windows and Linux:
+//   g++ -O2 -std=c++20 -I../../Dependencies/libdeflate inflatebench.cpp -ldeflate -o inflatebench
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <libdeflate.h>
+
+struct Record
+{
+    const uint8_t* data;
+    uint32_t size;
+    uint32_t out_size;
+};
+
+static bool read_file(const std::string& fname, std::vector<uint8_t>& data)
+{
+    auto file = fopen(fname.c_str(), "rb");
+    if (!file)
+        return false;
+
+    bool result = !fseek(file, 0, SEEK_END);
+    long size = result ? ftell(file) : -1;
+    result = result && (size >= 0) && !fseek(file, 0, SEEK_SET);
+    if (result)
+    {
+        data.resize((size_t)size);
+        result = fread(data.data(), 1, data.size(), file) == data.size();
+    }
+
+    fclose(file);
+    return result;
+}
+
+static uint32_t read_u32(const uint8_t* data)
+{
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+// Collects the compressed records of a plugin: a record header is 24 bytes (signature, data size, flags, form id,
+// version control, version), a group header is 24 bytes too and its contents follow it. The data of a compressed
+// record starts with the decompressed size, followed by the zlib stream.
+static size_t collect_records(const std::vector<uint8_t>& plugin, std::vector<Record>& records)
+{
+    constexpr uint32_t HEADER_SIZE = 24;
+    constexpr uint32_t FLAG_COMPRESSED = 0x00040000;
+
+    size_t count = 0;
+    for (size_t offset = 0; offset + HEADER_SIZE <= plugin.size();)
+    {
+        auto header = plugin.data() + offset;
+        if (!memcmp(header, "GRUP", 4))
+        {
+            offset += HEADER_SIZE;
+            continue;
+        }
+
+        auto size = read_u32(header + 4);
+        auto flags = read_u32(header + 8);
+        if (offset + HEADER_SIZE + size > plugin.size())
+            break;
+
+        if ((flags & FLAG_COMPRESSED) && (size > 4))
+        {
+            records.push_back({ header + HEADER_SIZE + 4, size - 4, read_u32(header + HEADER_SIZE) });
+            count++;
+        }
+
+        offset += HEADER_SIZE + size;
+    }
+
+    return count;
+}
+
+// Generates records that look like the editor's: a few subrecords with text, form ids and floats.
+static void generate_records(size_t count, std::vector<std::unique_ptr<uint8_t[]>>& storage, std::vector<Record>& records)
+{
+    static const char* words[] = { "Whiterun", "Dragon", "Sword", "Iron", "Steel", "Guard", "Bandit", "Chest",
+        "Potion", "Health", "Magicka", "Stamina", "Road", "Cave", "Tower", "Skyrim" };
+
+    auto compressor = libdeflate_alloc_compressor(6);
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+    auto next = [&seed]() { seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17; return seed; };
+
+    std::string text;
+    for (size_t i = 0; i < count; i++)
+    {
+        text.clear();
+        size_t subrecords = 4 + next() % 60;
+        for (size_t j = 0; j < subrecords; j++)
+        {
+            auto kind = next() % 3;
+            text.append(kind == 0 ? "FULL" : kind == 1 ? "CNTO" : "DATA");
+            if (kind == 0)
+            {
+                for (auto n = 1 + next() % 4; n; n--)
+                    text.append(words[next() % 16]).push_back(' ');
+                text.push_back('\0');
+            }
+            else
+            {
+                uint32_t value = (uint32_t)next() % (kind == 1 ? 0x100000u : 1000u);
+                text.append((const char*)&value, sizeof(value));
+            }
+        }
+
+        auto bound = libdeflate_zlib_compress_bound(compressor, text.size());
+        auto data = std::make_unique<uint8_t[]>(bound);
+        auto size = libdeflate_zlib_compress(compressor, text.data(), text.size(), data.get(), bound);
+        records.push_back({ data.get(), (uint32_t)size, (uint32_t)text.size() });
+        storage.emplace_back(std::move(data));
+    }
+
+    libdeflate_free_compressor(compressor);
+}
+
+static bool inflate_records(const std::vector<Record>& records, size_t passes, bool reuse)
+{
+    std::vector<uint8_t> buffer;
+    libdeflate_decompressor* decompressor = reuse ? libdeflate_alloc_decompressor() : nullptr;
+    bool result = true;
+
+    for (size_t pass = 0; pass < passes; pass++)
+    {
+        for (auto& record : records)
+        {
+            if (buffer.size() < record.out_size)
+                buffer.resize(record.out_size);
+
+            if (!reuse)
+                decompressor = libdeflate_alloc_decompressor();
+
+            size_t out_size = 0;
+            result = result && decompressor &&
+                (libdeflate_zlib_decompress(decompressor, record.data, record.size, buffer.data(), record.out_size,
+                    &out_size) == LIBDEFLATE_SUCCESS) && (out_size == record.out_size);
+
+            if (!reuse)
+                libdeflate_free_decompressor(decompressor);
+        }
+    }
+
+    if (reuse)
+        libdeflate_free_decompressor(decompressor);
+
+    return result;
+}
+
+static double run(const std::vector<Record>& records, size_t passes, size_t threads, bool reuse, bool& result)
+{
+    std::vector<std::thread> workers;
+    std::vector<char> results(threads, 1);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < threads; i++)
+        workers.emplace_back([&, i]() { results[i] = inflate_records(records, passes, reuse); });
+    for (auto& worker : workers)
+        worker.join();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (auto value : results)
+        result = result && value;
+
+    return elapsed;
+}
+
+static void usage()
+{
+    fputs(
+        "Usage: inflatebench [options] [<plugin>...]\n"
+        "  Without plugins the records are generated.\n"
+        "  -n, --records <count>   number of generated records (default 100000)\n"
+        "  -p, --passes <count>    passes over the records per thread (default 3)\n"
+        "  -t, --threads <count>   decompressing threads (default 1)\n", stderr);
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::unique_ptr<std::vector<uint8_t>>> files;
+    std::vector<std::unique_ptr<uint8_t[]>> storage;
+    std::vector<Record> records;
+    size_t count = 100000, passes = 3, threads = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view arg = argv[i];
+
+        size_t* value = nullptr;
+        if ((arg == "-n") || (arg == "--records"))
+            value = &count;
+        else if ((arg == "-p") || (arg == "--passes"))
+            value = &passes;
+        else if ((arg == "-t") || (arg == "--threads"))
+            value = &threads;
+        else if (!arg.empty() && (arg[0] == '-'))
+        {
+            usage();
+            return 1;
+        }
+        else
+        {
+            auto data = std::make_unique<std::vector<uint8_t>>();
+            if (!read_file(argv[i], *data))
+            {
+                fprintf(stderr, "Can't read %s\n", argv[i]);
+                return 1;
+            }
+
+            auto found = collect_records(*data, records);
+            fprintf(stderr, "%s: %zu compressed records\n", argv[i], found);
+            files.emplace_back(std::move(data));
+            continue;
+        }
+
+        if ((++i >= argc) || !(*value = strtoull(argv[i], nullptr, 10)))
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if (files.empty())
+        generate_records(count, storage, records);
+
+    if (records.empty())
+    {
+        fputs("No compressed records\n", stderr);
+        return 1;
+    }
+
+    uint64_t in_bytes = 0, out_bytes = 0;
+    for (auto& record : records)
+    {
+        in_bytes += record.size;
+        out_bytes += record.out_size;
+    }
+
+    printf("%zu records, %.2f MB compressed, %.2f MB decompressed, %zu passes, %zu threads\n", records.size(),
+        in_bytes / 1048576.0, out_bytes / 1048576.0, passes, threads);
+
+    bool result = true;
+    // Warm up the allocator and the caches
+    run(records, 1, threads, true, result);
+
+    auto total = (double)records.size() * passes;
+    auto per_call = run(records, passes, threads, false, result);
+    auto reused = run(records, passes, threads, true, result);
+
+    if (!result)
+    {
+        fputs("Decompression failed\n", stderr);
+        return 1;
+    }
+
+    auto megabytes = out_bytes / 1048576.0 * passes * threads;
+    printf("  alloc per call  %9.3f s  %8.1f ns/record  %8.1f MB/s\n", per_call, per_call * 1e9 / (total * threads),
+        megabytes / per_call);
+    printf("  reused          %9.3f s  %8.1f ns/record  %8.1f MB/s\n", reused, reused * 1e9 / (total * threads),
+        megabytes / reused);
+    printf("  speedup         %9.2fx\n", per_call / reused);
+
+    return 0;
+}
@@ -0,0 +1,281 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Checks the INI parser of Common::INIIndex (CKPE.INIParser.h): the lookups in the sample INIs are compared
+// with the values listed in samples/expected.txt, then every key of the samples and of the other given INI files
+// is compared with a line by line reference scan, with both syntaxes. Builds on Windows and Linux:
+//   g++ -O2 -std=c++20 -I../../CKPE/Include inicheck.cpp -o inicheck
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <CKPE.INIParser.h>
+
+using namespace CKPE;
+
+static bool read_file(const std::string& fname, std::string& text)
+{
+    auto file = fopen(fname.c_str(), "rb");
+    if (!file)
+        return false;
+
+    char buffer[4096];
+    size_t readed;
+    text.clear();
+    while ((readed = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        text.append(buffer, readed);
+
+    fclose(file);
+    return true;
+}
+
+struct Index
+{
+    std::string text;
+    std::vector<INIParser::Entry> entries;
+
+    bool open(const std::string& fname, INIParser::Syntax syntax)
+    {
+        if (!read_file(fname, text))
+            return false;
+
+        // Parse needs the null after the last byte, std::string has it
+        INIParser::Parse(text.data(), text.length(), syntax, entries);
+        return true;
+    }
+
+    bool find(std::string_view section, std::string_view key, std::string& value) const
+    {
+        auto entry = INIParser::Find(text.c_str(), entries, section, key);
+        if (!entry)
+            return false;
+
+        value.assign(text.c_str() + entry->value, entry->value_length);
+        return true;
+    }
+};
+
+static std::string lower(std::string_view s)
+{
+    std::string r(s);
+    for (auto& c : r)
+        c = INIParser::ToLowerASCII(c);
+    return r;
+}
+
+static std::string_view trim(std::string_view s)
+{
+    while (!s.empty() && ((s.front() == ' ') || (s.front() == '\t') || (s.front() == '\r')))
+        s.remove_prefix(1);
+    while (!s.empty() && ((s.back() == ' ') || (s.back() == '\t') || (s.back() == '\r')))
+        s.remove_suffix(1);
+    return s;
+}
+
+// Reference: the file is read line by line with std::string, the key is "section\nkey" in lower case
+static void reference_scan(const std::string& text, INIParser::Syntax syntax,
+    std::map<std::string, std::string>& values)
+{
+    std::string_view rest(text);
+    if ((rest.size() >= 3) && !memcmp(rest.data(), "\xEF\xBB\xBF", 3))
+        rest.remove_prefix(3);
+
+    std::string section;
+    bool has_section = false;
+    values.clear();
+
+    while (!rest.empty())
+    {
+        auto eol = rest.find('\n');
+        auto line = trim(rest.substr(0, eol));
+        rest = (eol == std::string_view::npos) ? std::string_view() : rest.substr(eol + 1);
+
+        if (line.empty() || (line[0] == ';') || (line[0] == '#'))
+            continue;
+
+        if (line[0] == '[')
+        {
+            auto close = line.find(']');
+            section = lower(trim(line.substr(1, (close == std::string_view::npos) ? close : close - 1)));
+            has_section = true;
+            continue;
+        }
+
+        auto split = (syntax == INIParser::Syntax::Settings) ? line.find_first_of("=:") : line.find('=');
+        if ((split == std::string_view::npos) || !has_section)
+            continue;
+
+        auto key = trim(line.substr(0, split));
+        if (key.empty())
+            continue;
+
+        auto name = section + "\n" + lower(key);
+        if ((syntax == INIParser::Syntax::Settings) || !values.count(name))
+            values[name] = std::string(trim(line.substr(split + 1)));
+    }
+}
+
+static size_t failures = 0;
+static size_t checks = 0;
+
+static void check_reference(const std::string& fname, INIParser::Syntax syntax)
+{
+    const char* syntax_name = (syntax == INIParser::Syntax::Settings) ? "settings" : "profile";
+
+    Index index;
+    std::map<std::string, std::string> values;
+    if (!index.open(fname, syntax))
+    {
+        fprintf(stderr, "Can't read \"%s\"\n", fname.c_str());
+        failures++;
+        return;
+    }
+
+    // Parse writes nulls in the text, the reference is done on a copy of the file
+    std::string text;
+    read_file(fname, text);
+    reference_scan(text, syntax, values);
+
+    if (values.size() != index.entries.size())
+    {
+        fprintf(stderr, "%s (%s): %zu keys, the reference has %zu\n", fname.c_str(), syntax_name,
+            index.entries.size(), values.size());
+        failures++;
+    }
+
+    for (auto& [name, expected] : values)
+    {
+        auto split = name.find('\n');
+        // The upper case lookup must find the same key
+        std::string section = name.substr(0, split), key = name.substr(split + 1), value;
+        for (auto& c : key)
+            c = (char)toupper((unsigned char)c);
+
+        checks++;
+        if (!index.find(section, key, value) || (value != expected))
+        {
+            fprintf(stderr, "%s (%s): [%s] %s: \"%s\", the reference has \"%s\"\n", fname.c_str(), syntax_name,
+                section.c_str(), key.c_str(), value.c_str(), expected.c_str());
+            failures++;
+        }
+    }
+}
+
+static bool check_expected(const std::string& dir)
+{
+    std::string text;
+    if (!read_file(dir + "/expected.txt", text))
+    {
+        fprintf(stderr, "Can't read \"%s/expected.txt\"\n", dir.c_str());
+        return false;
+    }
+
+    std::set<std::string> files;
+    std::string_view rest(text);
+    while (!rest.empty())
+    {
+        auto eol = rest.find('\n');
+        auto line = rest.substr(0, eol);
+        rest = (eol == std::string_view::npos) ? std::string_view() : rest.substr(eol + 1);
+        if (!line.empty() && (line.back() == '\r'))
+            line.remove_suffix(1);
+        if (line.empty() || (line[0] == '#'))
+            continue;
+
+        // file|syntax|section|key|value, the value is the rest of the line
+        std::string_view fields[5];
+        for (size_t i = 0; i < 4; i++)
+        {
+            auto split = line.find('|');
+            if (split == std::string_view::npos)
+            {
+                fprintf(stderr, "Wrong line in expected.txt: \"%.*s\"\n", (int)line.length(), line.data());
+                return false;
+            }
+
+            fields[i] = line.substr(0, split);
+            line.remove_prefix(split + 1);
+        }
+        fields[4] = line;
+
+        auto fname = dir + "/" + std::string(fields[0]);
+        auto syntax = (fields[1] == "settings") ? INIParser::Syntax::Settings : INIParser::Syntax::Profile;
+        files.insert(fname);
+
+        Index index;
+        if (!index.open(fname, syntax))
+        {
+            fprintf(stderr, "Can't read \"%s\"\n", fname.c_str());
+            return false;
+        }
+
+        std::string value;
+        bool found = index.find(fields[2], fields[3], value);
+        bool missing = fields[4] == "<missing>";
+
+        checks++;
+        if ((found == missing) || (found && (value != fields[4])))
+        {
+            fprintf(stderr, "%s (%.*s): [%.*s] %.*s: %s%s%s, expected %.*s\n", fname.c_str(),
+                (int)fields[1].length(), fields[1].data(), (int)fields[2].length(), fields[2].data(),
+                (int)fields[3].length(), fields[3].data(), found ? "\"" : "", found ? value.c_str() : "<missing>",
+                found ? "\"" : "", (int)fields[4].length(), fields[4].data());
+            failures++;
+        }
+    }
+
+    for (auto& fname : files)
+    {
+        check_reference(fname, INIParser::Syntax::Profile);
+        check_reference(fname, INIParser::Syntax::Settings);
+    }
+
+    return true;
+}
+
+static void usage()
+{
+    fputs("usage: inicheck <samples dir> [<file.ini> ...]\n"
+        "  the samples dir has the INI files and expected.txt, the other INI files (for example the ones\n"
+        "  of the game folder) are only compared with the reference scan\n", stderr);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        usage();
+        return 1;
+    }
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] == '-')
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if (!check_expected(argv[1]))
+        return 1;
+
+    for (int i = 2; i < argc; i++)
+    {
+        check_reference(argv[i], INIParser::Syntax::Profile);
+        check_reference(argv[i], INIParser::Syntax::Settings);
+    }
+
+    printf("checks: %zu, failures: %zu\n", checks, failures);
+    return failures ? 2 : 0;
+}
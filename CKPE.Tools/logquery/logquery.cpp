@@ -0,0 +1,661 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Query tool for the structured CKPE log (sStructuredLogFile, JSON Lines) and its index (<log>.idx).
+// --check runs the checks of the key extraction. Builds on Windows and Linux:
+//   g++ -O2 -std=c++20 -I../../CKPE/Include logquery.cpp -o logquery
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+
+#include <CKPE.LogIndex.h>
+
+using namespace CKPE;
+
+class MappedFile
+{
+    const char* _data = nullptr;
+    uint64_t _size = 0;
+#ifdef _WIN32
+    HANDLE _file = INVALID_HANDLE_VALUE;
+    HANDLE _mapping = nullptr;
+#endif
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        if (_data) UnmapViewOfFile(_data);
+        if (_mapping) CloseHandle(_mapping);
+        if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file);
+#else
+        if (_data) munmap((void*)_data, (size_t)_size);
+#endif
+    }
+
+    bool open(const std::string& fname)
+    {
+#ifdef _WIN32
+        // The editor may still be writing the log
+        _file = CreateFileA(fname.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (_file == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(_file, &size))
+            return false;
+
+        _size = (uint64_t)size.QuadPart;
+        if (!_size)
+            return true;
+
+        _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!_mapping)
+            return false;
+
+        _data = (const char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+        return _data != nullptr;
+#else
+        int fd = ::open(fname.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat st;
+        if (fstat(fd, &st))
+        {
+            close(fd);
+            return false;
+        }
+
+        _size = (uint64_t)st.st_size;
+        if (_size)
+        {
+            auto data = mmap(nullptr, (size_t)_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                madvise(data, (size_t)_size, MADV_SEQUENTIAL);
+                _data = (const char*)data;
+            }
+        }
+
+        close(fd);
+        return !_size || _data;
+#endif
+    }
+
+    const char* data() const { return _data; }
+    uint64_t size() const { return _size; }
+};
+
+struct Query
+{
+    bool has_formid = false;
+    uint32_t formid = 0;
+    std::string plugin;             // Lower case, as typed
+    std::string plugin_key;         // Lower case, the word the index knows it by
+    int severity = 0;
+    std::string source;
+    std::string text;               // Lower case
+    bool count_only = false;
+    bool raw = false;
+    bool use_index = true;
+};
+
+static const char* SEVERITY_NAMES[] = { "info", "warning", "error", "fatal" };
+
+static int severity_from_name(std::string_view name)
+{
+    for (int i = 0; i < 4; i++)
+        if (name == SEVERITY_NAMES[i])
+            return i;
+    return -1;
+}
+
+// Fields of a line written by Logger::WriteStructured, the order of the keys is fixed
+struct LineFields
+{
+    uint64_t time = 0;
+    uint32_t thread = 0;
+    std::string_view severity;
+    std::string_view source;
+    std::string_view message;       // Still escaped
+};
+
+static bool extract_string(std::string_view line, std::string_view key, std::string_view& value)
+{
+    auto pos = line.find(key);
+    if (pos == std::string_view::npos)
+        return false;
+
+    pos += key.size();
+    auto end = pos;
+    while ((end < line.size()) && (line[end] != '"'))
+        end += (line[end] == '\\') ? 2 : 1;
+
+    if (end > line.size())
+        return false;
+
+    value = line.substr(pos, end - pos);
+    return true;
+}
+
+static bool parse_line(std::string_view line, LineFields& fields)
+{
+    if (line.size() < 2 || line[0] != '{')
+        return false;
+
+    auto pos = line.find("\"t\":");
+    if (pos != std::string_view::npos)
+        fields.time = strtoull(line.data() + pos + 4, nullptr, 10);
+
+    pos = line.find("\"tid\":");
+    if (pos != std::string_view::npos)
+        fields.thread = (uint32_t)strtoul(line.data() + pos + 6, nullptr, 10);
+
+    return extract_string(line, "\"sev\":\"", fields.severity) &&
+        extract_string(line, "\"src\":\"", fields.source) &&
+        extract_string(line, "\"msg\":\"", fields.message);
+}
+
+static void unescape(std::string_view text, std::string& out)
+{
+    out.clear();
+    out.reserve(text.size());
+
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        auto ch = text[i];
+        if ((ch != '\\') || (i + 1 >= text.size()))
+        {
+            out.push_back(ch);
+            continue;
+        }
+
+        ch = text[++i];
+        switch (ch)
+        {
+        case 'n': out.push_back('\n'); break;
+        case 'r': out.push_back('\r'); break;
+        case 't': out.push_back('\t'); break;
+        case 'u':
+            if (i + 4 < text.size())
+            {
+                out.push_back((char)strtoul(std::string(text.substr(i + 1, 4)).c_str(), nullptr, 16));
+                i += 4;
+            }
+            break;
+        default: out.push_back(ch); break;
+        }
+    }
+}
+
+static bool contains_lower(std::string_view haystack, std::string_view needle_lower)
+{
+    if (needle_lower.empty())
+        return true;
+
+    if (haystack.size() < needle_lower.size())
+        return false;
+
+    auto first = needle_lower[0];
+    for (size_t i = 0, last = haystack.size() - needle_lower.size(); i <= last; i++)
+    {
+        auto ch = haystack[i];
+        if ((ch >= 'A') && (ch <= 'Z'))
+            ch = (char)(ch - 'A' + 'a');
+        if (ch != first)
+            continue;
+
+        size_t j = 1;
+        for (; j < needle_lower.size(); j++)
+        {
+            auto c = haystack[i + j];
+            if ((c >= 'A') && (c <= 'Z'))
+                c = (char)(c - 'A' + 'a');
+            if (c != needle_lower[j])
+                break;
+        }
+
+        if (j == needle_lower.size())
+            return true;
+    }
+
+    return false;
+}
+
+class Matcher
+{
+    const Query& _query;
+    std::string _message;
+    uint64_t _matches = 0;
+public:
+    explicit Matcher(const Query& query) : _query(query) {}
+
+    uint64_t matches() const { return _matches; }
+
+    // verify_keys: the line did not come from the index, check the form id and the plugin
+    void process(std::string_view line, bool verify_keys)
+    {
+        LineFields fields;
+        if (!parse_line(line, fields))
+            return;
+
+        if (_query.severity && (severity_from_name(fields.severity) < _query.severity))
+            return;
+
+        if (!_query.source.empty() && (fields.source != _query.source))
+            return;
+
+        // Cheap rejections on the escaped text before unescaping it
+        if (!_query.text.empty() && !contains_lower(fields.message, _query.text) &&
+            (fields.message.find('\\') == std::string_view::npos))
+            return;
+
+        unescape(fields.message, _message);
+
+        if (!_query.text.empty() && !contains_lower(_message, _query.text))
+            return;
+
+        // Plugins with spaces are indexed by their last word
+        if (!_query.plugin.empty() && (verify_keys || (_query.plugin != _query.plugin_key)) &&
+            !contains_lower(_message, _query.plugin))
+            return;
+
+        if (_query.has_formid && verify_keys)
+        {
+            bool found = false;
+            LogIndex::ExtractKeys(_message, [&](uint32_t formid) { found = found || (formid == _query.formid); },
+                [](std::string_view) {});
+            if (!found)
+                return;
+        }
+
+        _matches++;
+        if (_query.count_only)
+            return;
+
+        if (_query.raw)
+        {
+            fwrite(line.data(), 1, line.size(), stdout);
+            fputc('\n', stdout);
+            return;
+        }
+
+        auto seconds = (time_t)(fields.time / 1000);
+        struct tm tm_time;
+#ifdef _WIN32
+        localtime_s(&tm_time, &seconds);
+#else
+        localtime_r(&seconds, &tm_time);
+#endif
+        char time_text[32];
+        strftime(time_text, sizeof(time_text), "%Y-%m-%d %H:%M:%S", &tm_time);
+
+        printf("%s.%03u %5u %-7.*s %-8.*s %s\n", time_text, (unsigned)(fields.time % 1000), fields.thread,
+            (int)fields.severity.size(), fields.severity.data(), (int)fields.source.size(), fields.source.data(),
+            _message.c_str());
+    }
+};
+
+static void scan_range(const char* data, uint64_t begin, uint64_t end, Matcher& matcher)
+{
+    auto pos = begin;
+    while (pos < end)
+    {
+        auto eol = (const char*)memchr(data + pos, '\n', (size_t)(end - pos));
+        auto line_end = eol ? (uint64_t)(eol - data) : end;
+        matcher.process(std::string_view(data + pos, (size_t)(line_end - pos)), true);
+        pos = line_end + 1;
+    }
+}
+
+static void process_offset(const char* data, uint64_t size, uint64_t offset, Matcher& matcher, bool verify)
+{
+    if (offset >= size)
+        return;
+
+    auto eol = (const char*)memchr(data + offset, '\n', (size_t)(size - offset));
+    auto line_end = eol ? (uint64_t)(eol - data) : size;
+    matcher.process(std::string_view(data + offset, (size_t)(line_end - offset)), verify);
+}
+
+// Looks the query up in one segment of the index, returns false when the segment is cut off (a crashed session)
+static bool query_segment(const char* base, uint64_t available, const LogIndex::Header& header, const Query& query,
+    std::vector<uint64_t>& result)
+{
+    if (LogIndex::SegmentSize(header) > available)
+        return false;
+
+    auto formids_offset = sizeof(LogIndex::Header);
+    auto plugins_offset = formids_offset + (uint64_t)header.formid_count * sizeof(LogIndex::FormIdEntry);
+    auto postings_offset = plugins_offset + (uint64_t)header.plugin_count * sizeof(LogIndex::PluginEntry);
+    auto names_offset = postings_offset + header.postings_count * sizeof(uint64_t);
+
+    auto read_postings = [&](uint64_t first, uint32_t count)
+        {
+            std::vector<uint64_t> list((size_t)count);
+            if (count && ((first + count) <= header.postings_count))
+                memcpy(list.data(), base + postings_offset + first * sizeof(uint64_t), (size_t)count * sizeof(uint64_t));
+            return list;
+        };
+
+    std::vector<uint64_t> found;
+    bool has_result = false;
+
+    if (query.has_formid)
+    {
+        size_t lo = 0, hi = header.formid_count;
+        while (lo < hi)
+        {
+            auto mid = (lo + hi) / 2;
+            LogIndex::FormIdEntry entry;
+            memcpy(&entry, base + formids_offset + mid * sizeof(entry), sizeof(entry));
+            if (entry.formid < query.formid)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        LogIndex::FormIdEntry entry{};
+        if (lo < header.formid_count)
+            memcpy(&entry, base + formids_offset + lo * sizeof(entry), sizeof(entry));
+
+        found = (entry.formid == query.formid) ? read_postings(entry.first, entry.count) : std::vector<uint64_t>{};
+        has_result = true;
+    }
+
+    if (!query.plugin_key.empty())
+    {
+        size_t lo = 0, hi = header.plugin_count;
+        auto names = std::string_view(base + names_offset, (size_t)header.names_size);
+        auto name_of = [&](size_t i)
+            {
+                LogIndex::PluginEntry entry;
+                memcpy(&entry, base + plugins_offset + i * sizeof(entry), sizeof(entry));
+                return std::make_pair(entry, names.substr(entry.name_offset, entry.name_length));
+            };
+
+        while (lo < hi)
+        {
+            auto mid = (lo + hi) / 2;
+            if (name_of(mid).second < query.plugin_key)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        std::vector<uint64_t> list;
+        if (lo < header.plugin_count)
+        {
+            auto entry = name_of(lo);
+            if (entry.second == query.plugin_key)
+                list = read_postings(entry.first.first, entry.first.count);
+        }
+
+        if (has_result)
+        {
+            std::vector<uint64_t> both;
+            std::set_intersection(found.begin(), found.end(), list.begin(), list.end(), std::back_inserter(both));
+            found.swap(both);
+        }
+        else
+            found.swap(list);
+    }
+
+    // The segments follow the log, so the offsets stay sorted
+    result.insert(result.end(), found.begin(), found.end());
+    return true;
+}
+
+// Returns false when the index is missing or does not fit this log.
+// The segments are read up to the first one that is cut off, the log after them is scanned.
+static bool query_index(const std::string& index_name, uint64_t size, const Query& query,
+    std::vector<uint64_t>& offsets, uint64_t& indexed_size)
+{
+    MappedFile index;
+    if (!index.open(index_name))
+        return false;
+
+    std::vector<uint64_t> result;
+    uint64_t covered = 0;
+    uint64_t pos = 0;
+
+    while ((pos + sizeof(LogIndex::Header)) <= index.size())
+    {
+        LogIndex::Header header;
+        memcpy(&header, index.data() + pos, sizeof(header));
+        if (memcmp(header.magic, LogIndex::MAGIC, sizeof(LogIndex::MAGIC)) || (header.log_size > size) ||
+            (header.log_size < covered))
+            break;
+
+        if (!query_segment(index.data() + pos, index.size() - pos, header, query, result))
+            break;
+
+        covered = header.log_size;
+        pos += LogIndex::SegmentSize(header);
+    }
+
+    if (!pos)
+        return false;
+
+    offsets.swap(result);
+    indexed_size = covered;
+    return true;
+}
+
+static size_t failures = 0;
+static size_t checks = 0;
+
+static void check_keys(std::string_view message, std::vector<uint32_t> expected_formids,
+    std::vector<std::string> expected_plugins)
+{
+    std::vector<uint32_t> formids;
+    std::vector<std::string> plugins;
+    LogIndex::ExtractKeys(message, [&](uint32_t formid) { formids.push_back(formid); },
+        [&](std::string_view plugin) { plugins.emplace_back(plugin); });
+
+    checks++;
+    if ((formids != expected_formids) || (plugins != expected_plugins))
+    {
+        fprintf(stderr, "check failed: \"%.*s\": %zu form ids and %zu plugins, expected %zu and %zu\n",
+            (int)message.size(), message.data(), formids.size(), plugins.size(), expected_formids.size(),
+            expected_plugins.size());
+        failures++;
+    }
+}
+
+// The full scan must find the lines that the index finds
+static void check_scan(std::string_view line, uint32_t formid, uint64_t expected)
+{
+    Query query;
+    query.has_formid = true;
+    query.formid = formid;
+    query.count_only = true;
+
+    Matcher matcher(query);
+    matcher.process(line, true);
+
+    checks++;
+    if (matcher.matches() != expected)
+    {
+        fprintf(stderr, "check failed: %08X in \"%.*s\": %llu matches, expected %llu\n", formid,
+            (int)line.size(), line.data(), (unsigned long long)matcher.matches(), (unsigned long long)expected);
+        failures++;
+    }
+}
+
+static int run_checks()
+{
+    check_keys("form 0001A2B3 is missing", { 0x0001A2B3 }, {});
+    check_keys("form 0x0001A2B3 is missing", { 0x0001A2B3 }, {});
+    check_keys("form 0X0001a2b3, ref (0x00000014)", { 0x0001A2B3, 0x00000014 }, {});
+    check_keys("0x0001A2B3C 00001A2B3 0x001A2B3 0y0001A2B3 00x01A2B3 x0001A2B3", {}, {});
+    check_keys("0x0001A2B3 in 'Skyrim.esm' and Update.ESM", { 0x0001A2B3 }, { "Skyrim.esm", "Update.ESM" });
+
+    check_scan("{\"t\":1,\"tid\":2,\"sev\":\"warning\",\"src\":\"ckpe\",\"msg\":\"form 0x0001A2B3 is missing\"}",
+        0x0001A2B3, 1);
+    check_scan("{\"t\":1,\"tid\":2,\"sev\":\"warning\",\"src\":\"ckpe\",\"msg\":\"form 0001A2B3 is missing\"}",
+        0x0001A2B3, 1);
+    check_scan("{\"t\":1,\"tid\":2,\"sev\":\"warning\",\"src\":\"ckpe\",\"msg\":\"form 0x0001A2B4 is missing\"}",
+        0x0001A2B3, 0);
+
+    printf("checks: %zu, failures: %zu\n", checks, failures);
+    return failures ? 2 : 0;
+}
+
+static void usage()
+{
+    fputs(
+        "Usage: logquery <log> [options]\n"
+        "  -f, --formid <hex>      lines that mention the form id\n"
+        "  -p, --plugin <name>     lines that mention the plugin\n"
+        "  -s, --severity <level>  minimum severity: info, warning, error, fatal\n"
+        "  -S, --source <name>     only lines from this source: ckpe, console\n"
+        "  -t, --text <substring>  lines that contain the text (case insensitive)\n"
+        "  -c, --count             print only the number of matching lines\n"
+        "  -r, --raw               print the JSON lines as they are\n"
+        "      --no-index          do not use <log>.idx\n"
+        "      --stats             print the time spent to stderr\n"
+        "      --check             check the extraction of the form ids and plugins, then exit\n", stderr);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        usage();
+        return 1;
+    }
+
+    std::string log_name;
+    Query query;
+    bool stats = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view arg = argv[i];
+        auto value = [&]() -> const char*
+            {
+                if (i + 1 >= argc)
+                {
+                    fprintf(stderr, "Missing value for %s\n", argv[i]);
+                    exit(1);
+                }
+                return argv[++i];
+            };
+
+        if ((arg == "-f") || (arg == "--formid"))
+        {
+            query.has_formid = true;
+            query.formid = (uint32_t)strtoul(value(), nullptr, 16);
+        }
+        else if ((arg == "-p") || (arg == "--plugin"))
+        {
+            query.plugin = LogIndex::ToLower(value());
+            LogIndex::ExtractKeys(query.plugin, [](uint32_t) {},
+                [&](std::string_view key) { query.plugin_key = std::string(key); });
+            if (query.plugin_key.empty())
+            {
+                fprintf(stderr, "Not a plugin name: %s\n", query.plugin.c_str());
+                return 1;
+            }
+        }
+        else if ((arg == "-s") || (arg == "--severity"))
+        {
+            query.severity = severity_from_name(LogIndex::ToLower(value()));
+            if (query.severity < 0)
+            {
+                usage();
+                return 1;
+            }
+        }
+        else if ((arg == "-S") || (arg == "--source"))
+            query.source = value();
+        else if ((arg == "-t") || (arg == "--text"))
+            query.text = LogIndex::ToLower(value());
+        else if ((arg == "-c") || (arg == "--count"))
+            query.count_only = true;
+        else if ((arg == "-r") || (arg == "--raw"))
+            query.raw = true;
+        else if (arg == "--no-index")
+            query.use_index = false;
+        else if (arg == "--stats")
+            stats = true;
+        else if (arg == "--check")
+            return run_checks();
+        else if (log_name.empty() && (arg[0] != '-'))
+            log_name = arg;
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    MappedFile log;
+    if (!log.open(log_name))
+    {
+        fprintf(stderr, "Can't open \"%s\"\n", log_name.c_str());
+        return 1;
+    }
+
+    static char out_buffer[1 << 16];
+    setvbuf(stdout, out_buffer, _IOFBF, sizeof(out_buffer));
+
+    Matcher matcher(query);
+    std::vector<uint64_t> offsets;
+    uint64_t indexed_size = 0;
+    bool indexed = false;
+
+    if (query.use_index && (query.has_formid || !query.plugin_key.empty()))
+        indexed = query_index(log_name + ".idx", log.size(), query, offsets, indexed_size);
+
+    if (indexed)
+    {
+        for (auto offset : offsets)
+            process_offset(log.data(), indexed_size, offset, matcher, false);
+
+        // Lines written after the index
+        scan_range(log.data(), indexed_size, log.size(), matcher);
+    }
+    else
+        scan_range(log.data(), 0, log.size(), matcher);
+
+    if (query.count_only)
+        printf("%llu\n", (unsigned long long)matcher.matches());
+
+    fflush(stdout);
+
+    if (stats)
+        fprintf(stderr, "%llu matches, %s, %.3f ms\n", (unsigned long long)matcher.matches(),
+            indexed ? "index" : "full scan", std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count());
+
+    return 0;
+}
@@ -0,0 +1,451 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Symbolizes addresses against PE32+ files on disk the same way the crash handler does with the loaded modules
+// (CKPE.PESymbolizer.h), to check the crash logs and the symbolizer itself. --check runs the checks
+// of the symbolizer and of the stack unwinding on synthetic images. Builds on Windows and Linux:
+//   g++ -O2 -std=c++20 -I../../CKPE/Include pesym.cpp -o pesym
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <CKPE.PESymbolizer.h>
+
+using namespace CKPE;
+
+static bool read_file(const std::string& fname, std::vector<uint8_t>& data)
+{
+    auto file = fopen(fname.c_str(), "rb");
+    if (!file)
+        return false;
+
+    bool result = !fseek(file, 0, SEEK_END);
+    auto size = result ? ftell(file) : -1;
+    result = (size > 0) && !fseek(file, 0, SEEK_SET);
+    if (result)
+    {
+        data.resize((size_t)size);
+        result = fread(data.data(), 1, data.size(), file) == data.size();
+    }
+
+    fclose(file);
+    return result;
+}
+
+static std::string_view file_name(std::string_view path)
+{
+    auto slash = path.find_last_of("\\/");
+    return (slash == std::string_view::npos) ? path : path.substr(slash + 1);
+}
+
+static void print_symbol(const PESymbolizer::ModuleTable& table, uint64_t address)
+{
+    PESymbolizer::Symbol symbol;
+    if (!table.Symbolize(address, symbol))
+    {
+        printf("0x%016llX <unknown>\n", (unsigned long long)address);
+        return;
+    }
+
+    printf("0x%016llX %s+%X", (unsigned long long)address, symbol.module->name.c_str(), symbol.rva);
+
+    if (symbol.has_function)
+    {
+        auto& function = symbol.function;
+        if (function.fragment_begin == function.begin)
+            printf(" sub_%X+%X", function.begin, symbol.rva - function.begin);
+        else
+            printf(" sub_%X (part %X)+%X", function.begin, function.fragment_begin, symbol.rva - function.fragment_begin);
+    }
+    else if (symbol.code)
+        printf(" <no unwind info>");
+    else
+        printf(" <data>");
+
+    putchar('\n');
+}
+
+// Loaded image for the checks: the headers, .text at 0x1000 filled with int3, .pdata at 0x2000
+// and the unwind info at 0x2800
+class TestImage
+{
+    std::vector<uint8_t> _data = std::vector<uint8_t>(0x3000, 0xCC);
+    uint32_t _count_functions = 0;
+    uint32_t _unwind = 0x2800;
+public:
+    TestImage()
+    {
+        memset(_data.data(), 0, 0x1000);
+        put(0, { 'M', 'Z' });
+        put32(0x3C, 0x40);
+        put32(0x40, PESymbolizer::NT_SIGNATURE);
+        // File header: x64, one section, the optional header of PE32+
+        put(0x44, { 0x64, 0x86, 1, 0 });
+        put(0x54, { 240, 0 });
+        put(0x58, { 0x0B, 0x02 });
+        put32(0x58 + 56, (uint32_t)_data.size());
+        put32(0x58 + 108, 16);
+        put32(0x58 + 112 + PESymbolizer::DIRECTORY_EXCEPTION * 8, 0x2000);
+        // .text
+        put(0x148, { '.', 't', 'e', 'x', 't' });
+        put32(0x148 + 8, 0x1000);
+        put32(0x148 + 12, 0x1000);
+        put32(0x148 + 16, 0x1000);
+        put32(0x148 + 20, 0x1000);
+        put32(0x148 + 36, PESymbolizer::SCN_CNT_CODE | PESymbolizer::SCN_MEM_EXECUTE);
+    }
+
+    void put(uint32_t rva, std::initializer_list<uint8_t> bytes)
+    {
+        memcpy(_data.data() + rva, bytes.begin(), bytes.size());
+    }
+
+    void put32(uint32_t rva, uint32_t value)
+    {
+        memcpy(_data.data() + rva, &value, sizeof(value));
+    }
+
+    // The header of UNWIND_INFO and the codes, the size is padded to an even count of codes
+    uint32_t add_unwind(std::initializer_list<uint8_t> info)
+    {
+        auto rva = _unwind;
+        put(rva, info);
+        _unwind += ((uint32_t)info.size() + 3) & ~3u;
+        return rva;
+    }
+
+    // In the order of the addresses, as the linker writes them
+    uint32_t add_function(uint32_t begin, uint32_t end, uint32_t unwind)
+    {
+        auto rva = 0x2000 + _count_functions++ * 12;
+        put32(rva, begin);
+        put32(rva + 4, end);
+        put32(rva + 8, unwind);
+        put32(0x58 + 112 + PESymbolizer::DIRECTORY_EXCEPTION * 8 + 4, _count_functions * 12);
+        return rva;
+    }
+
+    const uint8_t* data() const { return _data.data(); }
+    size_t size() const { return _data.size(); }
+};
+
+static size_t check_failures = 0;
+
+static void check(bool result, const char* what)
+{
+    if (!result)
+    {
+        fprintf(stderr, "check failed: %s\n", what);
+        check_failures++;
+    }
+}
+
+static void check_unwind()
+{
+    constexpr uint64_t base = 0x140000000ull;
+    constexpr uint32_t RBX = 3, RBP = 5, RSI = 6;
+
+    TestImage image;
+
+    // sub_1000: push rbp; push rbx; sub rsp, 28h; ...; add rsp, 28h; pop rbx; pop rbp; ret
+    image.put(0x1000, { 0x55, 0x53, 0x48, 0x83, 0xEC, 0x28 });
+    image.put(0x1006, { 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90 });
+    image.put(0x1010, { 0xE8, 0, 0, 0, 0, 0x90 });
+    image.put(0x1020, { 0x48, 0x83, 0xC4, 0x28, 0x5B, 0x5D, 0xC3 });
+    auto unwind_1000 = image.add_unwind({ 0x01, 6, 3, 0, 6, 0x42, 2, 0x30, 1, 0x50 });
+    auto entry_1000 = image.add_function(0x1000, 0x1030, unwind_1000);
+
+    // sub_1040: push rbp; sub rsp, 40h; mov [rsp+30h], rsi; lea rbp, [rsp+20h]; ...; lea rsp, [rbp+20h]; pop rbp; ret
+    image.put(0x1040, { 0x55, 0x48, 0x83, 0xEC, 0x40, 0x48, 0x89, 0x74, 0x24, 0x30, 0x48, 0x8D, 0x6C, 0x24, 0x20 });
+    image.put(0x104F, { 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0xE8, 0, 0, 0, 0, 0x90 });
+    image.put(0x1070, { 0x48, 0x8D, 0x65, 0x20, 0x5D, 0xC3 });
+    image.add_function(0x1040, 0x1080,
+        image.add_unwind({ 0x01, 15, 5, 0x25, 15, 0x03, 10, 0x64, 6, 0, 5, 0x72, 1, 0x50 }));
+
+    // sub_1080: as sub_1040, but rsi is saved after the frame pointer is set, so the save is not at rsp + 30h
+    // when rsp has moved: push rbp; sub rsp, 40h; lea rbp, [rsp+20h]; mov [rsp+30h], rsi; ...
+    image.put(0x1080, { 0x55, 0x48, 0x83, 0xEC, 0x40, 0x48, 0x8D, 0x6C, 0x24, 0x20, 0x48, 0x89, 0x74, 0x24, 0x30 });
+    image.put(0x108F, { 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0xE8, 0, 0, 0, 0, 0x90 });
+    image.put(0x10B0, { 0x48, 0x8D, 0x65, 0x20, 0x5D, 0xC3 });
+    image.add_function(0x1080, 0x10C0,
+        image.add_unwind({ 0x01, 15, 5, 0x25, 15, 0x64, 6, 0, 10, 0x03, 5, 0x72, 1, 0x50 }));
+
+    // Cold part of sub_1000 (chained unwind info) and an entry that refers to the one of sub_1000
+    image.put(0x1100, { 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90 });
+    image.put(0x1120, { 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90 });
+    image.add_function(0x1100, 0x1120, image.add_unwind({ 0x21, 0, 0, 0, 0x00, 0x10, 0, 0, 0x30, 0x10, 0, 0,
+        (uint8_t)unwind_1000, (uint8_t)(unwind_1000 >> 8), 0, 0 }));
+    image.add_function(0x1120, 0x1130, entry_1000 | 1);
+
+    // Interrupt handler: the frame of the processor
+    image.put(0x1140, { 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90 });
+    image.add_function(0x1140, 0x1150, image.add_unwind({ 0x01, 0, 1, 0, 0, 0x0A, 0, 0 }));
+
+    // Leaf function without unwind data
+    image.put(0x1200, { 0x90, 0x90, 0x90, 0xC3 });
+
+    PESymbolizer::ModuleTable table;
+    auto& module = table.Add("test.dll", base, image.data(), image.size(), true);
+    check(module.image.IsOpen() && (module.image.GetCountFunctions() == 6), "the test image is opened");
+    table.Build();
+
+    // The stack of the thread at 0x7000, the copy is filled with a marker
+    constexpr uint64_t stack_base = 0x7000;
+    std::vector<uint64_t> memory(0x100, 0xDEADDEADDEADDEADull);
+    PESymbolizer::StackView stack{ stack_base, (const uint8_t*)memory.data(), memory.size() * 8 };
+    auto at = [&memory](uint64_t address) -> uint64_t& { return memory[(address - stack_base) / 8]; };
+
+    auto unwind = [&](uint32_t rva, uint64_t rsp, uint64_t rbp, PESymbolizer::Context& context)
+        {
+            memset(&context, 0, sizeof(context));
+            context.rip = base + rva;
+            context.gpr[PESymbolizer::REG_RSP] = rsp;
+            context.gpr[RBP] = rbp;
+            return table.begin()->image.Unwind(rva, context, stack);
+        };
+
+    constexpr uint64_t S = stack_base + 0x200, R = base + 0x5555, X = 0x1111, P = 0x2222, SI = 0x3333;
+    PESymbolizer::Context context;
+
+    // sub_1000 after the prolog: 28h of locals, rbx, rbp, the return address
+    at(S + 0x28) = X; at(S + 0x30) = P; at(S + 0x38) = R;
+    for (auto rva : { 0x1008u, 0x1015u, 0x1020u, 0x1108u, 0x1124u })
+    {
+        char what[64];
+        snprintf(what, sizeof(what), "unwind at %X (body, chained, add rsp)", rva);
+        check(unwind(rva, S, 0, context) && (context.rip == R) && (context.gpr[PESymbolizer::REG_RSP] == S + 0x40) &&
+            (context.gpr[RBX] == X) && (context.gpr[RBP] == P), what);
+    }
+
+    // In the prolog only the pushes that have run are undone
+    at(S) = X; at(S + 8) = P; at(S + 0x10) = R;
+    check(unwind(0x1002, S, 0, context) && (context.rip == R) && (context.gpr[PESymbolizer::REG_RSP] == S + 0x18) &&
+        (context.gpr[RBX] == X) && (context.gpr[RBP] == P), "unwind in the prolog after push rbx");
+    check(unwind(0x1024, S, 0, context) && (context.rip == R) && (context.gpr[PESymbolizer::REG_RSP] == S + 0x18) &&
+        (context.gpr[RBX] == X) && (context.gpr[RBP] == P), "unwind in the epilog at pop rbx");
+    at(S) = P; at(S + 8) = R;
+    check(unwind(0x1001, S, 0, context) && (context.rip == R) && (context.gpr[PESymbolizer::REG_RSP] == S + 0x10) &&
+        (context.gpr[RBP] == P), "unwind in the prolog after push rbp");
+    check(unwind(0x1000, S + 8, 0, context) && (context.rip == R) && (context.gpr[PESymbolizer::REG_RSP] == S + 0x10),
+        "unwind at the entry");
+    check(unwind(0x1026, S + 8, 0, context) && (context.rip == R) && (context.gpr[PESymbolizer::REG_RSP] == S + 0x10),
+        "unwind at ret");
+    check(unwind(0x1200, S + 8, 0, context) && (context.rip == R) && (context.gpr[PESymbolizer::REG_RSP] == S + 0x10),
+        "unwind of a leaf function");
+
+    // sub_1040: the frame pointer is rsp after the prolog + 20h, rsi is saved at +30h, rbp at +40h.
+    // In the body rsp has moved, only the frame pointer is right.
+    at(S + 0x30) = SI; at(S + 0x40) = P; at(S + 0x48) = R;
+    check(unwind(0x1055, S - 0x80, S + 0x20, context) && (context.rip == R) &&
+        (context.gpr[PESymbolizer::REG_RSP] == S + 0x50) && (context.gpr[RSI] == SI) && (context.gpr[RBP] == P),
+        "unwind by the frame pointer");
+    check(unwind(0x104A, S, 0, context) && (context.rip == R) && (context.gpr[PESymbolizer::REG_RSP] == S + 0x50) &&
+        (context.gpr[RSI] == SI) && (context.gpr[RBP] == P), "unwind in the prolog before the frame pointer is set");
+    check(unwind(0x1070, S - 0x80, S + 0x20, context) && (context.rip == R) &&
+        (context.gpr[PESymbolizer::REG_RSP] == S + 0x50) && (context.gpr[RBP] == P), "unwind in the epilog at lea rsp");
+    check(unwind(0x1095, S - 0x80, S + 0x20, context) && (context.rip == R) &&
+        (context.gpr[PESymbolizer::REG_RSP] == S + 0x50) && (context.gpr[RSI] == SI) && (context.gpr[RBP] == P),
+        "unwind of a save relative to the frame pointer");
+    check(unwind(0x108C, S - 0x80, S + 0x20, context) && (context.rip == R) &&
+        (context.gpr[PESymbolizer::REG_RSP] == S + 0x50) && !context.gpr[RSI] && (context.gpr[RBP] == P),
+        "unwind in the prolog after the frame pointer is set");
+
+    // The processor has pushed RIP, CS, EFLAGS, RSP, SS
+    at(S) = R; at(S + 0x18) = S + 0x100;
+    check(unwind(0x1144, S, 0, context) && (context.rip == R) && (context.gpr[PESymbolizer::REG_RSP] == S + 0x100),
+        "unwind of a machine frame");
+
+    // Reads out of the copy fail
+    check(!unwind(0x1008, stack_base + memory.size() * 8 - 0x30, 0, context), "unwind past the copy of the stack");
+    check(!unwind(0x1200, stack_base - 8, 0, context), "unwind below the copy of the stack");
+
+    // Whole stack: leaf -> sub_1040 -> sub_1000 -> 0
+    std::fill(memory.begin(), memory.end(), 0xDEADDEADDEADDEADull);
+    at(S) = base + 0x1055;
+    at(S + 8 + 0x30) = SI; at(S + 8 + 0x40) = P; at(S + 8 + 0x48) = base + 0x1015;
+    at(S + 0x58 + 0x28) = X; at(S + 0x58 + 0x30) = P; at(S + 0x58 + 0x38) = 0;
+
+    uintptr_t frames[16];
+    memset(&context, 0, sizeof(context));
+    context.rip = base + 0x1200;
+    context.gpr[PESymbolizer::REG_RSP] = S;
+    context.gpr[RBP] = S + 8 + 0x20;
+    auto count = table.Unwind(context, stack, frames, 16);
+    check((count == 3) && (frames[0] == base + 0x1200) && (frames[1] == base + 0x1055) && (frames[2] == base + 0x1015),
+        "walk of the whole stack");
+
+    memset(&context, 0, sizeof(context));
+    context.rip = base + 0x1200;
+    context.gpr[PESymbolizer::REG_RSP] = S;
+    context.gpr[RBP] = S + 8 + 0x20;
+    check(table.Unwind(context, stack, frames, 2) == 2, "the walk stops at the max of the frames");
+
+    // A garbage frame pointer leads down the stack, it ends the walk
+    memset(&context, 0, sizeof(context));
+    context.rip = base + 0x1055;
+    context.gpr[PESymbolizer::REG_RSP] = S;
+    context.gpr[RBP] = S - 0x100;
+    check(table.Unwind(context, stack, frames, 16) == 1, "the walk stops at a frame below its callee");
+}
+
+// The names of the annotations outlive the growth of the table, the modules are moved or copied
+static void check_annotations()
+{
+    constexpr uint64_t base = 0x140000000ull;
+
+    TestImage image;
+    image.put(0x1000, { 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0xC3 });
+    image.add_function(0x1000, 0x1010, image.add_unwind({ 0x01, 0, 0, 0 }));
+
+    // As CrashHandler::BuildModuleTable does: the application is annotated, then the modules after it are added
+    PESymbolizer::ModuleTable table;
+    auto& application = table.Add("application.exe", base, image.data(), image.size(), true);
+    for (uint16_t i = 0; i < 16; i++)
+        application.annotations.push_back({ 0x1000u + i, 1, i, table.AddName("Patch " + std::to_string(i)) });
+
+    for (uint32_t i = 0; i < 300; i++)
+        table.Add("module" + std::to_string(i) + ".dll", base + 0x10000ull * (i + 1), nullptr, 0x1000, true);
+    table.Build();
+
+    PESymbolizer::Symbol symbol;
+    check(table.Symbolize(base + 0x1008, symbol) && symbol.has_function && (symbol.module->name == "application.exe"),
+        "the application is found among 301 modules");
+
+    uint32_t count = 0, names = 0;
+    if (symbol.module)
+        symbol.module->ForEachAnnotation(symbol.function.begin, symbol.function.end,
+            [&](const PESymbolizer::Annotation& entry)
+            {
+                count++;
+                names += ("Patch " + std::to_string(entry.index)) == entry.name;
+            });
+    check((count == 16) && (names == 16), "the names of the annotations after 300 more modules are added");
+}
+
+static int run_checks()
+{
+    check_unwind();
+    check_annotations();
+    printf("checks: %s (%zu failed)\n", check_failures ? "FAILED" : "ok", check_failures);
+    return check_failures ? 2 : 0;
+}
+
+static void usage()
+{
+    fputs(
+        "Usage: pesym <module>[@base] [<module>[@base]...] [options] [--] <address>...\n"
+        "       pesym --check\n"
+        "  Without the base the module is placed at 0 and the addresses are RVAs.\n"
+        "  -l, --functions         print the functions of the modules (begin, end, primary begin)\n"
+        "      --stats             print the time spent to stderr\n"
+        "      --check             run the checks on synthetic images and exit\n", stderr);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        usage();
+        return 1;
+    }
+
+    if (std::string_view(argv[1]) == "--check")
+        return run_checks();
+
+    std::vector<std::unique_ptr<std::vector<uint8_t>>> files;
+    std::vector<uint64_t> addresses;
+    PESymbolizer::ModuleTable table;
+    bool functions = false, stats = false, only_addresses = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view arg = argv[i];
+
+        if (!only_addresses && (arg == "--"))
+            only_addresses = true;
+        else if (!only_addresses && ((arg == "-l") || (arg == "--functions")))
+            functions = true;
+        else if (!only_addresses && (arg == "--stats"))
+            stats = true;
+        else if (!only_addresses && !arg.empty() && (arg[0] == '-'))
+        {
+            usage();
+            return 1;
+        }
+        else
+        {
+            char* end = nullptr;
+            auto address = strtoull(argv[i], &end, 16);
+            if (only_addresses || (end && !*end))
+            {
+                addresses.push_back(address);
+                continue;
+            }
+
+            auto at = arg.find_last_of('@');
+            std::string fname(arg.substr(0, at));
+            uint64_t base = (at == std::string_view::npos) ? 0 : strtoull(argv[i] + at + 1, nullptr, 16);
+
+            auto data = std::make_unique<std::vector<uint8_t>>();
+            if (!read_file(fname, *data))
+            {
+                fprintf(stderr, "Can't read %s\n", fname.c_str());
+                return 1;
+            }
+
+            auto& module = table.Add(file_name(fname), base, data->data(), data->size(), false);
+            if (!module.image.IsOpen())
+            {
+                fprintf(stderr, "Not a PE32+ file: %s\n", fname.c_str());
+                return 1;
+            }
+
+            files.emplace_back(std::move(data));
+        }
+    }
+
+    if (table.IsEmpty())
+    {
+        usage();
+        return 1;
+    }
+
+    table.Build();
+
+    if (functions)
+    {
+        for (auto& module : table)
+        {
+            printf("%s: %u functions\n", module.name.c_str(), module.image.GetCountFunctions());
+
+            auto entries = module.image.GetFunctions();
+            for (uint32_t i = 0; i < module.image.GetCountFunctions(); i++)
+            {
+                PESymbolizer::Function function{};
+                if (module.image.FindFunction(entries[i].begin_address, function))
+                    printf("  %08X %08X %08X\n", entries[i].begin_address, entries[i].end_address, function.begin);
+            }
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (auto address : addresses)
+        print_symbol(table, address);
+
+    if (stats)
+        fprintf(stderr, "%zu addresses in %.3f ms\n", addresses.size(),
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+    return 0;
+}
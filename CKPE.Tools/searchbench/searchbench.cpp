@@ -0,0 +1,392 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Benchmark of the SearchArrayItem replacements (CKPE.SkyrimSE.Patch.LoadOptimization.cpp): the plain loop,
+// the SSE4.1, AVX2 and AVX-512 scans and the hash of positions used above uSearchArrayIndexThreshold, on arrays
+// of several sizes that grow while they're searched as during the plugin load. The functions are copies of the
+// patch ones over a plain vector, the vector ones run only when the CPU and the OS support them.
+// Builds on Windows and Linux:
+//   g++ -O2 -std=c++20 searchbench.cpp -o searchbench
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include <chrono>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__GNUC__)
+#define TARGET(name) __attribute__((target(name)))
+#else
+#define TARGET(name)
+#endif
+
+constexpr static uint32_t NOT_FOUND = 0xFFFFFFFF;
+
+using SearchFunc = uint32_t(*)(const std::vector<void*>& _array, void* _target, uint32_t _start_index);
+
+struct SearchArrayIndex
+{
+    void* const* data = nullptr;
+    uint32_t size = 0;
+    void* last = nullptr;
+    uint32_t probe = 0;
+    // Pointer -> index of its first occurrence
+    std::unordered_map<void*, uint32_t> positions;
+};
+
+static uint32_t SearchArrayItem(const std::vector<void*>& _array, void* _target, uint32_t _start_index)
+{
+    for (uint32_t i = _start_index; i < (uint32_t)_array.size(); i++)
+    {
+        if (_array[i] == _target)
+            return i;
+    }
+
+    return NOT_FOUND;
+}
+
+TARGET("sse4.1")
+static uint32_t SearchArrayItem_SSE41(const std::vector<void*>& _array, void* _target, uint32_t _start_index)
+{
+    uint32_t index = _start_index;
+    const int64_t* data = (const int64_t*)_array.data();
+    const uint32_t size = (uint32_t)_array.size();
+
+    const uint32_t comparesPerIter = 4;
+    const uint32_t vectorizedIterations = (size - index) / comparesPerIter;
+
+    const __m128i targets = _mm_set1_epi64x((int64_t)_target);
+
+    for (uint32_t iter = 0; iter < vectorizedIterations; iter++)
+    {
+        __m128i test1 = _mm_cmpeq_epi64(targets, _mm_loadu_si128((const __m128i*)&data[index + 0]));
+        __m128i test2 = _mm_cmpeq_epi64(targets, _mm_loadu_si128((const __m128i*)&data[index + 2]));
+
+        if (_mm_movemask_pd(_mm_castsi128_pd(_mm_or_si128(test1, test2))) != 0)
+            break;
+
+        index += comparesPerIter;
+    }
+
+    for (; index < size; index++)
+    {
+        if (data[index] == (int64_t)_target)
+            return index;
+    }
+
+    return NOT_FOUND;
+}
+
+TARGET("avx2")
+static uint32_t SearchArrayItem_AVX2(const std::vector<void*>& _array, void* _target, uint32_t _start_index)
+{
+    uint32_t index = _start_index;
+    const int64_t* data = (const int64_t*)_array.data();
+    const uint32_t size = (uint32_t)_array.size();
+
+    const uint32_t comparesPerIter = 8;
+    const uint32_t vectorizedIterations = (size - index) / comparesPerIter;
+
+    const __m256i targets = _mm256_set1_epi64x((int64_t)_target);
+
+    for (uint32_t iter = 0; iter < vectorizedIterations; iter++)
+    {
+        __m256i test1 = _mm256_cmpeq_epi64(targets, _mm256_loadu_si256((const __m256i*)&data[index + 0]));
+        __m256i test2 = _mm256_cmpeq_epi64(targets, _mm256_loadu_si256((const __m256i*)&data[index + 4]));
+
+        if (_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_or_si256(test1, test2))) != 0)
+            break;
+
+        index += comparesPerIter;
+    }
+
+    for (; index < size; index++)
+    {
+        if (data[index] == (int64_t)_target)
+            return index;
+    }
+
+    return NOT_FOUND;
+}
+
+TARGET("avx512f")
+static uint32_t SearchArrayItem_AVX512(const std::vector<void*>& _array, void* _target, uint32_t _start_index)
+{
+    uint32_t index = _start_index;
+    const int64_t* data = (const int64_t*)_array.data();
+    const uint32_t size = (uint32_t)_array.size();
+
+    const uint32_t comparesPerIter = 16;
+    const uint32_t vectorizedIterations = (size - index) / comparesPerIter;
+
+    const __m512i targets = _mm512_set1_epi64((int64_t)_target);
+
+    for (uint32_t iter = 0; iter < vectorizedIterations; iter++)
+    {
+        __mmask8 mask1 = _mm512_cmpeq_epi64_mask(targets, _mm512_loadu_si512(&data[index + 0]));
+        __mmask8 mask2 = _mm512_cmpeq_epi64_mask(targets, _mm512_loadu_si512(&data[index + 8]));
+
+        if ((mask1 | mask2) != 0)
+            break;
+
+        index += comparesPerIter;
+    }
+
+    for (; index < size; index++)
+    {
+        if (data[index] == (int64_t)_target)
+            return index;
+    }
+
+    return NOT_FOUND;
+}
+
+static uint32_t SearchArrayItem_Indexed(SearchArrayIndex& index, SearchFunc scan, const std::vector<void*>& _array,
+    void* _target, uint32_t _start_index)
+{
+    const uint32_t size = (uint32_t)_array.size();
+    if (!size)
+        return NOT_FOUND;
+
+    auto data = _array.data();
+
+    // Anything but appending to the same buffer invalidates the positions
+    bool stale = (index.data != data) || (index.size > size) || (index.size && (data[index.size - 1] != index.last));
+
+    // A pointer written in place over another one is found by one element per call checked in turn
+    if (!stale && index.size)
+    {
+        auto probe = index.probe++ % index.size;
+        auto it = index.positions.find(data[probe]);
+        stale = (it == index.positions.end()) || (it->second > probe);
+    }
+
+    auto update = [&](bool rebuild)
+        {
+            if (rebuild)
+            {
+                index.data = data;
+                index.size = 0;
+                index.positions.clear();
+            }
+
+            for (uint32_t i = index.size; i < size; i++)
+                index.positions.try_emplace(data[i], i);
+
+            index.size = size;
+            index.last = data[size - 1];
+        };
+
+    update(stale);
+
+    auto it = index.positions.find(_target);
+    if ((it != index.positions.end()) && (data[it->second] != _target))
+    {
+        update(true);
+        it = index.positions.find(_target);
+    }
+
+    if (it == index.positions.end())
+        return NOT_FOUND;
+
+    if (it->second >= _start_index)
+        return it->second;
+
+    return scan(_array, _target, _start_index);
+}
+
+// The same checks as the patch: the CPU flags and the registers saved by the OS
+static bool has_support(const char* name)
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!strcmp(name, "sse4.1"))
+        return (info[2] & (1 << 19)) != 0;
+    if (!osxsave)
+        return false;
+
+    auto xstate = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    if (!strcmp(name, "avx2"))
+        return (info[1] & (1 << 5)) && ((xstate & 0x06) == 0x06);
+    if (!strcmp(name, "avx512f"))
+        return (info[1] & (1 << 16)) && ((xstate & 0xE6) == 0xE6);
+    return false;
+#else
+    __builtin_cpu_init();
+    if (!strcmp(name, "sse4.1"))
+        return __builtin_cpu_supports("sse4.1");
+    if (!strcmp(name, "avx2"))
+        return __builtin_cpu_supports("avx2");
+    if (!strcmp(name, "avx512f"))
+        return __builtin_cpu_supports("avx512f");
+    return false;
+#endif
+}
+
+struct Random
+{
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+
+    uint64_t operator()()
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        return seed;
+    }
+};
+
+static void* make_pointer(uint64_t i)
+{
+    // Forms are allocated apart from each other
+    return (void*)(uintptr_t)(0x10000000000ull + i * 0x60);
+}
+
+// Appends the elements one by one. Before each append the new element is looked up (miss) when hits is 0,
+// otherwise 'hits' random elements already in the array are looked up.
+template<typename Search>
+static double run(uint32_t count, uint32_t hits, uint64_t& checksum, Search&& search)
+{
+    std::vector<void*> array;
+    Random random;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (!hits)
+            checksum += search(array, make_pointer(i), 0);
+        else if (!array.empty())
+            for (uint32_t j = 0; j < hits; j++)
+                checksum += search(array, array[random() % array.size()], 0);
+
+        array.push_back(make_pointer(i));
+    }
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void usage()
+{
+    fputs(
+        "Usage: searchbench [options]\n"
+        "  -n, --count <count>     elements appended to the array, can be repeated (default 1000, 10000, 50000)\n"
+        "  -h, --hits <count>      lookups of present elements per append (default 1)\n", stderr);
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<uint32_t> counts;
+    uint32_t hits = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view arg = argv[i];
+
+        uint32_t value = 0;
+        bool is_count = (arg == "-n") || (arg == "--count");
+        if ((!is_count && (arg != "-h") && (arg != "--hits")) || (++i >= argc) ||
+            !(value = (uint32_t)strtoul(argv[i], nullptr, 10)))
+        {
+            usage();
+            return 1;
+        }
+
+        if (is_count)
+            counts.push_back(value);
+        else
+            hits = value;
+    }
+
+    if (counts.empty())
+        counts = { 1000, 10000, 50000 };
+
+    struct Variant
+    {
+        const char* name;
+        const char* feature;
+        SearchFunc scan;
+    };
+
+    const Variant variants[] =
+    {
+        { "loop", nullptr, &SearchArrayItem },
+        { "sse4.1", "sse4.1", &SearchArrayItem_SSE41 },
+        { "avx2", "avx2", &SearchArrayItem_AVX2 },
+        { "avx-512", "avx512f", &SearchArrayItem_AVX512 },
+    };
+
+    // The index falls back to the widest scan, as the patch does
+    SearchFunc best = &SearchArrayItem;
+    for (auto& variant : variants)
+        if (!variant.feature || has_support(variant.feature))
+            best = variant.scan;
+
+    for (auto count : counts)
+    {
+        printf("%u elements, %u hits per append\n                 hits ns/search   misses ns/search\n", count, hits);
+
+        double loop_time[2] = {};
+        uint64_t loop_checksum[2] = {};
+
+        auto report = [&](const char* name, auto&& search)
+            {
+                printf("  %-10s", name);
+                for (uint32_t n = 0; n < 2; n++)
+                {
+                    uint32_t lookups = n ? 0 : hits;
+                    uint64_t checksum = 0;
+                    auto time = run(count, lookups, checksum, search);
+                    auto searches = (double)count * (lookups ? lookups : 1);
+
+                    if (!loop_time[n])
+                    {
+                        loop_time[n] = time;
+                        loop_checksum[n] = checksum;
+                    }
+                    else if (checksum != loop_checksum[n])
+                    {
+                        fprintf(stderr, "\n%s: the results differ from the loop\n", name);
+                        exit(1);
+                    }
+
+                    printf("  %10.1f %6.2fx", time * 1e9 / searches, loop_time[n] / time);
+                }
+                printf("\n");
+            };
+
+        for (auto& variant : variants)
+        {
+            if (variant.feature && !has_support(variant.feature))
+            {
+                printf("  %-10s  not supported\n", variant.name);
+                continue;
+            }
+
+            report(variant.name, [&variant](const std::vector<void*>& array, void* target, uint32_t start)
+                { return variant.scan(array, target, start); });
+        }
+
+        SearchArrayIndex index;
+        report("indexed", [&index, best](const std::vector<void*>& array, void* target, uint32_t start)
+            { return SearchArrayItem_Indexed(index, best, array, target, start); });
+    }
+
+    return 0;
+}
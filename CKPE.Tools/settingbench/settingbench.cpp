@@ -0,0 +1,259 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Measures the cost of reading an option by its string keys (_READ_OPTION_* -> TOMLSettingCollection::Read*)
+// against a cached SettingHandle. The options come from the given settings file (CreationKitPlatformExtended.toml),
+// the collection is modelled on toml11 (unordered_map tables, contains() then at() for the section and
+// for the option, std::string keys built from the literals at each call). Builds on Windows and Linux:
+//   g++ -O2 -std=c++20 settingbench.cpp -o settingbench
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct Value
+{
+    enum Type { tNone, tBool, tInteger, tFloat, tString, tTable } type{ tNone };
+    bool boolean{ false };
+    int64_t integer{ 0 };
+    double floating{ 0.0 };
+    std::string string;
+    std::unordered_map<std::string, Value> table;
+
+    bool contains(const std::string& key) const { return table.find(key) != table.end(); }
+    const Value& at(const std::string& key) const { return table.at(key); }
+};
+
+class Collection
+{
+    Value _root;
+public:
+    Collection() { _root.type = Value::tTable; }
+
+    Value& section(const std::string& name)
+    {
+        auto& value = _root.table[name];
+        value.type = Value::tTable;
+        return value;
+    }
+
+    // Same steps as TOMLSettingCollection::ReadFloat/ReadUInt/ReadBool
+    virtual float ReadFloat(const std::string& section, const std::string& option, float def) const
+    {
+        if (option.empty() || (option[0] != 'f') || !_root.contains(section))
+            return def;
+
+        auto& value_section = _root.at(section);
+        if (!value_section.contains(option))
+            return def;
+
+        auto& value = value_section.at(option);
+        if (value.type == Value::tFloat)
+            return (float)value.floating;
+        return (value.type == Value::tInteger) ? (float)value.integer : def;
+    }
+
+    virtual unsigned long ReadUInt(const std::string& section, const std::string& option, unsigned long def) const
+    {
+        if (option.empty() || (option[0] != 'u') || !_root.contains(section))
+            return def;
+
+        auto& value_section = _root.at(section);
+        if (!value_section.contains(option))
+            return def;
+
+        auto& value = value_section.at(option);
+        return (value.type == Value::tInteger) ? (unsigned long)value.integer : def;
+    }
+
+    virtual bool ReadBool(const std::string& section, const std::string& option, bool def) const
+    {
+        if (option.empty() || (option[0] != 'b') || !_root.contains(section))
+            return def;
+
+        auto& value_section = _root.at(section);
+        if (!value_section.contains(option))
+            return def;
+
+        auto& value = value_section.at(option);
+        return (value.type == Value::tBool) ? value.boolean : def;
+    }
+
+    virtual ~Collection() = default;
+};
+
+static std::string_view trim(std::string_view text)
+{
+    while (!text.empty() && ((text.front() == ' ') || (text.front() == '\t')))
+        text.remove_prefix(1);
+    while (!text.empty() && ((text.back() == ' ') || (text.back() == '\t') || (text.back() == '\r')))
+        text.remove_suffix(1);
+    return text;
+}
+
+struct Option
+{
+    std::string section;
+    std::string name;
+};
+
+// Only what the settings file of CKPE uses: [Section], key=value, # comments
+static bool load(const char* fname, Collection& collection, std::vector<Option>& options)
+{
+    auto file = fopen(fname, "rb");
+    if (!file)
+        return false;
+
+    char buffer[4096];
+    std::string current;
+
+    while (fgets(buffer, sizeof(buffer), file))
+    {
+        auto line = std::string_view(buffer);
+        if ((line.size() >= 3) && !memcmp(line.data(), "\xEF\xBB\xBF", 3))
+            line.remove_prefix(3);
+        if (auto comment = line.find('#'); comment != std::string_view::npos)
+            line = line.substr(0, comment);
+        line = trim(line.substr(0, line.find('\n')));
+        if (line.empty())
+            continue;
+
+        if ((line.front() == '[') && (line.back() == ']'))
+        {
+            current = std::string(line.substr(1, line.size() - 2));
+            collection.section(current);
+            continue;
+        }
+
+        auto split = line.find('=');
+        if ((split == std::string_view::npos) || current.empty())
+            continue;
+
+        auto key = std::string(trim(line.substr(0, split)));
+        auto text = std::string(trim(line.substr(split + 1)));
+        Value value;
+
+        if ((text == "true") || (text == "false"))
+        {
+            value.type = Value::tBool;
+            value.boolean = text == "true";
+        }
+        else if (!text.empty() && (text.front() == '"'))
+        {
+            value.type = Value::tString;
+            value.string = text;
+        }
+        else if (text.find('.') != std::string::npos)
+        {
+            value.type = Value::tFloat;
+            value.floating = strtod(text.c_str(), nullptr);
+        }
+        else
+        {
+            value.type = Value::tInteger;
+            value.integer = strtoll(text.c_str(), nullptr, 0);
+        }
+
+        if ((key[0] == 'b') || (key[0] == 'u') || (key[0] == 'f'))
+            options.push_back(Option{ current, key });
+
+        collection.section(current).table[key] = std::move(value);
+    }
+
+    fclose(file);
+    return true;
+}
+
+static void usage()
+{
+    fputs("usage: settingbench <CreationKitPlatformExtended.toml> [--reads <n>]\n", stderr);
+}
+
+int main(int argc, char** argv)
+{
+    const char* fname = nullptr;
+    uint64_t reads = 20000000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view arg = argv[i];
+        if ((arg == "--reads") && ((i + 1) < argc))
+            reads = strtoull(argv[++i], nullptr, 10);
+        else if (!fname && (arg[0] != '-'))
+            fname = argv[i];
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if (!fname)
+    {
+        usage();
+        return 1;
+    }
+
+    auto collection = std::make_unique<Collection>();
+    std::vector<Option> options;
+    if (!load(fname, *collection, options) || options.empty())
+    {
+        fprintf(stderr, "Can't read the options of \"%s\"\n", fname);
+        return 1;
+    }
+
+    // The callers pass literals, the keys are built at each call
+    std::vector<std::pair<const char*, const char*>> keys;
+    for (auto& option : options)
+        keys.emplace_back(option.section.c_str(), option.name.c_str());
+
+    // What the handles hold after Refresh
+    std::vector<std::atomic<float>> handles(keys.size());
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        auto option = keys[i].second;
+        float value = 0.f;
+        if (option[0] == 'f') value = collection->ReadFloat(keys[i].first, option, 0.f);
+        else if (option[0] == 'u') value = (float)collection->ReadUInt(keys[i].first, option, 0);
+        else value = collection->ReadBool(keys[i].first, option, false) ? 1.f : 0.f;
+        handles[i].store(value, std::memory_order_relaxed);
+    }
+
+    const Collection* settings = collection.get();
+    double sum_keys = 0.0, sum_handles = 0.0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t n = 0; n < reads; n++)
+    {
+        auto& key = keys[n % keys.size()];
+        auto option = key.second;
+        if (option[0] == 'f') sum_keys += settings->ReadFloat(key.first, option, 0.f);
+        else if (option[0] == 'u') sum_keys += (double)settings->ReadUInt(key.first, option, 0);
+        else sum_keys += settings->ReadBool(key.first, option, false) ? 1.0 : 0.0;
+    }
+    auto keys_time = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (uint64_t n = 0; n < reads; n++)
+        sum_handles += handles[n % handles.size()].load(std::memory_order_relaxed);
+    auto handles_time = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    if (sum_keys != sum_handles)
+        fprintf(stderr, "The values differ: %f against %f\n", sum_keys, sum_handles);
+
+    printf("%zu options, %llu reads\n", keys.size(), (unsigned long long)reads);
+    printf("string keys: %.1f ns per read\n", keys_time / (double)reads);
+    printf("handle:      %.2f ns per read (%.0fx)\n", handles_time / (double)reads, keys_time / handles_time);
+
+    return 0;
+}
@@ -0,0 +1,334 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Fuzzes the UTF-8 validator and the code page transcoding of StringUtils (CKPE.Utf8.h) against a strict
+// scalar reference (RFC 3629), then times the validator against the reference. Builds on Windows and Linux:
+//   g++ -O2 -std=c++20 -msse4.1 -I../../CKPE/Include utf8fuzz.cpp -o utf8fuzz
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <CKPE.Utf8.h>
+
+using namespace CKPE;
+
+// Strict reference: no overlongs, no surrogates, nothing above U+10FFFF, no truncated sequences
+static bool reference_validate(const uint8_t* data, size_t length)
+{
+    size_t i = 0;
+    while (i < length)
+    {
+        uint8_t c = data[i];
+        if (c < 0x80)
+        {
+            i++;
+            continue;
+        }
+
+        size_t count;
+        uint32_t code, min;
+        if ((c >= 0xC2) && (c <= 0xDF)) { count = 2; code = c & 0x1F; min = 0x80; }
+        else if ((c & 0xF0) == 0xE0) { count = 3; code = c & 0x0F; min = 0x800; }
+        else if ((c >= 0xF0) && (c <= 0xF4)) { count = 4; code = c & 0x07; min = 0x10000; }
+        else return false;
+
+        if ((i + count) > length)
+            return false;
+
+        for (size_t j = 1; j < count; j++)
+        {
+            if ((data[i + j] & 0xC0) != 0x80)
+                return false;
+            code = (code << 6) | (data[i + j] & 0x3F);
+        }
+
+        if ((code < min) || (code > 0x10FFFF) || ((code >= 0xD800) && (code <= 0xDFFF)))
+            return false;
+
+        i += count;
+    }
+
+    return true;
+}
+
+static void append_code(std::string& s, uint32_t code)
+{
+    if (code < 0x80)
+        s += (char)code;
+    else if (code < 0x800)
+    {
+        s += (char)(0xC0 | (code >> 6));
+        s += (char)(0x80 | (code & 0x3F));
+    }
+    else if (code < 0x10000)
+    {
+        s += (char)(0xE0 | (code >> 12));
+        s += (char)(0x80 | ((code >> 6) & 0x3F));
+        s += (char)(0x80 | (code & 0x3F));
+    }
+    else
+    {
+        s += (char)(0xF0 | (code >> 18));
+        s += (char)(0x80 | ((code >> 12) & 0x3F));
+        s += (char)(0x80 | ((code >> 6) & 0x3F));
+        s += (char)(0x80 | (code & 0x3F));
+    }
+}
+
+// Valid text with long ASCII runs, like the record and UI strings, so that the block paths are crossed
+static std::string random_valid(std::mt19937_64& rng, size_t count)
+{
+    std::string s;
+    for (size_t i = 0; i < count; i++)
+    {
+        switch (rng() % 8)
+        {
+        case 0: append_code(s, 0x80 + (uint32_t)(rng() % (0x800 - 0x80))); break;
+        case 1:
+        {
+            uint32_t code;
+            do code = 0x800 + (uint32_t)(rng() % (0x10000 - 0x800));
+            while ((code >= 0xD800) && (code <= 0xDFFF));
+            append_code(s, code);
+            break;
+        }
+        case 2: append_code(s, 0x10000 + (uint32_t)(rng() % (0x110000 - 0x10000))); break;
+        case 3:
+        {
+            // Boundary code points
+            static const uint32_t edges[] = { 0x7F, 0x80, 0x7FF, 0x800, 0xD7FF, 0xE000, 0xFFFD, 0xFFFF,
+                0x10000, 0x10FFFF };
+            append_code(s, edges[rng() % (sizeof(edges) / sizeof(edges[0]))]);
+            break;
+        }
+        default:
+            for (size_t n = rng() % 24; n; n--)
+                s += (char)(0x20 + rng() % 0x5F);
+            break;
+        }
+    }
+
+    return s;
+}
+
+static void mutate(std::mt19937_64& rng, std::string& s)
+{
+    if (s.empty())
+    {
+        s += (char)(rng() & 0xFF);
+        return;
+    }
+
+    size_t pos = rng() % s.length();
+    switch (rng() % 7)
+    {
+    case 0: s[pos] = (char)(rng() & 0xFF); break;
+    case 1: s[pos] ^= (char)(1 << (rng() % 8)); break;
+    case 2: s.erase(pos, 1); break;
+    case 3: s.insert(pos, 1, (char)(0x80 | (rng() & 0x3F))); break;
+    case 4: s.insert(pos, 1, (char)(0xC0 | (rng() & 0x3F))); break;
+    case 5: s.resize(pos); break;
+    default:
+    {
+        // Surrogates, overlongs and out of range sequences
+        static const char* bad[] = { "\xED\xA0\x80", "\xED\xBF\xBF", "\xC0\xAF", "\xC1\xBF", "\xE0\x80\xAF",
+            "\xE0\x9F\xBF", "\xF0\x8F\xBF\xBF", "\xF4\x90\x80\x80", "\xF5\x80\x80\x80", "\xFF", "\xFE" };
+        s.insert(pos, bad[rng() % (sizeof(bad) / sizeof(bad[0]))]);
+        break;
+    }
+    }
+}
+
+// Synthetic code page: ASCII as is, the upper half mapped to 2 and 3 byte code points, the rest of the BMP
+// to the default character, like the tables built from Win32
+static void make_codepage(std::mt19937_64& rng, Utf8::CodePage& codepage)
+{
+    codepage.default_char = '?';
+    codepage.from_unicode = std::make_unique<uint8_t[]>(0x10000);
+    memset(codepage.from_unicode.get(), '?', 0x10000);
+
+    for (uint32_t i = 0; i < 0x80; i++)
+    {
+        codepage.to_unicode[i] = (uint16_t)i;
+        codepage.from_unicode[i] = (uint8_t)i;
+    }
+
+    for (uint32_t i = 0x80; i < 0x100; i++)
+    {
+        uint32_t code;
+        do code = (i & 1) ? 0x80 + (uint32_t)(rng() % (0x800 - 0x80)) : 0x800 + (uint32_t)(rng() % (0xD800 - 0x800));
+        while (codepage.from_unicode[code] != '?');
+        codepage.to_unicode[i] = (uint16_t)code;
+        codepage.from_unicode[code] = (uint8_t)i;
+    }
+
+    codepage.valid = true;
+}
+
+static std::string reference_to_codepage(const Utf8::CodePage& codepage, const std::string& src)
+{
+    std::string r;
+    auto data = (const uint8_t*)src.data();
+    for (size_t i = 0; i < src.length();)
+    {
+        uint32_t code;
+        i += Utf8::Decode(data + i, src.length() - i, code);
+        r += (code < 0x10000) ? (char)codepage.from_unicode[code] : codepage.default_char;
+    }
+
+    return r;
+}
+
+static std::string reference_from_codepage(const Utf8::CodePage& codepage, const std::string& src)
+{
+    std::string r;
+    for (auto c : src)
+        append_code(r, codepage.to_unicode[(uint8_t)c]);
+    return r;
+}
+
+static void dump(const char* what, const std::string& s)
+{
+    fprintf(stderr, "  %s (%zu bytes):", what, s.length());
+    for (size_t i = 0; (i < s.length()) && (i < 64); i++)
+        fprintf(stderr, " %02X", (uint8_t)s[i]);
+    fputs((s.length() > 64) ? " ...\n" : "\n", stderr);
+}
+
+static void usage()
+{
+    fputs("usage: utf8fuzz [options]\n"
+        "  --cases <n>     fuzz cases (default 1000000)\n"
+        "  --seed <n>      random seed (default 1)\n"
+        "  --bench <kb>    size of the benchmark text in KB (default 64, 0 to skip)\n", stderr);
+}
+
+int main(int argc, char** argv)
+{
+    size_t cases = 1000000;
+    size_t bench_kb = 64;
+    uint64_t seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view arg = argv[i];
+        if ((arg == "--cases") && ((i + 1) < argc))
+            cases = strtoull(argv[++i], nullptr, 10);
+        else if ((arg == "--seed") && ((i + 1) < argc))
+            seed = strtoull(argv[++i], nullptr, 10);
+        else if ((arg == "--bench") && ((i + 1) < argc))
+            bench_kb = strtoull(argv[++i], nullptr, 10);
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    std::mt19937_64 rng(seed);
+    Utf8::CodePage codepage;
+    make_codepage(rng, codepage);
+
+    size_t mismatches = 0, valid_cases = 0, transcode_mismatches = 0;
+    for (size_t n = 0; n < cases; n++)
+    {
+        // Lengths from 0 to a few blocks, so that every tail length and block boundary is hit
+        auto s = random_valid(rng, rng() % 12);
+        if (s.length() > 80)
+            s.resize(rng() % 80);
+        for (size_t m = (n & 1) ? 1 + rng() % 3 : 0; m; m--)
+            mutate(rng, s);
+
+        auto data = (const uint8_t*)s.data();
+        bool expected = reference_validate(data, s.length());
+        valid_cases += expected;
+
+        if (Utf8::ValidateSSE41(data, s.length()) != expected)
+        {
+            if (mismatches++ < 10)
+            {
+                fprintf(stderr, "validate mismatch, expected %s\n", expected ? "valid" : "invalid");
+                dump("input", s);
+            }
+        }
+
+        bool ascii = true;
+        for (auto c : s)
+            ascii &= !(c & 0x80);
+        if (Utf8::IsASCII(data, s.length()) != ascii)
+        {
+            if (mismatches++ < 10)
+            {
+                fputs("ascii mismatch\n", stderr);
+                dump("input", s);
+            }
+        }
+
+        std::string r;
+        if (expected)
+        {
+            Utf8::ToCodePage(codepage, s, r);
+            if (r != reference_to_codepage(codepage, s))
+            {
+                if (transcode_mismatches++ < 10)
+                {
+                    fputs("to code page mismatch\n", stderr);
+                    dump("input", s);
+                }
+            }
+        }
+
+        Utf8::FromCodePage(codepage, s, r);
+        if (r != reference_from_codepage(codepage, s))
+        {
+            if (transcode_mismatches++ < 10)
+            {
+                fputs("from code page mismatch\n", stderr);
+                dump("input", s);
+            }
+        }
+    }
+
+    printf("cases: %zu (valid %zu), validate mismatches: %zu, transcode mismatches: %zu\n",
+        cases, valid_cases, mismatches, transcode_mismatches);
+
+    if (bench_kb)
+    {
+        std::string text;
+        while (text.length() < (bench_kb << 10))
+            text += random_valid(rng, 64);
+
+        auto data = (const uint8_t*)text.data();
+        auto time = [&](bool (*validate)(const uint8_t*, size_t))
+            {
+                size_t passes = 0, ok = 0;
+                auto start = std::chrono::steady_clock::now();
+                std::chrono::duration<double> elapsed{};
+                do
+                {
+                    ok += validate(data, text.length());
+                    passes++;
+                    elapsed = std::chrono::steady_clock::now() - start;
+                } while (elapsed.count() < 0.5);
+                if (ok != passes)
+                    fputs("benchmark text rejected\n", stderr);
+                return (double)(passes * text.length()) / elapsed.count() / (1024.0 * 1024.0);
+            };
+
+        double simd = time([](const uint8_t* d, size_t l) { return Utf8::ValidateSSE41(d, l); });
+        double scalar = time(reference_validate);
+        printf("validate %zu KB: sse4.1 %.0f MB/s, scalar %.0f MB/s (%.2fx)\n", text.length() >> 10, simd,
+            scalar, simd / scalar);
+    }
+
+    return (mismatches || transcode_mismatches) ? 2 : 0;
+}
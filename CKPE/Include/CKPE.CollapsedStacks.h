@@ -0,0 +1,137 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <unordered_map>
+
+namespace CKPE
+{
+	// Aggregation of sampled call stacks into the collapsed format of the flame graph tools
+	// (flamegraph.pl, inferno, speedscope): one line per unique stack "thread;root;...;leaf count".
+	// The samples are raw addresses, they're named once per unique address when the text is built,
+	// so it does not depend on Windows.
+	namespace CollapsedStacks
+	{
+		class Aggregator
+		{
+			// The thread and the frames (the leaf first)
+			using Key = std::vector<std::uintptr_t>;
+
+			struct KeyHash
+			{
+				std::size_t operator()(const Key& key) const noexcept(true)
+				{
+					// FNV-1a
+					std::uint64_t hash = 0xCBF29CE484222325ull;
+					for (auto value : key)
+					{
+						hash ^= (std::uint64_t)value;
+						hash *= 0x100000001B3ull;
+					}
+					return (std::size_t)hash;
+				}
+			};
+
+			std::unordered_map<Key, std::uint64_t, KeyHash> _stacks;
+			std::uint64_t _samples{ 0 };
+		public:
+			Aggregator() = default;
+
+			// The frames as they're unwound, the leaf first
+			void Add(std::uint32_t thread, const std::uintptr_t* frames, std::size_t count, std::uint64_t weight = 1)
+			{
+				if (!count || !weight)
+					return;
+
+				Key key;
+				key.reserve(count + 1);
+				key.push_back(thread);
+				key.insert(key.end(), frames, frames + count);
+
+				_stacks[std::move(key)] += weight;
+				_samples += weight;
+			}
+
+			void Clear()
+			{
+				_stacks.clear();
+				_samples = 0;
+			}
+
+			[[nodiscard]] inline std::uint64_t GetSamples() const noexcept(true) { return _samples; }
+			[[nodiscard]] inline std::size_t GetUniqueStacks() const noexcept(true) { return _stacks.size(); }
+
+			// ';' separates the frames and the line ends with the count, they can't be a part of a name
+			[[nodiscard]] static std::string Sanitize(std::string_view name)
+			{
+				std::string result(name);
+				for (auto& ch : result)
+					if ((ch == ';') || (ch == '\n') || (ch == '\r'))
+						ch = '_';
+				return result;
+			}
+
+			// ThreadNameT: std::string(std::uint32_t thread), an empty name omits the thread frame.
+			// FrameNameT: std::string(std::uintptr_t address), an empty name omits the frame.
+			// Different addresses of the same function give the same line, such lines are merged,
+			// the lines are sorted.
+			template<typename ThreadNameT, typename FrameNameT>
+			[[nodiscard]] std::string Collapse(ThreadNameT&& thread_name, FrameNameT&& frame_name) const
+			{
+				std::unordered_map<std::uintptr_t, std::string> names;
+				std::unordered_map<std::uint32_t, std::string> threads;
+				std::map<std::string, std::uint64_t> lines;
+
+				std::string line;
+				for (auto& stack : _stacks)
+				{
+					line.clear();
+
+					auto& key = stack.first;
+					auto thread = (std::uint32_t)key[0];
+
+					auto it_thread = threads.find(thread);
+					if (it_thread == threads.end())
+						it_thread = threads.emplace(thread, Sanitize(thread_name(thread))).first;
+
+					line.append(it_thread->second);
+
+					for (auto i = key.size() - 1; i > 0; i--)
+					{
+						auto it = names.find(key[i]);
+						if (it == names.end())
+							it = names.emplace(key[i], Sanitize(frame_name(key[i]))).first;
+
+						if (it->second.empty())
+							continue;
+
+						if (!line.empty())
+							line.push_back(';');
+						line.append(it->second);
+					}
+
+					if (!line.empty())
+						lines[line] += stack.second;
+				}
+
+				std::string result;
+				for (auto& it : lines)
+				{
+					result.append(it.first);
+					result.push_back(' ');
+					result.append(std::to_string(it.second));
+					result.push_back('\n');
+				}
+
+				return result;
+			}
+		};
+	}
+}
@@ -0,0 +1,188 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+
+namespace CKPE
+{
+	// One pass INI parser of Common::INIIndex: the text is split in place into section/key/value spans
+	// (each one ends with a null), sorted without regard to case so that lookups are a binary search.
+	// Shared with the INI check tool, so it does not depend on Windows.
+	namespace INIParser
+	{
+		enum class Syntax : std::uint8_t
+		{
+			// As GetPrivateProfileString: only '=' separates the value, the first of the duplicate keys is kept
+			Profile = 0,
+			// As the settings files of CKPE were always read: '=' or ':', the last of the duplicate keys is kept
+			Settings,
+		};
+
+		// Offsets in the text
+		struct Entry
+		{
+			std::uint32_t section;
+			std::uint32_t section_length;
+			std::uint32_t key;
+			std::uint32_t key_length;
+			std::uint32_t value;
+			std::uint32_t value_length;
+		};
+
+		[[nodiscard]] inline char ToLowerASCII(char ch) noexcept(true)
+		{
+			return ((ch >= 'A') && (ch <= 'Z')) ? (char)(ch + ('a' - 'A')) : ch;
+		}
+
+		[[nodiscard]] inline int CompareNoCase(const char* a, std::size_t a_length, const char* b,
+			std::size_t b_length) noexcept(true)
+		{
+			auto length = std::min(a_length, b_length);
+			for (std::size_t i = 0; i < length; i++)
+			{
+				auto ca = (unsigned char)ToLowerASCII(a[i]);
+				auto cb = (unsigned char)ToLowerASCII(b[i]);
+				if (ca != cb)
+					return (ca < cb) ? -1 : 1;
+			}
+
+			return (a_length == b_length) ? 0 : ((a_length < b_length) ? -1 : 1);
+		}
+
+		[[nodiscard]] inline bool IsBlank(char ch) noexcept(true)
+		{
+			return (ch == ' ') || (ch == '\t') || (ch == '\r');
+		}
+
+		[[nodiscard]] inline int CompareEntry(const char* text, const Entry& entry, std::string_view section,
+			std::string_view key) noexcept(true)
+		{
+			auto result = CompareNoCase(text + entry.section, entry.section_length, section.data(), section.length());
+			if (!result)
+				result = CompareNoCase(text + entry.key, entry.key_length, key.data(), key.length());
+			return result;
+		}
+
+		// The text must have a null after the last byte (text[size])
+		inline void Parse(char* text, std::size_t size, Syntax syntax, std::vector<Entry>& entries)
+		{
+			entries.clear();
+
+			std::size_t pos = 0;
+			if ((size >= 3) && !memcmp(text, "\xEF\xBB\xBF", 3))
+				pos = 3;
+
+			// Keys before the first section are not seen by GetPrivateProfileString either
+			bool has_section = false;
+			std::uint32_t section = 0, section_length = 0;
+
+			// Lines are ~30 bytes on average in the editor INIs
+			entries.reserve(size / 32 + 1);
+
+			while (pos < size)
+			{
+				auto eol = (char*)memchr(text + pos, '\n', size - pos);
+				auto end = eol ? (std::size_t)(eol - text) : size;
+				auto begin = pos;
+				pos = end + 1;
+
+				while ((begin < end) && IsBlank(text[begin])) begin++;
+				while ((end > begin) && IsBlank(text[end - 1])) end--;
+				if (begin == end)
+					continue;
+
+				auto ch = text[begin];
+				if ((ch == ';') || (ch == '#'))
+					continue;
+
+				if (ch == '[')
+				{
+					auto close = (char*)memchr(text + begin + 1, ']', end - begin - 1);
+					auto name_begin = begin + 1;
+					auto name_end = close ? (std::size_t)(close - text) : end;
+
+					while ((name_begin < name_end) && IsBlank(text[name_begin])) name_begin++;
+					while ((name_end > name_begin) && IsBlank(text[name_end - 1])) name_end--;
+
+					section = (std::uint32_t)name_begin;
+					section_length = (std::uint32_t)(name_end - name_begin);
+					has_section = true;
+					// Everything after the name is not needed, the spans are null terminated
+					text[name_end] = '\0';
+					continue;
+				}
+
+				auto separator = (char*)memchr(text + begin, '=', end - begin);
+				if (syntax == Syntax::Settings)
+				{
+					auto colon = (char*)memchr(text + begin, ':', end - begin);
+					if (colon && (!separator || (colon < separator)))
+						separator = colon;
+				}
+
+				if (!separator || !has_section)
+					continue;
+
+				auto key_end = (std::size_t)(separator - text);
+				auto value_begin = key_end + 1;
+				while ((key_end > begin) && IsBlank(text[key_end - 1])) key_end--;
+				while ((value_begin < end) && IsBlank(text[value_begin])) value_begin++;
+
+				if (key_end == begin)
+					continue;
+
+				entries.emplace_back(Entry{ section, section_length, (std::uint32_t)begin,
+					(std::uint32_t)(key_end - begin), (std::uint32_t)value_begin, (std::uint32_t)(end - value_begin) });
+
+				text[key_end] = '\0';
+				text[end] = '\0';
+			}
+
+			// Stable, the duplicates stay in the order of the file
+			std::stable_sort(entries.begin(), entries.end(), [text](const Entry& a, const Entry& b)
+				{
+					return CompareEntry(text, a, std::string_view(text + b.section, b.section_length),
+						std::string_view(text + b.key, b.key_length)) < 0;
+				});
+
+			// Only the duplicate that wins is kept
+			auto same = [text](const Entry& a, const Entry& b)
+				{
+					return !CompareEntry(text, a, std::string_view(text + b.section, b.section_length),
+						std::string_view(text + b.key, b.key_length));
+				};
+
+			if (syntax == Syntax::Settings)
+			{
+				std::reverse(entries.begin(), entries.end());
+				entries.erase(std::unique(entries.begin(), entries.end(), same), entries.end());
+				std::reverse(entries.begin(), entries.end());
+			}
+			else
+				entries.erase(std::unique(entries.begin(), entries.end(), same), entries.end());
+
+			entries.shrink_to_fit();
+		}
+
+		[[nodiscard]] inline const Entry* Find(const char* text, const std::vector<Entry>& entries,
+			std::string_view section, std::string_view key) noexcept(true)
+		{
+			auto it = std::lower_bound(entries.begin(), entries.end(), 0, [&](const Entry& entry, int)
+				{
+					return CompareEntry(text, entry, section, key) < 0;
+				});
+
+			if ((it == entries.end()) || CompareEntry(text, *it, section, key))
+				return nullptr;
+
+			return &(*it);
+		}
+	}
+}
@@ -0,0 +1,246 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+namespace CKPE
+{
+	// Index of the structured log (JSON Lines): the offsets of the lines by the form ids and the plugin names
+	// found in the messages. Shared by the logger and the log query tool, so it does not depend on Windows.
+	//
+	// The file is a sequence of segments, each one covers the log from the end of the previous segment
+	// up to its log_size. The logger appends a segment every few MB and on close, so the index of a session
+	// that crashed misses only the tail. Segment layout: Header, FormIdEntry[formid_count] sorted by id,
+	// PluginEntry[plugin_count] sorted by name, std::uint64_t postings[] (offsets of the lines),
+	// names (not null terminated, in lower case).
+	namespace LogIndex
+	{
+		constexpr static char MAGIC[8] = { 'C', 'K', 'P', 'E', 'L', 'I', 'X', '1' };
+
+#pragma pack(push, 1)
+		struct Header
+		{
+			char magic[8];
+			// The segment covers the log up to this size, the lines after the last segment are not indexed
+			std::uint64_t log_size;
+			std::uint64_t lines;
+			std::uint32_t formid_count;
+			std::uint32_t plugin_count;
+			std::uint64_t postings_count;
+			std::uint64_t names_size;
+		};
+
+		struct FormIdEntry
+		{
+			std::uint32_t formid;
+			std::uint32_t count;
+			std::uint64_t first;
+		};
+
+		struct PluginEntry
+		{
+			std::uint32_t name_offset;
+			std::uint32_t name_length;
+			std::uint32_t count;
+			std::uint32_t reserved;
+			std::uint64_t first;
+		};
+#pragma pack(pop)
+
+		[[nodiscard]] inline std::uint64_t SegmentSize(const Header& header) noexcept(true)
+		{
+			return sizeof(Header) + (std::uint64_t)header.formid_count * sizeof(FormIdEntry) +
+				(std::uint64_t)header.plugin_count * sizeof(PluginEntry) + header.postings_count * sizeof(std::uint64_t) +
+				header.names_size;
+		}
+
+		[[nodiscard]] inline bool IsHexDigit(char ch) noexcept(true)
+		{
+			return ((ch >= '0') && (ch <= '9')) || ((ch >= 'a') && (ch <= 'f')) || ((ch >= 'A') && (ch <= 'F'));
+		}
+
+		[[nodiscard]] inline bool IsWordChar(char ch) noexcept(true)
+		{
+			return ((ch >= '0') && (ch <= '9')) || ((ch >= 'a') && (ch <= 'z')) || ((ch >= 'A') && (ch <= 'Z')) ||
+				(ch == '_');
+		}
+
+		[[nodiscard]] inline bool IsPluginDelimiter(char ch) noexcept(true)
+		{
+			return (ch == ' ') || (ch == '\t') || (ch == '\'') || (ch == '"') || (ch == '(') || (ch == ')') ||
+				(ch == '[') || (ch == ']') || (ch == ':') || (ch == ',') || (ch == '\\') || (ch == '/');
+		}
+
+		[[nodiscard]] inline std::string ToLower(std::string_view text)
+		{
+			std::string result(text);
+			for (auto& ch : result)
+				if ((ch >= 'A') && (ch <= 'Z'))
+					ch = (char)(ch - 'A' + 'a');
+			return result;
+		}
+
+		// Form ids are words of exactly 8 hex digits with or without a 0x prefix, plugins are words that end with .esm, .esp or .esl
+		// (a name with spaces is indexed by its last word, the query tool checks the whole name in the line).
+		template<typename FormIdFunc, typename PluginFunc>
+		inline void ExtractKeys(std::string_view text, FormIdFunc&& on_formid, PluginFunc&& on_plugin)
+		{
+			auto size = text.size();
+
+			for (std::size_t i = 0; i < size;)
+			{
+				if (!IsWordChar(text[i]))
+				{
+					if ((text[i] == '.') && (i + 3 < size) && (i > 0))
+					{
+						auto a = (char)(text[i + 1] | 0x20), b = (char)(text[i + 2] | 0x20), c = (char)(text[i + 3] | 0x20);
+						if ((a == 'e') && (b == 's') && ((c == 'm') || (c == 'p') || (c == 'l')) &&
+							((i + 4 == size) || !IsWordChar(text[i + 4])))
+						{
+							auto start = i;
+							while (start && !IsPluginDelimiter(text[start - 1]))
+								start--;
+
+							if (start < i)
+								on_plugin(text.substr(start, i + 4 - start));
+
+							i += 4;
+							continue;
+						}
+					}
+
+					i++;
+					continue;
+				}
+
+				auto start = i;
+				while ((i < size) && IsWordChar(text[i]))
+					i++;
+
+				auto digits = start;
+				if (((i - start) == 10) && (text[start] == '0') && ((text[start + 1] | 0x20) == 'x'))
+					digits += 2;
+
+				if ((i - digits) == 8)
+				{
+					std::uint32_t formid = 0;
+					bool hex = true;
+
+					for (auto j = digits; j < i; j++)
+					{
+						auto ch = text[j];
+						if (!IsHexDigit(ch))
+						{
+							hex = false;
+							break;
+						}
+
+						formid = (formid << 4) | (std::uint32_t)((ch <= '9') ? (ch - '0') : ((ch | 0x20) - 'a' + 10));
+					}
+
+					if (hex)
+						on_formid(formid);
+				}
+			}
+		}
+
+		class Builder
+		{
+			std::unordered_map<std::uint32_t, std::vector<std::uint64_t>> _formids;
+			std::unordered_map<std::string, std::vector<std::uint64_t>> _plugins;
+			std::uint64_t _lines{ 0 };
+		public:
+			[[nodiscard]] bool Empty() const noexcept(true) { return !_lines; }
+
+			void Add(std::uint64_t offset, std::string_view message)
+			{
+				_lines++;
+
+				ExtractKeys(message,
+					[&](std::uint32_t formid)
+					{
+						auto& postings = _formids[formid];
+						if (postings.empty() || (postings.back() != offset))
+							postings.push_back(offset);
+					},
+					[&](std::string_view plugin)
+					{
+						auto& postings = _plugins[ToLower(plugin)];
+						if (postings.empty() || (postings.back() != offset))
+							postings.push_back(offset);
+					});
+			}
+
+			bool Write(FILE* file, std::uint64_t log_size) const
+			{
+				std::vector<FormIdEntry> formids;
+				std::vector<PluginEntry> plugins;
+				std::vector<const std::vector<std::uint64_t>*> lists;
+				std::string names;
+				std::uint64_t postings = 0;
+
+				formids.reserve(_formids.size());
+				for (auto& it : _formids)
+					formids.push_back(FormIdEntry{ it.first, (std::uint32_t)it.second.size(), 0 });
+				std::sort(formids.begin(), formids.end(),
+					[](const FormIdEntry& a, const FormIdEntry& b) { return a.formid < b.formid; });
+
+				std::vector<const std::string*> sorted_names;
+				sorted_names.reserve(_plugins.size());
+				for (auto& it : _plugins)
+					sorted_names.push_back(&it.first);
+				std::sort(sorted_names.begin(), sorted_names.end(),
+					[](const std::string* a, const std::string* b) { return *a < *b; });
+
+				for (auto& entry : formids)
+				{
+					auto& list = _formids.find(entry.formid)->second;
+					entry.first = postings;
+					postings += list.size();
+					lists.push_back(&list);
+				}
+
+				for (auto name : sorted_names)
+				{
+					auto& list = _plugins.find(*name)->second;
+					plugins.push_back(PluginEntry{ (std::uint32_t)names.size(), (std::uint32_t)name->size(),
+						(std::uint32_t)list.size(), 0, postings });
+					names.append(*name);
+					postings += list.size();
+					lists.push_back(&list);
+				}
+
+				Header header{};
+				memcpy(header.magic, MAGIC, sizeof(MAGIC));
+				header.log_size = log_size;
+				header.lines = _lines;
+				header.formid_count = (std::uint32_t)formids.size();
+				header.plugin_count = (std::uint32_t)plugins.size();
+				header.postings_count = postings;
+				header.names_size = names.size();
+
+				bool result = fwrite(&header, sizeof(Header), 1, file) == 1;
+				if (!formids.empty())
+					result = result && (fwrite(formids.data(), sizeof(FormIdEntry), formids.size(), file) == formids.size());
+				if (!plugins.empty())
+					result = result && (fwrite(plugins.data(), sizeof(PluginEntry), plugins.size(), file) == plugins.size());
+				for (auto list : lists)
+					result = result && (fwrite(list->data(), sizeof(std::uint64_t), list->size(), file) == list->size());
+				if (!names.empty())
+					result = result && (fwrite(names.data(), 1, names.size(), file) == names.size());
+
+				return result;
+			}
+		};
+	}
+}
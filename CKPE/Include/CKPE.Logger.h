@@ -8,6 +8,7 @@
 #include <string_view>
 #include <cstdint>
 #include <format>
+#include <atomic>
 #include <CKPE.Common.h>
 #include <CKPE.CriticalSection.h>
 
@@ -15,9 +16,16 @@ namespace CKPE
 {
 	class CKPE_API Logger
 	{
+		struct AsyncQueue;
+		struct StructuredSink;
+
 		void* _handle{ nullptr };
 		std::wstring* _fname{ nullptr };
 		CriticalSection _section;
+		std::atomic<AsyncQueue*> _queue{ nullptr };
+		// Writers that use the queue right now, it is deleted only when there are none
+		mutable std::atomic_uint32_t _queue_users{ 0 };
+		StructuredSink* _structured{ nullptr };
 	public:
 		enum Setting : std::uint32_t {
 			sAutoFlush							= 1 << 0,
@@ -47,6 +55,20 @@ namespace CKPE
 		bool Open(const std::string& fname) noexcept(true);
 		bool Open(const std::wstring& fname) noexcept(true);
 		void Close() noexcept(true);
+
+		// Messages go into a lock-free ring and are written by a background thread in batches.
+		// When the ring is full, the caller waits or the message is dropped (the count is written later).
+		bool EnableAsync(std::uint32_t buffer_size, bool block_when_full) noexcept(true);
+		void DisableAsync() noexcept(true);
+		[[nodiscard]] inline bool HasAsync() const noexcept(true) { return _queue.load(std::memory_order_acquire) != nullptr; }
+
+		// Second log in JSON Lines (time, thread, severity, source, message) for tools.
+		// The index of form ids and plugins is written next to it ("<file>.idx") in segments, every few MB and on close.
+		bool EnableStructured(const std::wstring& fname) noexcept(true);
+		void DisableStructured() noexcept(true);
+		[[nodiscard]] bool HasStructured() const noexcept(true);
+		void WriteStructured(TypeMsg type_msg, const char* source, const char* message,
+			std::size_t length) const noexcept(true);
 		[[nodiscard]] static Logger* GetSingleton() noexcept(true);
 
 		virtual void Write(const std::string& formatted_message, ...) const noexcept(true);
@@ -90,6 +112,14 @@ namespace CKPE
 		[[nodiscard]] inline constexpr virtual bool HasIfFatalErrorTriggerErrorHandler() const noexcept(true) { return _settings & sIfFatalErrorTriggerErrorHandler; }
 		[[nodiscard]] inline constexpr virtual bool HasOutputDebugger() const noexcept(true) { return _settings & sOutputDebugger; }
 	private:
+		[[nodiscard]] AsyncQueue* AcquireQueue() const noexcept(true);
+		void ReleaseQueue() const noexcept(true);
+		[[nodiscard]] bool Enqueue(AsyncQueue* queue, TypeMsg type_msg, const char* message, std::size_t length, 
+			bool new_line) const noexcept(true);
+		void DrainQueue(AsyncQueue* queue) const noexcept(true);
+		// The narrow messages are in the code page of the system, the wide ones are converted to UTF-8
+		void WriteMessage(TypeMsg type_msg, const std::string& message, bool utf8) const noexcept(true);
+
 		std::uint32_t _settings{ sAutoFlush | sAlwaysNewLine | sIfFatalErrorTriggerErrorHandler };
 	};
 
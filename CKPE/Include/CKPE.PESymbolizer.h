@@ -0,0 +1,766 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <algorithm>
+
+namespace CKPE
+{
+	// Symbolizer of the addresses of PE32+ modules: the module is found by a binary search in the table sorted
+	// by address, the function by a binary search in its exception directory (.pdata), chained unwind info
+	// is followed to the start of the function. The same tables unwind a copy of the stack of a thread.
+	// Shared by the crash handler and the symbolizer tool, so it does not depend on Windows and works
+	// with loaded images as well as with the files on disk.
+	namespace PESymbolizer
+	{
+		constexpr static std::uint16_t DOS_SIGNATURE = 0x5A4D;			// MZ
+		constexpr static std::uint32_t NT_SIGNATURE = 0x00004550;		// PE00
+		constexpr static std::uint16_t OPTIONAL_MAGIC_PE32PLUS = 0x20B;
+		constexpr static std::uint32_t DIRECTORY_EXCEPTION = 3;
+		constexpr static std::uint32_t SCN_CNT_CODE = 0x00000020;
+		constexpr static std::uint32_t SCN_MEM_EXECUTE = 0x20000000;
+		constexpr static std::uint8_t UNW_FLAG_CHAININFO = 0x4;
+		// Deeper chains are broken images
+		constexpr static std::uint32_t MAX_CHAIN_DEPTH = 32;
+		// Longer epilogs are not code generated by a compiler
+		constexpr static std::uint32_t MAX_EPILOG_INSTRUCTIONS = 32;
+
+		// Unwind operations (UNWIND_CODE)
+		constexpr static std::uint8_t UWOP_PUSH_NONVOL = 0;
+		constexpr static std::uint8_t UWOP_ALLOC_LARGE = 1;
+		constexpr static std::uint8_t UWOP_ALLOC_SMALL = 2;
+		constexpr static std::uint8_t UWOP_SET_FPREG = 3;
+		constexpr static std::uint8_t UWOP_SAVE_NONVOL = 4;
+		constexpr static std::uint8_t UWOP_SAVE_NONVOL_FAR = 5;
+		constexpr static std::uint8_t UWOP_EPILOG = 6;
+		constexpr static std::uint8_t UWOP_SPARE_CODE = 7;
+		constexpr static std::uint8_t UWOP_SAVE_XMM128 = 8;
+		constexpr static std::uint8_t UWOP_SAVE_XMM128_FAR = 9;
+		constexpr static std::uint8_t UWOP_PUSH_MACHFRAME = 10;
+
+		constexpr static std::uint32_t REG_RSP = 4;
+
+#pragma pack(push, 1)
+		struct FileHeader
+		{
+			std::uint16_t machine;
+			std::uint16_t number_of_sections;
+			std::uint32_t time_date_stamp;
+			std::uint32_t pointer_to_symbol_table;
+			std::uint32_t number_of_symbols;
+			std::uint16_t size_of_optional_header;
+			std::uint16_t characteristics;
+		};
+
+		struct DataDirectory
+		{
+			std::uint32_t virtual_address;
+			std::uint32_t size;
+		};
+
+		// Only the fields before the data directories that are needed
+		struct OptionalHeader64
+		{
+			std::uint16_t magic;
+			std::uint8_t unused0[54];
+			std::uint32_t size_of_image;
+			std::uint8_t unused1[48];
+			std::uint32_t number_of_rva_and_sizes;
+			DataDirectory data_directory[16];
+		};
+
+		struct SectionHeader
+		{
+			char name[8];
+			std::uint32_t virtual_size;
+			std::uint32_t virtual_address;
+			std::uint32_t size_of_raw_data;
+			std::uint32_t pointer_to_raw_data;
+			std::uint32_t pointer_to_relocations;
+			std::uint32_t pointer_to_line_numbers;
+			std::uint16_t number_of_relocations;
+			std::uint16_t number_of_line_numbers;
+			std::uint32_t characteristics;
+		};
+
+		struct RuntimeFunction
+		{
+			std::uint32_t begin_address;
+			std::uint32_t end_address;
+			std::uint32_t unwind_data;
+		};
+#pragma pack(pop)
+
+		static_assert(sizeof(OptionalHeader64) == 240);
+		static_assert(sizeof(SectionHeader) == 40);
+		static_assert(sizeof(RuntimeFunction) == 12);
+
+		// Function that contains the address, the offsets are relative to the base of the module.
+		// The fragment is the part of the function with the address, separated cold code has its own one.
+		struct Function
+		{
+			std::uint32_t begin;
+			std::uint32_t end;
+			std::uint32_t fragment_begin;
+			std::uint32_t fragment_end;
+		};
+
+		// Integer registers of a thread, gpr in the order of the x64 encoding:
+		// RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8-R15
+		struct Context
+		{
+			std::uint64_t rip;
+			std::uint64_t gpr[16];
+		};
+
+		// Copy of the stack of a thread, [base, base + size) of its address space.
+		// The unwinding reads nothing else from the stack, the thread may run on.
+		struct StackView
+		{
+			std::uint64_t base;
+			const std::uint8_t* data;
+			std::size_t size;
+
+			[[nodiscard]] bool Read(std::uint64_t address, std::uint64_t& value) const noexcept(true)
+			{
+				if ((address < base) || (address - base > size) || ((size - (address - base)) < sizeof(value)))
+					return false;
+
+				memcpy(&value, data + (address - base), sizeof(value));
+				return true;
+			}
+
+			// The return address on the top of the stack
+			[[nodiscard]] bool PopReturn(Context& context) const noexcept(true)
+			{
+				if (!Read(context.gpr[REG_RSP], context.rip))
+					return false;
+
+				context.gpr[REG_RSP] += 8;
+				return true;
+			}
+		};
+
+		// View of a loaded image (RVA is an offset from the base) or of a file (RVA is translated by the sections).
+		// The data is not copied, it must live as long as the view.
+		class Image
+		{
+			const std::uint8_t* _data{ nullptr };
+			std::size_t _size{ 0 };
+			bool _loaded{ false };
+			std::uint32_t _size_of_image{ 0 };
+			const SectionHeader* _sections{ nullptr };
+			std::uint32_t _count_sections{ 0 };
+			const RuntimeFunction* _functions{ nullptr };
+			std::uint32_t _count_functions{ 0 };
+		public:
+			Image() noexcept(true) = default;
+
+			// For a loaded image the size may be 0, then the size of the image from the headers is used
+			bool Open(const void* data, std::size_t size, bool loaded) noexcept(true)
+			{
+				*this = Image();
+
+				auto bytes = (const std::uint8_t*)data;
+				if (!bytes || (size && (size < 0x40)))
+					return false;
+
+				std::uint16_t dos_signature;
+				std::uint32_t nt_offset;
+				memcpy(&dos_signature, bytes, sizeof(dos_signature));
+				memcpy(&nt_offset, bytes + 0x3C, sizeof(nt_offset));
+				if ((dos_signature != DOS_SIGNATURE) || (nt_offset > 0x10000000))
+					return false;
+
+				auto headers_size = (std::size_t)nt_offset + 4 + sizeof(FileHeader) + sizeof(OptionalHeader64);
+				if (size && (size < headers_size))
+					return false;
+
+				std::uint32_t nt_signature;
+				memcpy(&nt_signature, bytes + nt_offset, sizeof(nt_signature));
+				auto file_header = (const FileHeader*)(bytes + nt_offset + 4);
+				auto optional_header = (const OptionalHeader64*)(bytes + nt_offset + 4 + sizeof(FileHeader));
+				if ((nt_signature != NT_SIGNATURE) || (optional_header->magic != OPTIONAL_MAGIC_PE32PLUS) ||
+					(file_header->size_of_optional_header < sizeof(OptionalHeader64)))
+					return false;
+
+				auto sections_offset = (std::size_t)nt_offset + 4 + sizeof(FileHeader) + file_header->size_of_optional_header;
+				if (size && (size < sections_offset + (std::size_t)file_header->number_of_sections * sizeof(SectionHeader)))
+					return false;
+
+				_data = bytes;
+				_loaded = loaded;
+				_size_of_image = optional_header->size_of_image;
+				_size = size ? size : (loaded ? _size_of_image : 0);
+				_sections = (const SectionHeader*)(bytes + sections_offset);
+				_count_sections = file_header->number_of_sections;
+
+				if (optional_header->number_of_rva_and_sizes > DIRECTORY_EXCEPTION)
+				{
+					auto& directory = optional_header->data_directory[DIRECTORY_EXCEPTION];
+					_functions = (const RuntimeFunction*)RvaToPointer(directory.virtual_address, directory.size);
+					_count_functions = _functions ? (std::uint32_t)(directory.size / sizeof(RuntimeFunction)) : 0;
+				}
+
+				return true;
+			}
+
+			[[nodiscard]] inline bool IsOpen() const noexcept(true) { return _data != nullptr; }
+			[[nodiscard]] inline std::uint32_t GetSizeOfImage() const noexcept(true) { return _size_of_image; }
+			[[nodiscard]] inline std::uint32_t GetCountFunctions() const noexcept(true) { return _count_functions; }
+			[[nodiscard]] inline const RuntimeFunction* GetFunctions() const noexcept(true) { return _functions; }
+
+			[[nodiscard]] const SectionHeader* FindSection(std::uint32_t rva) const noexcept(true)
+			{
+				for (std::uint32_t i = 0; i < _count_sections; i++)
+				{
+					auto& section = _sections[i];
+					auto size = std::max(section.virtual_size, section.size_of_raw_data);
+					if ((rva >= section.virtual_address) && (rva < section.virtual_address + size))
+						return &section;
+				}
+
+				return nullptr;
+			}
+
+			[[nodiscard]] const void* RvaToPointer(std::uint32_t rva, std::uint32_t size) const noexcept(true)
+			{
+				if (!_data)
+					return nullptr;
+
+				std::size_t offset = rva;
+				if (!_loaded)
+				{
+					auto section = FindSection(rva);
+					if (!section || ((std::size_t)rva - section->virtual_address + size > section->size_of_raw_data))
+						return nullptr;
+
+					offset = (std::size_t)section->pointer_to_raw_data + (rva - section->virtual_address);
+				}
+
+				if (_size && (offset + size > _size))
+					return nullptr;
+
+				return _data + offset;
+			}
+
+			[[nodiscard]] bool IsCode(std::uint32_t rva) const noexcept(true)
+			{
+				auto section = FindSection(rva);
+				return section && (section->characteristics & (SCN_CNT_CODE | SCN_MEM_EXECUTE));
+			}
+
+			[[nodiscard]] const RuntimeFunction* FindRuntimeFunction(std::uint32_t rva) const noexcept(true)
+			{
+				if (!_count_functions)
+					return nullptr;
+
+				// The table is sorted by the start address
+				auto it = std::upper_bound(_functions, _functions + _count_functions, rva,
+					[](std::uint32_t rva, const RuntimeFunction& entry) { return rva < entry.begin_address; });
+				if (it == _functions)
+					return nullptr;
+
+				auto entry = it - 1;
+				if ((rva < entry->begin_address) || (rva >= entry->end_address))
+					return nullptr;
+
+				return entry;
+			}
+
+			[[nodiscard]] bool FindFunction(std::uint32_t rva, Function& function) const noexcept(true)
+			{
+				auto entry = FindRuntimeFunction(rva);
+				if (!entry)
+					return false;
+
+				function.fragment_begin = entry->begin_address;
+				function.fragment_end = entry->end_address;
+
+				// The fragments of a function (the cold parts, the shrink-wrapped prologues) refer to the primary entry
+				for (std::uint32_t depth = 0; depth < MAX_CHAIN_DEPTH; depth++)
+				{
+					if (entry->unwind_data & 1)
+					{
+						auto chained = (const RuntimeFunction*)RvaToPointer(entry->unwind_data & ~1u, sizeof(RuntimeFunction));
+						if (!chained)
+							break;
+
+						entry = chained;
+						continue;
+					}
+
+					auto unwind = (const std::uint8_t*)RvaToPointer(entry->unwind_data, 4);
+					if (!unwind || !((unwind[0] >> 3) & UNW_FLAG_CHAININFO))
+						break;
+
+					auto count_codes = (std::uint32_t)unwind[2];
+					auto chained = (const RuntimeFunction*)RvaToPointer(entry->unwind_data + 4 +
+						((count_codes + 1) & ~1u) * 2, sizeof(RuntimeFunction));
+					if (!chained)
+						break;
+
+					entry = chained;
+				}
+
+				function.begin = entry->begin_address;
+				function.end = entry->end_address;
+
+				return true;
+			}
+
+			// One frame up as RtlVirtualUnwind does it, the rva is the one of context.rip. A function without
+			// unwind data is a leaf, its return address is on the top of the stack.
+			[[nodiscard]] bool Unwind(std::uint32_t rva, Context& context, const StackView& stack) const noexcept(true)
+			{
+				auto entry = FindRuntimeFunction(rva);
+				if (!entry)
+					return stack.PopReturn(context);
+
+				// An entry can refer to the one of the function
+				for (std::uint32_t depth = 0; (entry->unwind_data & 1) && (depth < MAX_CHAIN_DEPTH); depth++)
+				{
+					entry = (const RuntimeFunction*)RvaToPointer(entry->unwind_data & ~1u, sizeof(RuntimeFunction));
+					if (!entry)
+						return false;
+				}
+
+				auto offset = rva - entry->begin_address;
+				auto unwind = (const std::uint8_t*)RvaToPointer(entry->unwind_data, 4);
+				if (!unwind)
+					return false;
+
+				// After the prolog the code can be an epilog, the unwind codes don't describe it
+				if ((offset >= unwind[1]) && IsEpilog(rva, *entry))
+					return UnwindEpilog(rva, context, stack);
+
+				bool primary = true;
+				for (std::uint32_t depth = 0; depth < MAX_CHAIN_DEPTH; depth++)
+				{
+					auto flags = (std::uint8_t)(unwind[0] >> 3);
+					auto size_of_prolog = (std::uint32_t)unwind[1];
+					auto count_codes = (std::uint32_t)unwind[2];
+					auto frame_register = (std::uint32_t)(unwind[3] & 0xF);
+					auto frame_offset = (std::uint32_t)(unwind[3] >> 4) * 16;
+
+					auto codes = (const std::uint8_t*)RvaToPointer(entry->unwind_data + 4, count_codes * 2);
+					if (count_codes && !codes)
+						return false;
+
+					auto slot = [codes](std::uint32_t index) -> std::uint32_t
+						{
+							return (std::uint32_t)codes[index * 2] | ((std::uint32_t)codes[index * 2 + 1] << 8);
+						};
+
+					// The saves are relative to the establisher frame: the frame register once UWOP_SET_FPREG
+					// has run (rsp may have moved after it, by alloca for one), else rsp
+					auto frame = context.gpr[REG_RSP];
+					if (frame_register)
+					{
+						bool set = !primary || (offset >= size_of_prolog);
+						for (std::uint32_t i = 0; !set && (i < count_codes);)
+						{
+							auto operation = (std::uint8_t)(codes[i * 2 + 1] & 0xF);
+							auto slots = CountSlots(operation, (std::uint32_t)(codes[i * 2 + 1] >> 4));
+							if (!slots)
+								return false;
+
+							set = (operation == UWOP_SET_FPREG) && ((std::uint32_t)codes[i * 2] <= offset);
+							i += slots;
+						}
+
+						if (set)
+							frame = context.gpr[frame_register] - frame_offset;
+					}
+
+					for (std::uint32_t i = 0; i < count_codes;)
+					{
+						auto code_offset = (std::uint32_t)codes[i * 2];
+						auto operation = (std::uint8_t)(codes[i * 2 + 1] & 0xF);
+						auto info = (std::uint32_t)(codes[i * 2 + 1] >> 4);
+						auto slots = CountSlots(operation, info);
+						if (!slots || ((i + slots) > count_codes))
+							return false;
+
+						// In the prolog only the instructions that have run are undone,
+						// the prolog of a chained entry has run entirely
+						if (primary && (offset < size_of_prolog) && (code_offset > offset))
+						{
+							i += slots;
+							continue;
+						}
+
+						auto& rsp = context.gpr[REG_RSP];
+						switch (operation)
+						{
+						case UWOP_PUSH_NONVOL:
+							if (!stack.Read(rsp, context.gpr[info]))
+								return false;
+							rsp += 8;
+							break;
+						case UWOP_ALLOC_LARGE:
+							rsp += info ? (slot(i + 1) | (slot(i + 2) << 16)) : slot(i + 1) * 8;
+							break;
+						case UWOP_ALLOC_SMALL:
+							rsp += info * 8 + 8;
+							break;
+						case UWOP_SET_FPREG:
+							rsp = context.gpr[frame_register] - frame_offset;
+							break;
+						case UWOP_SAVE_NONVOL:
+							if (!stack.Read(frame + slot(i + 1) * 8, context.gpr[info]))
+								return false;
+							break;
+						case UWOP_SAVE_NONVOL_FAR:
+							if (!stack.Read(frame + (slot(i + 1) | (slot(i + 2) << 16)), context.gpr[info]))
+								return false;
+							break;
+						case UWOP_PUSH_MACHFRAME:
+						{
+							// The processor has pushed SS, RSP, EFLAGS, CS, RIP and maybe an error code
+							auto frame = rsp + (info ? 8 : 0);
+							return stack.Read(frame, context.rip) && stack.Read(frame + 24, rsp);
+						}
+						default:
+							// The XMM registers are not needed, UWOP_EPILOG only describes the epilogs
+							break;
+						}
+
+						i += slots;
+					}
+
+					if (!(flags & UNW_FLAG_CHAININFO))
+						break;
+
+					entry = (const RuntimeFunction*)RvaToPointer(entry->unwind_data + 4 + ((count_codes + 1) & ~1u) * 2,
+						sizeof(RuntimeFunction));
+					unwind = entry ? (const std::uint8_t*)RvaToPointer(entry->unwind_data, 4) : nullptr;
+					if (!unwind)
+						return false;
+
+					primary = false;
+				}
+
+				return stack.PopReturn(context);
+			}
+		private:
+			[[nodiscard]] static std::uint32_t CountSlots(std::uint8_t operation, std::uint32_t info) noexcept(true)
+			{
+				switch (operation)
+				{
+				case UWOP_PUSH_NONVOL:
+				case UWOP_ALLOC_SMALL:
+				case UWOP_SET_FPREG:
+				case UWOP_PUSH_MACHFRAME:
+					return 1;
+				case UWOP_ALLOC_LARGE:
+					return info ? 3 : 2;
+				case UWOP_SAVE_NONVOL:
+				case UWOP_EPILOG:
+				case UWOP_SAVE_XMM128:
+					return 2;
+				case UWOP_SAVE_NONVOL_FAR:
+				case UWOP_SPARE_CODE:
+				case UWOP_SAVE_XMM128_FAR:
+					return 3;
+				default:
+					return 0;
+				}
+			}
+
+			// The instructions that the epilogs are made of are the longest (7 bytes), int3 past the image
+			void FetchCode(std::uint32_t rva, std::uint8_t(&code)[8]) const noexcept(true)
+			{
+				for (std::uint32_t i = 0; i < 8; i++)
+				{
+					auto byte = (const std::uint8_t*)RvaToPointer(rva + i, 1);
+					code[i] = byte ? *byte : 0xCC;
+				}
+			}
+
+			// The epilog form of the x64 ABI: "add rsp, n" or "lea rsp, [reg + n]", pops, then ret or jmp
+			// (to a shared epilog of the function or an indirect tail call)
+			[[nodiscard]] bool IsEpilog(std::uint32_t rva, const RuntimeFunction& entry) const noexcept(true)
+			{
+				std::uint8_t code[8];
+				FetchCode(rva, code);
+
+				if ((code[0] & 0xF8) == 0x48)
+				{
+					if ((code[0] == 0x48) && (code[1] == 0x81) && (code[2] == 0xC4))
+						rva += 7;
+					else if ((code[0] == 0x48) && (code[1] == 0x83) && (code[2] == 0xC4))
+						rva += 4;
+					else if ((code[1] == 0x8D) && !(code[0] & 0x06) && (((code[2] >> 3) & 7) == REG_RSP) &&
+						((code[2] & 7) != 4) && (((code[2] >> 6) == 1) || ((code[2] >> 6) == 2)))
+						rva += ((code[2] >> 6) == 1) ? 4 : 7;
+				}
+
+				for (std::uint32_t i = 0; i < MAX_EPILOG_INSTRUCTIONS; i++)
+				{
+					FetchCode(rva, code);
+
+					auto at = ((code[0] & 0xF0) == 0x40) ? 1u : 0u;
+					auto op = code[at];
+					if ((op >= 0x58) && (op <= 0x5F))
+						rva += at + 1;
+					else if ((op == 0xC2) || (op == 0xC3))
+						return true;
+					else if ((op == 0xF3) && !at)
+						return code[1] == 0xC3;
+					else if ((op == 0xFF) && (code[at + 1] == 0x25))
+						return true;
+					else if ((op == 0xE9) || (op == 0xEB))
+					{
+						std::int32_t displacement;
+						if (op == 0xE9)
+							memcpy(&displacement, code + at + 1, sizeof(displacement));
+						else
+							displacement = (std::int8_t)code[at + 1];
+
+						auto target = rva + at + ((op == 0xE9) ? 5 : 2) + (std::uint32_t)displacement;
+						return (target >= entry.begin_address) && (target < entry.end_address);
+					}
+					else
+						return false;
+				}
+
+				return false;
+			}
+
+			// Runs the epilog that IsEpilog has found
+			[[nodiscard]] bool UnwindEpilog(std::uint32_t rva, Context& context, const StackView& stack) const noexcept(true)
+			{
+				std::uint8_t code[8];
+				FetchCode(rva, code);
+
+				auto& rsp = context.gpr[REG_RSP];
+				if ((code[0] & 0xF8) == 0x48)
+				{
+					std::int32_t displacement;
+					if (code[1] == 0x81)
+					{
+						memcpy(&displacement, code + 3, sizeof(displacement));
+						rsp += (std::int64_t)displacement;
+						rva += 7;
+					}
+					else if (code[1] == 0x83)
+					{
+						rsp += (std::int64_t)(std::int8_t)code[3];
+						rva += 4;
+					}
+					else if (code[1] == 0x8D)
+					{
+						auto base = context.gpr[(code[2] & 7) + ((code[0] & 1) ? 8 : 0)];
+						if ((code[2] >> 6) == 1)
+						{
+							rsp = base + (std::int64_t)(std::int8_t)code[3];
+							rva += 4;
+						}
+						else
+						{
+							memcpy(&displacement, code + 3, sizeof(displacement));
+							rsp = base + (std::int64_t)displacement;
+							rva += 7;
+						}
+					}
+				}
+
+				for (std::uint32_t i = 0; i < MAX_EPILOG_INSTRUCTIONS; i++)
+				{
+					FetchCode(rva, code);
+
+					auto at = ((code[0] & 0xF0) == 0x40) ? 1u : 0u;
+					auto op = code[at];
+					if ((op >= 0x58) && (op <= 0x5F))
+					{
+						if (!stack.Read(rsp, context.gpr[(op - 0x58) + ((at && (code[0] & 1)) ? 8 : 0)]))
+							return false;
+						rsp += 8;
+						rva += at + 1;
+					}
+					else if ((op == 0xE9) || (op == 0xEB))
+					{
+						std::int32_t displacement;
+						if (op == 0xE9)
+							memcpy(&displacement, code + at + 1, sizeof(displacement));
+						else
+							displacement = (std::int8_t)code[at + 1];
+
+						rva += at + ((op == 0xE9) ? 5 : 2) + (std::uint32_t)displacement;
+					}
+					else if (op == 0xC2)
+					{
+						std::uint16_t bytes;
+						memcpy(&bytes, code + at + 1, sizeof(bytes));
+						if (!stack.PopReturn(context))
+							return false;
+						rsp += bytes;
+						return true;
+					}
+					else
+						// ret, rep ret, the tail call
+						return stack.PopReturn(context);
+				}
+
+				return false;
+			}
+		};
+
+		// Name of an address inside a module: a virtual function, a patched place and so on.
+		// The name is not copied (ModuleTable::AddName keeps a copy), the tag and the index are left
+		// to the owner of the table.
+		struct Annotation
+		{
+			std::uint32_t rva;
+			std::uint16_t tag;
+			std::uint16_t index;
+			const char* name;
+		};
+
+		struct Module
+		{
+			std::string name;
+			std::uint64_t start;
+			std::uint64_t end;
+			Image image;
+			// Sorted by rva after Build()
+			std::vector<Annotation> annotations;
+
+			// Calls the function for the annotations in [begin, end)
+			template<typename T>
+			void ForEachAnnotation(std::uint32_t begin, std::uint32_t end, T&& func) const
+			{
+				auto it = std::lower_bound(annotations.begin(), annotations.end(), begin,
+					[](const Annotation& entry, std::uint32_t rva) { return entry.rva < rva; });
+				for (; (it != annotations.end()) && (it->rva < end); it++)
+					func(*it);
+			}
+		};
+
+		struct Symbol
+		{
+			const Module* module{ nullptr };
+			std::uint32_t rva{ 0 };
+			bool code{ false };
+			bool has_function{ false };
+			Function function{};
+		};
+
+		class ModuleTable
+		{
+			std::vector<Module> _modules;
+			// Names of the annotations owned by the table: the modules move when the vector grows,
+			// the elements of a deque don't move
+			std::deque<std::string> _names;
+
+			ModuleTable(const ModuleTable&) = delete;
+			ModuleTable& operator=(const ModuleTable&) = delete;
+		public:
+			ModuleTable() = default;
+
+			// The copy lives until the table is cleared
+			const char* AddName(std::string name)
+			{
+				return _names.emplace_back(std::move(name)).c_str();
+			}
+
+			// The image must stay valid as long as the table, the result is valid until the next Add()
+			Module& Add(std::string_view name, std::uint64_t base, const void* data, std::size_t size, bool loaded)
+			{
+				Module module;
+				module.name = name;
+				module.start = base;
+
+				if (module.image.Open(data, size, loaded))
+					module.end = base + module.image.GetSizeOfImage();
+				else
+					module.end = base + size;
+
+				return _modules.emplace_back(std::move(module));
+			}
+
+			void Build()
+			{
+				std::sort(_modules.begin(), _modules.end(),
+					[](const Module& a, const Module& b) { return a.start < b.start; });
+
+				for (auto& module : _modules)
+					std::stable_sort(module.annotations.begin(), module.annotations.end(),
+						[](const Annotation& a, const Annotation& b) { return a.rva < b.rva; });
+			}
+
+			void Clear()
+			{
+				_modules.clear();
+				_names.clear();
+			}
+
+			[[nodiscard]] inline std::size_t GetCount() const noexcept(true) { return _modules.size(); }
+			[[nodiscard]] inline bool IsEmpty() const noexcept(true) { return _modules.empty(); }
+			[[nodiscard]] inline std::vector<Module>::const_iterator begin() const noexcept(true) { return _modules.begin(); }
+			[[nodiscard]] inline std::vector<Module>::const_iterator end() const noexcept(true) { return _modules.end(); }
+
+			[[nodiscard]] const Module* Find(std::uint64_t address) const noexcept(true)
+			{
+				auto it = std::upper_bound(_modules.begin(), _modules.end(), address,
+					[](std::uint64_t address, const Module& module) { return address < module.start; });
+				if (it == _modules.begin())
+					return nullptr;
+
+				--it;
+				return (address < it->end) ? &(*it) : nullptr;
+			}
+
+			// Walks the stack from the context (the leaf first), the context is left at the last frame.
+			// Only the copy of the stack and the images are read, the thread may run on.
+			[[nodiscard]] std::uint32_t Unwind(Context& context, const StackView& stack, std::uintptr_t* frames,
+				std::uint32_t max_frames) const noexcept(true)
+			{
+				std::uint32_t count = 0;
+				while (context.rip && (count < max_frames))
+				{
+					frames[count++] = (std::uintptr_t)context.rip;
+
+					auto rsp = context.gpr[REG_RSP];
+					auto module = Find(context.rip);
+					bool result = (module && module->image.IsOpen()) ?
+						module->image.Unwind((std::uint32_t)(context.rip - module->start), context, stack) :
+						stack.PopReturn(context);
+
+					// The stack grows down, a caller below its callee is garbage
+					if (!result || (context.gpr[REG_RSP] <= rsp))
+						break;
+				}
+
+				return count;
+			}
+
+			[[nodiscard]] bool Symbolize(std::uint64_t address, Symbol& symbol) const noexcept(true)
+			{
+				symbol = Symbol();
+				symbol.module = Find(address);
+				if (!symbol.module)
+					return false;
+
+				symbol.rva = (std::uint32_t)(address - symbol.module->start);
+				if (symbol.module->image.IsOpen())
+				{
+					symbol.code = symbol.module->image.IsCode(symbol.rva);
+					if (symbol.code)
+						symbol.has_function = symbol.module->image.FindFunction(symbol.rva, symbol.function);
+				}
+
+				return true;
+			}
+		};
+	}
+}
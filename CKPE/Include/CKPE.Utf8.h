@@ -0,0 +1,242 @@
+﻿// Copyright © 2025 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/lgpl-3.0.html
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <memory>
+#include <bit>
+#include <immintrin.h>
+
+namespace CKPE
+{
+	// UTF-8 validation and the single-byte code page transcoding used by StringUtils. Shared with the fuzz tool,
+	// so it does not depend on Windows. GCC and Clang need -msse4.1, the caller checks the CPU for ValidateSSE41.
+	namespace Utf8
+	{
+		// Tables of a single-byte code page (CP1251, CP1252...): 256 entries towards Unicode and the BMP back
+		struct CodePage
+		{
+			bool valid{ false };
+			char default_char{ '?' };
+			std::uint16_t to_unicode[256]{};
+			std::unique_ptr<std::uint8_t[]> from_unicode;
+		};
+
+		[[nodiscard]] inline bool IsASCII(const std::uint8_t* data, std::size_t length) noexcept(true)
+		{
+			std::size_t i = 0;
+			for (; (i + 16) <= length; i += 16)
+				if (_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(data + i))))
+					return false;
+			for (; i < length; i++)
+				if (data[i] & 0x80) return false;
+			return true;
+		}
+
+		// Vectorized validation by the lookup algorithm of J. Keiser and D. Lemire (simdjson/simdutf).
+		// Each pair of adjacent bytes is classified by three 16-entry tables (high and low nibble of the first byte,
+		// high nibble of the second), the AND of the results is non-zero only for invalid pairs.
+		[[nodiscard]] inline bool ValidateSSE41(const std::uint8_t* data, std::size_t length) noexcept(true)
+		{
+			constexpr std::uint8_t TOO_SHORT = 1 << 0;
+			constexpr std::uint8_t TOO_LONG = 1 << 1;
+			constexpr std::uint8_t OVERLONG_3 = 1 << 2;
+			constexpr std::uint8_t TOO_LARGE = 1 << 3;
+			constexpr std::uint8_t SURROGATE = 1 << 4;
+			constexpr std::uint8_t OVERLONG_2 = 1 << 5;
+			constexpr std::uint8_t TOO_LARGE_1000 = 1 << 6;
+			constexpr std::uint8_t OVERLONG_4 = 1 << 6;
+			constexpr std::uint8_t TWO_CONTS = 1 << 7;
+			constexpr std::uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+			const auto byte_1_high_table = _mm_setr_epi8(
+				TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+				TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+				TOO_SHORT | OVERLONG_2,
+				TOO_SHORT,
+				TOO_SHORT | OVERLONG_3 | SURROGATE,
+				TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+			const auto byte_1_low_table = _mm_setr_epi8(
+				CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+				CARRY | OVERLONG_2,
+				CARRY,
+				CARRY,
+				CARRY | TOO_LARGE,
+				CARRY | TOO_LARGE | TOO_LARGE_1000,
+				CARRY | TOO_LARGE | TOO_LARGE_1000,
+				CARRY | TOO_LARGE | TOO_LARGE_1000,
+				CARRY | TOO_LARGE | TOO_LARGE_1000,
+				CARRY | TOO_LARGE | TOO_LARGE_1000,
+				CARRY | TOO_LARGE | TOO_LARGE_1000,
+				CARRY | TOO_LARGE | TOO_LARGE_1000,
+				CARRY | TOO_LARGE | TOO_LARGE_1000,
+				CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+				CARRY | TOO_LARGE | TOO_LARGE_1000,
+				CARRY | TOO_LARGE | TOO_LARGE_1000);
+			const auto byte_2_high_table = _mm_setr_epi8(
+				TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+				TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+				TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+				TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+				TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+				TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);
+			// The last bytes of a block that still expect continuation bytes
+			const auto incomplete_max = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+				(char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+			const auto nibble_mask = _mm_set1_epi8(0x0F);
+
+			auto error = _mm_setzero_si128();
+			auto prev_input = _mm_setzero_si128();
+			auto prev_incomplete = _mm_setzero_si128();
+
+			auto check_block = [&](__m128i input)
+				{
+					// ASCII block, only the sequence left open in the previous block can be wrong
+					if (!_mm_movemask_epi8(input))
+					{
+						error = _mm_or_si128(error, prev_incomplete);
+						return;
+					}
+
+					auto prev1 = _mm_alignr_epi8(input, prev_input, 15);
+					auto special = _mm_and_si128(
+						_mm_and_si128(
+							_mm_shuffle_epi8(byte_1_high_table, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble_mask)),
+							_mm_shuffle_epi8(byte_1_low_table, _mm_and_si128(prev1, nibble_mask))),
+						_mm_shuffle_epi8(byte_2_high_table, _mm_and_si128(_mm_srli_epi16(input, 4), nibble_mask)));
+
+					// Third and fourth bytes of the sequence must be continuation bytes, and only them
+					auto prev2 = _mm_alignr_epi8(input, prev_input, 14);
+					auto prev3 = _mm_alignr_epi8(input, prev_input, 13);
+					auto must23 = _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8((char)(0xE0 - 0x80))),
+						_mm_subs_epu8(prev3, _mm_set1_epi8((char)(0xF0 - 0x80))));
+					auto must23_80 = _mm_and_si128(must23, _mm_set1_epi8((char)0x80));
+
+					error = _mm_or_si128(error, _mm_xor_si128(must23_80, special));
+					prev_incomplete = _mm_subs_epu8(input, incomplete_max);
+				};
+
+			std::size_t i = 0;
+			for (; (i + 16) <= length; i += 16)
+			{
+				auto input = _mm_loadu_si128((const __m128i*)(data + i));
+				check_block(input);
+				prev_input = input;
+			}
+
+			if (i < length)
+			{
+				// The tail is padded with zeros, they are ASCII and close nothing
+				alignas(16) std::uint8_t tail[16]{};
+				memcpy(tail, data + i, length - i);
+				check_block(_mm_load_si128((const __m128i*)tail));
+			}
+
+			error = _mm_or_si128(error, prev_incomplete);
+			return _mm_testz_si128(error, error);
+		}
+
+		// Returns the number of bytes of the sequence, the code point is -1 for an invalid sequence
+		[[nodiscard]] inline std::size_t Decode(const std::uint8_t* data, std::size_t length,
+			std::uint32_t& code) noexcept(true)
+		{
+			auto c = data[0];
+			std::size_t count;
+
+			if (c < 0x80) { code = c; return 1; }
+			else if ((c & 0xE0) == 0xC0) { code = c & 0x1F; count = 2; }
+			else if ((c & 0xF0) == 0xE0) { code = c & 0x0F; count = 3; }
+			else if ((c & 0xF8) == 0xF0) { code = c & 0x07; count = 4; }
+			else { code = (std::uint32_t)-1; return 1; }
+
+			if (count > length)
+			{
+				code = (std::uint32_t)-1;
+				return length;
+			}
+
+			for (std::size_t i = 1; i < count; i++)
+			{
+				if ((data[i] & 0xC0) != 0x80)
+				{
+					code = (std::uint32_t)-1;
+					return i;
+				}
+
+				code = (code << 6) | (data[i] & 0x3F);
+			}
+
+			return count;
+		}
+
+		inline void ToCodePage(const CodePage& codepage, const std::string& src, std::string& dst) noexcept(true)
+		{
+			auto data = (const std::uint8_t*)src.data();
+			auto length = src.length();
+
+			dst.resize(length);
+			auto out = dst.data();
+
+			for (std::size_t i = 0; i < length;)
+			{
+				// ASCII runs are copied by blocks
+				if ((i + 16) <= length)
+				{
+					auto mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(data + i)));
+					if (!mask)
+					{
+						memcpy(out, data + i, 16);
+						out += 16;
+						i += 16;
+						continue;
+					}
+
+					auto ascii = (std::size_t)std::countr_zero((unsigned int)mask);
+					memcpy(out, data + i, ascii);
+					out += ascii;
+					i += ascii;
+				}
+
+				std::uint32_t code;
+				i += Decode(data + i, length - i, code);
+				*out++ = (code < 0x10000) ? (char)codepage.from_unicode[code] : codepage.default_char;
+			}
+
+			dst.resize((std::size_t)(out - dst.data()));
+		}
+
+		inline void FromCodePage(const CodePage& codepage, const std::string& src, std::string& dst) noexcept(true)
+		{
+			auto data = (const std::uint8_t*)src.data();
+			auto length = src.length();
+
+			// Single-byte code pages are in the BMP, 3 bytes at most
+			dst.resize(length * 3);
+			auto out = (std::uint8_t*)dst.data();
+
+			for (std::size_t i = 0; i < length; i++)
+			{
+				auto code = codepage.to_unicode[data[i]];
+				if (code < 0x80)
+					*out++ = (std::uint8_t)code;
+				else if (code < 0x800)
+				{
+					*out++ = (std::uint8_t)(0xC0 | (code >> 6));
+					*out++ = (std::uint8_t)(0x80 | (code & 0x3F));
+				}
+				else
+				{
+					*out++ = (std::uint8_t)(0xE0 | (code >> 12));
+					*out++ = (std::uint8_t)(0x80 | ((code >> 6) & 0x3F));
+					*out++ = (std::uint8_t)(0x80 | (code & 0x3F));
+				}
+			}
+
+			dst.resize((std::size_t)(out - (std::uint8_t*)dst.data()));
+		}
+	}
+}
@@ -8,9 +8,14 @@
 #include <cstdarg>
 #include <filesystem>
 #include <array>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <algorithm>
 #include <CKPE.Logger.h>
 #include <CKPE.ErrorHandler.h>
 #include <CKPE.StringUtils.h>
+#include <CKPE.LogIndex.h>
 
 namespace CKPE
 {
@@ -23,9 +28,116 @@ namespace CKPE
 			"[FATALERROR] ",
 	};
 
+	constexpr static std::array TYPEMSG_SEVERITY{
+			"info",
+			"warning",
+			"error",
+			"fatal",
+	};
+
+	constexpr static std::size_t LOGGER_SLOT_TEXT = 240;
+	constexpr static std::size_t LOGGER_MIN_SLOTS = 256;
+	constexpr static std::size_t LOGGER_BATCH_SIZE = 64 * 1024;
+	constexpr static DWORD LOGGER_WRITER_INTERVAL = 50;
+	constexpr static DWORD LOGGER_WRITER_STOP_TIMEOUT = 2000;
+	constexpr static std::size_t LOGGER_STRUCTURED_BUFFER = 1024 * 1024;
+	// A segment of the index is written each time the structured log grows by this much
+	constexpr static std::uint64_t LOGGER_INDEX_SEGMENT = 16 * 1024 * 1024;
+	// 100-ns intervals between 1601 and 1970
+	constexpr static std::uint64_t LOGGER_UNIX_EPOCH = 116444736000000000ull;
+
+	struct LoggerSlot
+	{
+		std::atomic_size_t sequence;
+		std::size_t length;
+		// Text that does not fit into the slot
+		char* heap;
+		char text[LOGGER_SLOT_TEXT];
+	};
+
+	// Bounded multi-producer queue (D. Vyukov), the only consumer is whoever holds the section of the logger
+	struct Logger::AsyncQueue
+	{
+		std::unique_ptr<LoggerSlot[]> slots;
+		std::size_t mask{ 0 };
+		bool block_when_full{ false };
+		alignas(64) std::atomic_size_t enqueue_pos{ 0 };
+		alignas(64) std::size_t dequeue_pos{ 0 };
+		std::atomic_uint64_t dropped{ 0 };
+		HANDLE wake_event{ nullptr };
+		HANDLE close_event{ nullptr };
+		std::thread* writer{ nullptr };
+		std::unique_ptr<char[]> batch;
+	};
+
+	struct Logger::StructuredSink
+	{
+		CriticalSection section;
+		FILE* file{ nullptr };
+		FILE* index_file{ nullptr };
+		std::wstring fname;
+		std::uint64_t offset{ 0 };
+		std::uint64_t segment_start{ 0 };
+		std::string line;
+		LogIndex::Builder index;
+
+		// The lines of the segment are flushed first, the index never points past the end of the log
+		void WriteSegment() noexcept(true)
+		{
+			if (!index_file || index.Empty())
+				return;
+
+			fflush(file);
+			if (index.Write(index_file, offset))
+				fflush(index_file);
+			else
+			{
+				// A broken segment would end the index for the reader anyway
+				fclose(index_file);
+				index_file = nullptr;
+			}
+
+			index = LogIndex::Builder();
+			segment_start = offset;
+		}
+	};
+
+	static void AppendJsonString(std::string& out, const char* text, std::size_t length) noexcept(true)
+	{
+		constexpr static char HEX[] = "0123456789abcdef";
+
+		out.push_back('"');
+		for (std::size_t i = 0; i < length; i++)
+		{
+			auto ch = (unsigned char)text[i];
+			switch (ch)
+			{
+			case '"': out.append("\\\""); break;
+			case '\\': out.append("\\\\"); break;
+			case '\n': out.append("\\n"); break;
+			case '\r': out.append("\\r"); break;
+			case '\t': out.append("\\t"); break;
+			default:
+				if (ch < 0x20)
+				{
+					out.append("\\u00");
+					out.push_back(HEX[ch >> 4]);
+					out.push_back(HEX[ch & 0xF]);
+				}
+				else
+					out.push_back((char)ch);
+				break;
+			}
+		}
+		out.push_back('"');
+	}
+
 	Logger::~Logger()
 	{
 		Close();
+
+		delete _structured;
+		_structured = nullptr;
 	}
 
 	bool Logger::Open(const std::string& fname) noexcept(true)
@@ -84,6 +196,10 @@ namespace CKPE
 
 	void Logger::Close() noexcept(true)
 	{
+		// Before the section is taken, the writer needs it to finish
+		DisableAsync();
+		DisableStructured();
+
 		ScopeCriticalSection guard{ _section };
 
 		if (HasOpen())
@@ -105,6 +221,330 @@ namespace CKPE
 		return &_slogger;
 	}
 
+	bool Logger::EnableAsync(std::uint32_t buffer_size, bool block_when_full) noexcept(true)
+	{
+		ScopeCriticalSection guard{ _section };
+
+		if (_queue.load(std::memory_order_acquire))
+			return true;
+
+		auto count = std::max((std::size_t)buffer_size / sizeof(LoggerSlot), LOGGER_MIN_SLOTS);
+		std::size_t slots = 1;
+		while (slots < count) slots <<= 1;
+
+		auto queue = new AsyncQueue;
+		queue->slots = std::make_unique<LoggerSlot[]>(slots);
+		queue->batch = std::make_unique<char[]>(LOGGER_BATCH_SIZE);
+		queue->mask = slots - 1;
+		queue->block_when_full = block_when_full;
+		for (std::size_t i = 0; i < slots; i++)
+		{
+			queue->slots[i].sequence.store(i, std::memory_order_relaxed);
+			queue->slots[i].heap = nullptr;
+		}
+
+		queue->wake_event = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+		queue->close_event = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+		if (!queue->wake_event || !queue->close_event)
+		{
+			if (queue->wake_event) CloseHandle(queue->wake_event);
+			if (queue->close_event) CloseHandle(queue->close_event);
+			delete queue;
+			return false;
+		}
+
+		queue->writer = new std::thread([this](AsyncQueue* queue)
+			{
+				HANDLE handles[2] = { queue->close_event, queue->wake_event };
+
+				while (true)
+				{
+					auto result = WaitForMultipleObjects(2, handles, FALSE, LOGGER_WRITER_INTERVAL);
+
+					{
+						ScopeCriticalSection guard{ _section };
+						DrainQueue(queue);
+					}
+
+					if (result == WAIT_OBJECT_0)
+						break;
+				}
+			}, queue);
+
+		_queue.store(queue, std::memory_order_release);
+		return true;
+	}
+
+	void Logger::DisableAsync() noexcept(true)
+	{
+		// New messages go straight to the file from here on
+		auto queue = _queue.exchange(nullptr);
+		if (!queue)
+			return;
+
+		// Writers that took the queue before finish their messages, the writer thread still makes room for them
+		while (_queue_users.load())
+			Sleep(1);
+
+		SetEvent(queue->close_event);
+		bool stopped = WaitForSingleObject(queue->writer->native_handle(), LOGGER_WRITER_STOP_TIMEOUT) == WAIT_OBJECT_0;
+		if (stopped)
+			queue->writer->join();
+		else
+			queue->writer->detach();
+
+		ScopeCriticalSection guard{ _section };
+
+		DrainQueue(queue);
+		if (HasOpen())
+			fflush((FILE*)_handle);
+
+		// A writer that did not stop still refers to the queue
+		if (stopped)
+		{
+			for (std::size_t i = 0; i <= queue->mask; i++)
+				delete[] queue->slots[i].heap;
+
+			CloseHandle(queue->wake_event);
+			CloseHandle(queue->close_event);
+			delete queue->writer;
+			delete queue;
+		}
+	}
+
+	bool Logger::EnableStructured(const std::wstring& fname) noexcept(true)
+	{
+		ScopeCriticalSection guard{ _section };
+
+		if (!_structured)
+			_structured = new StructuredSink;
+
+		ScopeCriticalSection sink_guard{ _structured->section };
+
+		if (_structured->file)
+			return true;
+
+		auto file = _wfsopen(fname.c_str(), L"wb", _SH_DENYWR);
+		if (!file)
+			return false;
+
+		setvbuf(file, nullptr, _IOFBF, LOGGER_STRUCTURED_BUFFER);
+
+		// Also replaces a stale index, it would point into the old log
+		auto index_file = _wfsopen((fname + L".idx").c_str(), L"wb", _SH_DENYWR);
+		if (index_file)
+			setvbuf(index_file, nullptr, _IOFBF, LOGGER_STRUCTURED_BUFFER);
+		else
+			_wremove((fname + L".idx").c_str());
+
+		_structured->file = file;
+		_structured->index_file = index_file;
+		_structured->fname = fname;
+		_structured->offset = 0;
+		_structured->segment_start = 0;
+		_structured->line.reserve(1024);
+		_structured->index = LogIndex::Builder();
+
+		return true;
+	}
+
+	void Logger::DisableStructured() noexcept(true)
+	{
+		// The sink itself lives until the logger is destroyed, writers may still hold it
+		auto sink = _structured;
+		if (!sink)
+			return;
+
+		ScopeCriticalSection guard{ sink->section };
+
+		if (!sink->file)
+			return;
+
+		sink->WriteSegment();
+
+		fclose(sink->file);
+		sink->file = nullptr;
+
+		if (sink->index_file)
+		{
+			fclose(sink->index_file);
+			sink->index_file = nullptr;
+		}
+
+		sink->index = LogIndex::Builder();
+		sink->line.clear();
+		sink->line.shrink_to_fit();
+	}
+
+	bool Logger::HasStructured() const noexcept(true)
+	{
+		return _structured && _structured->file;
+	}
+
+	void Logger::WriteStructured(TypeMsg type_msg, const char* source, const char* message,
+		std::size_t length) const noexcept(true)
+	{
+		auto sink = _structured;
+		if (!sink || !message)
+			return;
+
+		// The line breaks at the end belong to the text log
+		while (length && ((message[length - 1] == '\n') || (message[length - 1] == '\r')))
+			length--;
+
+		FILETIME time;
+		GetSystemTimePreciseAsFileTime(&time);
+		auto ms = ((((std::uint64_t)time.dwHighDateTime << 32) | time.dwLowDateTime) - LOGGER_UNIX_EPOCH) / 10000;
+
+		ScopeCriticalSection guard{ sink->section };
+
+		if (!sink->file)
+			return;
+
+		char head[128];
+		auto head_length = _snprintf_s(head, _TRUNCATE, "{\"t\":%llu,\"tid\":%lu,\"sev\":\"%s\",\"src\":",
+			ms, GetCurrentThreadId(), TYPEMSG_SEVERITY[type_msg]);
+		if (head_length < 0)
+			return;
+
+		auto& line = sink->line;
+		line.assign(head, (std::size_t)head_length);
+		AppendJsonString(line, source, strlen(source));
+		line.append(",\"msg\":");
+		AppendJsonString(line, message, length);
+		line.append("}\n");
+
+		if (fwrite(line.data(), 1, line.length(), sink->file) != line.length())
+			return;
+
+		sink->index.Add(sink->offset, std::string_view(message, length));
+		sink->offset += line.length();
+
+		if ((sink->offset - sink->segment_start) >= LOGGER_INDEX_SEGMENT)
+			sink->WriteSegment();
+		// Errors should survive a crash
+		else if (type_msg != TypeMsg::tMessage)
+			fflush(sink->file);
+	}
+
+	Logger::AsyncQueue* Logger::AcquireQueue() const noexcept(true)
+	{
+		// Counted before the queue is read, so DisableAsync either sees the writer or the writer sees no queue
+		_queue_users.fetch_add(1);
+		auto queue = _queue.load();
+		if (!queue)
+			_queue_users.fetch_sub(1);
+
+		return queue;
+	}
+
+	void Logger::ReleaseQueue() const noexcept(true)
+	{
+		_queue_users.fetch_sub(1);
+	}
+
+	bool Logger::Enqueue(AsyncQueue* queue, TypeMsg type_msg, const char* message, std::size_t length, 
+		bool new_line) const noexcept(true)
+	{
+		auto prefix = TYPEMSG_PREFIX[type_msg];
+		auto prefix_length = strlen(prefix);
+		auto total = prefix_length + length + (new_line ? 1 : 0);
+
+		auto pos = queue->enqueue_pos.load(std::memory_order_relaxed);
+		LoggerSlot* slot;
+
+		while (true)
+		{
+			slot = &queue->slots[pos & queue->mask];
+			auto diff = (std::intptr_t)slot->sequence.load(std::memory_order_acquire) - (std::intptr_t)pos;
+
+			if (!diff)
+			{
+				if (queue->enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+				// Full
+				return false;
+			else
+				pos = queue->enqueue_pos.load(std::memory_order_relaxed);
+		}
+
+		auto text = slot->text;
+		if (total > LOGGER_SLOT_TEXT)
+			text = slot->heap = new char[total];
+
+		memcpy(text, prefix, prefix_length);
+		memcpy(text + prefix_length, message, length);
+		if (new_line) text[total - 1] = '\n';
+		slot->length = total;
+
+		slot->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	void Logger::DrainQueue(AsyncQueue* queue) const noexcept(true)
+	{
+		auto batch = queue->batch.get();
+		std::size_t used = 0;
+		bool written = false;
+
+		auto write_batch = [&]()
+			{
+				if (used && HasOpen())
+				{
+					fwrite(batch, 1, used, (FILE*)_handle);
+					written = true;
+				}
+				used = 0;
+			};
+
+		auto dropped = queue->dropped.exchange(0);
+		if (dropped)
+			used = (std::size_t)std::max(_snprintf_s(batch, LOGGER_BATCH_SIZE, _TRUNCATE,
+				"[WARNING] The log buffer was full, %llu messages were dropped\n", dropped), 0);
+
+		while (true)
+		{
+			auto pos = queue->dequeue_pos;
+			auto& slot = queue->slots[pos & queue->mask];
+			if (slot.sequence.load(std::memory_order_acquire) != (pos + 1))
+				break;
+
+			auto text = slot.heap ? slot.heap : slot.text;
+			if ((used + slot.length) > LOGGER_BATCH_SIZE)
+				write_batch();
+
+			if (slot.length > LOGGER_BATCH_SIZE)
+			{
+				if (HasOpen())
+				{
+					fwrite(text, 1, slot.length, (FILE*)_handle);
+					written = true;
+				}
+			}
+			else
+			{
+				memcpy(batch + used, text, slot.length);
+				used += slot.length;
+			}
+
+			if (slot.heap)
+			{
+				delete[] slot.heap;
+				slot.heap = nullptr;
+			}
+
+			slot.sequence.store(pos + queue->mask + 1, std::memory_order_release);
+			queue->dequeue_pos = pos + 1;
+		}
+
+		write_batch();
+
+		if (written && HasAutoFlush())
+			fflush((FILE*)_handle);
+	}
+
 	void Logger::Write(const std::string& formatted_message, ...) const noexcept(true)
 	{
 		va_list ap;
@@ -134,7 +574,7 @@ namespace CKPE
 		_vswprintf(string_done.data(), formatted_message.c_str(), (va_list)ap);
 		va_end(ap);
 
-		WriteString(TypeMsg::tMessage, StringUtils::Utf16ToUtf8(string_done));
+		WriteString(TypeMsg::tMessage, string_done);
 	}
 
 	void Logger::Write(TypeMsg type_msg, const std::string& formatted_message, ...) const noexcept(true)
@@ -166,19 +606,48 @@ namespace CKPE
 		_vswprintf(string_done.data(), formatted_message.c_str(), (va_list)ap);
 		va_end(ap);
 
-		WriteString(type_msg, StringUtils::Utf16ToUtf8(string_done));
+		WriteString(type_msg, string_done);
 	}
 
 	void Logger::Flush() const noexcept(true)
 	{
 		ScopeCriticalSection guard{ _section };
 
+		// DisableAsync deletes the queue only under the section
+		if (auto queue = _queue.load(std::memory_order_acquire); queue)
+			DrainQueue(queue);
+
 		if (HasOpen())
 			fflush((FILE*)_handle);
+
+		if (auto sink = _structured; sink)
+		{
+			ScopeCriticalSection sink_guard{ sink->section };
+			if (sink->file)
+				fflush(sink->file);
+		}
 	}
 
 	void Logger::NewLine() const noexcept(true)
 	{
+		if (auto queue = AcquireQueue(); queue)
+		{
+			while (!Enqueue(queue, TypeMsg::tMessage, "\n", 1, false))
+			{
+				if (!queue->block_when_full)
+				{
+					queue->dropped.fetch_add(1, std::memory_order_relaxed);
+					break;
+				}
+
+				SetEvent(queue->wake_event);
+				Sleep(1);
+			}
+
+			ReleaseQueue();
+			return;
+		}
+
 		ScopeCriticalSection guard{ _section };
 
 		if (HasOpen())
@@ -187,6 +656,60 @@ namespace CKPE
 
 	void Logger::WriteString(TypeMsg type_msg, const std::string& message) const noexcept(true)
 	{
+		WriteMessage(type_msg, message, false);
+	}
+
+	void Logger::WriteString(TypeMsg type_msg, const std::wstring& message) const noexcept(true)
+	{
+		WriteMessage(type_msg, StringUtils::Utf16ToUtf8(message), true);
+	}
+
+	void Logger::WriteMessage(TypeMsg type_msg, const std::string& message, bool utf8) const noexcept(true)
+	{
+		if (_structured)
+		{
+			// JSON is UTF-8, as the console lines
+			if (utf8)
+				WriteStructured(type_msg, "ckpe", message.c_str(), message.length());
+			else
+			{
+				auto text = StringUtils::WinCPToUtf8(message);
+				WriteStructured(type_msg, "ckpe", text.c_str(), text.length());
+			}
+		}
+
+		if (auto queue = AcquireQueue(); queue)
+		{
+			while (!Enqueue(queue, type_msg, message.c_str(), message.length(), HasAlwaysNewLine()))
+			{
+				if (!queue->block_when_full)
+				{
+					queue->dropped.fetch_add(1, std::memory_order_relaxed);
+					break;
+				}
+
+				SetEvent(queue->wake_event);
+				Sleep(1);
+			}
+
+			// Errors are written without waiting for the interval
+			if (type_msg != TypeMsg::tMessage)
+				SetEvent(queue->wake_event);
+
+			ReleaseQueue();
+
+			if (HasOutputDebugger() && IsDebuggerPresent())
+				OutputDebugStringA(message.c_str());
+
+			if ((type_msg == TypeMsg::tFatalError) && HasIfFatalErrorTriggerErrorHandler())
+			{
+				Flush();
+				ErrorHandler::Trigger(message);
+			}
+
+			return;
+		}
+
 		ScopeCriticalSection guard{ _section };
 
 		if (HasOpen())
@@ -214,11 +737,6 @@ namespace CKPE
 		}
 	}
 
-	void Logger::WriteString(TypeMsg type_msg, const std::wstring& message) const noexcept(true)
-	{
-		WriteString(type_msg, StringUtils::Utf16ToUtf8(message));
-	}
-
 #ifndef CKPE_NO_LOGGER_FUNCTION
 	CKPE_API void _FATALERROR(const std::string_view& formatted_message, ...)
 	{
@@ -261,7 +779,7 @@ namespace CKPE
 		va_list ap;
 		va_start(ap, &formatted_message);
 		_slogger.WriteString(Logger::tFatalError,
-			StringUtils::Utf16ToUtf8(StringUtils::FormatStringVa(formatted_message.data(), ap)));
+			StringUtils::FormatStringVa(formatted_message.data(), ap));
 		va_end(ap);
 	}
 
@@ -270,7 +788,7 @@ namespace CKPE
 		va_list ap;
 		va_start(ap, &formatted_message);
 		_slogger.WriteString(Logger::tError,
-			StringUtils::Utf16ToUtf8(StringUtils::FormatStringVa(formatted_message.data(), ap)));
+			StringUtils::FormatStringVa(formatted_message.data(), ap));
 		va_end(ap);
 	}
 
@@ -279,7 +797,7 @@ namespace CKPE
 		va_list ap;
 		va_start(ap, &formatted_message);
 		_slogger.WriteString(Logger::tWarning,
-			StringUtils::Utf16ToUtf8(StringUtils::FormatStringVa(formatted_message.data(), ap)));
+			StringUtils::FormatStringVa(formatted_message.data(), ap));
 		va_end(ap);
 	}
 
@@ -288,7 +806,7 @@ namespace CKPE
 		va_list ap;
 		va_start(ap, &formatted_message);
 		_slogger.WriteString(Logger::tMessage,
-			StringUtils::Utf16ToUtf8(StringUtils::FormatStringVa(formatted_message.data(), ap)));
+			StringUtils::FormatStringVa(formatted_message.data(), ap));
 		va_end(ap);
 	}
 #endif // !CKPE_NO_LOGGER_FUNCTION
@@ -7,7 +7,10 @@
 #include <cstdio>
 #include <cstdlib>
 #include <memory>
+#include <intrin.h>
 #include <CKPE.StringUtils.h>
+#include <CKPE.Utf8.h>
+#include <CKPE.HardwareInfo.h>
 #include "Impl/utfcpp/utf8.h"
 #include "Impl/utf8.h"
 
@@ -15,11 +18,64 @@
 
 namespace CKPE
 {
+	// Tables of the active single-byte code page (CP1251, CP1252...), built once from the Win32 conversion
+	// so that the result is the same, including the best fit characters.
+	// Multi-byte code pages (CJK) are not supported by the tables and go through Win32.
+	struct SingleByteCodePage : public Utf8::CodePage
+	{
+		SingleByteCodePage() noexcept(true)
+		{
+			CPINFO info{};
+			if (!GetCPInfo(CP_ACP, &info) || (info.MaxCharSize != 1))
+				return;
+
+			default_char = (char)info.DefaultChar[0];
+
+			char bytes[256];
+			for (std::uint32_t i = 0; i < 256; i++)
+				bytes[i] = (char)i;
+
+			if (MultiByteToWideChar(CP_ACP, MB_PRECOMPOSED, bytes, 256, (wchar_t*)to_unicode, 256) != 256)
+				return;
+
+			from_unicode = std::make_unique<std::uint8_t[]>(0x10000);
+			auto chars = std::make_unique<wchar_t[]>(0x10000);
+			for (std::uint32_t i = 0; i < 0x10000; i++)
+				chars[i] = (wchar_t)i;
+
+			// Lone surrogates are skipped, they cannot come from valid utf-8
+			memset(from_unicode.get() + 0xD800, (std::uint8_t)default_char, 0x800);
+			if ((WideCharToMultiByte(CP_ACP, 0, chars.get(), 0xD800, (char*)from_unicode.get(), 0xD800,
+					nullptr, nullptr) != 0xD800) ||
+				(WideCharToMultiByte(CP_ACP, 0, chars.get() + 0xE000, 0x2000, (char*)from_unicode.get() + 0xE000,
+					0x2000, nullptr, nullptr) != 0x2000))
+			{
+				from_unicode.reset();
+				return;
+			}
+
+			valid = true;
+		}
+	};
+
+	[[nodiscard]] static const SingleByteCodePage& GetCodePage() noexcept(true)
+	{
+		static SingleByteCodePage codepage;
+		return codepage;
+	}
+
+	[[nodiscard]] static bool ValidateUtf8(const std::uint8_t* data, std::size_t length) noexcept(true)
+	{
+		static const bool support_sse41 = HardwareInfo::CPU::HasSupportSSE41();
+		if (support_sse41)
+			return Utf8::ValidateSSE41(data, length);
+
+		return utf8::is_valid(data, data + length);
+	}
+
 	bool StringUtils::IsASCII(const std::string& src) noexcept(true)
 	{
-		for (std::size_t i = 0; i < src.length(); i++)
-			if (src[i] & 0x80) return false;
-		return true;
+		return Utf8::IsASCII((const std::uint8_t*)src.data(), src.length());
 	}
 
 	bool StringUtils::IsUtf8(const std::string& src) noexcept(true)
@@ -98,16 +154,14 @@ namespace CKPE
 
 		return true;
 #else
-		return utf8::is_valid(src);
+		return ValidateUtf8((const std::uint8_t*)src.data(), src.length());
 #endif // DEBUG
 	}
 
 	bool StringUtils::IsASCII(const char* src) noexcept(true)
 	{
 		if (!src) return false;
-		for (std::size_t i = 0; src[i]; i++)
-			if (src[i] & 0x80) return false;
-		return true;
+		return Utf8::IsASCII((const std::uint8_t*)src, strlen(src));
 	}
 
 	bool StringUtils::IsUtf8(const char* src) noexcept(true)
@@ -188,7 +242,7 @@ namespace CKPE
 
 		return true;
 #else
-		return utf8::is_valid(src);
+		return ValidateUtf8((const std::uint8_t*)src, strlen(src));
 #endif // DEBUG
 	}
 
@@ -274,6 +328,14 @@ namespace CKPE
 			}
 		}
 #else
+		auto& codepage = GetCodePage();
+		if (codepage.valid)
+		{
+			std::string r;
+			Utf8::ToCodePage(codepage, src, r);
+			return r;
+		}
+
 		std::wstring u16s;
 		utf8::utf8to16(src.begin(), src.end(), std::back_inserter(u16s));
 
@@ -300,6 +362,14 @@ namespace CKPE
 	{
 		if (IsASCII(src) || !src.length()) return src;
 
+		auto& codepage = GetCodePage();
+		if (codepage.valid)
+		{
+			std::string r;
+			Utf8::FromCodePage(codepage, src, r);
+			return r;
+		}
+
 		auto len = MultiByteToWideChar(CP_ACP, MB_PRECOMPOSED, src.c_str(), (int)src.length(), 0, 0);
 		if (len > 0)
 		{
@@ -49,6 +49,12 @@ namespace voltek
 	// Возвращает размер памяти выделенной под указатель.
 	// Вернёт 0 при ошибке, что значит, указатель на память не пренадлежит менеджеру.
 	VOLTEK_MM_API size_t scalable_msize(const void* ptr);
+	// Возвращает системе пустые страницы и сбрасывает кэш свободных блоков.
+	// Вернёт кол-во освобождённых страниц.
+	// Заполнение кэша приостанавливается до вызова scalable_memory_resume_prefill.
+	VOLTEK_MM_API size_t scalable_memory_trim();
+	// Возобновляет заполнение кэша свободных блоков, когда памяти снова достаточно.
+	VOLTEK_MM_API void scalable_memory_resume_prefill();
 }
 
 #ifdef __cplusplus
@@ -69,4 +69,16 @@ namespace voltek
 		if (!memory_manager::global_memory_manager) return 0;
 		return memory_manager::global_memory_manager->msize(ptr);
 	}
+
+	VOLTEK_MM_API size_t scalable_memory_trim()
+	{
+		if (!memory_manager::global_memory_manager) return 0;
+		return memory_manager::global_memory_manager->trim();
+	}
+
+	VOLTEK_MM_API void scalable_memory_resume_prefill()
+	{
+		if (!memory_manager::global_memory_manager) return;
+		memory_manager::global_memory_manager->resume_prefill();
+	}
 }
\ No newline at end of file
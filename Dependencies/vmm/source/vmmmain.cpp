@@ -121,9 +121,10 @@ namespace voltek
 			}
 
 			thread = new std::thread([](HANDLE* ev_close, HANDLE* ev_close_w, void** pools, 
-				voltek::core::_internal::simple_lock* lock) {
+				voltek::core::_internal::simple_lock* lock, std::atomic_bool* paused) {
 				while (1)
 				{
+					if (!paused->load(std::memory_order_relaxed))
 					{
 						// Блокируем. Снятие блокировки будет заботить компилятор.
 						voltek::core::_internal::simple_scope_lock scope_lock(*lock);
@@ -152,7 +153,7 @@ namespace voltek
 
 					Sleep(1);
 				}
-			}, (HANDLE*)&event_close, (HANDLE*)&event_close_w, pools, &lock);
+			}, (HANDLE*)&event_close, (HANDLE*)&event_close_w, pools, &lock, &prefill_paused);
 			_vassert(!thread);
 			SetThreadPriority(thread->native_handle(), THREAD_PRIORITY_HIGHEST);
 			_vassert(!SetThreadAffinityMask(thread->native_handle(), 1llu << (thread->hardware_concurrency() - 1)));
@@ -797,6 +798,41 @@ namespace voltek
 			return (size_t)get_size_from_ptr(ptr);
 		}
 
+		size_t memory_manager::trim()
+		{
+			if (!pools)
+				return 0;
+
+			// Кэш опустошается, и поток кеширования не должен заполнить его снова до конца нехватки памяти.
+			prefill_paused.store(true, std::memory_order_relaxed);
+
+			// Блокируем. Снятие блокировки будет заботить компилятор.
+			voltek::core::_internal::simple_scope_lock scope_lock(lock);
+
+			size_t released = 0;
+			if (pools[POOL_8]) released += ((pool8_t*)pools[POOL_8])->trim();
+			if (pools[POOL_16]) released += ((pool16_t*)pools[POOL_16])->trim();
+			if (pools[POOL_32]) released += ((pool32_t*)pools[POOL_32])->trim();
+			if (pools[POOL_64]) released += ((pool64_t*)pools[POOL_64])->trim();
+			if (pools[POOL_128]) released += ((pool128_t*)pools[POOL_128])->trim();
+			if (pools[POOL_256]) released += ((pool256_t*)pools[POOL_256])->trim();
+			if (pools[POOL_512]) released += ((pool512_t*)pools[POOL_512])->trim();
+			if (pools[POOL_1024]) released += ((pool1024_t*)pools[POOL_1024])->trim();
+			if (pools[POOL_4096]) released += ((pool4096_t*)pools[POOL_4096])->trim();
+			if (pools[POOL_8192]) released += ((pool8192_t*)pools[POOL_8192])->trim();
+			if (pools[POOL_16384]) released += ((pool16384_t*)pools[POOL_16384])->trim();
+			if (pools[POOL_32768]) released += ((pool32768_t*)pools[POOL_32768])->trim();
+			if (pools[POOL_65536]) released += ((pool65536_t*)pools[POOL_65536])->trim();
+			if (pools[POOL_131072]) released += ((pool131072_t*)pools[POOL_131072])->trim();
+
+			return released;
+		}
+
+		void memory_manager::resume_prefill()
+		{
+			prefill_paused.store(false, std::memory_order_relaxed);
+		}
+
 		void memory_manager::dump_map(size_t pool_id, const char* filename) const
 		{
 #ifndef VMMDLL_EXPORTS
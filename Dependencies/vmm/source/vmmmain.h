@@ -9,6 +9,7 @@
 #include "vsimplelock.h"
 #include <stddef.h>
 #include <thread>
+#include <atomic>
 
 namespace voltek
 {
@@ -55,6 +56,12 @@ namespace voltek
 			// Возвращает размер выделенной памяти под указатель.
 			// Вернёт 0, что значит ошибка.
 			size_t msize(const void* ptr) const;
+			// Возвращает в систему пустые страницы всех пулов, включая кэш свободных блоков.
+			// Вернёт кол-во освобождённых страниц.
+			// Поток кеширования приостанавливается, иначе он сразу займёт страницы снова.
+			size_t trim();
+			// Возобновляет заполнение кэша свободных блоков после trim().
+			void resume_prefill();
 			// Вывод дампа битовой карты указанного пула
 			void dump_map(size_t pool_id, const char* filename) const;
 			// Вывод дампа памяти указанного пула
@@ -78,6 +85,8 @@ namespace voltek
 			void* event_close_w;
 			// Поток для кеширования
 			std::thread* thread;
+			// Поток кеширования не заполняет кэш, пока установлен
+			std::atomic_bool prefill_paused{ false };
 		};
 
 		// Глобальный менеджер памяти, который требует инициализации.
@@ -268,6 +268,39 @@ namespace voltek
 
 				return false;
 			}
+			// Возвращает блоки из стека в страницы и освобождает страницы, которые стали пустыми.
+			// Возвращает кол-во освобождённых страниц.
+			size_t trim()
+			{
+				// Сначала вернуть все блоки, страницы удаляются только после этого,
+				// так как в стеке может быть много блоков одной и той же страницы.
+				while (!free_stack_blocks.empty())
+				{
+					auto& item = free_stack_blocks.top();
+					item.first->set_block_free(item.second);
+					set_page_free((size_t)item.first->get_user_data());
+					free_stack_blocks.pop();
+				}
+
+				size_t released = 0;
+				// Первая страница никогда не освобождается.
+				for (size_t index_page = 1; index_page < _count; index_page++)
+				{
+					auto page = _pages[index_page];
+					if (page && page->is_all_blocks_free())
+					{
+						if (_current == page)
+							_current = nullptr;
+
+						delete page;
+
+						_pages[index_page] = nullptr;
+						released++;
+					}
+				}
+
+				return released;
+			}
 		private:
 			// Конструктор копий - НЕДОСТУПЕН.
 			// Пул один и уникален.